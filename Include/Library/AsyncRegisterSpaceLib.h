@@ -0,0 +1,111 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _ASYNC_REGISTER_SPACE_LIB_H_
+#define _ASYNC_REGISTER_SPACE_LIB_H_
+
+#include <Base.h>
+#include <RegisterAccessInterface.h>
+
+#define ASYNC_REGISTER_SPACE_DEFAULT_QUEUE_DEPTH  256
+
+/**
+  Called on the device thread whenever the request queue is empty. Lets the
+  device model advance its internal state between driver accesses.
+
+  @param[in] Context  Context passed to AsyncRegisterSpaceCreate.
+**/
+typedef
+VOID
+(*ASYNC_REGISTER_SPACE_IDLE) (
+  IN VOID  *Context
+  );
+
+/**
+  Creates register space which runs Device on its own thread.
+
+  Driver accesses are passed to the device thread through a lock-free single
+  producer single consumer queue. Writes are posted and return as soon as they
+  are queued. Reads are queued behind the writes issued before them and block
+  until the device thread completes them. Block writes are split into
+  naturally aligned writes.
+
+  Register space is registered as a notifier of the caller's simulation
+  context, so driver waits in RegisterAccessIoLib virtual time block until the
+  device model calls AsyncRegisterSpaceNotify. Device thread selects the same
+  context, so device model callbacks see the driver's DMA mappings and virtual
+  time.
+
+  Register space supports a single producer. Accesses from multiple driver
+  threads have to be serialized, for example with RegisterAccessIoLib thread
+  safe mode.
+
+  @param[in]  RegisterSpaceDescription  Name of the register space.
+  @param[in]  Device                    Register space of the device model. Owned by the caller.
+  @param[in]  QueueDepth                Number of requests the queue can hold. Rounded up to power of 2.
+                                        0 selects ASYNC_REGISTER_SPACE_DEFAULT_QUEUE_DEPTH.
+  @param[in]  Idle                      Optional callback run on the device thread when queue is empty.
+  @param[in]  IdleContext               Context passed to Idle.
+  @param[out] RegisterSpace             Created register space.
+
+  @retval EFI_SUCCESS            Register space created and device thread started.
+  @retval EFI_INVALID_PARAMETER  Device or RegisterSpace is NULL.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory or start the thread.
+**/
+EFI_STATUS
+AsyncRegisterSpaceCreate (
+  IN CHAR16                      *RegisterSpaceDescription,
+  IN REGISTER_ACCESS_INTERFACE   *Device,
+  IN UINT32                      QueueDepth,
+  IN ASYNC_REGISTER_SPACE_IDLE   Idle OPTIONAL,
+  IN VOID                        *IdleContext OPTIONAL,
+  OUT REGISTER_ACCESS_INTERFACE  **RegisterSpace
+  );
+
+/**
+  Waits until the device thread completed all queued requests.
+
+  @param[in] RegisterSpace  Register space created with AsyncRegisterSpaceCreate.
+
+  @retval EFI_SUCCESS            All requests completed.
+  @retval EFI_DEVICE_ERROR       Device failed at least one posted write since the last sync.
+  @retval EFI_INVALID_PARAMETER  RegisterSpace is NULL.
+**/
+EFI_STATUS
+AsyncRegisterSpaceSync (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace
+  );
+
+/**
+  Wakes the driver waiting for the device. Called by the device model, usually
+  from the idle callback, when its state changes in the background.
+
+  @param[in] RegisterSpace  Register space created with AsyncRegisterSpaceCreate.
+
+  @retval EFI_SUCCESS            Driver notified.
+  @retval EFI_INVALID_PARAMETER  RegisterSpace is NULL.
+**/
+EFI_STATUS
+AsyncRegisterSpaceNotify (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace
+  );
+
+/**
+  Completes queued requests, stops the device thread and frees the register space.
+  Device register space passed at creation is not destroyed.
+
+  @param[in] RegisterSpace  Register space created with AsyncRegisterSpaceCreate.
+
+  @retval EFI_SUCCESS            Register space destroyed.
+  @retval EFI_INVALID_PARAMETER  RegisterSpace is NULL.
+**/
+EFI_STATUS
+AsyncRegisterSpaceDestroy (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace
+  );
+
+#endif
\ No newline at end of file
@@ -0,0 +1,242 @@
+/** @file
+  C++20 coroutine layer for writing device models on top of FakeRegisterSpaceLib.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __COROUTINE_DEVICE_LIB_HPP__
+#define __COROUTINE_DEVICE_LIB_HPP__
+
+#ifdef __cplusplus
+#include <coroutine>
+#include <vector>
+extern "C" {
+  #include <Uefi.h>
+  #include <Library/FakeRegisterSpaceLib.h>
+}
+
+//
+// Default DMA timing, 1 us setup and 1 byte per nanosecond.
+//
+#define COROUTINE_DEVICE_DMA_LATENCY                1000
+#define COROUTINE_DEVICE_DMA_BYTES_PER_MICROSECOND  1000
+
+class CoroutineDevice;
+
+//
+// Return type of device model coroutines. Task doesn't run until it is passed
+// to CoroutineDevice::Start or awaited from another task, so behaviors can be
+// split into smaller tasks, e.g. co_await Reset ().
+//
+class CoroutineDeviceTask {
+  public:
+  struct promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  //
+  // Resumes the awaiting task once this one finishes. Frame of a task started
+  // with CoroutineDevice::Start is freed by the device right here.
+  //
+  struct FinalAwaiter {
+    bool await_ready () noexcept { return false; }
+    std::coroutine_handle<> await_suspend (Handle Task) noexcept;
+    void await_resume () noexcept {}
+  };
+
+  struct promise_type {
+    std::coroutine_handle<>  Continuation;
+    CoroutineDevice          *Owner = nullptr;
+
+    CoroutineDeviceTask get_return_object () { return CoroutineDeviceTask (Handle::from_promise (*this)); }
+    std::suspend_always initial_suspend () noexcept { return {}; }
+    FinalAwaiter final_suspend () noexcept { return {}; }
+    void return_void () {}
+    void unhandled_exception ();
+  };
+
+  CoroutineDeviceTask (CoroutineDeviceTask &&Other) noexcept;
+  CoroutineDeviceTask (const CoroutineDeviceTask&) = delete;
+  CoroutineDeviceTask& operator= (const CoroutineDeviceTask&) = delete;
+  ~CoroutineDeviceTask ();
+
+  bool await_ready () noexcept { return false; }
+  std::coroutine_handle<> await_suspend (std::coroutine_handle<> Caller) noexcept;
+  void await_resume () noexcept {}
+
+  private:
+  explicit CoroutineDeviceTask (Handle Coroutine) : Coroutine (Coroutine) {}
+  Handle Release ();
+
+  friend class CoroutineDevice;
+  Handle  Coroutine;
+};
+
+//
+// Suspends the task until the driver writes the register. Resumes with the
+// register value after the write.
+//
+class CoroutineDeviceWrite {
+  public:
+  bool await_ready () noexcept { return false; }
+  void await_suspend (std::coroutine_handle<> Handle);
+  UINT32 await_resume () noexcept { return Value; }
+
+  private:
+  CoroutineDeviceWrite (CoroutineDevice *Device, UINT64 Address, UINT32 Mask, UINT32 Expected) :
+    Device (Device), Address (Address), Mask (Mask), Expected (Expected), Value (0) {}
+
+  friend class CoroutineDevice;
+  CoroutineDevice          *Device;
+  UINT64                   Address;
+  UINT32                   Mask;
+  UINT32                   Expected;
+  UINT32                   Value;
+  std::coroutine_handle<>  Handle;
+};
+
+//
+// Suspends the task for the given virtual time. Resumes with EFI_SUCCESS, or
+// right away with the error if the virtual time event can't be scheduled.
+//
+class CoroutineDeviceDelay {
+  public:
+  virtual ~CoroutineDeviceDelay () {}
+
+  bool await_ready () noexcept { return Nanoseconds == 0; }
+  bool await_suspend (std::coroutine_handle<> Handle);
+  EFI_STATUS await_resume () noexcept { return Status; }
+
+  protected:
+  CoroutineDeviceDelay (CoroutineDevice *Device, UINT64 Nanoseconds, EFI_STATUS Status = EFI_SUCCESS) :
+    Device (Device), Nanoseconds (Nanoseconds), EventId (0), Status (Status) {}
+
+  //
+  // Called when the time expires, before the task resumes.
+  //
+  virtual VOID Expire () {}
+
+  static VOID Expired (VOID *Context);
+
+  friend class CoroutineDevice;
+  CoroutineDevice          *Device;
+  UINT64                   Nanoseconds;
+  UINT64                   EventId;
+  EFI_STATUS               Status;
+  std::coroutine_handle<>  Handle;
+};
+
+//
+// Suspends the task until DMA transfer completes. Data is copied when the
+// transfer completes. Resumes with EFI_NOT_FOUND if the driver didn't map
+// the device address.
+//
+class CoroutineDeviceDma : public CoroutineDeviceDelay {
+  public:
+  bool await_ready () noexcept { return false; }
+
+  private:
+  CoroutineDeviceDma (CoroutineDevice *Device, UINT64 Nanoseconds, UINT32 DeviceAddress, VOID *Buffer, UINTN Length, BOOLEAN ToHost) :
+    CoroutineDeviceDelay (Device, Nanoseconds, EFI_NOT_READY), DeviceAddress (DeviceAddress), Buffer (Buffer), Length (Length), ToHost (ToHost) {}
+
+  VOID Expire () override;
+
+  friend class CoroutineDevice;
+  UINT32   DeviceAddress;
+  VOID     *Buffer;
+  UINTN    Length;
+  BOOLEAN  ToHost;
+};
+
+//
+// Device model with a DWORD register file served through FakeRegisterSpaceLib.
+// Driver reads return the register file. Driver writes update it and resume
+// the tasks waiting for them before the write returns to the driver.
+//
+// Tasks run inline on the thread which resumes them: the driver thread for
+// register writes, the thread advancing virtual time of the simulation
+// context for delays and DMA. No threads or context switches are involved.
+//
+class CoroutineDevice {
+  public:
+  CoroutineDevice () : RegisterSpace (NULL) {}
+  virtual ~CoroutineDevice () { Destroy (); }
+  CoroutineDevice (const CoroutineDevice&) = delete;
+  CoroutineDevice& operator= (const CoroutineDevice&) = delete;
+
+  /**
+    Creates register space of the device.
+
+    @param[in] Name  Name of the register space.
+    @param[in] Size  Size of the register file in bytes.
+
+    @retval EFI_SUCCESS            Register space created.
+    @retval EFI_INVALID_PARAMETER  Size is 0.
+    @retval EFI_ALREADY_STARTED    Device is already created.
+    @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+  **/
+  EFI_STATUS Create (CHAR16 *Name, UINT32 Size);
+
+  /**
+    Destroys tasks which are still running and the register space.
+  **/
+  VOID Destroy ();
+
+  REGISTER_ACCESS_INTERFACE* GetRegisterSpace () { return RegisterSpace; }
+
+  UINT32 GetRegister (UINT64 Address);
+  VOID SetRegister (UINT64 Address, UINT32 Value);
+
+  /**
+    Runs the task until it first suspends. Device owns the task from now on
+    and frees its frame as soon as it finishes.
+  **/
+  VOID Start (CoroutineDeviceTask &&Task);
+
+  //
+  // Awaitables. The task resumes inline when the condition is met.
+  //
+  CoroutineDeviceWrite WaitForWrite (UINT64 Address) { return CoroutineDeviceWrite (this, Address, 0, 0); }
+  CoroutineDeviceWrite WaitForWrite (UINT64 Address, UINT32 Mask, UINT32 Expected) { return CoroutineDeviceWrite (this, Address, Mask, Expected); }
+  CoroutineDeviceDelay Delay (UINT64 Nanoseconds) { return CoroutineDeviceDelay (this, Nanoseconds); }
+  CoroutineDeviceDma DmaRead (UINT32 DeviceAddress, VOID *Buffer, UINTN Length) { return CoroutineDeviceDma (this, GetDmaTime (Length), DeviceAddress, Buffer, Length, FALSE); }
+  CoroutineDeviceDma DmaWrite (UINT32 DeviceAddress, CONST VOID *Buffer, UINTN Length) { return CoroutineDeviceDma (this, GetDmaTime (Length), DeviceAddress, (VOID*) Buffer, Length, TRUE); }
+
+  /**
+    Sets time DMA transfers take. Transfer of Length bytes takes
+    Latency + Length * 1000 / BytesPerMicrosecond nanoseconds.
+  **/
+  VOID SetDmaTiming (UINT64 Latency, UINT64 BytesPerMicrosecond);
+
+  protected:
+  /**
+    Called for every driver write after the register file is updated and
+    before waiting tasks resume. Lets the model implement registers with
+    side effects that need no task, e.g. write 1 to clear.
+  **/
+  virtual VOID OnWrite (UINT64 Address, UINT32 ByteEnable, UINT32 Value) {}
+
+  private:
+  UINT64 GetDmaTime (UINTN Length);
+  VOID CompleteWrite (UINT64 Address);
+  VOID Finish (CoroutineDeviceTask::Handle Task);
+
+  static VOID Read (VOID *Context, UINT64 Address, UINT32 ByteEnable, UINT32 *Value);
+  static VOID Write (VOID *Context, UINT64 Address, UINT32 ByteEnable, UINT32 Value);
+
+  friend class CoroutineDeviceTask;
+  friend class CoroutineDeviceWrite;
+  friend class CoroutineDeviceDelay;
+  REGISTER_ACCESS_INTERFACE                 *RegisterSpace;
+  std::vector<UINT32>                       Registers;
+  std::vector<CoroutineDeviceTask::Handle>  Tasks;
+  std::vector<CoroutineDeviceWrite*>        WriteWaiters;
+  std::vector<CoroutineDeviceDelay*>        DelayWaiters;
+  UINT64                                    DmaLatency = COROUTINE_DEVICE_DMA_LATENCY;
+  UINT64                                    DmaBytesPerMicrosecond = COROUTINE_DEVICE_DMA_BYTES_PER_MICROSECOND;
+};
+
+#endif
+
+#endif
\ No newline at end of file
@@ -18,6 +18,26 @@ typedef enum {
   FakeRegisterSpaceAlignmentQword = 8
 } FAKE_REGISTER_SPACE_ALIGNMENT;
 
+typedef enum {
+  //
+  // Callbacks exceeding the budget are printed with DEBUG_WARN and counted.
+  //
+  FakeRegisterSpaceBudgetReport,
+  //
+  // Callbacks exceeding the budget are printed with DEBUG_ERROR, counted and
+  // the Read/Write/WriteBlock call which made them returns EFI_TIMEOUT.
+  //
+  FakeRegisterSpaceBudgetFail
+} FAKE_REGISTER_SPACE_BUDGET_ACTION;
+
+typedef struct {
+  UINT64   Address;
+  UINT32   ByteEnable;
+  UINT32   Value;
+  BOOLEAN  IsWrite;
+  UINT64   Nanoseconds;
+} FAKE_REGISTER_SPACE_BUDGET_VIOLATION;
+
 typedef struct _FAKE_REGISTER_SPACE FAKE_REGISTER_SPACE;
 
 typedef
@@ -44,6 +64,13 @@ struct _FAKE_REGISTER_SPACE {
   FAKE_REGISTER_SPACE_ALIGNMENT  Alignment;
   REGISTER_READ_CALLBACK          Read;
   REGISTER_WRITE_CALLBACK         Write;
+  //
+  // Time budget of a single Read/Write callback in nanoseconds. 0 if unlimited.
+  //
+  UINT64                          CallbackBudget;
+  FAKE_REGISTER_SPACE_BUDGET_ACTION  BudgetAction;
+  UINT64                          NoOfBudgetViolations;
+  FAKE_REGISTER_SPACE_BUDGET_VIOLATION  WorstBudgetViolation;
 };
 
 EFI_STATUS
@@ -61,6 +88,43 @@ FakeRegisterSpaceDestroy (
   IN REGISTER_ACCESS_INTERFACE  *RegisterSpace
   );
 
+/**
+  Sets time budget of a single Read/Write callback of the register space.
+
+  Budget is meant to catch device models which accidentally became slow
+  (e.g. callback scanning a growing list) and turned a short test into a long one.
+
+  @param[in] RegisterSpace  Register space created with FakeRegisterSpaceCreate.
+  @param[in] Nanoseconds    Budget of a single callback. 0 removes the budget.
+  @param[in] Action         What to do when a callback exceeds the budget.
+
+  @retval EFI_SUCCESS            Budget set.
+  @retval EFI_INVALID_PARAMETER  RegisterSpace is NULL.
+**/
+EFI_STATUS
+FakeRegisterSpaceSetCallbackBudget (
+  IN REGISTER_ACCESS_INTERFACE          *RegisterSpace,
+  IN UINT64                             Nanoseconds,
+  IN FAKE_REGISTER_SPACE_BUDGET_ACTION  Action
+  );
+
+/**
+  Returns callbacks of the register space which exceeded the budget.
+
+  @param[in]  RegisterSpace   Register space created with FakeRegisterSpaceCreate.
+  @param[out] NoOfViolations  Number of callbacks which exceeded the budget.
+  @param[out] Worst           Slowest of these callbacks. Optional.
+
+  @retval EFI_SUCCESS            Violations returned.
+  @retval EFI_INVALID_PARAMETER  RegisterSpace or NoOfViolations is NULL.
+**/
+EFI_STATUS
+FakeRegisterSpaceGetBudgetViolations (
+  IN  REGISTER_ACCESS_INTERFACE             *RegisterSpace,
+  OUT UINT64                                *NoOfViolations,
+  OUT FAKE_REGISTER_SPACE_BUDGET_VIOLATION  *Worst OPTIONAL
+  );
+
 UINT32
 ByteEnableToBitMask (
   IN UINT32  ByteEnable
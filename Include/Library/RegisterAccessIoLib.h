@@ -10,13 +10,132 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <Library/PcdLib.h>
 #include <Library/IoLib.h>
+#include <Library/SynchronizationLib.h>
 #include <RegisterAccessInterface.h>
+#include <RegisterAccessTrace.h>
+
+#define REGISTER_ACCESS_IO_WRITE_COMBINE_LINE_SIZE  64
+#define REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE_SIZE  64
+#define REGISTER_ACCESS_IO_SIM_TIME_DEFAULT_ACCESS_COST  100
+//
+// Interrupt queue size must be a power of 2.
+//
+#define REGISTER_ACCESS_IO_INTERRUPT_QUEUE_SIZE          256
+#define REGISTER_ACCESS_IO_INTERRUPT_VECTORS             256
 
 typedef enum {
   RegisterAccessIoTypeMmio = 0,
   RegisterAccessIoTypeIo
 } REGISTER_ACCESS_IO_MEMORY_TYPE;
 
+#define REGISTER_ACCESS_IO_MAX_DMA_MAPPINGS  5
+
+//
+// DMA mapping handed out by RegisterAccessPciIoLib.
+//
+typedef struct {
+  BOOLEAN  Used;
+  VOID     *HostAddress;
+  UINT32   DeviceAddress;
+} REGISTER_ACCESS_IO_DMA_MAPPING;
+
+//
+// State of a single simulated platform. Every thread works with the context it
+// selected, threads which didn't select any share the default context of the
+// process.
+//
+typedef struct {
+  //
+  // IO and MMIO region maps owned by RegisterAccessIoLib.
+  //
+  VOID                            *IoMap;
+  VOID                            *MemMap;
+  //
+  // DMA mappings owned by RegisterAccessPciIoLib.
+  //
+  REGISTER_ACCESS_IO_DMA_MAPPING  DmaMappings[REGISTER_ACCESS_IO_MAX_DMA_MAPPINGS];
+  SPIN_LOCK                       DmaMappingLock;
+  //
+  // IIoLib object registered with GmockIoLibSetMock.
+  //
+  VOID                            *IoLibMock;
+  //
+  // Virtual clock and event queue. Allocated on first use.
+  //
+  VOID                            *SimTime;
+  //
+  // Interrupt queue and handlers. Allocated on first use.
+  //
+  VOID                            *Interrupts;
+} REGISTER_ACCESS_IO_SIM_CONTEXT;
+
+/**
+  Creates an empty simulation context.
+
+  @param[out] Context  Created context.
+
+  @retval EFI_SUCCESS            Context created.
+  @retval EFI_INVALID_PARAMETER  Context is NULL.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoSimContextCreate (
+  OUT REGISTER_ACCESS_IO_SIM_CONTEXT  **Context
+  );
+
+/**
+  Unregisters all regions of the context and frees it. Context must not be
+  selected by any other thread. Register spaces of the regions are owned by
+  the caller and aren't destroyed.
+
+  @param[in] Context  Context created with RegisterAccessIoSimContextCreate.
+
+  @retval EFI_SUCCESS            Context destroyed.
+  @retval EFI_INVALID_PARAMETER  Context is NULL or the default context.
+**/
+EFI_STATUS
+RegisterAccessIoSimContextDestroy (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  );
+
+/**
+  Selects simulation context of the calling thread. All register accesses,
+  region registrations, DMA mappings and mocks of the thread use the selected
+  context. Writes buffered by the thread are completed first.
+
+  @param[in] Context  Context to select or NULL to select the default context.
+
+  @return Context selected before the call, NULL for the default context.
+**/
+REGISTER_ACCESS_IO_SIM_CONTEXT*
+RegisterAccessIoSimContextSelect (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context OPTIONAL
+  );
+
+/**
+  Returns simulation context selected by the calling thread.
+**/
+REGISTER_ACCESS_IO_SIM_CONTEXT*
+RegisterAccessIoSimContextGetCurrent (
+  VOID
+  );
+
+/**
+  Registers register space at Address in the calling thread's simulation context.
+
+  Every registration takes a new trace region id. Ids are never reused so that
+  trace records keep resolving to the region after it is unregistered, which
+  limits the process to MAX_UINT16 registrations.
+
+  @param[in] RegisterAccess  Register space handling accesses of the region.
+  @param[in] Type            Type of the region.
+  @param[in] Address         Base address of the region.
+  @param[in] Size            Size of the region in bytes.
+
+  @retval EFI_SUCCESS           Region registered.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory or trace region ids
+                                are exhausted.
+**/
 EFI_STATUS
 RegisterAccessIoRegisterMmioAtAddress (
   IN REGISTER_ACCESS_INTERFACE *RegisterAccess,
@@ -31,6 +150,1384 @@ RegisterAccessIoUnRegisterMmioAtAddress (
   IN UINT64               Address
   );
 
+/**
+  Returns trace region id of the region registered at Address in the calling
+  thread's simulation context.
+
+  @param[in]  Type         Type of the region.
+  @param[in]  Address      Any address within the region.
+  @param[out] TraceRegion  Trace region id of the region.
+
+  @retval EFI_SUCCESS            Region found.
+  @retval EFI_INVALID_PARAMETER  TraceRegion is NULL.
+  @retval EFI_NOT_FOUND          No region is registered at Address.
+**/
+EFI_STATUS
+RegisterAccessIoGetTraceRegion (
+  IN  REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN  UINT64                          Address,
+  OUT UINT16                          *TraceRegion
+  );
+
+/**
+  Enables or disables write combining for the region registered at Address.
+
+  Writes to a write combining region are buffered and forwarded to the register
+  space as a single block write once REGISTER_ACCESS_IO_WRITE_COMBINE_LINE_SIZE
+  line is complete, a non-contiguous write is issued, any region is read, other
+  region is accessed or RegisterAccessIoFlushWriteCombining is called.
+
+  @param[in] Type     Type of the region. Only MMIO regions can be write combined.
+  @param[in] Address  Any address within the region.
+  @param[in] Enable   TRUE to enable write combining, FALSE to flush and disable it.
+
+  @retval EFI_SUCCESS           Write combining state changed.
+  @retval EFI_UNSUPPORTED       Region type can't be write combined.
+  @retval EFI_NOT_FOUND         No region registered at Address.
+**/
+EFI_STATUS
+RegisterAccessIoSetWriteCombining (
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN BOOLEAN                         Enable
+  );
+
+/**
+  Forwards all buffered write combining data to the register spaces.
+
+  @retval EFI_SUCCESS  Buffered data forwarded or nothing was buffered.
+  @retval Others       Register space failed the write.
+**/
+EFI_STATUS
+RegisterAccessIoFlushWriteCombining (
+  VOID
+  );
+
+/**
+  Enables or disables posted writes for the region registered at Address.
+
+  Writes to a region in posted mode return immediately and are queued. Queued
+  writes are forwarded to the register spaces in the order they were issued
+  when a region of the same register space is read, when a write to a region
+  which is not in posted mode is issued, when the queue of
+  REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE_SIZE writes is full, on PciIo Flush,
+  on RegisterAccessIoFlushPostedWrites and on RegisterAccessIoMemoryFence.
+  Errors returned by the register space for posted writes are only logged.
+
+  @param[in] Type     Type of the region. IO writes are never posted.
+  @param[in] Address  Any address within the region.
+  @param[in] Enable   TRUE to post writes, FALSE to drain queued writes and disable posting.
+
+  @retval EFI_SUCCESS      Posted write state changed.
+  @retval EFI_UNSUPPORTED  Region type can't post writes.
+  @retval EFI_NOT_FOUND    No region registered at Address.
+**/
+EFI_STATUS
+RegisterAccessIoSetPostedWrites (
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN BOOLEAN                         Enable
+  );
+
+/**
+  Forwards all writes posted by the calling thread to the register spaces.
+**/
+VOID
+RegisterAccessIoFlushPostedWrites (
+  VOID
+  );
+
+/**
+  Completes all writes issued by the calling thread, both write combined and
+  posted. Tests which need MemoryFence semantics from driver code can route
+  the fence to this function.
+**/
+VOID
+RegisterAccessIoMemoryFence (
+  VOID
+  );
+
+extern BOOLEAN  gRegisterAccessIoThreadSafe;
+
+//
+// Takes the lock only when thread safe mode is enabled so single threaded
+// tests pay a single branch per access.
+//
+#define REGISTER_ACCESS_IO_LOCK(Lock) \
+  do { \
+    if (gRegisterAccessIoThreadSafe) { \
+      AcquireSpinLock (Lock); \
+    } \
+  } while (FALSE)
+
+#define REGISTER_ACCESS_IO_UNLOCK(Lock) \
+  do { \
+    if (gRegisterAccessIoThreadSafe) { \
+      ReleaseSpinLock (Lock); \
+    } \
+  } while (FALSE)
+
+/**
+  Enables or disables thread safe mode.
+
+  In thread safe mode accesses to the same region are serialized with a lock
+  owned by the region so register space callbacks of a device never run
+  concurrently. Accesses to different regions proceed in parallel. Write
+  combining buffers and posted write queues are kept per thread, same as per
+  CPU buffers in hardware. Disabling write combining or posted writes of a
+  region, or unregistering it, forwards the data every thread buffered for it.
+
+  Mode must be set before threads accessing registers are started. Regions
+  must be registered and unregistered while no other thread accesses them.
+
+  @param[in] Enable  TRUE to serialize accesses per region.
+**/
+VOID
+RegisterAccessIoSetThreadSafe (
+  IN BOOLEAN  Enable
+  );
+
+extern BOOLEAN  gRegisterAccessIoTraceEnabled;
+
+//
+// Records a trace entry. Costs a single branch when tracing is disabled.
+//
+#define REGISTER_ACCESS_IO_TRACE(Type, Region, Address, Width, Value, Duration) \
+  do { \
+    if (gRegisterAccessIoTraceEnabled) { \
+      RegisterAccessIoTraceRecord ((Type), (Region), (Address), (Width), (Value), (Duration)); \
+    } \
+  } while (FALSE)
+
+/**
+  Enables or disables recording of register accesses.
+
+  Every thread records into its own ring buffer of PcdRegisterAccessTraceBufferSize
+  records. Once the buffer is full the oldest records are overwritten.
+
+  @param[in] Enable  TRUE to start recording, FALSE to stop it.
+**/
+VOID
+RegisterAccessIoTraceEnable (
+  IN BOOLEAN  Enable
+  );
+
+/**
+  Drops all recorded entries and restarts the access count. Buffers of the
+  threads are kept and reused. Can be called while other threads record,
+  records they take during the call may or may not be dropped.
+**/
+VOID
+RegisterAccessIoTraceReset (
+  VOID
+  );
+
+typedef enum {
+  //
+  // Every access is recorded.
+  //
+  RegisterAccessIoTraceSampleAll = 0,
+  //
+  // Every Period-th access of a thread is recorded.
+  //
+  RegisterAccessIoTraceSampleEveryNth,
+  //
+  // First access of a thread after Period timestamp ticks elapsed since its
+  // last recorded access is recorded.
+  //
+  RegisterAccessIoTraceSampleInterval
+} REGISTER_ACCESS_IO_TRACE_SAMPLING;
+
+/**
+  Selects which accesses are recorded while tracing is enabled.
+
+  Sampling is decided with per-thread counters so it doesn't take any locks.
+  Counters of all threads are restarted so the first access of every thread
+  after the call is recorded. Must not be called while other threads record.
+
+  @param[in] Sampling  Sampling mode.
+  @param[in] Period    Number of accesses for RegisterAccessIoTraceSampleEveryNth,
+                       number of timestamp ticks for RegisterAccessIoTraceSampleInterval.
+                       Ignored for RegisterAccessIoTraceSampleAll.
+
+  @retval EFI_SUCCESS            Sampling mode set.
+  @retval EFI_INVALID_PARAMETER  Sampling is not valid or Period is 0.
+**/
+EFI_STATUS
+RegisterAccessIoTraceSetSampling (
+  IN REGISTER_ACCESS_IO_TRACE_SAMPLING  Sampling,
+  IN UINT64                             Period
+  );
+
+typedef enum {
+  RegisterAccessIoTraceFilterRecord = 0,
+  RegisterAccessIoTraceFilterDrop
+} REGISTER_ACCESS_IO_TRACE_FILTER_ACTION;
+
+typedef struct {
+  //
+  // Action taken for accesses matching all conditions below.
+  //
+  REGISTER_ACCESS_IO_TRACE_FILTER_ACTION  Action;
+  //
+  // Name of the region. Trailing '*' matches any suffix. NULL matches every region.
+  //
+  CONST CHAR8                             *RegionName;
+  //
+  // Mask of access types, bit n set matches REGISTER_ACCESS_TRACE_TYPE n. 0 matches every type.
+  //
+  UINT32                                  Types;
+  //
+  // TRUE matches only accesses with the address as stored in the record
+  // within the inclusive range AddressMin..AddressMax. FALSE matches every address.
+  //
+  BOOLEAN                                 MatchAddress;
+  UINT64                                  AddressMin;
+  UINT64                                  AddressMax;
+  //
+  // Access matches if (Value & ValueMask) == ValueMatch. ValueMask 0 matches every value.
+  //
+  UINT64                                  ValueMask;
+  UINT64                                  ValueMatch;
+} REGISTER_ACCESS_IO_TRACE_FILTER;
+
+/**
+  Sets filters selecting which accesses are recorded while tracing is enabled.
+
+  Filters are evaluated in order and the first matching one decides whether
+  the access is recorded. Accesses matched by no filter are recorded only if
+  none of the filters records. Filters are compiled into a decision table
+  indexed by region and access type so accesses are filtered before they are
+  counted for sampling. Must not be called while other threads record.
+
+  @param[in] Filters      Filters. Copied by the function. NULL removes filtering.
+  @param[in] FilterCount  Number of filters.
+
+  @retval EFI_SUCCESS            Filters set.
+  @retval EFI_INVALID_PARAMETER  One of the filters is malformed.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory. Filtering is removed.
+**/
+EFI_STATUS
+RegisterAccessIoTraceSetFilters (
+  IN CONST REGISTER_ACCESS_IO_TRACE_FILTER  *Filters OPTIONAL,
+  IN UINTN                                  FilterCount
+  );
+
+/**
+  Returns number of accesses seen by the recorder since the last
+  RegisterAccessIoTraceReset, including the ones dropped by sampling. Can be
+  used to scale counts taken from a sampled trace. Accesses dropped by
+  filters are not counted.
+**/
+UINT64
+RegisterAccessIoTraceGetAccessCount (
+  VOID
+  );
+
+/**
+  Adds region to the trace region table.
+
+  Regions registered with RegisterAccessIoRegisterMmioAtAddress are added
+  automatically. Can be called while other threads record or read the table.
+
+  @param[in] Name  Name of the region.
+  @param[in] Type  Type of the region.
+  @param[in] Base  Base address of the region.
+  @param[in] Size  Size of the region.
+
+  @return Id of the region to be used in trace records. REGISTER_ACCESS_TRACE_REGION_UNMAPPED
+          with a warning if the table is full or memory couldn't be allocated.
+**/
+UINT16
+RegisterAccessIoTraceRegisterRegion (
+  IN CONST CHAR16                       *Name,
+  IN REGISTER_ACCESS_TRACE_REGION_TYPE  Type,
+  IN UINT64                             Base,
+  IN UINT64                             Size
+  );
+
+/**
+  Returns trace region table indexed by region id. Entries below RegionCount
+  stay valid when regions are added later.
+
+  @param[out] RegionCount  Number of entries in the table.
+
+  @return Region table.
+**/
+CONST REGISTER_ACCESS_TRACE_REGION*
+RegisterAccessIoTraceGetRegions (
+  OUT UINT32  *RegionCount
+  );
+
+/**
+  Returns current value of the trace timestamp counter.
+**/
+UINT64
+RegisterAccessIoTraceGetTimestamp (
+  VOID
+  );
+
+/**
+  Estimates frequency of the trace timestamp counter from the wall clock time
+  elapsed since tracing was enabled.
+
+  @return Ticks per second or 0 if unknown.
+**/
+UINT64
+RegisterAccessIoTraceGetTicksPerSecond (
+  VOID
+  );
+
+/**
+  Appends record to the ring buffer of the calling thread. Use REGISTER_ACCESS_IO_TRACE
+  instead of calling it directly.
+
+  @param[in] Type      Type of the operation.
+  @param[in] Region    Region id returned by RegisterAccessIoTraceRegisterRegion.
+  @param[in] Address   Address of the operation.
+  @param[in] Width     Width of the operation in bytes.
+  @param[in] Value     Value read or written.
+  @param[in] Duration  Ticks the operation took. Record is timestamped with the start of the operation.
+**/
+VOID
+RegisterAccessIoTraceRecord (
+  IN REGISTER_ACCESS_TRACE_TYPE  Type,
+  IN UINT16                      Region,
+  IN UINT64                      Address,
+  IN UINT8                       Width,
+  IN UINT64                      Value,
+  IN UINT32                      Duration
+  );
+
+/**
+  Collects records of all threads into a single array ordered by timestamp.
+  Can be called while other threads record, records they overwrite while
+  their buffer is copied are left out.
+
+  @param[out] Records      Records. Caller frees it with FreePool.
+  @param[out] RecordCount  Number of records.
+
+  @retval EFI_SUCCESS           Records collected.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoTraceGetRecords (
+  OUT REGISTER_ACCESS_TRACE_RECORD  **Records,
+  OUT UINTN                         *RecordCount
+  );
+
+/**
+  Saves recorded trace to a file. File layout is described in RegisterAccessTrace.h.
+
+  @param[in] FileName  Path of the file.
+
+  @retval EFI_SUCCESS           Trace saved.
+  @retval EFI_DEVICE_ERROR      Failed to write the file.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoTraceSave (
+  IN CONST CHAR8  *FileName
+  );
+
+/**
+  Saves recorded trace to a file in the compact format. See RegisterAccessTraceFileLib.
+
+  @param[in] FileName  Path of the file.
+
+  @retval EFI_SUCCESS            Trace saved.
+  @retval EFI_INVALID_PARAMETER  FileName is NULL.
+  @retval EFI_DEVICE_ERROR       Failed to write the file.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoTraceSaveCompact (
+  IN CONST CHAR8  *FileName
+  );
+
+/**
+  Saves recorded trace to a file in Chrome trace event (JSON) format which can be
+  opened in chrome://tracing or Perfetto UI.
+
+  Every region is shown as a separate track. Operations with duration, such as
+  polls and register space callbacks, are complete events, the rest are instant
+  events.
+
+  @param[in] FileName  Path of the file.
+
+  @retval EFI_SUCCESS           Trace saved.
+  @retval EFI_INVALID_PARAMETER FileName is NULL.
+  @retval EFI_DEVICE_ERROR      Failed to write the file.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoTraceSaveChromeTrace (
+  IN CONST CHAR8  *FileName
+  );
+
+/**
+  Converts trace saved with RegisterAccessIoTraceSave or RegisterAccessIoTraceSaveCompact
+  to Chrome trace event (JSON) format.
+  See RegisterAccessIoTraceSaveChromeTrace.
+
+  @param[in] TraceFileName  Path of the trace file.
+  @param[in] JsonFileName   Path of the JSON file to create.
+
+  @retval EFI_SUCCESS           Trace converted.
+  @retval EFI_INVALID_PARAMETER One of the parameters is NULL.
+  @retval EFI_NOT_FOUND         Failed to open the trace file.
+  @retval EFI_VOLUME_CORRUPTED  Trace file is malformed.
+  @retval EFI_DEVICE_ERROR      Failed to write the file.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoTraceConvertToChromeTrace (
+  IN CONST CHAR8  *TraceFileName,
+  IN CONST CHAR8  *JsonFileName
+  );
+
+typedef struct {
+  UINT16  Region;
+  //
+  // Offset within the region. Absolute address for the unmapped region.
+  //
+  UINT64  Offset;
+  UINT64  Reads;
+  UINT64  Writes;
+  //
+  // Bit N set if an access of (1 << N) bytes was seen.
+  //
+  UINT8   ReadWidths;
+  UINT8   WriteWidths;
+} REGISTER_ACCESS_IO_HOT_ACCESS;
+
+/**
+  Enables or disables per-register access counting.
+
+  Every thread counts into its own table so counting doesn't take any locks.
+
+  @param[in] Enable  TRUE to start counting, FALSE to stop it.
+**/
+VOID
+RegisterAccessIoHotAccessEnable (
+  IN BOOLEAN  Enable
+  );
+
+/**
+  Drops all counters. Must not be called while other threads access registers.
+**/
+VOID
+RegisterAccessIoHotAccessReset (
+  VOID
+  );
+
+/**
+  Returns registers with the highest number of accesses summed over all threads.
+
+  @param[out]    Entries     Buffer for the entries sorted from the hottest register.
+  @param[in,out] NoOfEntries On input size of Entries. On output number of entries returned.
+
+  @retval EFI_SUCCESS           Entries returned.
+  @retval EFI_INVALID_PARAMETER Entries or NoOfEntries is NULL.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoHotAccessGetTop (
+  OUT    REGISTER_ACCESS_IO_HOT_ACCESS  *Entries,
+  IN OUT UINTN                          *NoOfEntries
+  );
+
+/**
+  Prints the hottest registers with region names and access widths.
+  Intended to be called from test cleanup.
+
+  @param[in] Count  Number of registers to print.
+**/
+VOID
+RegisterAccessIoHotAccessDump (
+  IN UINTN  Count
+  );
+
+//
+// Latency of register space accesses in timestamp counter ticks.
+// Percentiles are accurate to 1/16 of the value.
+//
+typedef struct {
+  UINT64  Count;
+  UINT64  Min;
+  UINT64  P50;
+  UINT64  P99;
+  UINT64  Max;
+} REGISTER_ACCESS_IO_LATENCY_STATS;
+
+/**
+  Enables or disables timing of register space Read/Write calls made by the library.
+
+  Every thread collects its own histograms so timing doesn't take any locks.
+
+  @param[in] Enable  TRUE to start timing, FALSE to stop it.
+**/
+VOID
+RegisterAccessIoLatencyEnable (
+  IN BOOLEAN  Enable
+  );
+
+/**
+  Drops all collected samples. Must not be called while other threads access registers.
+**/
+VOID
+RegisterAccessIoLatencyReset (
+  VOID
+  );
+
+/**
+  Returns latency statistics of the region summed over all threads.
+
+  @param[in]  Region  Region id. See RegisterAccessIoTraceGetRegions.
+  @param[out] Stats   Statistics of the region.
+
+  @retval EFI_SUCCESS           Statistics returned.
+  @retval EFI_INVALID_PARAMETER Stats is NULL.
+  @retval EFI_NOT_FOUND         No samples were collected for the region.
+**/
+EFI_STATUS
+RegisterAccessIoLatencyGetStats (
+  IN  UINT16                            Region,
+  OUT REGISTER_ACCESS_IO_LATENCY_STATS  *Stats
+  );
+
+/**
+  Prints latency statistics of every region with at least one sample.
+**/
+VOID
+RegisterAccessIoLatencyDump (
+  VOID
+  );
+
+typedef struct {
+  //
+  // Return address of the outermost IoLib or PciIo call made by the driver.
+  //
+  UINT64  CallSite;
+  UINT16  Region;
+  //
+  // Offset within the region. Absolute address for the unmapped region.
+  //
+  UINT64  Offset;
+  UINT64  Reads;
+  UINT64  Writes;
+} REGISTER_ACCESS_IO_CALL_SITE;
+
+extern BOOLEAN  gRegisterAccessIoCallSiteEnabled;
+
+#if defined (_MSC_VER)
+VOID *
+_ReturnAddress (
+  VOID
+  );
+
+#pragma intrinsic (_ReturnAddress)
+#define REGISTER_ACCESS_IO_RETURN_ADDRESS()  _ReturnAddress ()
+#else
+#define REGISTER_ACCESS_IO_RETURN_ADDRESS()  __builtin_return_address (0)
+#endif
+
+//
+// Marks the entry of a library function which accesses registers through other
+// IoLib functions so that the accesses are attributed to the caller of the
+// outermost such function. Every ENTER must be paired with EXIT on all return
+// paths. Costs a single branch when call site counting is disabled.
+//
+#define REGISTER_ACCESS_IO_CALL_SITE_ENTER(Owner) \
+  (Owner) = (gRegisterAccessIoCallSiteEnabled && RegisterAccessIoCallSiteEnter (REGISTER_ACCESS_IO_RETURN_ADDRESS ()))
+
+#define REGISTER_ACCESS_IO_CALL_SITE_EXIT(Owner) \
+  do { \
+    if (Owner) { \
+      RegisterAccessIoCallSiteExit (); \
+    } \
+  } while (FALSE)
+
+/**
+  Sets the call site of the calling thread unless one is set already.
+  Use REGISTER_ACCESS_IO_CALL_SITE_ENTER instead of calling it directly.
+
+  @param[in] CallSite  Return address of the library function.
+
+  @retval TRUE   Call site set, RegisterAccessIoCallSiteExit must be called.
+  @retval FALSE  Thread is already within a library function.
+**/
+BOOLEAN
+RegisterAccessIoCallSiteEnter (
+  IN VOID  *CallSite
+  );
+
+/**
+  Clears the call site of the calling thread.
+**/
+VOID
+RegisterAccessIoCallSiteExit (
+  VOID
+  );
+
+/**
+  Enables or disables counting of register accesses per driver call site.
+
+  Every thread counts into its own table so counting doesn't take any locks.
+
+  @param[in] Enable  TRUE to start counting, FALSE to stop it.
+**/
+VOID
+RegisterAccessIoCallSiteEnable (
+  IN BOOLEAN  Enable
+  );
+
+/**
+  Drops all counters. Must not be called while other threads access registers.
+**/
+VOID
+RegisterAccessIoCallSiteReset (
+  VOID
+  );
+
+/**
+  Returns call site and register pairs with the highest number of accesses
+  summed over all threads.
+
+  @param[out]    Entries     Buffer for the entries sorted from the most frequent.
+  @param[in,out] NoOfEntries On input size of Entries. On output number of entries returned.
+
+  @retval EFI_SUCCESS           Entries returned.
+  @retval EFI_INVALID_PARAMETER Entries or NoOfEntries is NULL.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoCallSiteGetTop (
+  OUT    REGISTER_ACCESS_IO_CALL_SITE  *Entries,
+  IN OUT UINTN                         *NoOfEntries
+  );
+
+/**
+  Prints the most frequent call sites as module and offset within the module.
+
+  @param[in] Count  Number of entries to print.
+**/
+VOID
+RegisterAccessIoCallSiteDump (
+  IN UINTN  Count
+  );
+
+/**
+  Saves all call site counters to a tab separated text file for offline
+  symbolization. Every line holds module path, offset of the call site within
+  the module, absolute call site address, region name, register offset, reads
+  and writes.
+
+  @param[in] FileName  Path of the file.
+
+  @retval EFI_SUCCESS           Counters saved.
+  @retval EFI_INVALID_PARAMETER FileName is NULL.
+  @retval EFI_DEVICE_ERROR      Failed to write the file.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoCallSiteSave (
+  IN CONST CHAR8  *FileName
+  );
+
+typedef struct {
+  UINT64  Reads;
+  UINT64  Writes;
+  UINT64  ReadBytes;
+  UINT64  WriteBytes;
+  //
+  // Accesses whose offset is not a multiple of their size. Counted for every
+  // such access, including the ones the register space handles in a single
+  // callback. FakeRegisterSpaceLib only splits the ones crossing its
+  // alignment unit.
+  //
+  UINT64  Misaligned;
+  //
+  // Writes to the register the same thread read last.
+  //
+  UINT64  ReadModifyWrites;
+  //
+  // Accesses to addresses not mapped to any register space (counted for the
+  // unmapped region) and failed DMA mappings (counted for PCI functions).
+  //
+  UINT64  MapMisses;
+} REGISTER_ACCESS_IO_STATS;
+
+extern BOOLEAN  gRegisterAccessIoStatsEnabled;
+
+//
+// Counts register access. Costs a single branch when statistics are disabled.
+//
+#define REGISTER_ACCESS_IO_STATS_COUNT(Region, Offset, Size, IsWrite) \
+  do { \
+    if (gRegisterAccessIoStatsEnabled) { \
+      RegisterAccessIoStatsCount ((Region), (Offset), (Size), (IsWrite)); \
+    } \
+  } while (FALSE)
+
+#define REGISTER_ACCESS_IO_STATS_MAP_MISS(Region) \
+  do { \
+    if (gRegisterAccessIoStatsEnabled) { \
+      RegisterAccessIoStatsCountMapMiss (Region); \
+    } \
+  } while (FALSE)
+
+/**
+  Enables or disables collection of per-region statistics.
+
+  Every thread counts into its own shard so counting never contends.
+
+  @param[in] Enable  TRUE to start counting, FALSE to stop it.
+**/
+VOID
+RegisterAccessIoStatsEnable (
+  IN BOOLEAN  Enable
+  );
+
+/**
+  Clears statistics of all threads. Must not be called while other threads count.
+**/
+VOID
+RegisterAccessIoStatsReset (
+  VOID
+  );
+
+/**
+  Counts access in the shard of the calling thread. Use REGISTER_ACCESS_IO_STATS_COUNT
+  instead of calling it directly.
+
+  @param[in] Region   Region id. See RegisterAccessIoTraceGetRegions.
+  @param[in] Offset   Offset of the access within the region.
+  @param[in] Size     Size of the access in bytes.
+  @param[in] IsWrite  TRUE for write access.
+**/
+VOID
+RegisterAccessIoStatsCount (
+  IN UINT16   Region,
+  IN UINT64   Offset,
+  IN UINT32   Size,
+  IN BOOLEAN  IsWrite
+  );
+
+/**
+  Counts map miss in the shard of the calling thread. Use REGISTER_ACCESS_IO_STATS_MAP_MISS
+  instead of calling it directly.
+
+  @param[in] Region  Region id. See RegisterAccessIoTraceGetRegions.
+**/
+VOID
+RegisterAccessIoStatsCountMapMiss (
+  IN UINT16  Region
+  );
+
+/**
+  Returns statistics of the region summed over all threads. Can be called
+  while other threads count.
+
+  @param[in]  Region  Region id. See RegisterAccessIoTraceGetRegions.
+  @param[out] Stats   Statistics of the region.
+
+  @retval EFI_SUCCESS            Statistics returned.
+  @retval EFI_INVALID_PARAMETER  Stats is NULL.
+  @retval EFI_NOT_FOUND          Region doesn't exist.
+**/
+EFI_STATUS
+RegisterAccessIoStatsGet (
+  IN  UINT16                    Region,
+  OUT REGISTER_ACCESS_IO_STATS  *Stats
+  );
+
+/**
+  Prints statistics of every region with accesses with DEBUG_INFO level.
+**/
+VOID
+RegisterAccessIoStatsDump (
+  VOID
+  );
+
+/**
+  Saves statistics of every region into a tab separated file.
+
+  @param[in] FileName  Path of the file.
+
+  @retval EFI_SUCCESS            Statistics saved.
+  @retval EFI_INVALID_PARAMETER  FileName is NULL.
+  @retval EFI_DEVICE_ERROR       Failed to write the file.
+**/
+EFI_STATUS
+RegisterAccessIoStatsSave (
+  IN CONST CHAR8  *FileName
+  );
+
+/**
+  Saves statistics with RegisterAccessIoStatsSave when the process exits.
+
+  @param[in] FileName  Path of the file. NULL cancels the save.
+
+  @retval EFI_SUCCESS            Save scheduled or cancelled.
+  @retval EFI_INVALID_PARAMETER  FileName is too long.
+  @retval EFI_OUT_OF_RESOURCES   Failed to register the exit handler.
+**/
+EFI_STATUS
+RegisterAccessIoStatsSaveAtExit (
+  IN CONST CHAR8  *FileName OPTIONAL
+  );
+
+typedef struct {
+  CHAR8   Name[REGISTER_ACCESS_TRACE_REGION_NAME_LENGTH];
+  UINT8   Type;
+  //
+  // Registers are counted as DWORDs of the region.
+  //
+  UINT64  Registers;
+  UINT64  Read;
+  UINT64  Written;
+  //
+  // Registers read or written at least once.
+  //
+  UINT64  Accessed;
+} REGISTER_ACCESS_IO_COVERAGE_SUMMARY;
+
+extern BOOLEAN  gRegisterAccessIoCoverageEnabled;
+
+//
+// Marks register as covered. Costs a single branch when coverage is disabled.
+//
+#define REGISTER_ACCESS_IO_COVERAGE(Region, Offset, Size, IsWrite) \
+  do { \
+    if (gRegisterAccessIoCoverageEnabled) { \
+      RegisterAccessIoCoverageMark ((Region), (Offset), (Size), (IsWrite)); \
+    } \
+  } while (FALSE)
+
+/**
+  Enables or disables collection of register coverage.
+
+  @param[in] Enable  TRUE to start collecting, FALSE to stop it.
+**/
+VOID
+RegisterAccessIoCoverageEnable (
+  IN BOOLEAN  Enable
+  );
+
+/**
+  Clears coverage of all regions. Must not be called while other threads access registers.
+**/
+VOID
+RegisterAccessIoCoverageReset (
+  VOID
+  );
+
+/**
+  Sets read or write bit of every DWORD touched by the access. Use
+  REGISTER_ACCESS_IO_COVERAGE instead of calling it directly.
+
+  @param[in] Region   Region id. See RegisterAccessIoTraceGetRegions.
+  @param[in] Offset   Offset of the access within the region.
+  @param[in] Size     Size of the access in bytes.
+  @param[in] IsWrite  TRUE for write access.
+**/
+VOID
+RegisterAccessIoCoverageMark (
+  IN UINT16   Region,
+  IN UINT64   Offset,
+  IN UINT32   Size,
+  IN BOOLEAN  IsWrite
+  );
+
+/**
+  Returns coverage of the region collected in this process.
+
+  @param[in]  Region   Region id. See RegisterAccessIoTraceGetRegions.
+  @param[out] Summary  Coverage of the region.
+
+  @retval EFI_SUCCESS            Coverage returned.
+  @retval EFI_INVALID_PARAMETER  Summary is NULL.
+  @retval EFI_NOT_FOUND          Region doesn't exist.
+**/
+EFI_STATUS
+RegisterAccessIoCoverageGet (
+  IN  UINT16                               Region,
+  OUT REGISTER_ACCESS_IO_COVERAGE_SUMMARY  *Summary
+  );
+
+/**
+  Saves coverage collected in this process into a file. Regions with the same
+  name and type are saved as a single device so coverage of a device
+  registered by every test case is combined.
+
+  @param[in] FileName  Path of the file.
+
+  @retval EFI_SUCCESS            Coverage saved.
+  @retval EFI_INVALID_PARAMETER  FileName is NULL.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+  @retval EFI_DEVICE_ERROR       Failed to write the file.
+**/
+EFI_STATUS
+RegisterAccessIoCoverageSave (
+  IN CONST CHAR8  *FileName
+  );
+
+/**
+  Merges coverage files saved by different test binaries into one file.
+  Devices are matched by name and type.
+
+  @param[in] InputFiles      Paths of the files to merge.
+  @param[in] NoOfInputFiles  Number of files in InputFiles.
+  @param[in] OutputFile      Path of the merged file. Can be one of the input files.
+
+  @retval EFI_SUCCESS            Files merged.
+  @retval EFI_INVALID_PARAMETER  InputFiles or OutputFile is NULL.
+  @retval EFI_NOT_FOUND          Input file doesn't exist.
+  @retval EFI_VOLUME_CORRUPTED   Input file is not a coverage file.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+  @retval EFI_DEVICE_ERROR       Failed to write the output file.
+**/
+EFI_STATUS
+RegisterAccessIoCoverageMerge (
+  IN CONST CHAR8 *CONST  *InputFiles,
+  IN UINTN               NoOfInputFiles,
+  IN CONST CHAR8         *OutputFile
+  );
+
+/**
+  Prints per-device summary of the coverage file with DEBUG_INFO level.
+
+  @param[in]     FileName       Path of the coverage file.
+  @param[out]    Summaries      Buffer for summaries in the order of the file. Optional.
+  @param[in,out] NoOfSummaries  On input size of Summaries. On output number of
+                                summaries returned. Required if Summaries is not NULL.
+
+  @retval EFI_SUCCESS            Summary printed.
+  @retval EFI_INVALID_PARAMETER  FileName is NULL or Summaries is given without NoOfSummaries.
+  @retval EFI_NOT_FOUND          File doesn't exist.
+  @retval EFI_VOLUME_CORRUPTED   File is not a coverage file.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoCoverageReport (
+  IN     CONST CHAR8                          *FileName,
+  OUT    REGISTER_ACCESS_IO_COVERAGE_SUMMARY  *Summaries OPTIONAL,
+  IN OUT UINTN                                *NoOfSummaries OPTIONAL
+  );
+
+#define REGISTER_ACCESS_IO_MAX_WATCHPOINTS  32
+
+#define REGISTER_ACCESS_IO_WATCH_READ   BIT0
+#define REGISTER_ACCESS_IO_WATCH_WRITE  BIT1
+
+/**
+  Called when an access matches a watchpoint. Read is reported after the value
+  was read as the value isn't known earlier. Write is reported before the value
+  is written so that the callback sees the device state the write changes.
+  Register accesses done by the callback don't trigger watchpoints.
+
+  @param[in] Context  Context of the watchpoint.
+  @param[in] Id       Id of the watchpoint.
+  @param[in] Type     Address space of the access.
+  @param[in] Address  Address of the access.
+  @param[in] Size     Size of the access in bytes.
+  @param[in] Value    Value read or about to be written.
+  @param[in] IsWrite  TRUE for write access.
+**/
+typedef
+VOID
+(*REGISTER_ACCESS_IO_WATCHPOINT_CALLBACK) (
+  IN VOID                            *Context,
+  IN UINTN                           Id,
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN UINT32                          Size,
+  IN UINT64                          Value,
+  IN BOOLEAN                         IsWrite
+  );
+
+typedef struct {
+  REGISTER_ACCESS_IO_MEMORY_TYPE          Type;
+  //
+  // Inclusive range of watched addresses. Access matches if any of its bytes
+  // is in the range.
+  //
+  UINT64                                  AddressMin;
+  UINT64                                  AddressMax;
+  //
+  // REGISTER_ACCESS_IO_WATCH_READ and/or REGISTER_ACCESS_IO_WATCH_WRITE.
+  //
+  UINT32                                  Access;
+  //
+  // Access matches if (Value & ValueMask) == ValueMatch. Both 0 match any value.
+  //
+  UINT64                                  ValueMask;
+  UINT64                                  ValueMatch;
+  //
+  // Callback to call on match. NULL breaks into the debugger with CpuBreakpoint.
+  //
+  REGISTER_ACCESS_IO_WATCHPOINT_CALLBACK  Callback;
+  VOID                                    *Context;
+} REGISTER_ACCESS_IO_WATCHPOINT;
+
+/**
+  Arms watchpoint. Can be called while other threads access registers.
+
+  Watchpoints can be left armed in big test suites: access to an address
+  far from every watchpoint costs a single bit test.
+
+  @param[in]  Watchpoint  Watchpoint to arm. Copied by the library.
+  @param[out] Id          Id of the watchpoint.
+
+  @retval EFI_SUCCESS            Watchpoint armed.
+  @retval EFI_INVALID_PARAMETER  Watchpoint or Id is NULL or the watchpoint is malformed.
+  @retval EFI_OUT_OF_RESOURCES   REGISTER_ACCESS_IO_MAX_WATCHPOINTS are already armed
+                                 or failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoWatchpointAdd (
+  IN  CONST REGISTER_ACCESS_IO_WATCHPOINT  *Watchpoint,
+  OUT UINTN                                *Id
+  );
+
+/**
+  Removes watchpoint. Can be called while other threads access registers.
+
+  @param[in] Id  Id returned by RegisterAccessIoWatchpointAdd.
+
+  @retval EFI_SUCCESS           Watchpoint removed.
+  @retval EFI_NOT_FOUND         Watchpoint doesn't exist.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoWatchpointRemove (
+  IN UINTN  Id
+  );
+
+/**
+  Removes all watchpoints. Can be called while other threads access registers.
+**/
+VOID
+RegisterAccessIoWatchpointRemoveAll (
+  VOID
+  );
+
+/**
+  Called when virtual time reaches the time the event was scheduled for.
+  Time returned by RegisterAccessIoSimTimeGetNow is the time of the event.
+
+  @param[in] Context  Context passed to RegisterAccessIoSimTimeSchedule.
+**/
+typedef
+VOID
+(*REGISTER_ACCESS_IO_SIM_TIME_CALLBACK) (
+  IN VOID  *Context
+  );
+
+/**
+  Returns virtual time of the calling thread's simulation context in nanoseconds.
+**/
+UINT64
+RegisterAccessIoSimTimeGetNow (
+  VOID
+  );
+
+/**
+  Schedules callback to run when virtual time advances by Delay.
+  Events scheduled for the same time run in the order they were scheduled.
+
+  @param[in]  Delay     Delay from the current virtual time in nanoseconds.
+  @param[in]  Callback  Callback to run.
+  @param[in]  Context   Context passed to the callback.
+  @param[out] EventId   Optional id which can be passed to RegisterAccessIoSimTimeCancel.
+
+  @retval EFI_SUCCESS            Event scheduled.
+  @retval EFI_INVALID_PARAMETER  Callback is NULL.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoSimTimeSchedule (
+  IN  UINT64                                Delay,
+  IN  REGISTER_ACCESS_IO_SIM_TIME_CALLBACK  Callback,
+  IN  VOID                                  *Context OPTIONAL,
+  OUT UINT64                                *EventId OPTIONAL
+  );
+
+/**
+  Cancels event which didn't run yet.
+
+  @param[in] EventId  Id returned by RegisterAccessIoSimTimeSchedule.
+
+  @retval EFI_SUCCESS    Event cancelled.
+  @retval EFI_NOT_FOUND  Event already ran or doesn't exist.
+**/
+EFI_STATUS
+RegisterAccessIoSimTimeCancel (
+  IN UINT64  EventId
+  );
+
+/**
+  Advances virtual time by Delay running every event which becomes due, in
+  time order. Callbacks run with the clock set to their event time.
+
+  Time doesn't advance while an event callback runs, so register accesses
+  and waits issued by device models from callbacks take no virtual time.
+
+  @param[in] Delay  Time to advance by in nanoseconds.
+**/
+VOID
+RegisterAccessIoSimTimeAdvance (
+  IN UINT64  Delay
+  );
+
+/**
+  Waits for the next event for at most Timeout. Time jumps straight to the
+  next event if it is due within Timeout, so drivers polling for a device
+  state change spend no host time waiting.
+
+  If no event is due within Timeout and devices running on other threads are
+  registered as notifiers, waits for their notification for at most Timeout
+  of host time and advances virtual time by the host time spent.
+
+  @param[in] Timeout  Maximum time to wait in nanoseconds.
+
+  @return Virtual time that elapsed. Timeout if no event was due within it or
+          if called from an event callback.
+**/
+UINT64
+RegisterAccessIoSimTimeWait (
+  IN UINT64  Timeout
+  );
+
+/**
+  Checks whether anything besides the driver's own accesses can change device
+  state in the calling thread's context.
+
+  @return TRUE if no event is pending and no notifier is registered.
+**/
+BOOLEAN
+RegisterAccessIoSimTimeIsIdle (
+  VOID
+  );
+
+/**
+  Registers a device model running on another thread as a notifier of the
+  context. RegisterAccessIoSimTimeWait blocks on notifications while the
+  context has notifiers.
+
+  @param[in] Context  Context of the driver accessing the device.
+
+  @retval EFI_SUCCESS            Notifier registered.
+  @retval EFI_INVALID_PARAMETER  Context is NULL.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoSimTimeRegisterNotifier (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  );
+
+/**
+  Unregisters notifier registered with RegisterAccessIoSimTimeRegisterNotifier.
+
+  @param[in] Context  Context the notifier was registered with.
+**/
+VOID
+RegisterAccessIoSimTimeUnregisterNotifier (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  );
+
+/**
+  Wakes threads waiting in RegisterAccessIoSimTimeWait on the context. Called
+  by device models running on other threads when their state changes. Can be
+  called from any thread.
+
+  @param[in] Context  Context of the driver accessing the device.
+**/
+VOID
+RegisterAccessIoSimTimeNotify (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  );
+
+/**
+  Sets virtual time every register access takes in the calling thread's
+  simulation context. Default is REGISTER_ACCESS_IO_SIM_TIME_DEFAULT_ACCESS_COST.
+  0 stops the clock on accesses and skips the time keeping on the access path.
+
+  @param[in] Cost  Time of a single access in nanoseconds.
+**/
+VOID
+RegisterAccessIoSimTimeSetAccessCost (
+  IN UINT64  Cost
+  );
+
+/**
+  Drops all pending events of the calling thread's simulation context and
+  sets its virtual time back to 0.
+**/
+VOID
+RegisterAccessIoSimTimeReset (
+  VOID
+  );
+
+//
+// Interrupt raised by a device model.
+//
+typedef struct {
+  UINT32  Vector;
+  //
+  // MSI data or any value the device model passes along with the vector.
+  //
+  UINT32  Data;
+  //
+  // Virtual time of the context when the interrupt was raised.
+  //
+  UINT64  Time;
+} REGISTER_ACCESS_IO_INTERRUPT;
+
+typedef struct {
+  UINT64  Raised;
+  UINT64  Dispatched;
+  //
+  // Interrupts dispatched to vectors without a handler.
+  //
+  UINT64  Unhandled;
+  //
+  // Interrupts dropped because the queue was full.
+  //
+  UINT64  Lost;
+  //
+  // Virtual time from raise to dispatch.
+  //
+  UINT64  TotalLatency;
+  UINT64  MaxLatency;
+} REGISTER_ACCESS_IO_INTERRUPT_STATS;
+
+/**
+  Interrupt handler called by RegisterAccessIoInterruptDispatch.
+
+  @param[in] Interrupt  Interrupt being dispatched.
+  @param[in] Context    Context passed to RegisterAccessIoInterruptSetHandler.
+**/
+typedef
+VOID
+(*REGISTER_ACCESS_IO_INTERRUPT_HANDLER) (
+  IN REGISTER_ACCESS_IO_INTERRUPT  *Interrupt,
+  IN VOID                          *Context
+  );
+
+/**
+  Raises interrupt in the simulation context. Interrupt is queued in a
+  lock-free queue, so device models running on any thread can raise
+  interrupts concurrently without taking locks. Threads waiting in
+  RegisterAccessIoInterruptWait or RegisterAccessIoSimTimeWait on the
+  context are woken up.
+
+  @param[in] Context  Simulation context of the driver. NULL for the calling thread's context.
+  @param[in] Vector   Interrupt vector.
+  @param[in] Data     MSI data or any value for the handler.
+
+  @retval EFI_SUCCESS            Interrupt queued.
+  @retval EFI_INVALID_PARAMETER  Vector is out of range.
+  @retval EFI_OUT_OF_RESOURCES   Queue is full and the interrupt was lost, or
+                                 failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoInterruptRaise (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context OPTIONAL,
+  IN UINT32                          Vector,
+  IN UINT32                          Data
+  );
+
+/**
+  Takes the oldest pending interrupt of the calling thread's context off the
+  queue without dispatching it.
+
+  @param[out] Interrupt  Interrupt taken off the queue.
+
+  @retval TRUE   Interrupt returned.
+  @retval FALSE  No interrupt is pending.
+**/
+BOOLEAN
+RegisterAccessIoInterruptPop (
+  OUT REGISTER_ACCESS_IO_INTERRUPT  *Interrupt
+  );
+
+/**
+  Checks whether the calling thread's context has pending interrupts.
+**/
+BOOLEAN
+RegisterAccessIoInterruptIsPending (
+  VOID
+  );
+
+/**
+  Sets handler of the vector in the calling thread's context. Must not be
+  called while the context dispatches interrupts.
+
+  @param[in] Vector   Interrupt vector.
+  @param[in] Handler  Handler to call, NULL removes the handler.
+  @param[in] Context  Context passed to the handler.
+
+  @retval EFI_SUCCESS            Handler set.
+  @retval EFI_INVALID_PARAMETER  Vector is out of range.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoInterruptSetHandler (
+  IN UINT32                                Vector,
+  IN REGISTER_ACCESS_IO_INTERRUPT_HANDLER  Handler OPTIONAL,
+  IN VOID                                  *Context OPTIONAL
+  );
+
+/**
+  Dispatches pending interrupts of the calling thread's context to their
+  handlers in the order they were raised. Interrupts raised by the handlers
+  are dispatched as well.
+
+  @return Number of interrupts dispatched.
+**/
+UINTN
+RegisterAccessIoInterruptDispatch (
+  VOID
+  );
+
+/**
+  Waits on the virtual time of the calling thread's context until an
+  interrupt is pending. Interrupts are not dispatched.
+
+  @param[in] Timeout  Maximum virtual time to wait in nanoseconds.
+
+  @retval EFI_SUCCESS  Interrupt is pending.
+  @retval EFI_TIMEOUT  No interrupt was raised within Timeout.
+**/
+EFI_STATUS
+RegisterAccessIoInterruptWait (
+  IN UINT64  Timeout
+  );
+
+/**
+  Returns interrupt statistics of the calling thread's context.
+
+  @param[out] Stats  Statistics.
+
+  @retval EFI_SUCCESS            Statistics returned.
+  @retval EFI_INVALID_PARAMETER  Stats is NULL.
+**/
+EFI_STATUS
+RegisterAccessIoInterruptGetStats (
+  OUT REGISTER_ACCESS_IO_INTERRUPT_STATS  *Stats
+  );
+
+/**
+  Drops pending interrupts, handlers and statistics of the calling thread's
+  context. Must not be called while device models raise interrupts.
+**/
+VOID
+RegisterAccessIoInterruptReset (
+  VOID
+  );
+
 #ifdef REGISTER_ACCESS_IO_LIB_INCLUDE_FAKES
 
 UINT8
@@ -25,6 +25,8 @@ typedef struct {
   REGISTER_ACCESS_INTERFACE  *Bar[REGISTER_SPACE_PCI_LIB_MAX_SUPPORTED_BARS]; // BARs 0-4
   UINT64               BarAddress[REGISTER_SPACE_PCI_LIB_MAX_SUPPORTED_BARS];
   REGISTER_ACCESS_IO_MEMORY_TYPE  BarType[REGISTER_SPACE_PCI_LIB_MAX_SUPPORTED_BARS];
+  UINT16               TraceRegion;
+  UINT16               BarTraceRegion[REGISTER_SPACE_PCI_LIB_MAX_SUPPORTED_BARS];
 } REGISTER_ACCESS_PCI_DEVICE;
 
 typedef struct {
@@ -68,6 +70,22 @@ RegisterAccessPciDeviceDestroy (
   IN REGISTER_ACCESS_PCI_DEVICE  *PciDev
   );
 
+/**
+  Returns statistics of the PCI function summed over its config space and
+  all registered BARs.
+
+  @param[in]  PciDev  PCI device.
+  @param[out] Stats   Statistics of the function.
+
+  @retval EFI_SUCCESS            Statistics returned.
+  @retval EFI_INVALID_PARAMETER  PciDev or Stats is NULL.
+**/
+EFI_STATUS
+RegisterAccessPciDeviceGetStats (
+  IN  REGISTER_ACCESS_PCI_DEVICE  *PciDev,
+  OUT REGISTER_ACCESS_IO_STATS    *Stats
+  );
+
 EFI_STATUS
 EFIAPI
 RegisterAccessPciIoGetHostAddressFromDeviceAddress (
@@ -0,0 +1,290 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _REGISTER_ACCESS_TRACE_FILE_LIB_H_
+#define _REGISTER_ACCESS_TRACE_FILE_LIB_H_
+
+#include <Base.h>
+#include <RegisterAccessTrace.h>
+
+typedef struct _REGISTER_ACCESS_TRACE_WRITER  REGISTER_ACCESS_TRACE_WRITER;
+typedef struct _REGISTER_ACCESS_TRACE_READER  REGISTER_ACCESS_TRACE_READER;
+
+//
+// Values returned by read accesses are not compared. Useful when device model
+// state such as counters differs between the runs.
+//
+#define REGISTER_ACCESS_TRACE_DIFF_IGNORE_READ_VALUES  BIT0
+//
+// Stop at the first divergence. Summary counts cover the traces only up to it.
+//
+#define REGISTER_ACCESS_TRACE_DIFF_STOP_AT_FIRST       BIT1
+
+#define REGISTER_ACCESS_TRACE_DIFF_DEFAULT_WINDOW         256
+#define REGISTER_ACCESS_TRACE_DIFF_DEFAULT_RESYNC_LENGTH  4
+
+typedef struct {
+  UINT32  Flags;
+  //
+  // Number of records looked ahead in each trace when searching for the point
+  // where the traces match again. 0 selects the default.
+  //
+  UINT32  Window;
+  //
+  // Number of consecutive matching accesses required to consider the traces
+  // aligned again. 0 selects the default.
+  //
+  UINT32  ResyncLength;
+} REGISTER_ACCESS_TRACE_DIFF_OPTIONS;
+
+typedef enum {
+  RegisterAccessTraceDiffNone = 0,
+  //
+  // Same access with a different value.
+  //
+  RegisterAccessTraceDiffValue,
+  //
+  // Accesses present only in the first trace.
+  //
+  RegisterAccessTraceDiffDeleted,
+  //
+  // Accesses present only in the second trace.
+  //
+  RegisterAccessTraceDiffInserted,
+  //
+  // Accesses of the first trace replaced by different accesses in the second.
+  //
+  RegisterAccessTraceDiffReplaced
+} REGISTER_ACCESS_TRACE_DIFF_KIND;
+
+typedef struct {
+  UINT64                           RecordCount[2];
+  //
+  // Accesses matching in both traces.
+  //
+  UINT64                           MatchedCount;
+  //
+  // Accesses matching in both traces apart from the value.
+  //
+  UINT64                           ValueMismatchCount;
+  UINT64                           DeletedCount;
+  UINT64                           InsertedCount;
+  //
+  // Number of divergent sections after which the traces were aligned again.
+  //
+  UINT64                           ResyncCount;
+  //
+  // Number of times no alignment was found within the window and the whole
+  // window was reported as deleted and inserted.
+  //
+  UINT64                           ResyncFailureCount;
+  //
+  // First divergence. Index is the record index in each trace, records are
+  // valid if the index is lower than the trace record count. Deleted and
+  // inserted lengths are 0 for value mismatches.
+  //
+  REGISTER_ACCESS_TRACE_DIFF_KIND  FirstKind;
+  UINT64                           FirstIndex[2];
+  REGISTER_ACCESS_TRACE_RECORD     FirstRecord[2];
+  UINT64                           FirstDeletedLength;
+  UINT64                           FirstInsertedLength;
+} REGISTER_ACCESS_TRACE_DIFF_RESULT;
+
+/**
+  Creates compact trace file. Records are encoded as they are appended, only
+  the current block is kept in memory.
+
+  @param[in]  FileName        Path of the file.
+  @param[in]  TicksPerSecond  Frequency of the timestamp counter. 0 if unknown.
+  @param[out] Writer          Created writer.
+
+  @retval EFI_SUCCESS            Writer created.
+  @retval EFI_INVALID_PARAMETER  One of the parameters is NULL.
+  @retval EFI_DEVICE_ERROR       Failed to create the file.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessTraceWriterCreate (
+  IN  CONST CHAR8                   *FileName,
+  IN  UINT64                        TicksPerSecond,
+  OUT REGISTER_ACCESS_TRACE_WRITER  **Writer
+  );
+
+/**
+  Appends record to the trace.
+
+  @param[in] Writer  Writer created with RegisterAccessTraceWriterCreate.
+  @param[in] Record  Record to append.
+
+  @retval EFI_SUCCESS            Record appended.
+  @retval EFI_INVALID_PARAMETER  One of the parameters is NULL.
+  @retval EFI_DEVICE_ERROR       Failed to write the file.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessTraceWriterAppend (
+  IN REGISTER_ACCESS_TRACE_WRITER        *Writer,
+  IN CONST REGISTER_ACCESS_TRACE_RECORD  *Record
+  );
+
+/**
+  Writes the last block, region table and block index and closes the file.
+  Writer is freed even if writing fails.
+
+  @param[in] Writer       Writer created with RegisterAccessTraceWriterCreate.
+  @param[in] Regions      Region table indexed by region id.
+  @param[in] RegionCount  Number of entries in the region table.
+
+  @retval EFI_SUCCESS            Trace written.
+  @retval EFI_INVALID_PARAMETER  Writer is NULL.
+  @retval EFI_DEVICE_ERROR       Failed to write the file.
+**/
+EFI_STATUS
+RegisterAccessTraceWriterClose (
+  IN REGISTER_ACCESS_TRACE_WRITER        *Writer,
+  IN CONST REGISTER_ACCESS_TRACE_REGION  *Regions OPTIONAL,
+  IN UINT32                              RegionCount
+  );
+
+/**
+  Opens trace file for reading. Both the raw format written by RegisterAccessIoTraceSave
+  and the compact format are supported. File is memory mapped.
+
+  @param[in]  FileName  Path of the file.
+  @param[out] Reader    Created reader positioned at the first record.
+
+  @retval EFI_SUCCESS            Trace opened.
+  @retval EFI_INVALID_PARAMETER  One of the parameters is NULL.
+  @retval EFI_NOT_FOUND          Failed to open the file.
+  @retval EFI_VOLUME_CORRUPTED   File is not a valid trace.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessTraceReaderOpen (
+  IN  CONST CHAR8                   *FileName,
+  OUT REGISTER_ACCESS_TRACE_READER  **Reader
+  );
+
+/**
+  Returns trace properties.
+
+  @param[in]  Reader          Reader created with RegisterAccessTraceReaderOpen.
+  @param[out] RecordCount     Number of records in the trace.
+  @param[out] TicksPerSecond  Frequency of the timestamp counter. 0 if unknown.
+  @param[out] Regions         Region table indexed by region id.
+  @param[out] RegionCount     Number of entries in the region table.
+**/
+VOID
+RegisterAccessTraceReaderGetInfo (
+  IN  REGISTER_ACCESS_TRACE_READER        *Reader,
+  OUT UINT64                              *RecordCount OPTIONAL,
+  OUT UINT64                              *TicksPerSecond OPTIONAL,
+  OUT CONST REGISTER_ACCESS_TRACE_REGION  **Regions OPTIONAL,
+  OUT UINT32                              *RegionCount OPTIONAL
+  );
+
+/**
+  Reads the next record.
+
+  @param[in]  Reader  Reader created with RegisterAccessTraceReaderOpen.
+  @param[out] Record  Record read.
+
+  @retval EFI_SUCCESS           Record read.
+  @retval EFI_END_OF_FILE       No more records.
+  @retval EFI_VOLUME_CORRUPTED  Record can't be decoded.
+**/
+EFI_STATUS
+RegisterAccessTraceReaderNext (
+  IN  REGISTER_ACCESS_TRACE_READER  *Reader,
+  OUT REGISTER_ACCESS_TRACE_RECORD  *Record
+  );
+
+/**
+  Positions the reader at the record with the given index. Compact traces
+  decode only the block holding the record.
+
+  @param[in] Reader  Reader created with RegisterAccessTraceReaderOpen.
+  @param[in] Index   Index of the record. Equal to record count positions at the end.
+
+  @retval EFI_SUCCESS            Reader positioned.
+  @retval EFI_INVALID_PARAMETER  Index is beyond the end of the trace.
+  @retval EFI_VOLUME_CORRUPTED   Block can't be decoded.
+**/
+EFI_STATUS
+RegisterAccessTraceReaderSeek (
+  IN REGISTER_ACCESS_TRACE_READER  *Reader,
+  IN UINT64                        Index
+  );
+
+/**
+  Positions the reader at the first record, in trace order, with timestamp not
+  lower than Timestamp. Records aren't sorted by timestamp (poll records are
+  stamped at the start of the poll and appended when it completes) so the first
+  call reads the whole trace to index the running maximum of timestamps.
+
+  @param[in]  Reader     Reader created with RegisterAccessTraceReaderOpen.
+  @param[in]  Timestamp  Timestamp to look for.
+  @param[out] Index      Index of the record the reader is positioned at.
+
+  @retval EFI_SUCCESS           Reader positioned. It is at the end if all records are older.
+  @retval EFI_VOLUME_CORRUPTED  Block can't be decoded.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate the timestamp index.
+**/
+EFI_STATUS
+RegisterAccessTraceReaderSeekTimestamp (
+  IN  REGISTER_ACCESS_TRACE_READER  *Reader,
+  IN  UINT64                        Timestamp,
+  OUT UINT64                        *Index OPTIONAL
+  );
+
+VOID
+RegisterAccessTraceReaderClose (
+  IN REGISTER_ACCESS_TRACE_READER  *Reader
+  );
+
+/**
+  Compares two traces, e.g. recorded before and after a driver change. Traces
+  are streamed so only Window records of each are kept in memory.
+
+  Records are compared by type, region, address, width and value. Timestamps and
+  durations are ignored and regions are matched by name and type so region
+  numbering may differ between the traces. When the accesses differ the
+  closest point within the window at which ResyncLength accesses match again is
+  searched for and the records before it are reported as deleted, inserted or
+  replaced.
+
+  @param[in]  FirstFileName   Path of the first (reference) trace.
+  @param[in]  SecondFileName  Path of the second trace.
+  @param[in]  Options         Comparison options. NULL selects the defaults.
+  @param[out] Result          First divergence and summary counts.
+
+  @retval EFI_SUCCESS            Traces compared. Result->FirstKind is
+                                 RegisterAccessTraceDiffNone if they match.
+  @retval EFI_INVALID_PARAMETER  One of the parameters is NULL.
+  @retval EFI_NOT_FOUND          Failed to open one of the files.
+  @retval EFI_VOLUME_CORRUPTED   One of the files is not a valid trace.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessTraceDiff (
+  IN  CONST CHAR8                               *FirstFileName,
+  IN  CONST CHAR8                               *SecondFileName,
+  IN  CONST REGISTER_ACCESS_TRACE_DIFF_OPTIONS  *Options OPTIONAL,
+  OUT REGISTER_ACCESS_TRACE_DIFF_RESULT         *Result
+  );
+
+/**
+  Prints the first divergence and summary counts with DEBUG_INFO level.
+
+  @param[in] Result  Result of RegisterAccessTraceDiff.
+**/
+VOID
+RegisterAccessTraceDiffPrint (
+  IN CONST REGISTER_ACCESS_TRACE_DIFF_RESULT  *Result
+  );
+
+#endif
\ No newline at end of file
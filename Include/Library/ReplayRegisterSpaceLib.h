@@ -0,0 +1,78 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _REPLAY_REGISTER_SPACE_LIB_H_
+#define _REPLAY_REGISTER_SPACE_LIB_H_
+
+#include <Base.h>
+#include <RegisterAccessInterface.h>
+
+typedef enum {
+  //
+  // Accesses have to follow the recorded sequence exactly. Reads return
+  // the recorded values, writes are checked against the recorded ones.
+  //
+  ReplayRegisterSpaceModeStrict = 0,
+  //
+  // Reads are answered per address in the recorded order regardless of
+  // accesses to other addresses. Last value is repeated once all values
+  // recorded for the address were returned. Writes are ignored.
+  //
+  ReplayRegisterSpaceModeRelaxed
+} REPLAY_REGISTER_SPACE_MODE;
+
+/**
+  Creates register space answering accesses from a recorded trace.
+
+  Only MMIO and IO records of regions named RegionName are replayed. Addresses
+  are relative to the base of the region the record belongs to.
+
+  @param[in]  RegisterSpaceDescription  Name of the register space.
+  @param[in]  TraceFileName             Path of the trace saved with RegisterAccessIoTraceSave or
+                                        RegisterAccessIoTraceSaveCompact.
+  @param[in]  RegionName                Name of the recorded region to replay.
+  @param[in]  Mode                      Replay mode.
+  @param[out] RegisterSpace             Created register space.
+
+  @retval EFI_SUCCESS            Register space created.
+  @retval EFI_INVALID_PARAMETER  One of the parameters is NULL.
+  @retval EFI_NOT_FOUND          Failed to open the trace or region not found in the trace.
+  @retval EFI_VOLUME_CORRUPTED   Trace file is malformed.
+  @retval EFI_OUT_OF_RESOURCES   Failed to allocate memory.
+**/
+EFI_STATUS
+ReplayRegisterSpaceCreate (
+  IN CHAR16                      *RegisterSpaceDescription,
+  IN CONST CHAR8                 *TraceFileName,
+  IN CONST CHAR8                 *RegionName,
+  IN REPLAY_REGISTER_SPACE_MODE  Mode,
+  OUT REGISTER_ACCESS_INTERFACE  **RegisterSpace
+  );
+
+/**
+  Returns replay progress.
+
+  @param[in]  RegisterSpace  Register space created with ReplayRegisterSpaceCreate.
+  @param[out] Remaining      Number of records not consumed yet. Only meaningful in strict mode.
+  @param[out] Mismatches     Number of accesses which didn't match the trace.
+
+  @retval EFI_SUCCESS            Status returned.
+  @retval EFI_INVALID_PARAMETER  RegisterSpace is NULL.
+**/
+EFI_STATUS
+ReplayRegisterSpaceGetStatus (
+  IN  REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  OUT UINT64                     *Remaining OPTIONAL,
+  OUT UINT64                     *Mismatches OPTIONAL
+  );
+
+EFI_STATUS
+ReplayRegisterSpaceDestroy (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace
+  );
+
+#endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _SIM_BOOT_SERVICES_LIB_H_
+#define _SIM_BOOT_SERVICES_LIB_H_
+
+#include <Uefi.h>
+
+//
+// Period of the simulated timer tick in nanoseconds. Timers set with
+// TriggerTime of 0 fire on the next tick.
+//
+#define SIM_BOOT_SERVICES_TIMER_TICK  10000
+
+/**
+  Replaces event, timer and TPL services of BootServices with implementations
+  running on the virtual time of RegisterAccessIoLib.
+
+  Replaced services are RaiseTPL, RestoreTPL, CreateEvent, CreateEventEx,
+  SetTimer, WaitForEvent, SignalEvent, CloseEvent, CheckEvent and Stall.
+  Timers are scheduled as events on the virtual clock of the calling thread's
+  simulation context, so they fire in order with device model events while the
+  driver stalls, delays, waits for an event or accesses registers. Notify
+  functions run when the TPL drops below their notify TPL, same as in firmware.
+  Notify functions of timers which expire during a Stall or WaitForEvent run
+  at the time the timer expired. Timers which expire during other delays or
+  register accesses run their notify functions on the next call to Stall,
+  WaitForEvent, CheckEvent, SignalEvent or RestoreTPL.
+
+  WaitForEvent jumps the virtual clock to the next scheduled event instead of
+  spinning, and fails with EFI_NOT_READY when no event is signaled and nothing
+  can signal one, where firmware would hang.
+
+  Events and the current TPL are kept per simulation context. Event services
+  of a single context are not thread safe, same as in firmware. Table CRC32 is
+  recomputed over Hdr.HeaderSize bytes.
+
+  @param[in, out] BootServices  Boot services table, usually gBS.
+
+  @retval EFI_SUCCESS            Services installed.
+  @retval EFI_INVALID_PARAMETER  BootServices is NULL.
+  @retval EFI_ALREADY_STARTED    Services are already installed.
+**/
+EFI_STATUS
+SimBootServicesInstall (
+  IN OUT EFI_BOOT_SERVICES  *BootServices
+  );
+
+/**
+  Restores services replaced by SimBootServicesInstall and closes all events
+  which are still open in any simulation context.
+
+  @retval EFI_SUCCESS    Services restored.
+  @retval EFI_NOT_FOUND  Services are not installed.
+**/
+EFI_STATUS
+SimBootServicesUninstall (
+  VOID
+  );
+
+#endif
\ No newline at end of file
@@ -31,10 +31,30 @@ EFI_STATUS
   IN UINT64               Value
   );
 
+//
+// Optional. Writes Length bytes starting at Address as a single transaction.
+// Used to forward write combined data. When NULL the data is split into
+// naturally aligned writes.
+//
+// WriteBlock was added after Name, Read and Write. Interfaces which predate it
+// or don't implement it must set it to NULL, for example by allocating the
+// structure with AllocateZeroPool, otherwise write combining calls whatever
+// the member happens to hold.
+//
+typedef
+EFI_STATUS
+(*REGISTER_SPACE_WRITE_BLOCK) (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64               Address,
+  IN UINT32               Length,
+  IN CONST UINT8          *Buffer
+  );
+
 struct _REGISTER_ACCESS_INTERFACE {
-  CHAR16                *Name;
-  REGISTER_SPACE_READ   Read;
-  REGISTER_SPACE_WRITE  Write;
+  CHAR16                      *Name;
+  REGISTER_SPACE_READ         Read;
+  REGISTER_SPACE_WRITE        Write;
+  REGISTER_SPACE_WRITE_BLOCK  WriteBlock;
 };
 
 #endif
\ No newline at end of file
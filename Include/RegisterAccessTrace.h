@@ -0,0 +1,148 @@
+/** @file
+  Definitions of the register access trace records and trace file layout.
+
+  Trace file consists of REGISTER_ACCESS_TRACE_HEADER followed by RegionCount
+  REGISTER_ACCESS_TRACE_REGION entries and RecordCount
+  REGISTER_ACCESS_TRACE_RECORD entries sorted by timestamp.
+
+  Compact trace file consists of REGISTER_ACCESS_TRACE_COMPACT_HEADER followed
+  by encoded blocks of up to REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS records.
+  Block index (BlockCount REGISTER_ACCESS_TRACE_COMPACT_BLOCK entries) followed
+  by RegionCount REGISTER_ACCESS_TRACE_REGION entries is stored at IndexOffset,
+  after the last block, so that the file can be written in a single pass.
+
+  Every encoded record starts with a tag byte:
+    Bits 0-3  Type.
+    Bits 4-6  Width: 0, 1, 2, 4 or 8 bytes encoded as 0-4. 7 means width byte follows the tag.
+    Bit  7    Region differs from the previous record, region follows as varint.
+  followed by the timestamp delta from the previous record (zigzag varint),
+  the address delta from the previous address of the same region slot
+  (Region % REGISTER_ACCESS_TRACE_COMPACT_ADDRESS_SLOTS, zigzag varint), the
+  value (varint) and the duration (varint). Varints are LEB128. Delta state is
+  reset at the start of each block (timestamp to FirstTimestamp of the block,
+  region and addresses to 0) so every block can be decoded on its own.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _REGISTER_ACCESS_TRACE_H_
+#define _REGISTER_ACCESS_TRACE_H_
+
+#include <Base.h>
+
+#define REGISTER_ACCESS_TRACE_SIGNATURE  SIGNATURE_64 ('R', 'A', 'T', 'R', 'A', 'C', 'E', '0')
+#define REGISTER_ACCESS_TRACE_VERSION    1
+
+//
+// Region 0 is reserved for accesses which didn't hit any registered region.
+//
+#define REGISTER_ACCESS_TRACE_REGION_UNMAPPED  0
+
+#define REGISTER_ACCESS_TRACE_REGION_NAME_LENGTH  48
+
+#define REGISTER_ACCESS_TRACE_COMPACT_SIGNATURE  SIGNATURE_64 ('R', 'A', 'T', 'R', 'A', 'C', 'E', 'Z')
+#define REGISTER_ACCESS_TRACE_COMPACT_VERSION    1
+
+#define REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS    4096
+#define REGISTER_ACCESS_TRACE_COMPACT_ADDRESS_SLOTS    256
+
+#define REGISTER_ACCESS_TRACE_COMPACT_TAG_TYPE_MASK       0x0F
+#define REGISTER_ACCESS_TRACE_COMPACT_TAG_WIDTH_SHIFT     4
+#define REGISTER_ACCESS_TRACE_COMPACT_TAG_WIDTH_MASK      0x07
+#define REGISTER_ACCESS_TRACE_COMPACT_TAG_WIDTH_EXPLICIT  0x07
+#define REGISTER_ACCESS_TRACE_COMPACT_TAG_REGION          BIT7
+
+typedef enum {
+  RegisterAccessTraceRegionMmio = 0,
+  RegisterAccessTraceRegionIo,
+  RegisterAccessTraceRegionPciFunction,
+  RegisterAccessTraceRegionUnmapped
+} REGISTER_ACCESS_TRACE_REGION_TYPE;
+
+typedef enum {
+  RegisterAccessTraceMmioRead = 0,
+  RegisterAccessTraceMmioWrite,
+  RegisterAccessTraceIoRead,
+  RegisterAccessTraceIoWrite,
+  RegisterAccessTracePciConfigRead,
+  RegisterAccessTracePciConfigWrite,
+  RegisterAccessTracePciPollMem,
+  RegisterAccessTracePciPollIo,
+  RegisterAccessTracePciFlush,
+  RegisterAccessTracePciMap,
+  RegisterAccessTracePciUnmap,
+  RegisterAccessTraceTypeMax
+} REGISTER_ACCESS_TRACE_TYPE;
+
+#pragma pack(1)
+
+typedef struct {
+  UINT64  Signature;
+  UINT32  Version;
+  UINT32  RegionCount;
+  UINT64  RecordCount;
+  //
+  // Frequency of the timestamp counter. 0 if unknown.
+  //
+  UINT64  TicksPerSecond;
+} REGISTER_ACCESS_TRACE_HEADER;
+
+typedef struct {
+  UINT64  Base;
+  UINT64  Size;
+  UINT8   Type;
+  UINT8   Reserved[7];
+  CHAR8   Name[REGISTER_ACCESS_TRACE_REGION_NAME_LENGTH];
+} REGISTER_ACCESS_TRACE_REGION;
+
+typedef struct {
+  UINT64  Timestamp;
+  //
+  // Absolute address of the access. For PCI function regions it is the offset
+  // within configuration space for config accesses and device address for
+  // map/unmap.
+  //
+  UINT64  Address;
+  UINT64  Value;
+  //
+  // Ticks spent in the operation. For register accesses it is the time spent
+  // in the register space. 0 for accesses which didn't reach register space.
+  //
+  UINT32  Duration;
+  UINT16  Region;
+  UINT8   Type;
+  UINT8   Width;
+} REGISTER_ACCESS_TRACE_RECORD;
+
+typedef struct {
+  UINT64  Signature;
+  UINT32  Version;
+  UINT32  RegionCount;
+  UINT64  RecordCount;
+  //
+  // Frequency of the timestamp counter. 0 if unknown.
+  //
+  UINT64  TicksPerSecond;
+  UINT64  BlockCount;
+  UINT64  IndexOffset;
+} REGISTER_ACCESS_TRACE_COMPACT_HEADER;
+
+typedef struct {
+  //
+  // File offset and size of the encoded block.
+  //
+  UINT64  Offset;
+  UINT32  Size;
+  UINT32  RecordCount;
+  //
+  // Index of the first record of the block within the trace.
+  //
+  UINT64  FirstRecord;
+  UINT64  FirstTimestamp;
+} REGISTER_ACCESS_TRACE_COMPACT_BLOCK;
+
+#pragma pack()
+
+#endif
@@ -0,0 +1,385 @@
+/** @file
+  Register space running the device model on its own thread.
+
+  Driver thread is the only producer and the device thread the only consumer
+  of a ring of requests, so the ring needs no locks. Each side owns its index
+  and only reads the index of the other side. Reads wait until the device
+  thread moves its index past the read request and then take the value from
+  the completion slot.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/AsyncRegisterSpaceLib.h>
+#include <Library/RegisterAccessIoLib.h>
+
+#include <threads.h>
+
+#define ASYNC_CACHE_LINE_SIZE  64
+
+//
+// Number of polls spent spinning before waiting thread starts to yield the CPU.
+//
+#define ASYNC_SPIN_COUNT  1000
+
+typedef enum {
+  AsyncRequestRead = 0,
+  AsyncRequestWrite,
+  AsyncRequestStop
+} ASYNC_REQUEST_TYPE;
+
+typedef struct {
+  UINT64  Address;
+  UINT64  Value;
+  UINT32  Size;
+  UINT32  Type;
+} ASYNC_REQUEST;
+
+//
+// Index padded to the cache line so that producer and consumer don't write
+// to the same line.
+//
+typedef struct {
+  volatile UINT32  Value;
+  UINT8            Pad[ASYNC_CACHE_LINE_SIZE - sizeof (UINT32)];
+} ASYNC_INDEX;
+
+typedef struct {
+  REGISTER_ACCESS_INTERFACE  RegisterSpace;
+  REGISTER_ACCESS_INTERFACE  *Device;
+  ASYNC_REGISTER_SPACE_IDLE  Idle;
+  VOID                       *IdleContext;
+  //
+  // Simulation context of the driver. Notified when the device state changes.
+  //
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *SimContext;
+  thrd_t                     Thread;
+  ASYNC_REQUEST              *Requests;
+  UINT32                     Mask;
+  UINT8                      Pad[ASYNC_CACHE_LINE_SIZE];
+  //
+  // Written by the driver thread.
+  //
+  ASYNC_INDEX                Tail;
+  UINT32                     ReportedWriteErrors;
+  UINT8                      Pad2[ASYNC_CACHE_LINE_SIZE];
+  //
+  // Written by the device thread.
+  //
+  ASYNC_INDEX                Head;
+  UINT64                     CompletionValue;
+  EFI_STATUS                 CompletionStatus;
+  volatile UINT32            WriteErrors;
+} ASYNC_REGISTER_SPACE;
+
+STATIC
+VOID
+AsyncWait (
+  IN OUT UINTN  *Spins
+  )
+{
+  if (*Spins < ASYNC_SPIN_COUNT) {
+    (*Spins)++;
+    CpuPause ();
+  } else {
+    thrd_yield ();
+  }
+}
+
+/**
+  Queues request. Waits for a free slot if the queue is full.
+
+  @return Index of the queued request.
+**/
+STATIC
+UINT32
+AsyncPush (
+  IN ASYNC_REGISTER_SPACE  *Async,
+  IN ASYNC_REQUEST_TYPE    Type,
+  IN UINT64                Address,
+  IN UINT32                Size,
+  IN UINT64                Value
+  )
+{
+  ASYNC_REQUEST  *Request;
+  UINT32         Tail;
+  UINTN          Spins;
+
+  Tail = Async->Tail.Value;
+  Spins = 0;
+  while (Tail - Async->Head.Value > Async->Mask) {
+    AsyncWait (&Spins);
+  }
+
+  Request = &Async->Requests[Tail & Async->Mask];
+  Request->Type = Type;
+  Request->Address = Address;
+  Request->Size = Size;
+  Request->Value = Value;
+
+  //
+  // Request has to be visible before the device thread can see the new index.
+  //
+  MemoryFence ();
+  Async->Tail.Value = Tail + 1;
+
+  return Tail;
+}
+
+/**
+  Waits until the device thread completes request at Index.
+**/
+STATIC
+VOID
+AsyncWaitForCompletion (
+  IN ASYNC_REGISTER_SPACE  *Async,
+  IN UINT32                Index
+  )
+{
+  UINTN  Spins;
+
+  Spins = 0;
+  while ((INT32) (Async->Head.Value - Index) <= 0) {
+    AsyncWait (&Spins);
+  }
+  MemoryFence ();
+}
+
+STATIC
+int
+AsyncDeviceThread (
+  IN VOID  *Context
+  )
+{
+  ASYNC_REGISTER_SPACE       *Async;
+  REGISTER_ACCESS_INTERFACE  *Device;
+  ASYNC_REQUEST              *Request;
+  UINT32                     Head;
+  UINTN                      Spins;
+  UINT64                     Value;
+  EFI_STATUS                 Status;
+  BOOLEAN                    Stop;
+
+  Async = (ASYNC_REGISTER_SPACE*) Context;
+  Device = Async->Device;
+  Head = Async->Head.Value;
+
+  //
+  // Device model runs in the driver's context, so its DMA, interrupts and
+  // virtual time calls reach the driver's platform.
+  //
+  RegisterAccessIoSimContextSelect (Async->SimContext);
+  Spins = 0;
+  Stop = FALSE;
+
+  while (!Stop) {
+    if (Head == Async->Tail.Value) {
+      if (Async->Idle != NULL) {
+        Async->Idle (Async->IdleContext);
+      }
+      AsyncWait (&Spins);
+      continue;
+    }
+    Spins = 0;
+
+    //
+    // Request is read only after its index was observed.
+    //
+    MemoryFence ();
+    Request = &Async->Requests[Head & Async->Mask];
+    switch (Request->Type) {
+      case AsyncRequestRead:
+        Value = 0;
+        Status = Device->Read (Device, Request->Address, Request->Size, &Value);
+        Async->CompletionValue = Value;
+        Async->CompletionStatus = Status;
+        break;
+      case AsyncRequestWrite:
+        Status = Device->Write (Device, Request->Address, Request->Size, Request->Value);
+        if (EFI_ERROR (Status)) {
+          DEBUG ((DEBUG_ERROR, "%s: Posted write to %LX failed %r\n", Async->RegisterSpace.Name, Request->Address, Status));
+          Async->WriteErrors++;
+        }
+        break;
+      case AsyncRequestStop:
+      default:
+        Stop = TRUE;
+        break;
+    }
+
+    //
+    // Completion has to be visible before the slot is released.
+    //
+    MemoryFence ();
+    Head++;
+    Async->Head.Value = Head;
+  }
+
+  return 0;
+}
+
+STATIC
+EFI_STATUS
+AsyncRegisterRead (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64                     Address,
+  IN UINT32                     Size,
+  OUT UINT64                    *Value
+  )
+{
+  ASYNC_REGISTER_SPACE  *Async;
+  UINT32                Index;
+
+  Async = (ASYNC_REGISTER_SPACE*) RegisterSpace;
+
+  //
+  // Only one read can be in flight so the single completion slot is enough.
+  //
+  Index = AsyncPush (Async, AsyncRequestRead, Address, Size, 0);
+  AsyncWaitForCompletion (Async, Index);
+  *Value = Async->CompletionValue;
+  return Async->CompletionStatus;
+}
+
+STATIC
+EFI_STATUS
+AsyncRegisterWrite (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64                     Address,
+  IN UINT32                     Size,
+  IN UINT64                     Value
+  )
+{
+  AsyncPush ((ASYNC_REGISTER_SPACE*) RegisterSpace, AsyncRequestWrite, Address, Size, Value);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AsyncRegisterSpaceCreate (
+  IN CHAR16                      *RegisterSpaceDescription,
+  IN REGISTER_ACCESS_INTERFACE   *Device,
+  IN UINT32                      QueueDepth,
+  IN ASYNC_REGISTER_SPACE_IDLE   Idle OPTIONAL,
+  IN VOID                        *IdleContext OPTIONAL,
+  OUT REGISTER_ACCESS_INTERFACE  **RegisterSpace
+  )
+{
+  ASYNC_REGISTER_SPACE  *Async;
+
+  if (Device == NULL || RegisterSpace == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (QueueDepth == 0) {
+    QueueDepth = ASYNC_REGISTER_SPACE_DEFAULT_QUEUE_DEPTH;
+  }
+  if (QueueDepth > BIT31) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (GetPowerOfTwo32 (QueueDepth) != QueueDepth) {
+    QueueDepth = GetPowerOfTwo32 (QueueDepth) << 1;
+  }
+
+  Async = AllocateZeroPool (sizeof (ASYNC_REGISTER_SPACE));
+  if (Async == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Async->Requests = AllocateZeroPool (QueueDepth * sizeof (ASYNC_REQUEST));
+  if (Async->Requests == NULL) {
+    FreePool (Async);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Async->RegisterSpace.Name = RegisterSpaceDescription;
+  Async->RegisterSpace.Read = AsyncRegisterRead;
+  Async->RegisterSpace.Write = AsyncRegisterWrite;
+  Async->RegisterSpace.WriteBlock = NULL;
+  Async->Device = Device;
+  Async->Idle = Idle;
+  Async->IdleContext = IdleContext;
+  Async->Mask = QueueDepth - 1;
+  Async->SimContext = RegisterAccessIoSimContextGetCurrent ();
+
+  if (EFI_ERROR (RegisterAccessIoSimTimeRegisterNotifier (Async->SimContext))) {
+    FreePool (Async->Requests);
+    FreePool (Async);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (thrd_create (&Async->Thread, AsyncDeviceThread, Async) != thrd_success) {
+    DEBUG ((DEBUG_ERROR, "%s: Failed to start device thread\n", RegisterSpaceDescription));
+    RegisterAccessIoSimTimeUnregisterNotifier (Async->SimContext);
+    FreePool (Async->Requests);
+    FreePool (Async);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *RegisterSpace = &Async->RegisterSpace;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AsyncRegisterSpaceSync (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace
+  )
+{
+  ASYNC_REGISTER_SPACE  *Async;
+  UINT32                WriteErrors;
+
+  if (RegisterSpace == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Async = (ASYNC_REGISTER_SPACE*) RegisterSpace;
+  AsyncWaitForCompletion (Async, Async->Tail.Value - 1);
+
+  WriteErrors = Async->WriteErrors;
+  if (WriteErrors != Async->ReportedWriteErrors) {
+    Async->ReportedWriteErrors = WriteErrors;
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AsyncRegisterSpaceNotify (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace
+  )
+{
+  if (RegisterSpace == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  RegisterAccessIoSimTimeNotify (((ASYNC_REGISTER_SPACE*) RegisterSpace)->SimContext);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AsyncRegisterSpaceDestroy (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace
+  )
+{
+  ASYNC_REGISTER_SPACE  *Async;
+
+  if (RegisterSpace == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Async = (ASYNC_REGISTER_SPACE*) RegisterSpace;
+  AsyncPush (Async, AsyncRequestStop, 0, 0, 0);
+  thrd_join (Async->Thread, NULL);
+  RegisterAccessIoSimTimeUnregisterNotifier (Async->SimContext);
+
+  FreePool (Async->Requests);
+  FreePool (Async);
+  return EFI_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+/** @file
+  Measures read round trip latency and posted write throughput of the
+  asynchronous register space against the same device model called directly.
+
+  Usage: AsyncRegisterSpaceLibBenchmark [NoOfAccesses] [QueueDepth]
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/DebugLib.h>
+#include <Library/FakeRegisterSpaceLib.h>
+#include <Library/AsyncRegisterSpaceLib.h>
+#include <Library/RegisterAccessIoLib.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../RegisterAccessIoLib/RegisterAccessIoLibInternal.h"
+
+#define BENCHMARK_DEVICE_NAME         L"BenchmarkDevice"
+#define BENCHMARK_ASYNC_NAME          L"BenchmarkDeviceAsync"
+#define BENCHMARK_DEVICE_ADDRESS      0x40000000
+#define BENCHMARK_DEVICE_SIZE         0x100
+#define BENCHMARK_DEFAULT_ACCESSES    1000000
+
+#define BENCHMARK_REG  0x0
+
+typedef struct {
+  UINT32  Register;
+} BENCHMARK_DEVICE;
+
+VOID
+BenchmarkDeviceRead (
+  IN  VOID    *Context,
+  IN  UINT64  Address,
+  IN  UINT32  ByteEnable,
+  OUT UINT32  *Value
+  )
+{
+  *Value = ((BENCHMARK_DEVICE*) Context)->Register & ByteEnableToBitMask (ByteEnable);
+}
+
+VOID
+BenchmarkDeviceWrite (
+  IN VOID    *Context,
+  IN UINT64  Address,
+  IN UINT32  ByteEnable,
+  IN UINT32  Value
+  )
+{
+  ((BENCHMARK_DEVICE*) Context)->Register = Value;
+}
+
+/**
+  Runs reads and writes against the register space registered at the
+  benchmark address and prints the results.
+
+  @param[in] Label          Name of the configuration.
+  @param[in] AsyncSpace     Asynchronous register space to sync after writes or NULL.
+  @param[in] NoOfAccesses   Number of reads and writes.
+**/
+STATIC
+VOID
+BenchmarkRun (
+  IN CONST CHAR8                *Label,
+  IN REGISTER_ACCESS_INTERFACE  *AsyncSpace OPTIONAL,
+  IN UINT32                     NoOfAccesses
+  )
+{
+  UINT64  Start;
+  UINT64  ReadTime;
+  UINT64  WriteTime;
+  UINT64  Sum;
+  UINT32  Index;
+
+  Sum = 0;
+  Start = RegisterAccessIoGetHostNanoseconds ();
+  for (Index = 0; Index < NoOfAccesses; Index++) {
+    Sum += MmioRead32 (BENCHMARK_DEVICE_ADDRESS + BENCHMARK_REG);
+  }
+  ReadTime = RegisterAccessIoGetHostNanoseconds () - Start;
+
+  Start = RegisterAccessIoGetHostNanoseconds ();
+  for (Index = 0; Index < NoOfAccesses; Index++) {
+    MmioWrite32 (BENCHMARK_DEVICE_ADDRESS + BENCHMARK_REG, Index);
+  }
+  if (AsyncSpace != NULL) {
+    AsyncRegisterSpaceSync (AsyncSpace);
+  }
+  WriteTime = RegisterAccessIoGetHostNanoseconds () - Start;
+
+  printf (
+    "%-16s read latency %8.1f ns   write throughput %8.2f M/s   (checksum %llu)\n",
+    Label,
+    (double) ReadTime / NoOfAccesses,
+    (WriteTime == 0) ? 0.0 : (double) NoOfAccesses * 1000.0 / (double) WriteTime,
+    (unsigned long long) Sum
+    );
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  BENCHMARK_DEVICE           Device;
+  REGISTER_ACCESS_INTERFACE  *FakeSpace;
+  REGISTER_ACCESS_INTERFACE  *AsyncSpace;
+  UINT32                     NoOfAccesses;
+  UINT32                     QueueDepth;
+  EFI_STATUS                 Status;
+
+  NoOfAccesses = (argc > 1) ? (UINT32) strtoul (argv[1], NULL, 0) : BENCHMARK_DEFAULT_ACCESSES;
+  QueueDepth = (argc > 2) ? (UINT32) strtoul (argv[2], NULL, 0) : ASYNC_REGISTER_SPACE_DEFAULT_QUEUE_DEPTH;
+  if (NoOfAccesses == 0) {
+    NoOfAccesses = BENCHMARK_DEFAULT_ACCESSES;
+  }
+
+  Device.Register = 0;
+  Status = FakeRegisterSpaceCreate (BENCHMARK_DEVICE_NAME, FakeRegisterSpaceAlignmentDword, BenchmarkDeviceWrite, BenchmarkDeviceRead, &Device, &FakeSpace);
+  if (EFI_ERROR (Status)) {
+    return 1;
+  }
+
+  RegisterAccessIoRegisterMmioAtAddress (FakeSpace, RegisterAccessIoTypeMmio, BENCHMARK_DEVICE_ADDRESS, BENCHMARK_DEVICE_SIZE);
+  BenchmarkRun ("Synchronous", NULL, NoOfAccesses);
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, BENCHMARK_DEVICE_ADDRESS);
+
+  Status = AsyncRegisterSpaceCreate (BENCHMARK_ASYNC_NAME, FakeSpace, QueueDepth, NULL, NULL, &AsyncSpace);
+  if (EFI_ERROR (Status)) {
+    FakeRegisterSpaceDestroy (FakeSpace);
+    return 1;
+  }
+
+  RegisterAccessIoRegisterMmioAtAddress (AsyncSpace, RegisterAccessIoTypeMmio, BENCHMARK_DEVICE_ADDRESS, BENCHMARK_DEVICE_SIZE);
+  BenchmarkRun ("Asynchronous", AsyncSpace, NoOfAccesses);
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, BENCHMARK_DEVICE_ADDRESS);
+
+  AsyncRegisterSpaceDestroy (AsyncSpace);
+  FakeRegisterSpaceDestroy (FakeSpace);
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,433 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/FakeRegisterSpaceLib.h>
+#include <Library/AsyncRegisterSpaceLib.h>
+#include <Library/RegisterAccessIoLib.h>
+
+#include <threads.h>
+
+#define UNIT_TEST_NAME     "AsyncRegisterSpaceLib unit tests"
+#define UNIT_TEST_VERSION  "0.1"
+
+#define ASYNC_TEST_DEVICE_NAME     L"AsyncTestDevice"
+#define ASYNC_TEST_ASYNC_NAME      L"AsyncTestDeviceAsync"
+#define ASYNC_TEST_DEVICE_ADDRESS  0x30000000
+#define ASYNC_TEST_DEVICE_SIZE     0x100
+#define ASYNC_TEST_QUEUE_DEPTH     4
+#define ASYNC_TEST_NO_OF_WRITES    1000
+#define ASYNC_TEST_JOB_LENGTH      100
+#define ASYNC_TEST_WAIT_TIMEOUT    1000000000ULL
+
+#define ASYNC_TEST_DOORBELL_REG  0x0 // WO, write starts a job
+#define ASYNC_TEST_STATUS_REG    0x4 // RO, BIT0 set while job is running
+#define ASYNC_TEST_SCRATCH_REG   0x8 // RW
+#define ASYNC_TEST_ERROR_REG     0xC // Writes fail
+
+typedef struct {
+  UINT32   Scratch;
+  UINT32   WriteCount;
+  BOOLEAN  Busy;
+  UINT32   Remaining;
+  UINT32   IdleCount;
+  BOOLEAN  CalledFromDriverThread;
+  thrd_t   DriverThread;
+  //
+  // Simulation context current when the device model last ran.
+  //
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *SimContext;
+  //
+  // Register space notified when a job completes.
+  //
+  REGISTER_ACCESS_INTERFACE  *AsyncRegisterSpace;
+} ASYNC_TEST_DEVICE;
+
+typedef struct {
+  ASYNC_TEST_DEVICE          Device;
+  REGISTER_ACCESS_INTERFACE  *FakeRegisterSpace;
+  REGISTER_ACCESS_INTERFACE  *AsyncRegisterSpace;
+} ASYNC_TEST_CONTEXT;
+
+VOID
+AsyncTestDeviceRead (
+  IN  VOID    *Context,
+  IN  UINT64  Address,
+  IN  UINT32  ByteEnable,
+  OUT UINT32  *Value
+  )
+{
+  ASYNC_TEST_DEVICE  *Device;
+
+  Device = (ASYNC_TEST_DEVICE*) Context;
+  if (thrd_equal (thrd_current (), Device->DriverThread)) {
+    Device->CalledFromDriverThread = TRUE;
+  }
+
+  switch (Address) {
+    case ASYNC_TEST_STATUS_REG:
+      *Value = Device->Busy ? BIT0 : 0;
+      break;
+    case ASYNC_TEST_SCRATCH_REG:
+      *Value = Device->Scratch;
+      break;
+    default:
+      *Value = 0xFFFFFFFF;
+      break;
+  }
+  *Value &= ByteEnableToBitMask (ByteEnable);
+}
+
+VOID
+AsyncTestDeviceWrite (
+  IN VOID    *Context,
+  IN UINT64  Address,
+  IN UINT32  ByteEnable,
+  IN UINT32  Value
+  )
+{
+  ASYNC_TEST_DEVICE  *Device;
+  UINT32             ByteMask;
+
+  Device = (ASYNC_TEST_DEVICE*) Context;
+  if (thrd_equal (thrd_current (), Device->DriverThread)) {
+    Device->CalledFromDriverThread = TRUE;
+  }
+
+  Device->WriteCount++;
+  Device->SimContext = RegisterAccessIoSimContextGetCurrent ();
+  ByteMask = ByteEnableToBitMask (ByteEnable);
+  switch (Address) {
+    case ASYNC_TEST_DOORBELL_REG:
+      Device->Busy = TRUE;
+      Device->Remaining = ASYNC_TEST_JOB_LENGTH;
+      break;
+    case ASYNC_TEST_SCRATCH_REG:
+      Device->Scratch &= ~ByteMask;
+      Device->Scratch |= (Value & ByteMask);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+  Job started with the doorbell completes after a number of idle calls
+  without any further driver access.
+**/
+VOID
+AsyncTestDeviceIdle (
+  IN VOID  *Context
+  )
+{
+  ASYNC_TEST_DEVICE  *Device;
+
+  Device = (ASYNC_TEST_DEVICE*) Context;
+  Device->IdleCount++;
+  if (Device->Busy) {
+    Device->Remaining--;
+    if (Device->Remaining == 0) {
+      Device->Busy = FALSE;
+      if (Device->AsyncRegisterSpace != NULL) {
+        AsyncRegisterSpaceNotify (Device->AsyncRegisterSpace);
+      }
+    }
+  }
+}
+
+//
+// Minimal register space failing writes to the error register. Used to check
+// that failures of posted writes are reported by sync.
+//
+EFI_STATUS
+AsyncTestErrorRead (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64                     Address,
+  IN UINT32                     Size,
+  OUT UINT64                    *Value
+  )
+{
+  *Value = 0;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AsyncTestErrorWrite (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64                     Address,
+  IN UINT32                     Size,
+  IN UINT64                     Value
+  )
+{
+  return (Address == ASYNC_TEST_ERROR_REG) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+AsyncTestPrerequisite (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ASYNC_TEST_CONTEXT  *TestContext;
+  EFI_STATUS          Status;
+
+  TestContext = (ASYNC_TEST_CONTEXT*) Context;
+  ZeroMem (&TestContext->Device, sizeof (TestContext->Device));
+  TestContext->Device.DriverThread = thrd_current ();
+
+  Status = FakeRegisterSpaceCreate (ASYNC_TEST_DEVICE_NAME, FakeRegisterSpaceAlignmentDword, AsyncTestDeviceWrite, AsyncTestDeviceRead, &TestContext->Device, &TestContext->FakeRegisterSpace);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = AsyncRegisterSpaceCreate (ASYNC_TEST_ASYNC_NAME, TestContext->FakeRegisterSpace, ASYNC_TEST_QUEUE_DEPTH, AsyncTestDeviceIdle, &TestContext->Device, &TestContext->AsyncRegisterSpace);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  TestContext->Device.AsyncRegisterSpace = TestContext->AsyncRegisterSpace;
+
+  Status = RegisterAccessIoRegisterMmioAtAddress (TestContext->AsyncRegisterSpace, RegisterAccessIoTypeMmio, ASYNC_TEST_DEVICE_ADDRESS, ASYNC_TEST_DEVICE_SIZE);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+VOID
+EFIAPI
+AsyncTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ASYNC_TEST_CONTEXT  *TestContext;
+
+  TestContext = (ASYNC_TEST_CONTEXT*) Context;
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, ASYNC_TEST_DEVICE_ADDRESS);
+  AsyncRegisterSpaceDestroy (TestContext->AsyncRegisterSpace);
+  FakeRegisterSpaceDestroy (TestContext->FakeRegisterSpace);
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+AsyncRegisterSpaceCreateTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_INTERFACE  ErrorDevice;
+  REGISTER_ACCESS_INTERFACE  *RegisterSpace;
+
+  ErrorDevice.Name = ASYNC_TEST_DEVICE_NAME;
+  ErrorDevice.Read = AsyncTestErrorRead;
+  ErrorDevice.Write = AsyncTestErrorWrite;
+  ErrorDevice.WriteBlock = NULL;
+
+  UT_ASSERT_EQUAL (AsyncRegisterSpaceCreate (ASYNC_TEST_ASYNC_NAME, NULL, 0, NULL, NULL, &RegisterSpace), EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (AsyncRegisterSpaceCreate (ASYNC_TEST_ASYNC_NAME, &ErrorDevice, 0, NULL, NULL, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (AsyncRegisterSpaceSync (NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (AsyncRegisterSpaceDestroy (NULL), EFI_INVALID_PARAMETER);
+
+  //
+  // Queue depth which is not a power of 2 is rounded up.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (AsyncRegisterSpaceCreate (ASYNC_TEST_ASYNC_NAME, &ErrorDevice, 3, NULL, NULL, &RegisterSpace));
+  UT_ASSERT_NOT_EFI_ERROR (AsyncRegisterSpaceSync (RegisterSpace));
+
+  //
+  // Failed posted write is reported by the next sync only.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterSpace->Write (RegisterSpace, ASYNC_TEST_ERROR_REG, 4, 0));
+  UT_ASSERT_EQUAL (AsyncRegisterSpaceSync (RegisterSpace), EFI_DEVICE_ERROR);
+  UT_ASSERT_NOT_EFI_ERROR (AsyncRegisterSpaceSync (RegisterSpace));
+  UT_ASSERT_NOT_EFI_ERROR (AsyncRegisterSpaceDestroy (RegisterSpace));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+AsyncRegisterSpaceOrderingTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ASYNC_TEST_CONTEXT  *TestContext;
+  UINT32              Index;
+
+  TestContext = (ASYNC_TEST_CONTEXT*) Context;
+
+  //
+  // Queue is much shorter than the number of writes so the driver keeps
+  // waiting for free slots. Read has to observe the last write.
+  //
+  for (Index = 0; Index < ASYNC_TEST_NO_OF_WRITES; Index++) {
+    MmioWrite32 (ASYNC_TEST_DEVICE_ADDRESS + ASYNC_TEST_SCRATCH_REG, Index);
+  }
+  UT_ASSERT_EQUAL (MmioRead32 (ASYNC_TEST_DEVICE_ADDRESS + ASYNC_TEST_SCRATCH_REG), ASYNC_TEST_NO_OF_WRITES - 1);
+  UT_ASSERT_EQUAL (TestContext->Device.WriteCount, ASYNC_TEST_NO_OF_WRITES);
+
+  for (Index = 0; Index < ASYNC_TEST_NO_OF_WRITES; Index++) {
+    MmioWrite8 (ASYNC_TEST_DEVICE_ADDRESS + ASYNC_TEST_SCRATCH_REG + (Index % 4), (UINT8) Index);
+  }
+  UT_ASSERT_NOT_EFI_ERROR (AsyncRegisterSpaceSync (TestContext->AsyncRegisterSpace));
+  UT_ASSERT_EQUAL (TestContext->Device.WriteCount, 2 * ASYNC_TEST_NO_OF_WRITES);
+  UT_ASSERT_EQUAL (MmioRead32 (ASYNC_TEST_DEVICE_ADDRESS + ASYNC_TEST_SCRATCH_REG), 0xE7E6E5E4);
+
+  UT_ASSERT_FALSE (TestContext->Device.CalledFromDriverThread);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+AsyncRegisterSpaceIdleTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ASYNC_TEST_CONTEXT  *TestContext;
+  UINTN               Polls;
+
+  TestContext = (ASYNC_TEST_CONTEXT*) Context;
+
+  //
+  // Job completes on the device thread while the driver polls the status.
+  //
+  MmioWrite32 (ASYNC_TEST_DEVICE_ADDRESS + ASYNC_TEST_DOORBELL_REG, 1);
+  Polls = 0;
+  while ((MmioRead32 (ASYNC_TEST_DEVICE_ADDRESS + ASYNC_TEST_STATUS_REG) & BIT0) != 0) {
+    Polls++;
+    UT_ASSERT_TRUE (Polls < MAX_UINT32);
+  }
+  UT_ASSERT_FALSE (TestContext->Device.Busy);
+  UT_ASSERT_TRUE (TestContext->Device.IdleCount >= ASYNC_TEST_JOB_LENGTH);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+AsyncRegisterSpaceNotifyTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ASYNC_TEST_CONTEXT  *TestContext;
+  UINTN               Polls;
+  UINT64              Start;
+
+  TestContext = (ASYNC_TEST_CONTEXT*) Context;
+
+  UT_ASSERT_EQUAL (AsyncRegisterSpaceNotify (NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_FALSE (RegisterAccessIoSimTimeIsIdle ());
+
+  //
+  // Driver waits on the notification instead of spinning on the status
+  // register. Wait may end once for a notification of an earlier job.
+  //
+  MmioWrite32 (ASYNC_TEST_DEVICE_ADDRESS + ASYNC_TEST_DOORBELL_REG, 1);
+  Start = RegisterAccessIoSimTimeGetNow ();
+  Polls = 0;
+  while ((MmioRead32 (ASYNC_TEST_DEVICE_ADDRESS + ASYNC_TEST_STATUS_REG) & BIT0) != 0) {
+    Polls++;
+    UT_ASSERT_TRUE (Polls <= 2);
+    RegisterAccessIoSimTimeWait (ASYNC_TEST_WAIT_TIMEOUT);
+  }
+  UT_ASSERT_FALSE (TestContext->Device.Busy);
+  UT_ASSERT_TRUE (RegisterAccessIoSimTimeGetNow () - Start < ASYNC_TEST_WAIT_TIMEOUT);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+AsyncRegisterSpaceSimContextTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ASYNC_TEST_DEVICE               Device;
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *SimContext;
+  REGISTER_ACCESS_INTERFACE       *FakeRegisterSpace;
+  REGISTER_ACCESS_INTERFACE       *AsyncRegisterSpace;
+
+  ZeroMem (&Device, sizeof (Device));
+  Device.DriverThread = thrd_current ();
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimContextCreate (&SimContext));
+  RegisterAccessIoSimContextSelect (SimContext);
+
+  //
+  // Device model running on the device thread sees the context of the
+  // driver which created the register space.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (FakeRegisterSpaceCreate (ASYNC_TEST_DEVICE_NAME, FakeRegisterSpaceAlignmentDword, AsyncTestDeviceWrite, AsyncTestDeviceRead, &Device, &FakeRegisterSpace));
+  UT_ASSERT_NOT_EFI_ERROR (AsyncRegisterSpaceCreate (ASYNC_TEST_ASYNC_NAME, FakeRegisterSpace, ASYNC_TEST_QUEUE_DEPTH, NULL, NULL, &AsyncRegisterSpace));
+  UT_ASSERT_NOT_EFI_ERROR (AsyncRegisterSpace->Write (AsyncRegisterSpace, ASYNC_TEST_SCRATCH_REG, 4, 1));
+  UT_ASSERT_NOT_EFI_ERROR (AsyncRegisterSpaceSync (AsyncRegisterSpace));
+  AsyncRegisterSpaceDestroy (AsyncRegisterSpace);
+  FakeRegisterSpaceDestroy (FakeRegisterSpace);
+
+  RegisterAccessIoSimContextSelect (NULL);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimContextDestroy (SimContext));
+  UT_ASSERT_EQUAL (Device.WriteCount, 1);
+  UT_ASSERT_EQUAL (Device.SimContext, SimContext);
+  UT_ASSERT_FALSE (Device.CalledFromDriverThread);
+
+  return UNIT_TEST_PASSED;
+}
+
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      AsyncRegisterSpaceLibTest;
+  ASYNC_TEST_CONTEXT          TestContext;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    return Status;
+  }
+
+  Status = CreateUnitTestSuite (&AsyncRegisterSpaceLibTest, Framework, "AsyncRegisterSpaceLibUnitTests", "AsyncRegisterSpaceLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  AddTestCase (AsyncRegisterSpaceLibTest, "AsyncRegisterSpaceCreateTest", "AsyncRegisterSpaceCreateTest", AsyncRegisterSpaceCreateTest, NULL, NULL, NULL);
+  AddTestCase (AsyncRegisterSpaceLibTest, "AsyncRegisterSpaceOrderingTest", "AsyncRegisterSpaceOrderingTest", AsyncRegisterSpaceOrderingTest, AsyncTestPrerequisite, AsyncTestCleanup, &TestContext);
+  AddTestCase (AsyncRegisterSpaceLibTest, "AsyncRegisterSpaceIdleTest", "AsyncRegisterSpaceIdleTest", AsyncRegisterSpaceIdleTest, AsyncTestPrerequisite, AsyncTestCleanup, &TestContext);
+  AddTestCase (AsyncRegisterSpaceLibTest, "AsyncRegisterSpaceNotifyTest", "AsyncRegisterSpaceNotifyTest", AsyncRegisterSpaceNotifyTest, AsyncTestPrerequisite, AsyncTestCleanup, &TestContext);
+  AddTestCase (AsyncRegisterSpaceLibTest, "AsyncRegisterSpaceSimContextTest", "AsyncRegisterSpaceSimContextTest", AsyncRegisterSpaceSimContextTest, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UefiTestMain ();
+}
\ No newline at end of file
@@ -0,0 +1,331 @@
+/** @file
+  Coroutine device models on top of FakeRegisterSpaceLib.
+
+  Suspended tasks are kept in lists of the awaiting condition. Register
+  writes and virtual time events resume them inline, so a multi-step device
+  behavior is a plain sequence of awaits instead of a state machine spread
+  over write callbacks.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <exception>
+#include <algorithm>
+#include <Library/CoroutineDeviceLib.hpp>
+extern "C" {
+  #include <Library/BaseLib.h>
+  #include <Library/DebugLib.h>
+  #include <Library/BaseMemoryLib.h>
+  #include <Library/RegisterAccessIoLib.h>
+  #include <Library/RegisterAccessPciLib.h>
+}
+
+std::coroutine_handle<>
+CoroutineDeviceTask::FinalAwaiter::await_suspend (
+  Handle  Task
+  ) noexcept
+{
+  if (Task.promise ().Continuation) {
+    return Task.promise ().Continuation;
+  }
+
+  //
+  // Task is suspended for good so its frame can be freed from here. Nothing
+  // touches the frame after Finish returns.
+  //
+  if (Task.promise ().Owner != nullptr) {
+    Task.promise ().Owner->Finish (Task);
+  }
+  return std::noop_coroutine ();
+}
+
+void
+CoroutineDeviceTask::promise_type::unhandled_exception (
+  )
+{
+  DEBUG ((DEBUG_ERROR, "Unhandled exception in device model task\n"));
+  std::terminate ();
+}
+
+CoroutineDeviceTask::CoroutineDeviceTask (
+  CoroutineDeviceTask  &&Other
+  ) noexcept : Coroutine (Other.Release ())
+{
+}
+
+CoroutineDeviceTask::~CoroutineDeviceTask (
+  )
+{
+  if (Coroutine) {
+    Coroutine.destroy ();
+  }
+}
+
+std::coroutine_handle<>
+CoroutineDeviceTask::await_suspend (
+  std::coroutine_handle<>  Caller
+  ) noexcept
+{
+  Coroutine.promise ().Continuation = Caller;
+  return Coroutine;
+}
+
+CoroutineDeviceTask::Handle
+CoroutineDeviceTask::Release (
+  )
+{
+  Handle  Task;
+
+  Task = Coroutine;
+  Coroutine = nullptr;
+  return Task;
+}
+
+void
+CoroutineDeviceWrite::await_suspend (
+  std::coroutine_handle<>  Handle
+  )
+{
+  this->Handle = Handle;
+  Device->WriteWaiters.push_back (this);
+}
+
+/**
+  Returns false to resume the task right away with the error if the event
+  can't be scheduled, there would be nothing to resume it otherwise.
+**/
+bool
+CoroutineDeviceDelay::await_suspend (
+  std::coroutine_handle<>  Handle
+  )
+{
+  EFI_STATUS  ScheduleStatus;
+
+  this->Handle = Handle;
+  ScheduleStatus = RegisterAccessIoSimTimeSchedule (Nanoseconds, CoroutineDeviceDelay::Expired, this, &EventId);
+  if (EFI_ERROR (ScheduleStatus)) {
+    DEBUG ((DEBUG_ERROR, "%s: Failed to schedule device event %r\n", Device->GetRegisterSpace ()->Name, ScheduleStatus));
+    Status = ScheduleStatus;
+    return false;
+  }
+
+  Device->DelayWaiters.push_back (this);
+  return true;
+}
+
+VOID
+CoroutineDeviceDelay::Expired (
+  VOID  *Context
+  )
+{
+  CoroutineDeviceDelay  *Delay;
+  CoroutineDevice       *Device;
+
+  Delay = (CoroutineDeviceDelay*) Context;
+  Device = Delay->Device;
+  Device->DelayWaiters.erase (std::find (Device->DelayWaiters.begin (), Device->DelayWaiters.end (), Delay));
+  Delay->EventId = 0;
+  Delay->Status = EFI_SUCCESS;
+  Delay->Expire ();
+  Delay->Handle.resume ();
+}
+
+VOID
+CoroutineDeviceDma::Expire (
+  )
+{
+  VOID  *HostAddress;
+
+  Status = RegisterAccessPciIoGetHostAddressFromDeviceAddress (DeviceAddress, &HostAddress);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%s: DMA to unmapped address %X\n", Device->GetRegisterSpace ()->Name, DeviceAddress));
+    return;
+  }
+
+  if (ToHost) {
+    CopyMem (HostAddress, Buffer, Length);
+  } else {
+    CopyMem (Buffer, HostAddress, Length);
+  }
+}
+
+EFI_STATUS
+CoroutineDevice::Create (
+  CHAR16  *Name,
+  UINT32  Size
+  )
+{
+  EFI_STATUS  Status;
+
+  if (Size == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (RegisterSpace != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  Registers.assign ((Size + sizeof (UINT32) - 1) / sizeof (UINT32), 0);
+  Status = FakeRegisterSpaceCreate (Name, FakeRegisterSpaceAlignmentDword, CoroutineDevice::Write, CoroutineDevice::Read, this, &RegisterSpace);
+  if (EFI_ERROR (Status)) {
+    RegisterSpace = NULL;
+    Registers.clear ();
+  }
+
+  return Status;
+}
+
+VOID
+CoroutineDevice::Destroy (
+  )
+{
+  if (RegisterSpace == NULL) {
+    return;
+  }
+
+  //
+  // Awaiters live in the task frames, so they are dropped before the frames.
+  //
+  for (CoroutineDeviceDelay *Delay : DelayWaiters) {
+    RegisterAccessIoSimTimeCancel (Delay->EventId);
+  }
+  DelayWaiters.clear ();
+  WriteWaiters.clear ();
+
+  for (CoroutineDeviceTask::Handle Task : Tasks) {
+    Task.destroy ();
+  }
+  Tasks.clear ();
+
+  FakeRegisterSpaceDestroy (RegisterSpace);
+  RegisterSpace = NULL;
+  Registers.clear ();
+}
+
+UINT32
+CoroutineDevice::GetRegister (
+  UINT64  Address
+  )
+{
+  if (Address / sizeof (UINT32) >= Registers.size ()) {
+    return MAX_UINT32;
+  }
+  return Registers[Address / sizeof (UINT32)];
+}
+
+VOID
+CoroutineDevice::SetRegister (
+  UINT64  Address,
+  UINT32  Value
+  )
+{
+  if (Address / sizeof (UINT32) < Registers.size ()) {
+    Registers[Address / sizeof (UINT32)] = Value;
+  }
+}
+
+VOID
+CoroutineDevice::Start (
+  CoroutineDeviceTask  &&Task
+  )
+{
+  CoroutineDeviceTask::Handle  Coroutine;
+
+  Coroutine = Task.Release ();
+  Coroutine.promise ().Owner = this;
+  Tasks.push_back (Coroutine);
+  Coroutine.resume ();
+}
+
+/**
+  Frees the frame of a started task which reached its final suspend point.
+**/
+VOID
+CoroutineDevice::Finish (
+  CoroutineDeviceTask::Handle  Task
+  )
+{
+  Tasks.erase (std::find (Tasks.begin (), Tasks.end (), Task));
+  Task.destroy ();
+}
+
+VOID
+CoroutineDevice::SetDmaTiming (
+  UINT64  Latency,
+  UINT64  BytesPerMicrosecond
+  )
+{
+  DmaLatency = Latency;
+  DmaBytesPerMicrosecond = BytesPerMicrosecond;
+}
+
+UINT64
+CoroutineDevice::GetDmaTime (
+  UINTN  Length
+  )
+{
+  if (DmaBytesPerMicrosecond == 0) {
+    return DmaLatency;
+  }
+  return DmaLatency + DivU64x64Remainder (MultU64x32 (Length, 1000), DmaBytesPerMicrosecond, NULL);
+}
+
+/**
+  Resumes tasks waiting for the write which just updated the register. Only
+  tasks waiting before the write are considered, a task which awaits the same
+  register again after resuming waits for the next write.
+**/
+VOID
+CoroutineDevice::CompleteWrite (
+  UINT64  Address
+  )
+{
+  std::vector<CoroutineDeviceWrite*>  Ready;
+  UINT32                              Value;
+
+  Value = GetRegister (Address);
+  for (auto Iterator = WriteWaiters.begin (); Iterator != WriteWaiters.end ();) {
+    if ((*Iterator)->Address == Address && (Value & (*Iterator)->Mask) == (*Iterator)->Expected) {
+      (*Iterator)->Value = Value;
+      Ready.push_back (*Iterator);
+      Iterator = WriteWaiters.erase (Iterator);
+    } else {
+      Iterator++;
+    }
+  }
+
+  for (CoroutineDeviceWrite *Waiter : Ready) {
+    Waiter->Handle.resume ();
+  }
+}
+
+VOID
+CoroutineDevice::Read (
+  VOID    *Context,
+  UINT64  Address,
+  UINT32  ByteEnable,
+  UINT32  *Value
+  )
+{
+  *Value = ((CoroutineDevice*) Context)->GetRegister (Address) & ByteEnableToBitMask (ByteEnable);
+}
+
+VOID
+CoroutineDevice::Write (
+  VOID    *Context,
+  UINT64  Address,
+  UINT32  ByteEnable,
+  UINT32  Value
+  )
+{
+  CoroutineDevice  *Device;
+  UINT32           Mask;
+
+  Device = (CoroutineDevice*) Context;
+  Mask = ByteEnableToBitMask (ByteEnable);
+  Device->SetRegister (Address, (Device->GetRegister (Address) & ~Mask) | (Value & Mask));
+  Device->OnWrite (Address, ByteEnable, Value);
+  Device->CompleteWrite (Address);
+}
\ No newline at end of file
@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+#include <exception>
+#include <Library/CoroutineDeviceLib.hpp>
+extern "C" {
+  #include <Library/BaseMemoryLib.h>
+  #include <Library/IoLib.h>
+  #include <Library/RegisterAccessIoLib.h>
+  #include <Library/RegisterAccessPciLib.h>
+}
+
+#define COROUTINE_TEST_DEVICE_NAME     L"CoroutineTestDevice"
+#define COROUTINE_TEST_CONFIG_NAME     L"CoroutineTestDeviceConfig"
+#define COROUTINE_TEST_DEVICE_ADDRESS  0x60000000
+#define COROUTINE_TEST_DEVICE_SIZE     0x100
+#define COROUTINE_TEST_RESET_TIME      1000000
+#define COROUTINE_TEST_DATA_SIZE       64
+
+#define COROUTINE_TEST_CONTROL_REG   0x0  // BIT0 reset, BIT1 start command
+#define COROUTINE_TEST_STATUS_REG    0x4  // BIT0 ready, BIT1 busy, BIT2 command done, BIT3 command failed
+#define COROUTINE_TEST_DMA_ADDR_REG  0x8
+#define COROUTINE_TEST_DMA_SIZE_REG  0xC
+
+#define COROUTINE_TEST_CONTROL_RESET  BIT0
+#define COROUTINE_TEST_CONTROL_START  BIT1
+#define COROUTINE_TEST_STATUS_READY   BIT0
+#define COROUTINE_TEST_STATUS_BUSY    BIT1
+#define COROUTINE_TEST_STATUS_DONE    BIT2
+#define COROUTINE_TEST_STATUS_FAILED  BIT3
+
+//
+// Counts freed frames of the tasks it was passed to.
+//
+class CoroutineTestFrameGuard {
+  public:
+  explicit CoroutineTestFrameGuard (UINT32 *Freed) : Freed (Freed) {}
+  CoroutineTestFrameGuard (CoroutineTestFrameGuard &&Other) noexcept : Freed (Other.Freed) { Other.Freed = nullptr; }
+  ~CoroutineTestFrameGuard () { if (Freed != nullptr) { (*Freed)++; } }
+
+  private:
+  UINT32  *Freed;
+};
+
+//
+// Device which resets in COROUTINE_TEST_RESET_TIME and executes a command
+// that reads a buffer from the host, inverts it and writes it back.
+//
+class CoroutineTestDevice : public CoroutineDevice {
+  public:
+  UINT8   Data[COROUTINE_TEST_DATA_SIZE];
+  UINT32  NoOfCommands = 0;
+
+  CoroutineDeviceTask Reset () {
+    SetRegister (COROUTINE_TEST_STATUS_REG, COROUTINE_TEST_STATUS_BUSY);
+    co_await Delay (COROUTINE_TEST_RESET_TIME);
+    SetRegister (COROUTINE_TEST_STATUS_REG, COROUTINE_TEST_STATUS_READY);
+  }
+
+  CoroutineDeviceTask Command () {
+    UINT32      Size;
+    EFI_STATUS  Status;
+
+    SetRegister (COROUTINE_TEST_STATUS_REG, COROUTINE_TEST_STATUS_BUSY);
+    Size = MIN (GetRegister (COROUTINE_TEST_DMA_SIZE_REG), sizeof (Data));
+    Status = co_await DmaRead (GetRegister (COROUTINE_TEST_DMA_ADDR_REG), Data, Size);
+    if (EFI_ERROR (Status)) {
+      SetRegister (COROUTINE_TEST_STATUS_REG, COROUTINE_TEST_STATUS_READY | COROUTINE_TEST_STATUS_FAILED);
+      co_return;
+    }
+
+    for (UINT32 Index = 0; Index < Size; Index++) {
+      Data[Index] = ~Data[Index];
+    }
+
+    Status = co_await DmaWrite (GetRegister (COROUTINE_TEST_DMA_ADDR_REG), Data, Size);
+    SetRegister (COROUTINE_TEST_STATUS_REG, COROUTINE_TEST_STATUS_READY | COROUTINE_TEST_STATUS_DONE | (EFI_ERROR (Status) ? COROUTINE_TEST_STATUS_FAILED : 0));
+    NoOfCommands++;
+  }
+
+  CoroutineDeviceTask Wait (CoroutineTestFrameGuard Guard, UINT64 Nanoseconds) {
+    EFI_STATUS  Status;
+
+    Status = co_await Delay (Nanoseconds);
+    if (EFI_ERROR (Status)) {
+      SetRegister (COROUTINE_TEST_STATUS_REG, COROUTINE_TEST_STATUS_FAILED);
+    }
+  }
+
+  CoroutineDeviceTask Run () {
+    UINT32  Control;
+
+    while (TRUE) {
+      Control = co_await WaitForWrite (COROUTINE_TEST_CONTROL_REG);
+      if ((Control & COROUTINE_TEST_CONTROL_RESET) != 0) {
+        co_await Reset ();
+      } else if ((Control & COROUTINE_TEST_CONTROL_START) != 0 && (GetRegister (COROUTINE_TEST_STATUS_REG) & COROUTINE_TEST_STATUS_READY) != 0) {
+        co_await Command ();
+      }
+    }
+  }
+};
+
+class CoroutineDeviceTest : public ::testing::Test {
+  protected:
+  void SetUp() override {
+    EFI_STATUS  Status;
+
+    RegisterAccessIoSimTimeReset ();
+
+    Status = Config.Create ((CHAR16*) COROUTINE_TEST_CONFIG_NAME, 0x1000);
+    if (EFI_ERROR (Status)) {
+      throw new std::bad_alloc();
+    }
+
+    Status = Device.Create ((CHAR16*) COROUTINE_TEST_DEVICE_NAME, COROUTINE_TEST_DEVICE_SIZE);
+    if (EFI_ERROR (Status)) {
+      throw new std::bad_alloc();
+    }
+
+    Status = RegisterAccessPciDeviceInitialize (Config.GetRegisterSpace (), 0, 0, 0, 0, &PciDev);
+    if (EFI_ERROR (Status)) {
+      throw new std::bad_alloc();
+    }
+
+    Status = RegisterAccessPciDeviceRegisterBar (PciDev, Device.GetRegisterSpace (), 0, RegisterAccessIoTypeMmio, COROUTINE_TEST_DEVICE_ADDRESS, COROUTINE_TEST_DEVICE_SIZE);
+    if (EFI_ERROR (Status)) {
+      throw new std::bad_function_call();
+    }
+
+    Status = RegisterAccessPciIoCreate (PciDev, &PciIo);
+    if (EFI_ERROR (Status)) {
+      throw new std::bad_alloc();
+    }
+
+    Device.Start (Device.Run ());
+  }
+
+  void TearDown() override {
+    RegisterAccessPciIoDestroy (PciIo);
+    RegisterAccessPciDeviceDestroy (PciDev);
+    Device.Destroy ();
+    Config.Destroy ();
+    RegisterAccessIoSimTimeReset ();
+  }
+
+  UINT32 ReadStatus () {
+    return MmioRead32 (COROUTINE_TEST_DEVICE_ADDRESS + COROUTINE_TEST_STATUS_REG);
+  }
+
+  VOID ResetDevice () {
+    MmioWrite32 (COROUTINE_TEST_DEVICE_ADDRESS + COROUTINE_TEST_CONTROL_REG, COROUTINE_TEST_CONTROL_RESET);
+    RegisterAccessIoSimTimeAdvance (COROUTINE_TEST_RESET_TIME);
+  }
+
+  CoroutineDevice             Config;
+  CoroutineTestDevice         Device;
+  REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+  EFI_PCI_IO_PROTOCOL         *PciIo;
+};
+
+TEST_F(CoroutineDeviceTest, ResetHandshakeTest) {
+  EXPECT_EQ (ReadStatus (), 0);
+
+  MmioWrite32 (COROUTINE_TEST_DEVICE_ADDRESS + COROUTINE_TEST_CONTROL_REG, COROUTINE_TEST_CONTROL_RESET);
+  EXPECT_EQ (ReadStatus (), COROUTINE_TEST_STATUS_BUSY);
+  RegisterAccessIoSimTimeAdvance (COROUTINE_TEST_RESET_TIME / 2);
+  EXPECT_EQ (ReadStatus (), COROUTINE_TEST_STATUS_BUSY);
+  RegisterAccessIoSimTimeAdvance (COROUTINE_TEST_RESET_TIME / 2);
+  EXPECT_EQ (ReadStatus (), COROUTINE_TEST_STATUS_READY);
+
+  //
+  // Model loops back to wait for the next write after the reset task finishes.
+  //
+  ResetDevice ();
+  EXPECT_EQ (ReadStatus (), COROUTINE_TEST_STATUS_READY);
+  EXPECT_TRUE (RegisterAccessIoSimTimeIsIdle ());
+}
+
+TEST_F(CoroutineDeviceTest, DmaCommandTest) {
+  UINT8                 Buffer[COROUTINE_TEST_DATA_SIZE];
+  UINTN                 NumberOfBytes;
+  EFI_PHYSICAL_ADDRESS  DeviceAddress;
+  VOID                  *Mapping;
+  EFI_STATUS            Status;
+
+  SetMem (Buffer, sizeof (Buffer), 0x5A);
+  ResetDevice ();
+
+  NumberOfBytes = sizeof (Buffer);
+  Status = PciIo->Map (PciIo, EfiPciIoOperationBusMasterCommonBuffer, Buffer, &NumberOfBytes, &DeviceAddress, &Mapping);
+  ASSERT_EQ (Status, EFI_SUCCESS);
+
+  MmioWrite32 (COROUTINE_TEST_DEVICE_ADDRESS + COROUTINE_TEST_DMA_ADDR_REG, (UINT32) DeviceAddress);
+  MmioWrite32 (COROUTINE_TEST_DEVICE_ADDRESS + COROUTINE_TEST_DMA_SIZE_REG, sizeof (Buffer));
+  MmioWrite32 (COROUTINE_TEST_DEVICE_ADDRESS + COROUTINE_TEST_CONTROL_REG, COROUTINE_TEST_CONTROL_START);
+  EXPECT_EQ (ReadStatus (), COROUTINE_TEST_STATUS_BUSY);
+
+  //
+  // Buffer is only written when the second transfer completes.
+  //
+  RegisterAccessIoSimTimeAdvance (COROUTINE_DEVICE_DMA_LATENCY + sizeof (Buffer));
+  EXPECT_EQ (Buffer[0], 0x5A);
+  RegisterAccessIoSimTimeAdvance (COROUTINE_DEVICE_DMA_LATENCY + sizeof (Buffer));
+  EXPECT_EQ (ReadStatus (), COROUTINE_TEST_STATUS_READY | COROUTINE_TEST_STATUS_DONE);
+  for (UINTN Index = 0; Index < sizeof (Buffer); Index++) {
+    EXPECT_EQ (Buffer[Index], 0xA5);
+  }
+  EXPECT_EQ (Device.NoOfCommands, 1);
+
+  PciIo->Unmap (PciIo, Mapping);
+
+  //
+  // Command fails once the buffer is unmapped.
+  //
+  MmioWrite32 (COROUTINE_TEST_DEVICE_ADDRESS + COROUTINE_TEST_CONTROL_REG, COROUTINE_TEST_CONTROL_START);
+  RegisterAccessIoSimTimeAdvance (COROUTINE_DEVICE_DMA_LATENCY + sizeof (Buffer));
+  EXPECT_EQ (ReadStatus (), COROUTINE_TEST_STATUS_READY | COROUTINE_TEST_STATUS_FAILED);
+  EXPECT_EQ (Device.NoOfCommands, 1);
+}
+
+TEST_F(CoroutineDeviceTest, DestroyPendingTaskTest) {
+  MmioWrite32 (COROUTINE_TEST_DEVICE_ADDRESS + COROUTINE_TEST_CONTROL_REG, COROUTINE_TEST_CONTROL_RESET);
+  EXPECT_FALSE (RegisterAccessIoSimTimeIsIdle ());
+
+  //
+  // Task suspended in the middle of reset is destroyed together with its
+  // pending delay.
+  //
+  Device.Destroy ();
+  EXPECT_TRUE (RegisterAccessIoSimTimeIsIdle ());
+  RegisterAccessIoSimTimeAdvance (COROUTINE_TEST_RESET_TIME);
+  EXPECT_EQ (Device.GetRegisterSpace (), nullptr);
+}
+
+TEST_F(CoroutineDeviceTest, FinishedTaskFreedTest) {
+  UINT32  Freed;
+
+  //
+  // Frames of started tasks are freed when they finish, whether that is
+  // inside Start or later from a virtual time event.
+  //
+  Freed = 0;
+  Device.Start (Device.Wait (CoroutineTestFrameGuard (&Freed), 0));
+  EXPECT_EQ (Freed, 1);
+
+  Device.Start (Device.Wait (CoroutineTestFrameGuard (&Freed), COROUTINE_TEST_RESET_TIME));
+  EXPECT_EQ (Freed, 1);
+  RegisterAccessIoSimTimeAdvance (COROUTINE_TEST_RESET_TIME);
+  EXPECT_EQ (Freed, 2);
+  EXPECT_TRUE (RegisterAccessIoSimTimeIsIdle ());
+  EXPECT_EQ (Device.GetRegister (COROUTINE_TEST_STATUS_REG), 0);
+
+  //
+  // Run is still suspended and keeps serving the driver.
+  //
+  ResetDevice ();
+  EXPECT_EQ (ReadStatus (), COROUTINE_TEST_STATUS_READY);
+}
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
\ No newline at end of file
@@ -9,10 +9,107 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/UefiLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/FakeRegisterSpaceLib.h>
 
+//
+// Only for the host time helper, which is header only so that the library
+// doesn't depend on the IoLib instance.
+//
+#include "../RegisterAccessIoLib/RegisterAccessIoLibInternal.h"
+
 #define ALIGN_ADDR(Address, Alignment) (Address - (Address % Alignment))
 
+/**
+  Records a callback which exceeded the budget.
+
+  @retval EFI_SUCCESS  Callback fit in the budget or the budget action is report.
+  @retval EFI_TIMEOUT  Callback exceeded the budget and the budget action is fail.
+**/
+STATIC
+EFI_STATUS
+FakeRegisterSpaceCheckBudget (
+  IN FAKE_REGISTER_SPACE  *SimpleRegisterSpace,
+  IN BOOLEAN              IsWrite,
+  IN UINT64               Address,
+  IN UINT32               ByteEnable,
+  IN UINT32               Value,
+  IN UINT64               Nanoseconds
+  )
+{
+  if (Nanoseconds <= SimpleRegisterSpace->CallbackBudget) {
+    return EFI_SUCCESS;
+  }
+
+  SimpleRegisterSpace->NoOfBudgetViolations++;
+  if (Nanoseconds > SimpleRegisterSpace->WorstBudgetViolation.Nanoseconds) {
+    SimpleRegisterSpace->WorstBudgetViolation.Address = Address;
+    SimpleRegisterSpace->WorstBudgetViolation.ByteEnable = ByteEnable;
+    SimpleRegisterSpace->WorstBudgetViolation.Value = Value;
+    SimpleRegisterSpace->WorstBudgetViolation.IsWrite = IsWrite;
+    SimpleRegisterSpace->WorstBudgetViolation.Nanoseconds = Nanoseconds;
+  }
+
+  DEBUG ((
+    (SimpleRegisterSpace->BudgetAction == FakeRegisterSpaceBudgetFail) ? DEBUG_ERROR : DEBUG_WARN,
+    "%s: %a callback at 0x%LX BE 0x%X value 0x%X took %Lu ns, budget is %Lu ns\n",
+    SimpleRegisterSpace->RegisterSpace.Name,
+    IsWrite ? "Write" : "Read",
+    Address,
+    ByteEnable,
+    Value,
+    Nanoseconds,
+    SimpleRegisterSpace->CallbackBudget
+    ));
+  if (SimpleRegisterSpace->BudgetAction == FakeRegisterSpaceBudgetFail) {
+    return EFI_TIMEOUT;
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+FakeRegisterSpaceCallRead (
+  IN  FAKE_REGISTER_SPACE  *SimpleRegisterSpace,
+  IN  UINT64               Address,
+  IN  UINT32               ByteEnable,
+  OUT UINT32               *Value
+  )
+{
+  UINT64  Start;
+
+  if (SimpleRegisterSpace->CallbackBudget == 0) {
+    SimpleRegisterSpace->Read (SimpleRegisterSpace->RwContext, Address, ByteEnable, Value);
+    return EFI_SUCCESS;
+  }
+
+  Start = RegisterAccessIoGetHostNanoseconds ();
+  SimpleRegisterSpace->Read (SimpleRegisterSpace->RwContext, Address, ByteEnable, Value);
+  return FakeRegisterSpaceCheckBudget (SimpleRegisterSpace, FALSE, Address, ByteEnable, *Value, RegisterAccessIoGetHostNanoseconds () - Start);
+}
+
+STATIC
+EFI_STATUS
+FakeRegisterSpaceCallWrite (
+  IN FAKE_REGISTER_SPACE  *SimpleRegisterSpace,
+  IN UINT64               Address,
+  IN UINT32               ByteEnable,
+  IN UINT32               Value
+  )
+{
+  UINT64  Start;
+
+  if (SimpleRegisterSpace->CallbackBudget == 0) {
+    SimpleRegisterSpace->Write (SimpleRegisterSpace->RwContext, Address, ByteEnable, Value);
+    return EFI_SUCCESS;
+  }
+
+  Start = RegisterAccessIoGetHostNanoseconds ();
+  SimpleRegisterSpace->Write (SimpleRegisterSpace->RwContext, Address, ByteEnable, Value);
+  return FakeRegisterSpaceCheckBudget (SimpleRegisterSpace, TRUE, Address, ByteEnable, Value, RegisterAccessIoGetHostNanoseconds () - Start);
+}
+
 STATIC
 UINT32
 SizeToByteEnable (
@@ -70,6 +167,7 @@ FakeRegisterRead (
   UINT64      TempValue;
   UINT32      Position;
   EFI_STATUS  Status;
+  EFI_STATUS  CallStatus;
 
   SimpleRegisterSpace = (FAKE_REGISTER_SPACE*) RegisterSpace;
 
@@ -94,7 +192,10 @@ FakeRegisterRead (
   *Value = 0;
   Position = 0;
   while (RemainingSize > 0) {
-    SimpleRegisterSpace->Read(SimpleRegisterSpace->RwContext, CurrentAddress, ByteEnable, &CurrentValue);
+    CallStatus = FakeRegisterSpaceCallRead (SimpleRegisterSpace, CurrentAddress, ByteEnable, &CurrentValue);
+    if (EFI_ERROR (CallStatus)) {
+      Status = CallStatus;
+    }
     CurrentAddress += SimpleRegisterSpace->Alignment;
     TempValue = CurrentValue;
     TempValue = TempValue << Position;
@@ -123,9 +224,12 @@ FakeRegisterWrite (
   INT32       RemainingSize;
   UINT32      CurrentValue;
   UINT32      ByteEnable;
+  EFI_STATUS  Status;
+  EFI_STATUS  CallStatus;
 
   SimpleRegisterSpace = (FAKE_REGISTER_SPACE*) RegisterSpace;
 
+  Status = EFI_SUCCESS;
   CurrentAddress = ALIGN_ADDR(Address, SimpleRegisterSpace->Alignment);
   ByteEnable = SizeToByteEnable (Size);
   ByteEnable = (ByteEnable << (Address % SimpleRegisterSpace->Alignment));
@@ -144,7 +248,10 @@ FakeRegisterWrite (
   CurrentValue = (UINT32)(Value << ((Address % SimpleRegisterSpace->Alignment) * 8));
   RemainingSize = Size;
   while (RemainingSize > 0) {
-    SimpleRegisterSpace->Write(SimpleRegisterSpace->RwContext, CurrentAddress, ByteEnable, CurrentValue);
+    CallStatus = FakeRegisterSpaceCallWrite (SimpleRegisterSpace, CurrentAddress, ByteEnable, CurrentValue);
+    if (EFI_ERROR (CallStatus)) {
+      Status = CallStatus;
+    }
     RemainingSize -= ByteEnableToNoOfBytes(ByteEnable);
     Value = Value >> (ByteEnableToNoOfBytes(ByteEnable) * 8);
     ByteEnable = SizeToByteEnable(RemainingSize);
@@ -152,7 +259,64 @@ FakeRegisterWrite (
     CurrentValue = (UINT32)Value;
   }
 
-  return EFI_SUCCESS;
+  return Status;
+}
+
+EFI_STATUS
+FakeRegisterWriteBlock (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64          Address,
+  IN UINT32          Length,
+  IN CONST UINT8     *Buffer
+  )
+{
+  FAKE_REGISTER_SPACE  *SimpleRegisterSpace;
+  UINT32      UnitSize;
+  UINT64      CurrentAddress;
+  UINT32      CurrentValue;
+  UINT32      ByteEnable;
+  UINT32      Byte;
+  UINT32      Index;
+  EFI_STATUS  Status;
+  EFI_STATUS  CallStatus;
+
+  SimpleRegisterSpace = (FAKE_REGISTER_SPACE*) RegisterSpace;
+
+  //
+  // Callbacks operate on at most DWORD so merge the block into one callback
+  // per DWORD of each aligned unit with byte enables covering the bytes present
+  // in the block. The DWORDs of a QWORD unit go to the addresses FakeRegisterWrite
+  // uses for a QWORD write so both paths look the same to the device.
+  //
+  Status = EFI_SUCCESS;
+  UnitSize = (UINT32) SimpleRegisterSpace->Alignment;
+  Index = 0;
+  while (Index < Length) {
+    CurrentAddress = Address + Index;
+    Byte = (UINT32)(CurrentAddress % UnitSize);
+    CurrentAddress -= Byte;
+    CurrentValue = 0;
+    ByteEnable = 0;
+    for (; Byte < UnitSize && Index < Length; Byte++) {
+      if ((Byte % 4) == 0 && ByteEnable != 0) {
+        CallStatus = FakeRegisterSpaceCallWrite (SimpleRegisterSpace, CurrentAddress + ((Byte / 4) - 1) * UnitSize, ByteEnable, CurrentValue);
+        if (EFI_ERROR (CallStatus)) {
+          Status = CallStatus;
+        }
+        CurrentValue = 0;
+        ByteEnable = 0;
+      }
+      CurrentValue |= ((UINT32) Buffer[Index]) << ((Byte % 4) * 8);
+      ByteEnable |= (0x1 << (Byte % 4));
+      Index++;
+    }
+    CallStatus = FakeRegisterSpaceCallWrite (SimpleRegisterSpace, CurrentAddress + ((Byte - 1) / 4) * UnitSize, ByteEnable, CurrentValue);
+    if (EFI_ERROR (CallStatus)) {
+      Status = CallStatus;
+    }
+  }
+
+  return Status;
 }
 
 EFI_STATUS
@@ -171,6 +335,7 @@ FakeRegisterSpaceCreate (
   LocalRegisterSpace->RegisterSpace.Name = RegisterSpaceDescription;
   LocalRegisterSpace->RegisterSpace.Read = FakeRegisterRead;
   LocalRegisterSpace->RegisterSpace.Write = FakeRegisterWrite;
+  LocalRegisterSpace->RegisterSpace.WriteBlock = FakeRegisterWriteBlock;
   LocalRegisterSpace->Alignment = Alignment;
   LocalRegisterSpace->Read = Read;
   LocalRegisterSpace->Write = Write;
@@ -194,6 +359,50 @@ FakeRegisterSpaceDestroy (
   return EFI_SUCCESS;
 }
 
+EFI_STATUS
+FakeRegisterSpaceSetCallbackBudget (
+  IN REGISTER_ACCESS_INTERFACE          *RegisterSpace,
+  IN UINT64                             Nanoseconds,
+  IN FAKE_REGISTER_SPACE_BUDGET_ACTION  Action
+  )
+{
+  FAKE_REGISTER_SPACE  *SimpleRegisterSpace;
+
+  if (RegisterSpace == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SimpleRegisterSpace = (FAKE_REGISTER_SPACE*) RegisterSpace;
+  SimpleRegisterSpace->CallbackBudget = Nanoseconds;
+  SimpleRegisterSpace->BudgetAction = Action;
+  SimpleRegisterSpace->NoOfBudgetViolations = 0;
+  ZeroMem (&SimpleRegisterSpace->WorstBudgetViolation, sizeof (FAKE_REGISTER_SPACE_BUDGET_VIOLATION));
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+FakeRegisterSpaceGetBudgetViolations (
+  IN  REGISTER_ACCESS_INTERFACE             *RegisterSpace,
+  OUT UINT64                                *NoOfViolations,
+  OUT FAKE_REGISTER_SPACE_BUDGET_VIOLATION  *Worst OPTIONAL
+  )
+{
+  FAKE_REGISTER_SPACE  *SimpleRegisterSpace;
+
+  if (RegisterSpace == NULL || NoOfViolations == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SimpleRegisterSpace = (FAKE_REGISTER_SPACE*) RegisterSpace;
+  *NoOfViolations = SimpleRegisterSpace->NoOfBudgetViolations;
+  if (Worst != NULL) {
+    CopyMem (Worst, &SimpleRegisterSpace->WorstBudgetViolation, sizeof (FAKE_REGISTER_SPACE_BUDGET_VIOLATION));
+  }
+
+  return EFI_SUCCESS;
+}
+
 UINT32
 ByteEnableToBitMask (
   IN UINT32  ByteEnable
@@ -11,8 +11,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DebugLib.h>
 #include <Library/UnitTestLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/FakeRegisterSpaceLib.h>
 #include <stdint.h>
+#include <time.h>
 
 #define UNIT_TEST_NAME     "FakeRegisterSpaceLib unit tests"
 #define UNIT_TEST_VERSION  "0.1"
@@ -230,6 +232,102 @@ TestDeviceWordAlignedRegisterWrite (
   DEBUG ((DEBUG_INFO, "word Value wrote %X\n", DeviceContext->Regs[RegisterIndex]));
 }
 
+#define TEST_DEVICE_SLOW_DELAY_REG 0x4
+
+STATIC
+UINT64
+TestGetMilliseconds (
+  VOID
+  )
+{
+  struct timespec  Time;
+
+  timespec_get (&Time, TIME_UTC);
+  return (UINT64) Time.tv_sec * 1000 + (UINT64) Time.tv_nsec / 1000000;
+}
+
+//
+// Device which busy waits in the write callback for the number of milliseconds
+// written to TEST_DEVICE_SLOW_DELAY_REG.
+//
+VOID
+TestDeviceSlowRegisterRead (
+  IN  VOID    *Context,
+  IN  UINT64  Address,
+  IN  UINT32  ByteEnable,
+  OUT UINT32  *Value
+  )
+{
+  *Value = 0;
+}
+
+VOID
+TestDeviceSlowRegisterWrite (
+  IN VOID    *Context,
+  IN UINT64  Address,
+  IN UINT32  ByteEnable,
+  IN UINT32  Value
+  )
+{
+  UINT64  End;
+
+  if (Address != TEST_DEVICE_SLOW_DELAY_REG) {
+    return;
+  }
+
+  End = TestGetMilliseconds () + Value;
+  while (TestGetMilliseconds () < End) {
+  }
+}
+
+#define TEST_DEVICE_MAX_RECORDED_WRITES 8
+
+typedef struct {
+  UINT64  Address;
+  UINT32  ByteEnable;
+  UINT32  Value;
+} TEST_DEVICE_RECORDED_WRITE;
+
+typedef struct {
+  TEST_DEVICE_RECORDED_WRITE  Writes[TEST_DEVICE_MAX_RECORDED_WRITES];
+  UINT32                      NoOfWrites;
+} TEST_DEVICE_RECORDING_CONTEXT;
+
+//
+// Device which records every write callback it receives.
+//
+VOID
+TestDeviceRecordingRegisterRead (
+  IN  VOID    *Context,
+  IN  UINT64  Address,
+  IN  UINT32  ByteEnable,
+  OUT UINT32  *Value
+  )
+{
+  *Value = 0;
+}
+
+VOID
+TestDeviceRecordingRegisterWrite (
+  IN VOID    *Context,
+  IN UINT64  Address,
+  IN UINT32  ByteEnable,
+  IN UINT32  Value
+  )
+{
+  TEST_DEVICE_RECORDING_CONTEXT  *DeviceContext;
+
+  DeviceContext = (TEST_DEVICE_RECORDING_CONTEXT*) Context;
+  if (DeviceContext->NoOfWrites >= TEST_DEVICE_MAX_RECORDED_WRITES) {
+    return;
+  }
+
+  DeviceContext->Writes[DeviceContext->NoOfWrites].Address = Address;
+  DeviceContext->Writes[DeviceContext->NoOfWrites].ByteEnable = ByteEnable;
+  DeviceContext->Writes[DeviceContext->NoOfWrites].Value = Value;
+  DeviceContext->NoOfWrites++;
+}
+
 UNIT_TEST_STATUS
 EFIAPI
 FakeRegisterSpaceCreateTest (
@@ -682,6 +780,119 @@ FakeRegisterSpaceWordAlignedDeviceTest (
   return UNIT_TEST_PASSED;
 }
 
+UNIT_TEST_STATUS
+EFIAPI
+FakeRegisterSpaceCallbackBudgetTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                            Status;
+  REGISTER_ACCESS_INTERFACE             *RegisterSpace;
+  UINT64                                NoOfViolations;
+  FAKE_REGISTER_SPACE_BUDGET_VIOLATION  Worst;
+  UINT64                                Value;
+
+  Status = FakeRegisterSpaceCreate (L"Slow device", FakeRegisterSpaceAlignmentDword, TestDeviceSlowRegisterWrite, TestDeviceSlowRegisterRead, NULL, &RegisterSpace);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = FakeRegisterSpaceSetCallbackBudget (RegisterSpace, 10000000, FakeRegisterSpaceBudgetReport);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+
+  RegisterSpace->Read (RegisterSpace, 0, 4, &Value);
+  RegisterSpace->Write (RegisterSpace, TEST_DEVICE_SLOW_DELAY_REG, 4, 0);
+  Status = FakeRegisterSpaceGetBudgetViolations (RegisterSpace, &NoOfViolations, NULL);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (NoOfViolations, 0);
+
+  RegisterSpace->Write (RegisterSpace, TEST_DEVICE_SLOW_DELAY_REG, 4, 20);
+  Status = FakeRegisterSpaceGetBudgetViolations (RegisterSpace, &NoOfViolations, &Worst);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (NoOfViolations, 1);
+  UT_ASSERT_EQUAL (Worst.Address, TEST_DEVICE_SLOW_DELAY_REG);
+  UT_ASSERT_EQUAL (Worst.ByteEnable, 0xF);
+  UT_ASSERT_EQUAL (Worst.Value, 20);
+  UT_ASSERT_TRUE (Worst.IsWrite);
+  UT_ASSERT_TRUE (Worst.Nanoseconds > 10000000);
+
+  //
+  // Fail action makes the access which ran the slow callback fail.
+  //
+  Status = FakeRegisterSpaceSetCallbackBudget (RegisterSpace, 10000000, FakeRegisterSpaceBudgetFail);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  Status = RegisterSpace->Write (RegisterSpace, TEST_DEVICE_SLOW_DELAY_REG, 4, 0);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  Status = RegisterSpace->Write (RegisterSpace, TEST_DEVICE_SLOW_DELAY_REG, 4, 20);
+  UT_ASSERT_EQUAL (Status, EFI_TIMEOUT);
+  Status = FakeRegisterSpaceGetBudgetViolations (RegisterSpace, &NoOfViolations, NULL);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (NoOfViolations, 1);
+
+  //
+  // Removing the budget clears violations.
+  //
+  Status = FakeRegisterSpaceSetCallbackBudget (RegisterSpace, 0, FakeRegisterSpaceBudgetReport);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  RegisterSpace->Write (RegisterSpace, TEST_DEVICE_SLOW_DELAY_REG, 4, 20);
+  Status = FakeRegisterSpaceGetBudgetViolations (RegisterSpace, &NoOfViolations, NULL);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (NoOfViolations, 0);
+
+  Status = FakeRegisterSpaceDestroy (RegisterSpace);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+FakeRegisterSpaceQwordWriteBlockTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                     Status;
+  REGISTER_ACCESS_INTERFACE      *RegisterSpace;
+  TEST_DEVICE_RECORDING_CONTEXT  WriteContext;
+  TEST_DEVICE_RECORDING_CONTEXT  BlockContext;
+  UINT64                         Value;
+  UINT32                         Index;
+
+  ZeroMem (&WriteContext, sizeof (WriteContext));
+  ZeroMem (&BlockContext, sizeof (BlockContext));
+  Value = QWORD_TEST_VALUE;
+
+  Status = FakeRegisterSpaceCreate (L"QWORD aligned device", FakeRegisterSpaceAlignmentQword, TestDeviceRecordingRegisterWrite, TestDeviceRecordingRegisterRead, &WriteContext, &RegisterSpace);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  RegisterSpace->Write (RegisterSpace, 8, 8, Value);
+  Status = FakeRegisterSpaceDestroy (RegisterSpace);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+
+  Status = FakeRegisterSpaceCreate (L"QWORD aligned device", FakeRegisterSpaceAlignmentQword, TestDeviceRecordingRegisterWrite, TestDeviceRecordingRegisterRead, &BlockContext, &RegisterSpace);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  Status = RegisterSpace->WriteBlock (RegisterSpace, 8, sizeof (Value), (UINT8 *) &Value);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  Status = FakeRegisterSpaceDestroy (RegisterSpace);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+
+  //
+  // A block covering a whole QWORD reaches the device as the same callbacks as a QWORD write.
+  //
+  UT_ASSERT_EQUAL (WriteContext.NoOfWrites, 2);
+  UT_ASSERT_EQUAL (BlockContext.NoOfWrites, WriteContext.NoOfWrites);
+  for (Index = 0; Index < WriteContext.NoOfWrites; Index++) {
+    UT_ASSERT_EQUAL (BlockContext.Writes[Index].Address, WriteContext.Writes[Index].Address);
+    UT_ASSERT_EQUAL (BlockContext.Writes[Index].ByteEnable, WriteContext.Writes[Index].ByteEnable);
+    UT_ASSERT_EQUAL (BlockContext.Writes[Index].Value, WriteContext.Writes[Index].Value);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
 EFI_STATUS
 EFIAPI
 UefiTestMain (
@@ -742,6 +953,16 @@ UefiTestMain (
   // WORD aligned test device
   //
   AddTestCase (FakeRegisterSpaceTest, "FakeRegisterSpaceWordAlignedDeviceTest", "FakeRegisterSpaceWordAlignedDeviceTest", FakeRegisterSpaceWordAlignedDeviceTest, NULL, NULL, NULL);
+
+  //
+  // QWORD aligned block writes
+  //
+  AddTestCase (FakeRegisterSpaceTest, "FakeRegisterSpaceQwordWriteBlockTest", "FakeRegisterSpaceQwordWriteBlockTest", FakeRegisterSpaceQwordWriteBlockTest, NULL, NULL, NULL);
+
+  //
+  // Callback time budget
+  //
+  AddTestCase (FakeRegisterSpaceTest, "FakeRegisterSpaceCallbackBudgetTest", "FakeRegisterSpaceCallbackBudgetTest", FakeRegisterSpaceCallbackBudgetTest, NULL, NULL, NULL);
   
   Status = RunAllTestSuites (Framework);
   if (Framework) {
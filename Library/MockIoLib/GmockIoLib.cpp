@@ -5,120 +5,126 @@ extern "C" {
   #include <Library/RegisterAccessIoLib.h>
 }
 
-IIoLib* pIoLibMock = nullptr;
+//
+// Mock is kept in the simulation context selected by the calling thread so
+// that tests running in separate contexts don't share expectations.
+//
+static IIoLib* GetIoLibMock () {
+  return (IIoLib*) RegisterAccessIoSimContextGetCurrent ()->IoLibMock;
+}
 
 extern "C" {
 
     UINT8 EFIAPI IoRead8 (UINTN Address) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->IoRead8 (Address);
+    return GetIoLibMock ()->IoRead8 (Address);
     }
 
     UINT8 EFIAPI IoWrite8 (UINTN Address, UINT8 Value) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->IoWrite8 (Address, Value);
+    return GetIoLibMock ()->IoWrite8 (Address, Value);
     }
 
     UINT16 EFIAPI IoRead16 (UINTN Address) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->IoRead16 (Address);
+    return GetIoLibMock ()->IoRead16 (Address);
     }
 
     UINT16 EFIAPI IoWrite16 (UINTN Address, UINT16 Value) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->IoWrite16 (Address, Value);
+    return GetIoLibMock ()->IoWrite16 (Address, Value);
     }
 
     UINT32 EFIAPI IoRead32 (UINTN Address) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->IoRead32 (Address);
+    return GetIoLibMock ()->IoRead32 (Address);
     }
 
     UINT32 EFIAPI IoWrite32 (UINTN Address, UINT32 Value) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->IoWrite32 (Address, Value);
+    return GetIoLibMock ()->IoWrite32 (Address, Value);
     }
 
     UINT64 EFIAPI IoRead64 (UINTN Address) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->IoRead64 (Address);
+    return GetIoLibMock ()->IoRead64 (Address);
     }
 
     UINT64 EFIAPI IoWrite64 (UINTN Address, UINT64 Value) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->IoWrite64 (Address, Value);
+    return GetIoLibMock ()->IoWrite64 (Address, Value);
     }
 
     UINT8 EFIAPI MmioRead8 (UINTN Address) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->MmioRead8 (Address);
+    return GetIoLibMock ()->MmioRead8 (Address);
     }
 
     UINT8 EFIAPI MmioWrite8 (UINTN Address, UINT8 Value) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->MmioWrite8 (Address, Value);
+    return GetIoLibMock ()->MmioWrite8 (Address, Value);
     }
 
     UINT16 EFIAPI MmioRead16 (UINTN Address) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->MmioRead16 (Address);
+    return GetIoLibMock ()->MmioRead16 (Address);
     }
 
     UINT16 EFIAPI MmioWrite16 (UINTN Address, UINT16 Value) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->MmioWrite16 (Address, Value);
+    return GetIoLibMock ()->MmioWrite16 (Address, Value);
     }
 
     UINT32 EFIAPI MmioRead32 (UINTN Address) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->MmioRead32 (Address);
+    return GetIoLibMock ()->MmioRead32 (Address);
     }
 
     UINT32 EFIAPI MmioWrite32 (UINTN Address, UINT32 Value) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->MmioWrite32 (Address, Value);
+    return GetIoLibMock ()->MmioWrite32 (Address, Value);
     }
 
     UINT64 EFIAPI MmioRead64 (UINTN Address) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->MmioRead64 (Address);
+    return GetIoLibMock ()->MmioRead64 (Address);
     }
 
     UINT64 EFIAPI MmioWrite64 (UINTN Address, UINT64 Value) {
-    if (pIoLibMock == nullptr) {
+    if (GetIoLibMock () == nullptr) {
       return 0;
     }
-    return pIoLibMock->MmioWrite64 (Address, Value);
+    return GetIoLibMock ()->MmioWrite64 (Address, Value);
     }
 
 UINT8* EFIAPI MmioReadBuffer8 (
@@ -127,10 +133,10 @@ UINT8* EFIAPI MmioReadBuffer8 (
   OUT UINT8  *Buffer
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioReadBuffer8 (StartAddress, Length, Buffer);
+  return GetIoLibMock ()->MmioReadBuffer8 (StartAddress, Length, Buffer);
 }
 
 UINT16* EFIAPI MmioReadBuffer16 (
@@ -139,10 +145,10 @@ UINT16* EFIAPI MmioReadBuffer16 (
   OUT UINT16  *Buffer
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioReadBuffer16 (StartAddress, Length, Buffer);
+  return GetIoLibMock ()->MmioReadBuffer16 (StartAddress, Length, Buffer);
 }
 
 
@@ -152,10 +158,10 @@ UINT32* EFIAPI MmioReadBuffer32 (
   OUT UINT32  *Buffer
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioReadBuffer32 (StartAddress, Length, Buffer);
+  return GetIoLibMock ()->MmioReadBuffer32 (StartAddress, Length, Buffer);
 }
 
 UINT64* EFIAPI MmioReadBuffer64 (
@@ -164,10 +170,10 @@ UINT64* EFIAPI MmioReadBuffer64 (
   OUT UINT64  *Buffer
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioReadBuffer64 (StartAddress, Length, Buffer);
+  return GetIoLibMock ()->MmioReadBuffer64 (StartAddress, Length, Buffer);
 }
 
 UINT8* EFIAPI MmioWriteBuffer8 (
@@ -176,10 +182,10 @@ UINT8* EFIAPI MmioWriteBuffer8 (
   IN  CONST UINT8  *Buffer
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioWriteBuffer8 (StartAddress, Length, Buffer);
+  return GetIoLibMock ()->MmioWriteBuffer8 (StartAddress, Length, Buffer);
 }
 
 UINT16* EFIAPI MmioWriteBuffer16 (
@@ -188,10 +194,10 @@ UINT16* EFIAPI MmioWriteBuffer16 (
   IN  CONST UINT16  *Buffer
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioWriteBuffer16 (StartAddress, Length, Buffer);
+  return GetIoLibMock ()->MmioWriteBuffer16 (StartAddress, Length, Buffer);
 }
 
 UINT32* EFIAPI MmioWriteBuffer32 (
@@ -200,10 +206,10 @@ UINT32* EFIAPI MmioWriteBuffer32 (
   IN  CONST UINT32  *Buffer
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioWriteBuffer32 (StartAddress, Length, Buffer);
+  return GetIoLibMock ()->MmioWriteBuffer32 (StartAddress, Length, Buffer);
 }
 
 UINT64* EFIAPI MmioWriteBuffer64 (
@@ -212,10 +218,10 @@ UINT64* EFIAPI MmioWriteBuffer64 (
   IN  CONST UINT64  *Buffer
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioWriteBuffer64 (StartAddress, Length, Buffer);
+  return GetIoLibMock ()->MmioWriteBuffer64 (StartAddress, Length, Buffer);
 }
 
 UINT8 EFIAPI IoOr8 (
@@ -223,10 +229,10 @@ UINT8 EFIAPI IoOr8 (
   IN      UINT8  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoOr8 (Port, OrData);
+  return GetIoLibMock ()->IoOr8 (Port, OrData);
 }
 
 UINT8 EFIAPI IoAnd8 (
@@ -234,10 +240,10 @@ UINT8 EFIAPI IoAnd8 (
   IN      UINT8  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoAnd8 (Port, AndData);
+  return GetIoLibMock ()->IoAnd8 (Port, AndData);
 }
 
 UINT8 EFIAPI IoAndThenOr8 (
@@ -246,10 +252,10 @@ UINT8 EFIAPI IoAndThenOr8 (
   IN      UINT8  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoAndThenOr8 (Port, AndData, OrData);
+  return GetIoLibMock ()->IoAndThenOr8 (Port, AndData, OrData);
 }
 
 UINT8 EFIAPI IoBitFieldRead8 (
@@ -258,10 +264,10 @@ UINT8 EFIAPI IoBitFieldRead8 (
   IN      UINTN  EndBit
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldRead8 (Port, StartBit, EndBit);
+  return GetIoLibMock ()->IoBitFieldRead8 (Port, StartBit, EndBit);
 }
 
 UINT8 EFIAPI IoBitFieldWrite8 (
@@ -271,10 +277,10 @@ UINT8 EFIAPI IoBitFieldWrite8 (
   IN      UINT8  Value
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldWrite8 (Port, StartBit, EndBit, Value);
+  return GetIoLibMock ()->IoBitFieldWrite8 (Port, StartBit, EndBit, Value);
 }
 
 UINT8 EFIAPI IoBitFieldOr8 (
@@ -284,10 +290,10 @@ UINT8 EFIAPI IoBitFieldOr8 (
   IN      UINT8  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldOr8 (Port, StartBit, EndBit, OrData);
+  return GetIoLibMock ()->IoBitFieldOr8 (Port, StartBit, EndBit, OrData);
 }
 
 UINT8 EFIAPI IoBitFieldAnd8 (
@@ -297,10 +303,10 @@ UINT8 EFIAPI IoBitFieldAnd8 (
   IN      UINT8  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldAnd8 (Port, StartBit, EndBit, AndData);
+  return GetIoLibMock ()->IoBitFieldAnd8 (Port, StartBit, EndBit, AndData);
 }
 
 UINT8 EFIAPI IoBitFieldAndThenOr8 (
@@ -311,10 +317,10 @@ UINT8 EFIAPI IoBitFieldAndThenOr8 (
   IN      UINT8  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldAndThenOr8 (Port, StartBit, EndBit, AndData, OrData);
+  return GetIoLibMock ()->IoBitFieldAndThenOr8 (Port, StartBit, EndBit, AndData, OrData);
 }
 
 UINT16 EFIAPI IoOr16 (
@@ -322,10 +328,10 @@ UINT16 EFIAPI IoOr16 (
   IN      UINT16  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoOr16 (Port, OrData);
+  return GetIoLibMock ()->IoOr16 (Port, OrData);
 }
 
 UINT16 EFIAPI IoAnd16 (
@@ -333,10 +339,10 @@ UINT16 EFIAPI IoAnd16 (
   IN      UINT16  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoAnd16 (Port, AndData);
+  return GetIoLibMock ()->IoAnd16 (Port, AndData);
 }
 
 UINT16 EFIAPI IoAndThenOr16 (
@@ -345,10 +351,10 @@ UINT16 EFIAPI IoAndThenOr16 (
   IN      UINT16  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoAndThenOr16 (Port, AndData, OrData);
+  return GetIoLibMock ()->IoAndThenOr16 (Port, AndData, OrData);
 }
 
 UINT16 EFIAPI IoBitFieldRead16 (
@@ -357,10 +363,10 @@ UINT16 EFIAPI IoBitFieldRead16 (
   IN      UINTN  EndBit
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldRead16 (Port, StartBit, EndBit);
+  return GetIoLibMock ()->IoBitFieldRead16 (Port, StartBit, EndBit);
 }
 
 UINT16 EFIAPI IoBitFieldWrite16 (
@@ -370,10 +376,10 @@ UINT16 EFIAPI IoBitFieldWrite16 (
   IN      UINT16  Value
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldWrite16 (Port, StartBit, EndBit, Value);
+  return GetIoLibMock ()->IoBitFieldWrite16 (Port, StartBit, EndBit, Value);
 }
 
 UINT16 EFIAPI IoBitFieldOr16 (
@@ -383,10 +389,10 @@ UINT16 EFIAPI IoBitFieldOr16 (
   IN      UINT16  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldOr16 (Port, StartBit, EndBit, OrData);
+  return GetIoLibMock ()->IoBitFieldOr16 (Port, StartBit, EndBit, OrData);
 }
 
 UINT16 EFIAPI IoBitFieldAnd16 (
@@ -396,10 +402,10 @@ UINT16 EFIAPI IoBitFieldAnd16 (
   IN      UINT16  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldAnd16 (Port, StartBit, EndBit, AndData);
+  return GetIoLibMock ()->IoBitFieldAnd16 (Port, StartBit, EndBit, AndData);
 }
 
 UINT16 EFIAPI IoBitFieldAndThenOr16 (
@@ -410,10 +416,10 @@ UINT16 EFIAPI IoBitFieldAndThenOr16 (
   IN      UINT16  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldAndThenOr16 (Port, StartBit, EndBit, AndData, OrData);
+  return GetIoLibMock ()->IoBitFieldAndThenOr16 (Port, StartBit, EndBit, AndData, OrData);
 }
 
 UINT32 EFIAPI IoOr32 (
@@ -421,10 +427,10 @@ UINT32 EFIAPI IoOr32 (
   IN      UINT32  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoOr32 (Port, OrData);
+  return GetIoLibMock ()->IoOr32 (Port, OrData);
 }
 
 UINT32 EFIAPI IoAnd32 (
@@ -432,10 +438,10 @@ UINT32 EFIAPI IoAnd32 (
   IN      UINT32  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoAnd32 (Port, AndData);
+  return GetIoLibMock ()->IoAnd32 (Port, AndData);
 }
 
 UINT32 EFIAPI IoAndThenOr32 (
@@ -444,10 +450,10 @@ UINT32 EFIAPI IoAndThenOr32 (
   IN      UINT32  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoAndThenOr32 (Port, AndData, OrData);
+  return GetIoLibMock ()->IoAndThenOr32 (Port, AndData, OrData);
 }
 
 UINT32 EFIAPI IoBitFieldRead32 (
@@ -456,10 +462,10 @@ UINT32 EFIAPI IoBitFieldRead32 (
   IN      UINTN  EndBit
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldRead32 (Port, StartBit, EndBit);
+  return GetIoLibMock ()->IoBitFieldRead32 (Port, StartBit, EndBit);
 }
 
 UINT32 EFIAPI IoBitFieldWrite32 (
@@ -469,10 +475,10 @@ UINT32 EFIAPI IoBitFieldWrite32 (
   IN      UINT32  Value
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldWrite32 (Port, StartBit, EndBit, Value);
+  return GetIoLibMock ()->IoBitFieldWrite32 (Port, StartBit, EndBit, Value);
 }
 
 UINT32 EFIAPI IoBitFieldOr32 (
@@ -482,10 +488,10 @@ UINT32 EFIAPI IoBitFieldOr32 (
   IN      UINT32  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldOr32 (Port, StartBit, EndBit, OrData);
+  return GetIoLibMock ()->IoBitFieldOr32 (Port, StartBit, EndBit, OrData);
 }
 
 UINT32 EFIAPI IoBitFieldAnd32 (
@@ -495,10 +501,10 @@ UINT32 EFIAPI IoBitFieldAnd32 (
   IN      UINT32  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldAnd32 (Port, StartBit, EndBit, AndData);
+  return GetIoLibMock ()->IoBitFieldAnd32 (Port, StartBit, EndBit, AndData);
 }
 
 UINT32 EFIAPI IoBitFieldAndThenOr32 (
@@ -509,10 +515,10 @@ UINT32 EFIAPI IoBitFieldAndThenOr32 (
   IN      UINT32  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldAndThenOr32 (Port, StartBit, EndBit, AndData, OrData);
+  return GetIoLibMock ()->IoBitFieldAndThenOr32 (Port, StartBit, EndBit, AndData, OrData);
 }
 
 UINT64 EFIAPI IoOr64 (
@@ -520,10 +526,10 @@ UINT64 EFIAPI IoOr64 (
   IN      UINT64  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoOr64 (Port, OrData);
+  return GetIoLibMock ()->IoOr64 (Port, OrData);
 }
 
 UINT64 EFIAPI IoAnd64 (
@@ -531,10 +537,10 @@ UINT64 EFIAPI IoAnd64 (
   IN      UINT64  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoAnd64 (Port, AndData);
+  return GetIoLibMock ()->IoAnd64 (Port, AndData);
 }
 
 UINT64 EFIAPI IoAndThenOr64 (
@@ -543,10 +549,10 @@ UINT64 EFIAPI IoAndThenOr64 (
   IN      UINT64  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoAndThenOr64 (Port, AndData, OrData);
+  return GetIoLibMock ()->IoAndThenOr64 (Port, AndData, OrData);
 }
 
 UINT64 EFIAPI IoBitFieldRead64 (
@@ -555,10 +561,10 @@ UINT64 EFIAPI IoBitFieldRead64 (
   IN      UINTN  EndBit
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldRead64 (Port, StartBit, EndBit);
+  return GetIoLibMock ()->IoBitFieldRead64 (Port, StartBit, EndBit);
 }
 
 UINT64 EFIAPI IoBitFieldWrite64 (
@@ -568,10 +574,10 @@ UINT64 EFIAPI IoBitFieldWrite64 (
   IN      UINT64  Value
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldWrite64 (Port, StartBit, EndBit, Value);
+  return GetIoLibMock ()->IoBitFieldWrite64 (Port, StartBit, EndBit, Value);
 }
 
 UINT64 EFIAPI IoBitFieldOr64 (
@@ -581,10 +587,10 @@ UINT64 EFIAPI IoBitFieldOr64 (
   IN      UINT64  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldOr64 (Port, StartBit, EndBit, OrData);
+  return GetIoLibMock ()->IoBitFieldOr64 (Port, StartBit, EndBit, OrData);
 }
 
 UINT64 EFIAPI IoBitFieldAnd64 (
@@ -594,10 +600,10 @@ UINT64 EFIAPI IoBitFieldAnd64 (
   IN      UINT64  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldAnd64 (Port, StartBit, EndBit, AndData);
+  return GetIoLibMock ()->IoBitFieldAnd64 (Port, StartBit, EndBit, AndData);
 }
 
 UINT64 EFIAPI IoBitFieldAndThenOr64 (
@@ -608,10 +614,10 @@ UINT64 EFIAPI IoBitFieldAndThenOr64 (
   IN      UINT64  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->IoBitFieldAndThenOr64 (Port, StartBit, EndBit, AndData, OrData);
+  return GetIoLibMock ()->IoBitFieldAndThenOr64 (Port, StartBit, EndBit, AndData, OrData);
 }
 
 UINT8 EFIAPI MmioOr8 (
@@ -619,10 +625,10 @@ UINT8 EFIAPI MmioOr8 (
   IN      UINT8  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioOr8 (Address, OrData);
+  return GetIoLibMock ()->MmioOr8 (Address, OrData);
 }
 
 UINT8 EFIAPI MmioAnd8 (
@@ -630,10 +636,10 @@ UINT8 EFIAPI MmioAnd8 (
   IN      UINT8  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioAnd8 (Address, AndData);
+  return GetIoLibMock ()->MmioAnd8 (Address, AndData);
 }
 
 UINT8 EFIAPI MmioAndThenOr8 (
@@ -642,10 +648,10 @@ UINT8 EFIAPI MmioAndThenOr8 (
   IN      UINT8  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioAndThenOr8 (Address, AndData, OrData);
+  return GetIoLibMock ()->MmioAndThenOr8 (Address, AndData, OrData);
 }
 
 UINT8 EFIAPI MmioBitFieldRead8 (
@@ -654,10 +660,10 @@ UINT8 EFIAPI MmioBitFieldRead8 (
   IN      UINTN  EndBit
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldRead8 (Address, StartBit, EndBit);
+  return GetIoLibMock ()->MmioBitFieldRead8 (Address, StartBit, EndBit);
 }
 
 UINT8 EFIAPI MmioBitFieldWrite8 (
@@ -667,10 +673,10 @@ UINT8 EFIAPI MmioBitFieldWrite8 (
   IN      UINT8  Value
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldWrite8 (Address, StartBit, EndBit, Value);
+  return GetIoLibMock ()->MmioBitFieldWrite8 (Address, StartBit, EndBit, Value);
 }
 
 UINT8 EFIAPI MmioBitFieldOr8 (
@@ -680,10 +686,10 @@ UINT8 EFIAPI MmioBitFieldOr8 (
   IN      UINT8  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldOr8 (Address, StartBit, EndBit, OrData);
+  return GetIoLibMock ()->MmioBitFieldOr8 (Address, StartBit, EndBit, OrData);
 }
 
 UINT8 EFIAPI MmioBitFieldAnd8 (
@@ -693,10 +699,10 @@ UINT8 EFIAPI MmioBitFieldAnd8 (
   IN      UINT8  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldAnd8 (Address, StartBit, EndBit, AndData);
+  return GetIoLibMock ()->MmioBitFieldAnd8 (Address, StartBit, EndBit, AndData);
 }
 
 UINT8 EFIAPI MmioBitFieldAndThenOr8 (
@@ -707,10 +713,10 @@ UINT8 EFIAPI MmioBitFieldAndThenOr8 (
   IN      UINT8  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldAndThenOr8 (Address, StartBit, EndBit, AndData, OrData);
+  return GetIoLibMock ()->MmioBitFieldAndThenOr8 (Address, StartBit, EndBit, AndData, OrData);
 }
 
 UINT16 EFIAPI MmioOr16 (
@@ -718,10 +724,10 @@ UINT16 EFIAPI MmioOr16 (
   IN      UINT16  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioOr16 (Address, OrData);
+  return GetIoLibMock ()->MmioOr16 (Address, OrData);
 }
 
 UINT16 EFIAPI MmioAnd16 (
@@ -729,10 +735,10 @@ UINT16 EFIAPI MmioAnd16 (
   IN      UINT16  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioAnd16 (Address, AndData);
+  return GetIoLibMock ()->MmioAnd16 (Address, AndData);
 }
 
 UINT16 EFIAPI MmioAndThenOr16 (
@@ -741,10 +747,10 @@ UINT16 EFIAPI MmioAndThenOr16 (
   IN      UINT16  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioAndThenOr16 (Address, AndData, OrData);
+  return GetIoLibMock ()->MmioAndThenOr16 (Address, AndData, OrData);
 }
 
 UINT16 EFIAPI MmioBitFieldRead16 (
@@ -753,10 +759,10 @@ UINT16 EFIAPI MmioBitFieldRead16 (
   IN      UINTN  EndBit
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldRead16 (Address, StartBit, EndBit);
+  return GetIoLibMock ()->MmioBitFieldRead16 (Address, StartBit, EndBit);
 }
 
 UINT16 EFIAPI MmioBitFieldWrite16 (
@@ -766,10 +772,10 @@ UINT16 EFIAPI MmioBitFieldWrite16 (
   IN      UINT16  Value
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldWrite16 (Address, StartBit, EndBit, Value);
+  return GetIoLibMock ()->MmioBitFieldWrite16 (Address, StartBit, EndBit, Value);
 }
 
 UINT16 EFIAPI MmioBitFieldOr16 (
@@ -779,10 +785,10 @@ UINT16 EFIAPI MmioBitFieldOr16 (
   IN      UINT16  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldOr16 (Address, StartBit, EndBit, OrData);
+  return GetIoLibMock ()->MmioBitFieldOr16 (Address, StartBit, EndBit, OrData);
 }
 
 UINT16 EFIAPI MmioBitFieldAnd16 (
@@ -792,10 +798,10 @@ UINT16 EFIAPI MmioBitFieldAnd16 (
   IN      UINT16  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldAnd16 (Address, StartBit, EndBit, AndData);
+  return GetIoLibMock ()->MmioBitFieldAnd16 (Address, StartBit, EndBit, AndData);
 }
 
 UINT16 EFIAPI MmioBitFieldAndThenOr16 (
@@ -806,10 +812,10 @@ UINT16 EFIAPI MmioBitFieldAndThenOr16 (
   IN      UINT16  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldAndThenOr16 (Address, StartBit, EndBit, AndData, OrData);
+  return GetIoLibMock ()->MmioBitFieldAndThenOr16 (Address, StartBit, EndBit, AndData, OrData);
 }
 
 UINT32 EFIAPI MmioOr32 (
@@ -817,10 +823,10 @@ UINT32 EFIAPI MmioOr32 (
   IN      UINT32  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioOr32 (Address, OrData);
+  return GetIoLibMock ()->MmioOr32 (Address, OrData);
 }
 
 UINT32 EFIAPI MmioAnd32 (
@@ -828,10 +834,10 @@ UINT32 EFIAPI MmioAnd32 (
   IN      UINT32  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioAnd32 (Address, AndData);
+  return GetIoLibMock ()->MmioAnd32 (Address, AndData);
 }
 
 UINT32 EFIAPI MmioAndThenOr32 (
@@ -840,10 +846,10 @@ UINT32 EFIAPI MmioAndThenOr32 (
   IN      UINT32  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioAndThenOr32 (Address, AndData, OrData);
+  return GetIoLibMock ()->MmioAndThenOr32 (Address, AndData, OrData);
 }
 
 UINT32 EFIAPI MmioBitFieldRead32 (
@@ -852,10 +858,10 @@ UINT32 EFIAPI MmioBitFieldRead32 (
   IN      UINTN  EndBit
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldRead32 (Address, StartBit, EndBit);
+  return GetIoLibMock ()->MmioBitFieldRead32 (Address, StartBit, EndBit);
 }
 
 UINT32 EFIAPI MmioBitFieldWrite32 (
@@ -865,10 +871,10 @@ UINT32 EFIAPI MmioBitFieldWrite32 (
   IN      UINT32  Value
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldWrite32 (Address, StartBit, EndBit, Value);
+  return GetIoLibMock ()->MmioBitFieldWrite32 (Address, StartBit, EndBit, Value);
 }
 
 UINT32 EFIAPI MmioBitFieldOr32 (
@@ -878,10 +884,10 @@ UINT32 EFIAPI MmioBitFieldOr32 (
   IN      UINT32  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldOr32 (Address, StartBit, EndBit, OrData);
+  return GetIoLibMock ()->MmioBitFieldOr32 (Address, StartBit, EndBit, OrData);
 }
 
 UINT32 EFIAPI MmioBitFieldAnd32 (
@@ -891,10 +897,10 @@ UINT32 EFIAPI MmioBitFieldAnd32 (
   IN      UINT32  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldAnd32 (Address, StartBit, EndBit, AndData);
+  return GetIoLibMock ()->MmioBitFieldAnd32 (Address, StartBit, EndBit, AndData);
 }
 
 UINT32 EFIAPI MmioBitFieldAndThenOr32 (
@@ -905,10 +911,10 @@ UINT32 EFIAPI MmioBitFieldAndThenOr32 (
   IN      UINT32  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldAndThenOr32 (Address, StartBit, EndBit, AndData, OrData);
+  return GetIoLibMock ()->MmioBitFieldAndThenOr32 (Address, StartBit, EndBit, AndData, OrData);
 }
 
 UINT64 EFIAPI MmioOr64 (
@@ -916,10 +922,10 @@ UINT64 EFIAPI MmioOr64 (
   IN      UINT64  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioOr64 (Address, OrData);
+  return GetIoLibMock ()->MmioOr64 (Address, OrData);
 }
 
 UINT64 EFIAPI MmioAnd64 (
@@ -927,10 +933,10 @@ UINT64 EFIAPI MmioAnd64 (
   IN      UINT64  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioAnd64 (Address, AndData);
+  return GetIoLibMock ()->MmioAnd64 (Address, AndData);
 }
 
 UINT64 EFIAPI MmioAndThenOr64 (
@@ -939,10 +945,10 @@ UINT64 EFIAPI MmioAndThenOr64 (
   IN      UINT64  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioAndThenOr64 (Address, AndData, OrData);
+  return GetIoLibMock ()->MmioAndThenOr64 (Address, AndData, OrData);
 }
 
 UINT64 EFIAPI MmioBitFieldRead64 (
@@ -951,10 +957,10 @@ UINT64 EFIAPI MmioBitFieldRead64 (
   IN      UINTN  EndBit
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldRead64 (Address, StartBit, EndBit);
+  return GetIoLibMock ()->MmioBitFieldRead64 (Address, StartBit, EndBit);
 }
 
 UINT64 EFIAPI MmioBitFieldWrite64 (
@@ -964,10 +970,10 @@ UINT64 EFIAPI MmioBitFieldWrite64 (
   IN      UINT64  Value
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldWrite64 (Address, StartBit, EndBit, Value);
+  return GetIoLibMock ()->MmioBitFieldWrite64 (Address, StartBit, EndBit, Value);
 }
 
 UINT64 EFIAPI MmioBitFieldOr64 (
@@ -977,10 +983,10 @@ UINT64 EFIAPI MmioBitFieldOr64 (
   IN      UINT64  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldOr64 (Address, StartBit, EndBit, OrData);
+  return GetIoLibMock ()->MmioBitFieldOr64 (Address, StartBit, EndBit, OrData);
 }
 
 UINT64 EFIAPI MmioBitFieldAnd64 (
@@ -990,10 +996,10 @@ UINT64 EFIAPI MmioBitFieldAnd64 (
   IN      UINT64  AndData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldAnd64 (Address, StartBit, EndBit, AndData);
+  return GetIoLibMock ()->MmioBitFieldAnd64 (Address, StartBit, EndBit, AndData);
 }
 
 UINT64 EFIAPI MmioBitFieldAndThenOr64 (
@@ -1004,10 +1010,10 @@ UINT64 EFIAPI MmioBitFieldAndThenOr64 (
   IN      UINT64  OrData
   )
 {
-  if (pIoLibMock == nullptr) {
+  if (GetIoLibMock () == nullptr) {
     return 0;
   }
-  return pIoLibMock->MmioBitFieldAndThenOr64 (Address, StartBit, EndBit, AndData, OrData);
+  return GetIoLibMock ()->MmioBitFieldAndThenOr64 (Address, StartBit, EndBit, AndData, OrData);
 }
 
   VOID
@@ -1015,7 +1021,7 @@ UINT64 EFIAPI MmioBitFieldAndThenOr64 (
     IIoLib *IoLibMock
     )
   {
-    pIoLibMock = IoLibMock;
+    RegisterAccessIoSimContextGetCurrent ()->IoLibMock = IoLibMock;
   }
 
   VOID
@@ -1023,7 +1029,7 @@ UINT64 EFIAPI MmioBitFieldAndThenOr64 (
     VOID
   )
   {
-    pIoLibMock = nullptr;
+    RegisterAccessIoSimContextGetCurrent ()->IoLibMock = nullptr;
   }
 }
 
@@ -15,6 +15,7 @@
 #include <Library/DebugLib.h>
 #include <Library/BaseLib.h>
 #include <Library/PeiServicesTablePointerLib.h>
+#include <Library/RegisterAccessIoLib.h>
 
 #include "FakeNameDecorator.h"
 
@@ -43,7 +44,13 @@ FAKE_NAME_DECORATOR(IoOr8) (
   IN      UINT8  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite8) (Port, (UINT8)(FAKE_NAME_DECORATOR(IoRead8) (Port) | OrData));
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite8) (Port, (UINT8)(FAKE_NAME_DECORATOR(IoRead8) (Port) | OrData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -71,7 +78,13 @@ FAKE_NAME_DECORATOR(IoAnd8) (
   IN      UINT8  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite8) (Port, (UINT8)(FAKE_NAME_DECORATOR(IoRead8) (Port) & AndData));
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite8) (Port, (UINT8)(FAKE_NAME_DECORATOR(IoRead8) (Port) & AndData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -102,7 +115,13 @@ FAKE_NAME_DECORATOR(IoAndThenOr8) (
   IN      UINT8  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite8) (Port, (UINT8)((FAKE_NAME_DECORATOR(IoRead8) (Port) & AndData) | OrData));
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite8) (Port, (UINT8)((FAKE_NAME_DECORATOR(IoRead8) (Port) & AndData) | OrData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -133,7 +152,13 @@ FAKE_NAME_DECORATOR(IoBitFieldRead8) (
   IN      UINTN  EndBit
   )
 {
-  return BitFieldRead8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit);
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = BitFieldRead8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -168,10 +193,16 @@ FAKE_NAME_DECORATOR(IoBitFieldWrite8) (
   IN      UINT8  Value
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite8) (
-           Port,
-           BitFieldWrite8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit, Value)
-           );
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite8) (
+             Port,
+             BitFieldWrite8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit, Value)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -209,10 +240,16 @@ FAKE_NAME_DECORATOR(IoBitFieldOr8) (
   IN      UINT8  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite8) (
-           Port,
-           BitFieldOr8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit, OrData)
-           );
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite8) (
+             Port,
+             BitFieldOr8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -250,10 +287,16 @@ FAKE_NAME_DECORATOR(IoBitFieldAnd8) (
   IN      UINT8  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite8) (
-           Port,
-           BitFieldAnd8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit, AndData)
-           );
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite8) (
+             Port,
+             BitFieldAnd8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit, AndData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -296,10 +339,16 @@ FAKE_NAME_DECORATOR(IoBitFieldAndThenOr8) (
   IN      UINT8  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite8) (
-           Port,
-           BitFieldAndThenOr8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit, AndData, OrData)
-           );
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite8) (
+             Port,
+             BitFieldAndThenOr8 (FAKE_NAME_DECORATOR(IoRead8) (Port), StartBit, EndBit, AndData, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -328,7 +377,13 @@ FAKE_NAME_DECORATOR(IoOr16) (
   IN      UINT16  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite16) (Port, (UINT16)(FAKE_NAME_DECORATOR(IoRead16) (Port) | OrData));
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite16) (Port, (UINT16)(FAKE_NAME_DECORATOR(IoRead16) (Port) | OrData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -357,7 +412,13 @@ FAKE_NAME_DECORATOR(IoAnd16) (
   IN      UINT16  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite16) (Port, (UINT16)(FAKE_NAME_DECORATOR(IoRead16) (Port) & AndData));
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite16) (Port, (UINT16)(FAKE_NAME_DECORATOR(IoRead16) (Port) & AndData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -389,7 +450,13 @@ FAKE_NAME_DECORATOR(IoAndThenOr16) (
   IN      UINT16  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite16) (Port, (UINT16)((FAKE_NAME_DECORATOR(IoRead16) (Port) & AndData) | OrData));
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite16) (Port, (UINT16)((FAKE_NAME_DECORATOR(IoRead16) (Port) & AndData) | OrData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -421,7 +488,13 @@ FAKE_NAME_DECORATOR(IoBitFieldRead16) (
   IN      UINTN  EndBit
   )
 {
-  return BitFieldRead16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit);
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = BitFieldRead16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -458,10 +531,16 @@ FAKE_NAME_DECORATOR(IoBitFieldWrite16) (
   IN      UINT16  Value
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite16) (
-           Port,
-           BitFieldWrite16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit, Value)
-           );
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite16) (
+             Port,
+             BitFieldWrite16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit, Value)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -500,10 +579,16 @@ FAKE_NAME_DECORATOR(IoBitFieldOr16) (
   IN      UINT16  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite16) (
-           Port,
-           BitFieldOr16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit, OrData)
-           );
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite16) (
+             Port,
+             BitFieldOr16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -542,10 +627,16 @@ FAKE_NAME_DECORATOR(IoBitFieldAnd16) (
   IN      UINT16  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite16) (
-           Port,
-           BitFieldAnd16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit, AndData)
-           );
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite16) (
+             Port,
+             BitFieldAnd16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit, AndData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -589,10 +680,16 @@ FAKE_NAME_DECORATOR(IoBitFieldAndThenOr16) (
   IN      UINT16  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite16) (
-           Port,
-           BitFieldAndThenOr16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit, AndData, OrData)
-           );
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite16) (
+             Port,
+             BitFieldAndThenOr16 (FAKE_NAME_DECORATOR(IoRead16) (Port), StartBit, EndBit, AndData, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -621,7 +718,13 @@ FAKE_NAME_DECORATOR(IoOr32) (
   IN      UINT32  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite32) (Port, FAKE_NAME_DECORATOR(IoRead32) (Port) | OrData);
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite32) (Port, FAKE_NAME_DECORATOR(IoRead32) (Port) | OrData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -650,7 +753,13 @@ FAKE_NAME_DECORATOR(IoAnd32) (
   IN      UINT32  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite32) (Port, FAKE_NAME_DECORATOR(IoRead32) (Port) & AndData);
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite32) (Port, FAKE_NAME_DECORATOR(IoRead32) (Port) & AndData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -682,7 +791,13 @@ FAKE_NAME_DECORATOR(IoAndThenOr32) (
   IN      UINT32  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite32) (Port, (FAKE_NAME_DECORATOR(IoRead32) (Port) & AndData) | OrData);
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite32) (Port, (FAKE_NAME_DECORATOR(IoRead32) (Port) & AndData) | OrData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -714,7 +829,13 @@ FAKE_NAME_DECORATOR(IoBitFieldRead32) (
   IN      UINTN  EndBit
   )
 {
-  return BitFieldRead32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit);
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = BitFieldRead32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -751,10 +872,16 @@ FAKE_NAME_DECORATOR(IoBitFieldWrite32) (
   IN      UINT32  Value
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite32) (
-           Port,
-           BitFieldWrite32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit, Value)
-           );
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite32) (
+             Port,
+             BitFieldWrite32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit, Value)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -793,10 +920,16 @@ FAKE_NAME_DECORATOR(IoBitFieldOr32) (
   IN      UINT32  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite32) (
-           Port,
-           BitFieldOr32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit, OrData)
-           );
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite32) (
+             Port,
+             BitFieldOr32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -835,10 +968,16 @@ FAKE_NAME_DECORATOR(IoBitFieldAnd32) (
   IN      UINT32  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite32) (
-           Port,
-           BitFieldAnd32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit, AndData)
-           );
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite32) (
+             Port,
+             BitFieldAnd32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit, AndData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -882,10 +1021,16 @@ FAKE_NAME_DECORATOR(IoBitFieldAndThenOr32) (
   IN      UINT32  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite32) (
-           Port,
-           BitFieldAndThenOr32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit, AndData, OrData)
-           );
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite32) (
+             Port,
+             BitFieldAndThenOr32 (FAKE_NAME_DECORATOR(IoRead32) (Port), StartBit, EndBit, AndData, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -914,7 +1059,13 @@ FAKE_NAME_DECORATOR(IoOr64) (
   IN      UINT64  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite64) (Port, FAKE_NAME_DECORATOR(IoRead64) (Port) | OrData);
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite64) (Port, FAKE_NAME_DECORATOR(IoRead64) (Port) | OrData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -943,7 +1094,13 @@ FAKE_NAME_DECORATOR(IoAnd64) (
   IN      UINT64  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite64) (Port, FAKE_NAME_DECORATOR(IoRead64) (Port) & AndData);
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite64) (Port, FAKE_NAME_DECORATOR(IoRead64) (Port) & AndData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -975,7 +1132,13 @@ FAKE_NAME_DECORATOR(IoAndThenOr64) (
   IN      UINT64  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite64) (Port, (FAKE_NAME_DECORATOR(IoRead64) (Port) & AndData) | OrData);
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite64) (Port, (FAKE_NAME_DECORATOR(IoRead64) (Port) & AndData) | OrData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1007,7 +1170,13 @@ FAKE_NAME_DECORATOR(IoBitFieldRead64) (
   IN      UINTN  EndBit
   )
 {
-  return BitFieldRead64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit);
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = BitFieldRead64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1044,10 +1213,16 @@ FAKE_NAME_DECORATOR(IoBitFieldWrite64) (
   IN      UINT64  Value
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite64) (
-           Port,
-           BitFieldWrite64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit, Value)
-           );
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite64) (
+             Port,
+             BitFieldWrite64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit, Value)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1086,10 +1261,16 @@ FAKE_NAME_DECORATOR(IoBitFieldOr64) (
   IN      UINT64  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite64) (
-           Port,
-           BitFieldOr64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit, OrData)
-           );
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite64) (
+             Port,
+             BitFieldOr64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1128,10 +1309,16 @@ FAKE_NAME_DECORATOR(IoBitFieldAnd64) (
   IN      UINT64  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite64) (
-           Port,
-           BitFieldAnd64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit, AndData)
-           );
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite64) (
+             Port,
+             BitFieldAnd64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit, AndData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1175,10 +1362,16 @@ FAKE_NAME_DECORATOR(IoBitFieldAndThenOr64) (
   IN      UINT64  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(IoWrite64) (
-           Port,
-           BitFieldAndThenOr64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit, AndData, OrData)
-           );
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(IoWrite64) (
+             Port,
+             BitFieldAndThenOr64 (FAKE_NAME_DECORATOR(IoRead64) (Port), StartBit, EndBit, AndData, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1206,7 +1399,13 @@ FAKE_NAME_DECORATOR(MmioOr8) (
   IN      UINT8  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite8) (Address, (UINT8)(FAKE_NAME_DECORATOR(MmioRead8) (Address) | OrData));
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite8) (Address, (UINT8)(FAKE_NAME_DECORATOR(MmioRead8) (Address) | OrData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1234,7 +1433,13 @@ FAKE_NAME_DECORATOR(MmioAnd8) (
   IN      UINT8  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite8) (Address, (UINT8)(FAKE_NAME_DECORATOR(MmioRead8) (Address) & AndData));
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite8) (Address, (UINT8)(FAKE_NAME_DECORATOR(MmioRead8) (Address) & AndData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1266,7 +1471,13 @@ FAKE_NAME_DECORATOR(MmioAndThenOr8) (
   IN      UINT8  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite8) (Address, (UINT8)((FAKE_NAME_DECORATOR(MmioRead8) (Address) & AndData) | OrData));
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite8) (Address, (UINT8)((FAKE_NAME_DECORATOR(MmioRead8) (Address) & AndData) | OrData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1297,7 +1508,13 @@ FAKE_NAME_DECORATOR(MmioBitFieldRead8) (
   IN      UINTN  EndBit
   )
 {
-  return BitFieldRead8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit);
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = BitFieldRead8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1332,10 +1549,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldWrite8) (
   IN      UINT8  Value
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite8) (
-           Address,
-           BitFieldWrite8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit, Value)
-           );
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite8) (
+             Address,
+             BitFieldWrite8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit, Value)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1374,10 +1597,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldOr8) (
   IN      UINT8  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite8) (
-           Address,
-           BitFieldOr8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit, OrData)
-           );
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite8) (
+             Address,
+             BitFieldOr8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1416,10 +1645,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldAnd8) (
   IN      UINT8  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite8) (
-           Address,
-           BitFieldAnd8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit, AndData)
-           );
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite8) (
+             Address,
+             BitFieldAnd8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit, AndData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1462,10 +1697,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldAndThenOr8) (
   IN      UINT8  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite8) (
-           Address,
-           BitFieldAndThenOr8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit, AndData, OrData)
-           );
+  UINT8    Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite8) (
+             Address,
+             BitFieldAndThenOr8 (FAKE_NAME_DECORATOR(MmioRead8) (Address), StartBit, EndBit, AndData, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1494,7 +1735,13 @@ FAKE_NAME_DECORATOR(MmioOr16) (
   IN      UINT16  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite16) (Address, (UINT16)(FAKE_NAME_DECORATOR(MmioRead16) (Address) | OrData));
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite16) (Address, (UINT16)(FAKE_NAME_DECORATOR(MmioRead16) (Address) | OrData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1523,7 +1770,13 @@ FAKE_NAME_DECORATOR(MmioAnd16) (
   IN      UINT16  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite16) (Address, (UINT16)(FAKE_NAME_DECORATOR(MmioRead16) (Address) & AndData));
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite16) (Address, (UINT16)(FAKE_NAME_DECORATOR(MmioRead16) (Address) & AndData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1555,7 +1808,13 @@ FAKE_NAME_DECORATOR(MmioAndThenOr16) (
   IN      UINT16  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite16) (Address, (UINT16)((FAKE_NAME_DECORATOR(MmioRead16) (Address) & AndData) | OrData));
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite16) (Address, (UINT16)((FAKE_NAME_DECORATOR(MmioRead16) (Address) & AndData) | OrData));
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1587,7 +1846,13 @@ FAKE_NAME_DECORATOR(MmioBitFieldRead16) (
   IN      UINTN  EndBit
   )
 {
-  return BitFieldRead16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit);
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = BitFieldRead16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1623,10 +1888,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldWrite16) (
   IN      UINT16  Value
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite16) (
-           Address,
-           BitFieldWrite16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit, Value)
-           );
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite16) (
+             Address,
+             BitFieldWrite16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit, Value)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1666,10 +1937,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldOr16) (
   IN      UINT16  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite16) (
-           Address,
-           BitFieldOr16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit, OrData)
-           );
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite16) (
+             Address,
+             BitFieldOr16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1709,10 +1986,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldAnd16) (
   IN      UINT16  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite16) (
-           Address,
-           BitFieldAnd16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit, AndData)
-           );
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite16) (
+             Address,
+             BitFieldAnd16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit, AndData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1756,10 +2039,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldAndThenOr16) (
   IN      UINT16  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite16) (
-           Address,
-           BitFieldAndThenOr16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit, AndData, OrData)
-           );
+  UINT16   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite16) (
+             Address,
+             BitFieldAndThenOr16 (FAKE_NAME_DECORATOR(MmioRead16) (Address), StartBit, EndBit, AndData, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1788,7 +2077,13 @@ FAKE_NAME_DECORATOR(MmioOr32) (
   IN      UINT32  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite32) (Address, FAKE_NAME_DECORATOR(MmioRead32) (Address) | OrData);
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite32) (Address, FAKE_NAME_DECORATOR(MmioRead32) (Address) | OrData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1817,7 +2112,13 @@ FAKE_NAME_DECORATOR(MmioAnd32) (
   IN      UINT32  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite32) (Address, FAKE_NAME_DECORATOR(MmioRead32) (Address) & AndData);
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite32) (Address, FAKE_NAME_DECORATOR(MmioRead32) (Address) & AndData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1849,7 +2150,13 @@ FAKE_NAME_DECORATOR(MmioAndThenOr32) (
   IN      UINT32  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite32) (Address, (FAKE_NAME_DECORATOR(MmioRead32) (Address) & AndData) | OrData);
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite32) (Address, (FAKE_NAME_DECORATOR(MmioRead32) (Address) & AndData) | OrData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1881,7 +2188,13 @@ FAKE_NAME_DECORATOR(MmioBitFieldRead32) (
   IN      UINTN  EndBit
   )
 {
-  return BitFieldRead32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit);
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = BitFieldRead32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1917,10 +2230,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldWrite32) (
   IN      UINT32  Value
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite32) (
-           Address,
-           BitFieldWrite32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit, Value)
-           );
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite32) (
+             Address,
+             BitFieldWrite32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit, Value)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -1960,10 +2279,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldOr32) (
   IN      UINT32  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite32) (
-           Address,
-           BitFieldOr32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit, OrData)
-           );
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite32) (
+             Address,
+             BitFieldOr32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2003,10 +2328,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldAnd32) (
   IN      UINT32  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite32) (
-           Address,
-           BitFieldAnd32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit, AndData)
-           );
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite32) (
+             Address,
+             BitFieldAnd32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit, AndData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2050,10 +2381,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldAndThenOr32) (
   IN      UINT32  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite32) (
-           Address,
-           BitFieldAndThenOr32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit, AndData, OrData)
-           );
+  UINT32   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite32) (
+             Address,
+             BitFieldAndThenOr32 (FAKE_NAME_DECORATOR(MmioRead32) (Address), StartBit, EndBit, AndData, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2082,7 +2419,13 @@ FAKE_NAME_DECORATOR(MmioOr64) (
   IN      UINT64  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite64) (Address, FAKE_NAME_DECORATOR(MmioRead64) (Address) | OrData);
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite64) (Address, FAKE_NAME_DECORATOR(MmioRead64) (Address) | OrData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2111,7 +2454,13 @@ FAKE_NAME_DECORATOR(MmioAnd64) (
   IN      UINT64  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite64) (Address, FAKE_NAME_DECORATOR(MmioRead64) (Address) & AndData);
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite64) (Address, FAKE_NAME_DECORATOR(MmioRead64) (Address) & AndData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2143,7 +2492,13 @@ FAKE_NAME_DECORATOR(MmioAndThenOr64) (
   IN      UINT64  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite64) (Address, (FAKE_NAME_DECORATOR(MmioRead64) (Address) & AndData) | OrData);
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite64) (Address, (FAKE_NAME_DECORATOR(MmioRead64) (Address) & AndData) | OrData);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2175,7 +2530,13 @@ FAKE_NAME_DECORATOR(MmioBitFieldRead64) (
   IN      UINTN  EndBit
   )
 {
-  return BitFieldRead64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit);
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = BitFieldRead64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2211,10 +2572,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldWrite64) (
   IN      UINT64  Value
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite64) (
-           Address,
-           BitFieldWrite64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit, Value)
-           );
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite64) (
+             Address,
+             BitFieldWrite64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit, Value)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2254,10 +2621,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldOr64) (
   IN      UINT64  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite64) (
-           Address,
-           BitFieldOr64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit, OrData)
-           );
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite64) (
+             Address,
+             BitFieldOr64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2297,10 +2670,16 @@ FAKE_NAME_DECORATOR(MmioBitFieldAnd64) (
   IN      UINT64  AndData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite64) (
-           Address,
-           BitFieldAnd64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit, AndData)
-           );
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite64) (
+             Address,
+             BitFieldAnd64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit, AndData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
 
 /**
@@ -2344,8 +2723,14 @@ FAKE_NAME_DECORATOR(MmioBitFieldAndThenOr64) (
   IN      UINT64  OrData
   )
 {
-  return FAKE_NAME_DECORATOR(MmioWrite64) (
-           Address,
-           BitFieldAndThenOr64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit, AndData, OrData)
-           );
+  UINT64   Result;
+  BOOLEAN  CallSiteOwner;
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  Result = FAKE_NAME_DECORATOR(MmioWrite64) (
+             Address,
+             BitFieldAndThenOr64 (FAKE_NAME_DECORATOR(MmioRead64) (Address), StartBit, EndBit, AndData, OrData)
+             );
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Result;
 }
@@ -0,0 +1,344 @@
+/** @file
+  Per-thread register access counter tables.
+
+  Shared by hot access and call site counting. Every thread counts into its
+  own open-addressed table keyed by call site, region and offset so the hot
+  path never takes a lock. Tables are linked into a list of the feature with
+  a compare-exchange on the first access of the thread and merged only when
+  the counters are read.
+
+  Table grows by doubling. A grown entry array is published once filled and
+  the old one is kept, as threads merging the counters may still walk it.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+#define ACCESS_COUNTER_INITIAL_TABLE_SIZE  256
+
+struct _REGISTER_ACCESS_IO_COUNTER_ARRAY {
+  //
+  // Array this one replaced when the table grew.
+  //
+  REGISTER_ACCESS_IO_COUNTER_ARRAY  *Retired;
+  UINTN                             Mask;
+  //
+  // Entry is free when both Reads and Writes are 0.
+  //
+  REGISTER_ACCESS_IO_COUNTER        Entries[1];
+};
+
+STATIC
+UINTN
+AccessCounterHash (
+  IN UINT64  CallSite,
+  IN UINT16  Region,
+  IN UINT64  Offset
+  )
+{
+  return (UINTN)(((CallSite ^ Offset ^ LShiftU64 (Region, 48)) * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+STATIC
+REGISTER_ACCESS_IO_COUNTER*
+AccessCounterLookup (
+  IN REGISTER_ACCESS_IO_COUNTER  *Entries,
+  IN UINTN                       Mask,
+  IN UINT64                      CallSite,
+  IN UINT16                      Region,
+  IN UINT64                      Offset
+  )
+{
+  UINTN  Index;
+
+  Index = AccessCounterHash (CallSite, Region, Offset) & Mask;
+  while (Entries[Index].Reads != 0 || Entries[Index].Writes != 0) {
+    if (Entries[Index].CallSite == CallSite && Entries[Index].Region == Region && Entries[Index].Offset == Offset) {
+      break;
+    }
+    Index = (Index + 1) & Mask;
+  }
+
+  return &Entries[Index];
+}
+
+STATIC
+VOID
+AccessCounterAccumulate (
+  IN REGISTER_ACCESS_IO_COUNTER        *Entry,
+  IN CONST REGISTER_ACCESS_IO_COUNTER  *Source
+  )
+{
+  Entry->CallSite = Source->CallSite;
+  Entry->Region = Source->Region;
+  Entry->Offset = Source->Offset;
+  Entry->Reads += Source->Reads;
+  Entry->Writes += Source->Writes;
+  Entry->ReadWidths |= Source->ReadWidths;
+  Entry->WriteWidths |= Source->WriteWidths;
+}
+
+STATIC
+REGISTER_ACCESS_IO_COUNTER_ARRAY*
+AccessCounterAllocateArray (
+  IN UINTN  Size
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER_ARRAY  *Array;
+
+  Array = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_COUNTER_ARRAY) + (Size - 1) * sizeof (REGISTER_ACCESS_IO_COUNTER));
+  if (Array == NULL) {
+    return NULL;
+  }
+  Array->Mask = Size - 1;
+
+  return Array;
+}
+
+STATIC
+EFI_STATUS
+AccessCounterGrow (
+  IN REGISTER_ACCESS_IO_COUNTER_TABLE  *Table
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER_ARRAY  *Array;
+  REGISTER_ACCESS_IO_COUNTER_ARRAY  *Old;
+  REGISTER_ACCESS_IO_COUNTER        *Entry;
+  UINTN                             Index;
+
+  Old = Table->Array;
+  Array = AccessCounterAllocateArray ((Old->Mask + 1) * 2);
+  if (Array == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index <= Old->Mask; Index++) {
+    Entry = &Old->Entries[Index];
+    if (Entry->Reads != 0 || Entry->Writes != 0) {
+      AccessCounterAccumulate (AccessCounterLookup (Array->Entries, Array->Mask, Entry->CallSite, Entry->Region, Entry->Offset), Entry);
+    }
+  }
+
+  //
+  // Array must be complete before merging threads see it.
+  //
+  Array->Retired = Old;
+  MemoryFence ();
+  Table->Array = Array;
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+REGISTER_ACCESS_IO_COUNTER_TABLE*
+AccessCounterAllocateTable (
+  IN OUT REGISTER_ACCESS_IO_COUNTER_TABLE *volatile  *List
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER_TABLE  *Table;
+  REGISTER_ACCESS_IO_COUNTER_TABLE  *Head;
+
+  Table = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_COUNTER_TABLE));
+  if (Table == NULL) {
+    return NULL;
+  }
+
+  Table->Array = AccessCounterAllocateArray (ACCESS_COUNTER_INITIAL_TABLE_SIZE);
+  if (Table->Array == NULL) {
+    FreePool (Table);
+    return NULL;
+  }
+
+  do {
+    Head = *List;
+    Table->Next = Head;
+  } while (InterlockedCompareExchangePointer ((VOID *volatile *) List, Head, Table) != Head);
+
+  return Table;
+}
+
+REGISTER_ACCESS_IO_COUNTER*
+RegisterAccessIoCounterGet (
+  IN OUT REGISTER_ACCESS_IO_COUNTER_TABLE           **Table,
+  IN OUT REGISTER_ACCESS_IO_COUNTER_TABLE *volatile  *List,
+  IN     UINT64                                      CallSite,
+  IN     UINT16                                      Region,
+  IN     UINT64                                      Offset
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER_ARRAY  *Array;
+  REGISTER_ACCESS_IO_COUNTER        *Entry;
+
+  if (*Table == NULL) {
+    *Table = AccessCounterAllocateTable (List);
+    if (*Table == NULL) {
+      return NULL;
+    }
+  }
+
+  //
+  // Keep load factor under 1/2 so that probe sequences stay short.
+  //
+  if (((*Table)->Used + 1) * 2 > (*Table)->Array->Mask + 1) {
+    if (EFI_ERROR (AccessCounterGrow (*Table))) {
+      return NULL;
+    }
+  }
+
+  Array = (*Table)->Array;
+  Entry = AccessCounterLookup (Array->Entries, Array->Mask, CallSite, Region, Offset);
+  if (Entry->Reads == 0 && Entry->Writes == 0) {
+    Entry->CallSite = CallSite;
+    Entry->Region = Region;
+    Entry->Offset = Offset;
+    (*Table)->Used++;
+  }
+
+  return Entry;
+}
+
+VOID
+RegisterAccessIoCounterReset (
+  IN REGISTER_ACCESS_IO_COUNTER_TABLE  *List
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER_TABLE  *Table;
+
+  for (Table = List; Table != NULL; Table = Table->Next) {
+    ZeroMem (Table->Array->Entries, (Table->Array->Mask + 1) * sizeof (REGISTER_ACCESS_IO_COUNTER));
+    Table->Used = 0;
+  }
+}
+
+STATIC
+INTN
+EFIAPI
+AccessCounterCompare (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST REGISTER_ACCESS_IO_COUNTER  *Entry1;
+  CONST REGISTER_ACCESS_IO_COUNTER  *Entry2;
+  UINT64                            Count1;
+  UINT64                            Count2;
+
+  Entry1 = (CONST REGISTER_ACCESS_IO_COUNTER*) Buffer1;
+  Entry2 = (CONST REGISTER_ACCESS_IO_COUNTER*) Buffer2;
+  Count1 = Entry1->Reads + Entry1->Writes;
+  Count2 = Entry2->Reads + Entry2->Writes;
+  if (Count1 != Count2) {
+    return (Count1 > Count2) ? -1 : 1;
+  }
+  if (Entry1->CallSite != Entry2->CallSite) {
+    return (Entry1->CallSite < Entry2->CallSite) ? -1 : 1;
+  }
+  if (Entry1->Region != Entry2->Region) {
+    return (Entry1->Region < Entry2->Region) ? -1 : 1;
+  }
+  if (Entry1->Offset != Entry2->Offset) {
+    return (Entry1->Offset < Entry2->Offset) ? -1 : 1;
+  }
+  return 0;
+}
+
+EFI_STATUS
+RegisterAccessIoCounterMerge (
+  IN  REGISTER_ACCESS_IO_COUNTER_TABLE  *List,
+  OUT REGISTER_ACCESS_IO_COUNTER        **Entries,
+  OUT UINTN                             *Count
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER_TABLE  *Table;
+  REGISTER_ACCESS_IO_COUNTER_ARRAY  **Arrays;
+  REGISTER_ACCESS_IO_COUNTER        *Merged;
+  REGISTER_ACCESS_IO_COUNTER        *Entry;
+  REGISTER_ACCESS_IO_COUNTER        *Target;
+  REGISTER_ACCESS_IO_COUNTER        Swap;
+  UINTN                             NoOfTables;
+  UINTN                             Total;
+  UINTN                             Used;
+  UINTN                             Mask;
+  UINTN                             Index;
+  UINTN                             Slot;
+
+  *Entries = NULL;
+  *Count = 0;
+
+  NoOfTables = 0;
+  for (Table = List; Table != NULL; Table = Table->Next) {
+    NoOfTables++;
+  }
+  if (NoOfTables == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Arrays = AllocatePool (NoOfTables * sizeof (REGISTER_ACCESS_IO_COUNTER_ARRAY*));
+  if (Arrays == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Arrays are taken once so they can't grow under the merge. Owners keep
+  // their arrays at most half full which bounds the number of entries.
+  //
+  Total = 0;
+  Index = 0;
+  for (Table = List; Table != NULL; Table = Table->Next, Index++) {
+    Arrays[Index] = Table->Array;
+    Total += (Arrays[Index]->Mask + 1) / 2;
+  }
+
+  Mask = GetPowerOfTwo64 (Total * 4) - 1;
+  Merged = AllocateZeroPool ((Mask + 1) * sizeof (REGISTER_ACCESS_IO_COUNTER));
+  if (Merged == NULL) {
+    FreePool (Arrays);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Counters racing with a reset may exceed the bound, they are dropped
+  // rather than let the merged table fill up.
+  //
+  Used = 0;
+  for (Index = 0; Index < NoOfTables; Index++) {
+    for (Slot = 0; Slot <= Arrays[Index]->Mask; Slot++) {
+      Entry = &Arrays[Index]->Entries[Slot];
+      if (Entry->Reads == 0 && Entry->Writes == 0) {
+        continue;
+      }
+      Target = AccessCounterLookup (Merged, Mask, Entry->CallSite, Entry->Region, Entry->Offset);
+      if (Target->Reads == 0 && Target->Writes == 0) {
+        if (Used == Total) {
+          continue;
+        }
+        Used++;
+      }
+      AccessCounterAccumulate (Target, Entry);
+    }
+  }
+  FreePool (Arrays);
+
+  //
+  // Compact used entries to the front and sort them.
+  //
+  for (Index = 0; Index <= Mask; Index++) {
+    if (Merged[Index].Reads != 0 || Merged[Index].Writes != 0) {
+      CopyMem (&Merged[(*Count)++], &Merged[Index], sizeof (REGISTER_ACCESS_IO_COUNTER));
+    }
+  }
+  QuickSort (Merged, *Count, sizeof (REGISTER_ACCESS_IO_COUNTER), AccessCounterCompare, &Swap);
+
+  *Entries = Merged;
+  return EFI_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,298 @@
+/** @file
+  Attribution of register accesses to driver call sites.
+
+  Leaf IoLib functions pass their return address with every access. Library
+  functions implemented on top of them (FIFO, buffer, bit field and PciIo
+  operations) mark themselves with REGISTER_ACCESS_IO_CALL_SITE_ENTER so that
+  the accesses they issue are attributed to the driver code which called the
+  outermost library function rather than to the library itself.
+
+  Counters are kept in per-thread access counter tables keyed by call site,
+  region and offset, shared with hot access counting. Call sites are resolved to
+  module and module offset when reported so they can be symbolized offline
+  with tools such as addr2line.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#if !defined (_WIN32)
+#define _GNU_SOURCE
+#endif
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <stdio.h>
+#if !defined (_WIN32)
+#include <dlfcn.h>
+#endif
+
+#include "RegisterAccessIoLibInternal.h"
+
+BOOLEAN  gRegisterAccessIoCallSiteEnabled = FALSE;
+
+//
+// Call site of the outermost library function the calling thread is in.
+//
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL VOID  *mCallSite = NULL;
+
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL REGISTER_ACCESS_IO_COUNTER_TABLE  *mCallSiteTable = NULL;
+STATIC REGISTER_ACCESS_IO_COUNTER_TABLE  *volatile mCallSiteTableList = NULL;
+
+BOOLEAN
+RegisterAccessIoCallSiteEnter (
+  IN VOID  *CallSite
+  )
+{
+  if (mCallSite != NULL) {
+    return FALSE;
+  }
+
+  mCallSite = CallSite;
+  return TRUE;
+}
+
+VOID
+RegisterAccessIoCallSiteExit (
+  VOID
+  )
+{
+  mCallSite = NULL;
+}
+
+VOID
+RegisterAccessIoCallSiteCount (
+  IN VOID     *CallSite,
+  IN UINT16   Region,
+  IN UINT64   Offset,
+  IN BOOLEAN  IsWrite
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER  *Entry;
+  UINT64                      Site;
+
+  Site = (UINT64)(UINTN)((mCallSite != NULL) ? mCallSite : CallSite);
+  Entry = RegisterAccessIoCounterGet (&mCallSiteTable, &mCallSiteTableList, Site, Region, Offset);
+  if (Entry == NULL) {
+    return;
+  }
+
+  if (IsWrite) {
+    Entry->Writes++;
+  } else {
+    Entry->Reads++;
+  }
+}
+
+VOID
+RegisterAccessIoCallSiteEnable (
+  IN BOOLEAN  Enable
+  )
+{
+  gRegisterAccessIoCallSiteEnabled = Enable;
+}
+
+VOID
+RegisterAccessIoCallSiteReset (
+  VOID
+  )
+{
+  RegisterAccessIoCounterReset (mCallSiteTableList);
+}
+
+EFI_STATUS
+RegisterAccessIoCallSiteGetTop (
+  OUT    REGISTER_ACCESS_IO_CALL_SITE  *Entries,
+  IN OUT UINTN                         *NoOfEntries
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER  *Merged;
+  UINTN                       Count;
+  UINTN                       Index;
+  EFI_STATUS                  Status;
+
+  if (Entries == NULL || NoOfEntries == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RegisterAccessIoCounterMerge (mCallSiteTableList, &Merged, &Count);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  *NoOfEntries = MIN (*NoOfEntries, Count);
+  for (Index = 0; Index < *NoOfEntries; Index++) {
+    Entries[Index].CallSite = Merged[Index].CallSite;
+    Entries[Index].Region = Merged[Index].Region;
+    Entries[Index].Offset = Merged[Index].Offset;
+    Entries[Index].Reads = Merged[Index].Reads;
+    Entries[Index].Writes = Merged[Index].Writes;
+  }
+
+  if (Merged != NULL) {
+    FreePool (Merged);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Finds the module containing the call site.
+
+  @param[in]  CallSite      Return address.
+  @param[out] Module        Path of the module or "?" if unknown.
+  @param[out] ModuleOffset  Offset of the call site from the module load address.
+                            Equal to CallSite if the module is unknown.
+**/
+STATIC
+VOID
+CallSiteResolve (
+  IN  UINT64       CallSite,
+  OUT CONST CHAR8  **Module,
+  OUT UINT64       *ModuleOffset
+  )
+{
+#if !defined (_WIN32)
+  Dl_info  Info;
+
+  if (dladdr ((VOID *)(UINTN) CallSite, &Info) != 0 && Info.dli_fname != NULL) {
+    *Module = Info.dli_fname;
+    *ModuleOffset = CallSite - (UINT64)(UINTN) Info.dli_fbase;
+    return;
+  }
+#endif
+
+  *Module = "?";
+  *ModuleOffset = CallSite;
+}
+
+/**
+  Returns the file name part of the module path.
+**/
+STATIC
+CONST CHAR8*
+CallSiteModuleName (
+  IN CONST CHAR8  *Module
+  )
+{
+  CONST CHAR8  *Name;
+
+  for (Name = Module; *Module != '\0'; Module++) {
+    if (*Module == '/' || *Module == '\\') {
+      Name = Module + 1;
+    }
+  }
+
+  return Name;
+}
+
+VOID
+RegisterAccessIoCallSiteDump (
+  IN UINTN  Count
+  )
+{
+  REGISTER_ACCESS_IO_CALL_SITE        *Entries;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  CONST CHAR8                         *Module;
+  UINT64                              ModuleOffset;
+  UINTN                               Index;
+
+  if (Count == 0) {
+    return;
+  }
+
+  Entries = AllocatePool (Count * sizeof (REGISTER_ACCESS_IO_CALL_SITE));
+  if (Entries == NULL) {
+    return;
+  }
+
+  if (EFI_ERROR (RegisterAccessIoCallSiteGetTop (Entries, &Count))) {
+    FreePool (Entries);
+    return;
+  }
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  DEBUG ((DEBUG_INFO, "Hottest call sites:\n"));
+  DEBUG ((DEBUG_INFO, "%-32a %-16a %-32a %-16a %-12a %-12a\n", "Module", "ModuleOffset", "Region", "Offset", "Reads", "Writes"));
+  for (Index = 0; Index < Count; Index++) {
+    CallSiteResolve (Entries[Index].CallSite, &Module, &ModuleOffset);
+    DEBUG ((
+      DEBUG_INFO,
+      "%-32a %016LX %-32a %016LX %-12Ld %-12Ld\n",
+      CallSiteModuleName (Module),
+      ModuleOffset,
+      (Entries[Index].Region < RegionCount) ? Regions[Entries[Index].Region].Name : "?",
+      Entries[Index].Offset,
+      Entries[Index].Reads,
+      Entries[Index].Writes
+      ));
+  }
+
+  FreePool (Entries);
+}
+
+EFI_STATUS
+RegisterAccessIoCallSiteSave (
+  IN CONST CHAR8  *FileName
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER          *Entries;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  CONST CHAR8                         *Module;
+  UINT64                              ModuleOffset;
+  UINTN                               Count;
+  UINTN                               Index;
+  FILE                                *File;
+  EFI_STATUS                          Status;
+
+  if (FileName == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RegisterAccessIoCounterMerge (mCallSiteTableList, &Entries, &Count);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  File = fopen (FileName, "w");
+  if (File == NULL) {
+    if (Entries != NULL) {
+      FreePool (Entries);
+    }
+    return EFI_DEVICE_ERROR;
+  }
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  fprintf (File, "# Module\tModuleOffset\tAddress\tRegion\tOffset\tReads\tWrites\n");
+  for (Index = 0; Index < Count; Index++) {
+    CallSiteResolve (Entries[Index].CallSite, &Module, &ModuleOffset);
+    fprintf (
+      File,
+      "%s\t0x%llx\t0x%llx\t%s\t0x%llx\t%llu\t%llu\n",
+      Module,
+      (unsigned long long) ModuleOffset,
+      (unsigned long long) Entries[Index].CallSite,
+      (Entries[Index].Region < RegionCount) ? Regions[Entries[Index].Region].Name : "?",
+      (unsigned long long) Entries[Index].Offset,
+      (unsigned long long) Entries[Index].Reads,
+      (unsigned long long) Entries[Index].Writes
+      );
+  }
+
+  Status = (ferror (File) != 0) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+  if (fclose (File) != 0) {
+    Status = EFI_DEVICE_ERROR;
+  }
+
+  if (Entries != NULL) {
+    FreePool (Entries);
+  }
+
+  return Status;
+}
\ No newline at end of file
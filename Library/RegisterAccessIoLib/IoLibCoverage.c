@@ -0,0 +1,616 @@
+/** @file
+  Register offset coverage per region.
+
+  Every region has a bitmap with a read and a write bit per DWORD. Bitmaps
+  are shared by all threads: a bit is set with a compare-exchange the first
+  time the DWORD is accessed, every later access only reads it. Bitmaps are
+  kept in pages of regions which are never reallocated so coverage can be
+  collected while other threads access registers.
+
+  Coverage files list regions by name and type so files saved by different
+  test binaries, which register devices in different order and at different
+  addresses, can be merged into a single per-device summary.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+#define COVERAGE_PAGE_SHIFT  8
+#define COVERAGE_PAGE_SIZE   (1 << COVERAGE_PAGE_SHIFT)
+#define COVERAGE_PAGE_COUNT  ((MAX_UINT16 + 1) >> COVERAGE_PAGE_SHIFT)
+
+//
+// Offsets above 16MB of a region are not tracked.
+//
+#define COVERAGE_MAX_DWORDS  (SIZE_16MB / sizeof (UINT32))
+
+#define COVERAGE_BITS_PER_WORD  32
+#define COVERAGE_WORDS(NoOfDwords)  ((UINTN) DivU64x32 ((NoOfDwords) * 2 + COVERAGE_BITS_PER_WORD - 1, COVERAGE_BITS_PER_WORD))
+
+#define COVERAGE_FILE_HEADER  "# RegisterAccessIoLib coverage\n"
+#define COVERAGE_LINE_LENGTH  256
+
+typedef struct {
+  UINT64  NoOfDwords;
+  //
+  // Bit 2 * Dword is set when the DWORD was read, bit 2 * Dword + 1 when it
+  // was written.
+  //
+  UINT32  *Bits;
+} REGISTER_ACCESS_IO_COVERAGE_BITMAP;
+
+//
+// Coverage of a device merged from any number of regions and files.
+//
+typedef struct {
+  CHAR8   Name[REGISTER_ACCESS_TRACE_REGION_NAME_LENGTH];
+  UINT8   Type;
+  UINT64  NoOfDwords;
+  UINT32  *Bits;
+} COVERAGE_ENTRY;
+
+typedef struct {
+  COVERAGE_ENTRY  *Entries;
+  UINTN           NoOfEntries;
+} COVERAGE_SET;
+
+BOOLEAN  gRegisterAccessIoCoverageEnabled = FALSE;
+
+STATIC REGISTER_ACCESS_IO_COVERAGE_BITMAP  **volatile  mCoveragePages[COVERAGE_PAGE_COUNT];
+
+/**
+  Returns bitmap of the region. Allocates it on the first access.
+
+  @return Bitmap or NULL if the region has no size or memory allocation failed.
+**/
+STATIC
+REGISTER_ACCESS_IO_COVERAGE_BITMAP*
+CoverageGetBitmap (
+  IN UINT16  Region
+  )
+{
+  REGISTER_ACCESS_IO_COVERAGE_BITMAP  **Page;
+  REGISTER_ACCESS_IO_COVERAGE_BITMAP  *Bitmap;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINT64                              NoOfDwords;
+
+  Page = mCoveragePages[Region >> COVERAGE_PAGE_SHIFT];
+  if (Page == NULL) {
+    Page = AllocateZeroPool (COVERAGE_PAGE_SIZE * sizeof (REGISTER_ACCESS_IO_COVERAGE_BITMAP*));
+    if (Page == NULL) {
+      return NULL;
+    }
+    if (InterlockedCompareExchangePointer ((VOID *volatile *) &mCoveragePages[Region >> COVERAGE_PAGE_SHIFT], NULL, Page) != NULL) {
+      FreePool (Page);
+      Page = mCoveragePages[Region >> COVERAGE_PAGE_SHIFT];
+    }
+  }
+
+  Bitmap = Page[Region & (COVERAGE_PAGE_SIZE - 1)];
+  if (Bitmap != NULL) {
+    return Bitmap;
+  }
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  if (Region >= RegionCount) {
+    return NULL;
+  }
+  NoOfDwords = MIN (DivU64x32 (Regions[Region].Size + sizeof (UINT32) - 1, sizeof (UINT32)), COVERAGE_MAX_DWORDS);
+  if (NoOfDwords == 0) {
+    return NULL;
+  }
+
+  Bitmap = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_COVERAGE_BITMAP) + COVERAGE_WORDS (NoOfDwords) * sizeof (UINT32));
+  if (Bitmap == NULL) {
+    return NULL;
+  }
+  Bitmap->NoOfDwords = NoOfDwords;
+  Bitmap->Bits = (UINT32 *)(Bitmap + 1);
+  if (InterlockedCompareExchangePointer ((VOID *volatile *) &Page[Region & (COVERAGE_PAGE_SIZE - 1)], NULL, Bitmap) != NULL) {
+    FreePool (Bitmap);
+    Bitmap = Page[Region & (COVERAGE_PAGE_SIZE - 1)];
+  }
+
+  return Bitmap;
+}
+
+VOID
+RegisterAccessIoCoverageMark (
+  IN UINT16   Region,
+  IN UINT64   Offset,
+  IN UINT32   Size,
+  IN BOOLEAN  IsWrite
+  )
+{
+  REGISTER_ACCESS_IO_COVERAGE_BITMAP  *Bitmap;
+  volatile UINT32                     *Word;
+  UINT32                              Mask;
+  UINT32                              Value;
+  UINTN                               Dword;
+  UINTN                               LastDword;
+  UINTN                               Bit;
+
+  if (Region == REGISTER_ACCESS_TRACE_REGION_UNMAPPED) {
+    return;
+  }
+
+  Bitmap = CoverageGetBitmap (Region);
+  if (Bitmap == NULL) {
+    return;
+  }
+
+  if (RShiftU64 (Offset, 2) >= Bitmap->NoOfDwords) {
+    return;
+  }
+
+  LastDword = (UINTN) MIN (RShiftU64 (Offset + MAX (Size, 1) - 1, 2), Bitmap->NoOfDwords - 1);
+  for (Dword = (UINTN) RShiftU64 (Offset, 2); Dword <= LastDword; Dword++) {
+    Bit = Dword * 2 + (IsWrite ? 1 : 0);
+    Word = &Bitmap->Bits[Bit / COVERAGE_BITS_PER_WORD];
+    Mask = 1U << (Bit % COVERAGE_BITS_PER_WORD);
+    //
+    // Registers are accessed many times but their bit is set only once, so
+    // only the first access pays for the compare-exchange.
+    //
+    while (((Value = *Word) & Mask) == 0) {
+      if (InterlockedCompareExchange32 ((volatile UINT32 *) Word, Value, Value | Mask) == Value) {
+        break;
+      }
+    }
+  }
+}
+
+VOID
+RegisterAccessIoCoverageEnable (
+  IN BOOLEAN  Enable
+  )
+{
+  gRegisterAccessIoCoverageEnabled = Enable;
+}
+
+VOID
+RegisterAccessIoCoverageReset (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_COVERAGE_BITMAP  **Page;
+  UINTN                               PageIndex;
+  UINTN                               Index;
+
+  for (PageIndex = 0; PageIndex < COVERAGE_PAGE_COUNT; PageIndex++) {
+    Page = mCoveragePages[PageIndex];
+    if (Page == NULL) {
+      continue;
+    }
+    for (Index = 0; Index < COVERAGE_PAGE_SIZE; Index++) {
+      if (Page[Index] != NULL) {
+        ZeroMem (Page[Index]->Bits, COVERAGE_WORDS (Page[Index]->NoOfDwords) * sizeof (UINT32));
+      }
+    }
+  }
+}
+
+/**
+  Counts registers covered by the bitmap.
+**/
+STATIC
+VOID
+CoverageSummarize (
+  IN  CONST UINT32                         *Bits,
+  IN  UINT64                               NoOfDwords,
+  OUT REGISTER_ACCESS_IO_COVERAGE_SUMMARY  *Summary
+  )
+{
+  UINTN   Dword;
+  UINT32  Pair;
+
+  Summary->Registers = NoOfDwords;
+  Summary->Read = 0;
+  Summary->Written = 0;
+  Summary->Accessed = 0;
+  for (Dword = 0; Dword < NoOfDwords; Dword++) {
+    Pair = (Bits[(Dword * 2) / COVERAGE_BITS_PER_WORD] >> ((Dword * 2) % COVERAGE_BITS_PER_WORD)) & 0x3;
+    if ((Pair & BIT0) != 0) {
+      Summary->Read++;
+    }
+    if ((Pair & BIT1) != 0) {
+      Summary->Written++;
+    }
+    if (Pair != 0) {
+      Summary->Accessed++;
+    }
+  }
+}
+
+EFI_STATUS
+RegisterAccessIoCoverageGet (
+  IN  UINT16                               Region,
+  OUT REGISTER_ACCESS_IO_COVERAGE_SUMMARY  *Summary
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  REGISTER_ACCESS_IO_COVERAGE_BITMAP  **Page;
+  REGISTER_ACCESS_IO_COVERAGE_BITMAP  *Bitmap;
+  UINT32                              RegionCount;
+
+  if (Summary == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  if (Region >= RegionCount) {
+    return EFI_NOT_FOUND;
+  }
+
+  ZeroMem (Summary, sizeof (REGISTER_ACCESS_IO_COVERAGE_SUMMARY));
+  CopyMem (Summary->Name, Regions[Region].Name, sizeof (Summary->Name));
+  Summary->Type = Regions[Region].Type;
+  Summary->Registers = MIN (DivU64x32 (Regions[Region].Size + sizeof (UINT32) - 1, sizeof (UINT32)), COVERAGE_MAX_DWORDS);
+
+  Page = mCoveragePages[Region >> COVERAGE_PAGE_SHIFT];
+  Bitmap = (Page != NULL) ? Page[Region & (COVERAGE_PAGE_SIZE - 1)] : NULL;
+  if (Bitmap != NULL) {
+    CoverageSummarize (Bitmap->Bits, Bitmap->NoOfDwords, Summary);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Adds coverage of a region to the set. Regions with the same name and type
+  are merged into one entry as the same device.
+
+  @param[in,out] Set         Set to add to.
+  @param[in]     Name        Name of the region.
+  @param[in]     Type        Type of the region.
+  @param[in]     NoOfDwords  Size of the region in DWORDs.
+
+  @return Entry of the region or NULL if memory allocation failed.
+**/
+STATIC
+COVERAGE_ENTRY*
+CoverageSetAdd (
+  IN OUT COVERAGE_SET  *Set,
+  IN     CONST CHAR8   *Name,
+  IN     UINT8         Type,
+  IN     UINT64        NoOfDwords
+  )
+{
+  COVERAGE_ENTRY  *Entries;
+  COVERAGE_ENTRY  *Entry;
+  UINT32          *Bits;
+  UINTN           Index;
+
+  NoOfDwords = MIN (NoOfDwords, COVERAGE_MAX_DWORDS);
+  Entry = NULL;
+  for (Index = 0; Index < Set->NoOfEntries; Index++) {
+    if (Set->Entries[Index].Type == Type && AsciiStrCmp (Set->Entries[Index].Name, Name) == 0) {
+      Entry = &Set->Entries[Index];
+      break;
+    }
+  }
+
+  if (Entry == NULL) {
+    Entries = ReallocatePool (
+                Set->NoOfEntries * sizeof (COVERAGE_ENTRY),
+                (Set->NoOfEntries + 1) * sizeof (COVERAGE_ENTRY),
+                Set->Entries
+                );
+    if (Entries == NULL) {
+      return NULL;
+    }
+    Set->Entries = Entries;
+    Entry = &Set->Entries[Set->NoOfEntries];
+    ZeroMem (Entry, sizeof (COVERAGE_ENTRY));
+    AsciiStrnCpyS (Entry->Name, sizeof (Entry->Name), Name, sizeof (Entry->Name) - 1);
+    Entry->Type = Type;
+    Set->NoOfEntries++;
+  }
+
+  //
+  // Device model can grow between builds, keep the largest size seen.
+  //
+  if (NoOfDwords > Entry->NoOfDwords) {
+    Bits = ReallocatePool (
+             COVERAGE_WORDS (Entry->NoOfDwords) * sizeof (UINT32),
+             COVERAGE_WORDS (NoOfDwords) * sizeof (UINT32),
+             Entry->Bits
+             );
+    if (Bits == NULL) {
+      return NULL;
+    }
+    ZeroMem (
+      &Bits[COVERAGE_WORDS (Entry->NoOfDwords)],
+      (COVERAGE_WORDS (NoOfDwords) - COVERAGE_WORDS (Entry->NoOfDwords)) * sizeof (UINT32)
+      );
+    Entry->Bits = Bits;
+    Entry->NoOfDwords = NoOfDwords;
+  }
+
+  return Entry;
+}
+
+STATIC
+VOID
+CoverageSetFree (
+  IN COVERAGE_SET  *Set
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Set->NoOfEntries; Index++) {
+    if (Set->Entries[Index].Bits != NULL) {
+      FreePool (Set->Entries[Index].Bits);
+    }
+  }
+  if (Set->Entries != NULL) {
+    FreePool (Set->Entries);
+  }
+  Set->Entries = NULL;
+  Set->NoOfEntries = 0;
+}
+
+/**
+  Adds coverage collected in this process to the set.
+**/
+STATIC
+EFI_STATUS
+CoverageSetAddLive (
+  IN OUT COVERAGE_SET  *Set
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  REGISTER_ACCESS_IO_COVERAGE_BITMAP  **Page;
+  REGISTER_ACCESS_IO_COVERAGE_BITMAP  *Bitmap;
+  COVERAGE_ENTRY                      *Entry;
+  UINT32                              RegionCount;
+  UINT32                              Region;
+  UINTN                               Index;
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  for (Region = 0; Region < RegionCount; Region++) {
+    if (Regions[Region].Size == 0) {
+      continue;
+    }
+    Entry = CoverageSetAdd (Set, Regions[Region].Name, Regions[Region].Type, DivU64x32 (Regions[Region].Size + sizeof (UINT32) - 1, sizeof (UINT32)));
+    if (Entry == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Page = mCoveragePages[Region >> COVERAGE_PAGE_SHIFT];
+    Bitmap = (Page != NULL) ? Page[Region & (COVERAGE_PAGE_SIZE - 1)] : NULL;
+    if (Bitmap == NULL) {
+      continue;
+    }
+    for (Index = 0; Index < COVERAGE_WORDS (Bitmap->NoOfDwords); Index++) {
+      Entry->Bits[Index] |= Bitmap->Bits[Index];
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Adds coverage saved in the file to the set.
+
+  File lists a region per line as "Name<TAB>Type<TAB>Registers" followed by
+  lines "<TAB>WordIndex<TAB>0xBits" for every non-zero word of its bitmap.
+**/
+STATIC
+EFI_STATUS
+CoverageSetAddFile (
+  IN OUT COVERAGE_SET  *Set,
+  IN     CONST CHAR8   *FileName
+  )
+{
+  FILE                *File;
+  CHAR8               Line[COVERAGE_LINE_LENGTH];
+  CHAR8               *Tab;
+  COVERAGE_ENTRY      *Entry;
+  unsigned int        Type;
+  unsigned long long  NoOfDwords;
+  unsigned long long  WordIndex;
+  unsigned int        Bits;
+  EFI_STATUS          Status;
+
+  File = fopen (FileName, "r");
+  if (File == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (fgets (Line, sizeof (Line), File) == NULL || AsciiStrCmp (Line, COVERAGE_FILE_HEADER) != 0) {
+    fclose (File);
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Status = EFI_SUCCESS;
+  Entry = NULL;
+  while (fgets (Line, sizeof (Line), File) != NULL) {
+    if (Line[0] == '#') {
+      continue;
+    }
+
+    if (Line[0] == '\t') {
+      if (Entry == NULL || sscanf (Line, "\t%llu\t%x", &WordIndex, &Bits) != 2) {
+        Status = EFI_VOLUME_CORRUPTED;
+        break;
+      }
+      if (WordIndex < COVERAGE_WORDS (Entry->NoOfDwords)) {
+        Entry->Bits[WordIndex] |= Bits;
+      }
+      continue;
+    }
+
+    Tab = strchr (Line, '\t');
+    if (Tab == NULL || sscanf (Tab, "\t%u\t%llu", &Type, &NoOfDwords) != 2) {
+      Status = EFI_VOLUME_CORRUPTED;
+      break;
+    }
+    *Tab = '\0';
+    Entry = CoverageSetAdd (Set, Line, (UINT8) Type, NoOfDwords);
+    if (Entry == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      break;
+    }
+  }
+
+  fclose (File);
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+CoverageSetSave (
+  IN COVERAGE_SET  *Set,
+  IN CONST CHAR8   *FileName
+  )
+{
+  FILE            *File;
+  COVERAGE_ENTRY  *Entry;
+  UINTN           EntryIndex;
+  UINTN           Index;
+  EFI_STATUS      Status;
+
+  File = fopen (FileName, "w");
+  if (File == NULL) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  fprintf (File, COVERAGE_FILE_HEADER);
+  fprintf (File, "# Name\tType\tRegisters\n");
+  for (EntryIndex = 0; EntryIndex < Set->NoOfEntries; EntryIndex++) {
+    Entry = &Set->Entries[EntryIndex];
+    fprintf (File, "%s\t%u\t%llu\n", Entry->Name, (unsigned int) Entry->Type, (unsigned long long) Entry->NoOfDwords);
+    for (Index = 0; Index < COVERAGE_WORDS (Entry->NoOfDwords); Index++) {
+      if (Entry->Bits[Index] != 0) {
+        fprintf (File, "\t%llu\t0x%08x\n", (unsigned long long) Index, (unsigned int) Entry->Bits[Index]);
+      }
+    }
+  }
+
+  Status = (ferror (File) != 0) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+  if (fclose (File) != 0) {
+    Status = EFI_DEVICE_ERROR;
+  }
+
+  return Status;
+}
+
+EFI_STATUS
+RegisterAccessIoCoverageSave (
+  IN CONST CHAR8  *FileName
+  )
+{
+  COVERAGE_SET  Set;
+  EFI_STATUS    Status;
+
+  if (FileName == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (&Set, sizeof (Set));
+  Status = CoverageSetAddLive (&Set);
+  if (!EFI_ERROR (Status)) {
+    Status = CoverageSetSave (&Set, FileName);
+  }
+  CoverageSetFree (&Set);
+
+  return Status;
+}
+
+EFI_STATUS
+RegisterAccessIoCoverageMerge (
+  IN CONST CHAR8 *CONST  *InputFiles,
+  IN UINTN               NoOfInputFiles,
+  IN CONST CHAR8         *OutputFile
+  )
+{
+  COVERAGE_SET  Set;
+  EFI_STATUS    Status;
+  UINTN         Index;
+
+  if ((InputFiles == NULL && NoOfInputFiles != 0) || OutputFile == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (&Set, sizeof (Set));
+  Status = EFI_SUCCESS;
+  for (Index = 0; Index < NoOfInputFiles && !EFI_ERROR (Status); Index++) {
+    Status = CoverageSetAddFile (&Set, InputFiles[Index]);
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = CoverageSetSave (&Set, OutputFile);
+  }
+  CoverageSetFree (&Set);
+
+  return Status;
+}
+
+EFI_STATUS
+RegisterAccessIoCoverageReport (
+  IN     CONST CHAR8                          *FileName,
+  OUT    REGISTER_ACCESS_IO_COVERAGE_SUMMARY  *Summaries OPTIONAL,
+  IN OUT UINTN                                *NoOfSummaries OPTIONAL
+  )
+{
+  COVERAGE_SET                         Set;
+  COVERAGE_ENTRY                       *Entry;
+  REGISTER_ACCESS_IO_COVERAGE_SUMMARY  Summary;
+  EFI_STATUS                           Status;
+  UINTN                                Index;
+
+  if (FileName == NULL || (Summaries != NULL && NoOfSummaries == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (&Set, sizeof (Set));
+  Status = CoverageSetAddFile (&Set, FileName);
+  if (EFI_ERROR (Status)) {
+    CoverageSetFree (&Set);
+    return Status;
+  }
+
+  DEBUG ((DEBUG_INFO, "Register coverage of %a:\n", FileName));
+  DEBUG ((DEBUG_INFO, "%-32a %-8a %-10a %-10a %-10a %-10a %a\n", "Device", "Type", "Registers", "Read", "Written", "Untouched", "Covered"));
+  for (Index = 0; Index < Set.NoOfEntries; Index++) {
+    Entry = &Set.Entries[Index];
+    ZeroMem (&Summary, sizeof (Summary));
+    CopyMem (Summary.Name, Entry->Name, sizeof (Summary.Name));
+    Summary.Type = Entry->Type;
+    CoverageSummarize (Entry->Bits, Entry->NoOfDwords, &Summary);
+    DEBUG ((
+      DEBUG_INFO,
+      "%-32a %-8a %-10Ld %-10Ld %-10Ld %-10Ld %Ld%%\n",
+      Summary.Name,
+      RegisterAccessIoRegionTypeName (Summary.Type),
+      Summary.Registers,
+      Summary.Read,
+      Summary.Written,
+      Summary.Registers - Summary.Accessed,
+      (Summary.Registers != 0) ? DivU64x64Remainder (Summary.Accessed * 100, Summary.Registers, NULL) : 0
+      ));
+    if (Summaries != NULL && Index < *NoOfSummaries) {
+      CopyMem (&Summaries[Index], &Summary, sizeof (Summary));
+    }
+  }
+
+  if (Summaries != NULL) {
+    *NoOfSummaries = MIN (*NoOfSummaries, Set.NoOfEntries);
+  }
+  CoverageSetFree (&Set);
+
+  return EFI_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+/** @file
+  Per-register access counters.
+
+  Counters are kept in per-thread access counter tables keyed by region and
+  offset so the hot path never takes a lock. Tables are merged only when the
+  counters are read.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+BOOLEAN  gRegisterAccessIoHotAccessEnabled = FALSE;
+
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL REGISTER_ACCESS_IO_COUNTER_TABLE  *mHotAccessTable = NULL;
+STATIC REGISTER_ACCESS_IO_COUNTER_TABLE  *volatile mHotAccessTableList = NULL;
+
+VOID
+RegisterAccessIoHotAccessCount (
+  IN UINT16   Region,
+  IN UINT64   Offset,
+  IN UINT32   Width,
+  IN BOOLEAN  IsWrite
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER  *Entry;
+
+  Entry = RegisterAccessIoCounterGet (&mHotAccessTable, &mHotAccessTableList, 0, Region, Offset);
+  if (Entry == NULL) {
+    return;
+  }
+
+  //
+  // Widths are powers of 2 so OR-ing them gives the width bitmap directly.
+  //
+  if (IsWrite) {
+    Entry->Writes++;
+    Entry->WriteWidths |= (UINT8) Width;
+  } else {
+    Entry->Reads++;
+    Entry->ReadWidths |= (UINT8) Width;
+  }
+}
+
+VOID
+RegisterAccessIoHotAccessEnable (
+  IN BOOLEAN  Enable
+  )
+{
+  gRegisterAccessIoHotAccessEnabled = Enable;
+}
+
+VOID
+RegisterAccessIoHotAccessReset (
+  VOID
+  )
+{
+  RegisterAccessIoCounterReset (mHotAccessTableList);
+}
+
+EFI_STATUS
+RegisterAccessIoHotAccessGetTop (
+  OUT    REGISTER_ACCESS_IO_HOT_ACCESS  *Entries,
+  IN OUT UINTN                          *NoOfEntries
+  )
+{
+  REGISTER_ACCESS_IO_COUNTER  *Merged;
+  UINTN                       Count;
+  UINTN                       Index;
+  EFI_STATUS                  Status;
+
+  if (Entries == NULL || NoOfEntries == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RegisterAccessIoCounterMerge (mHotAccessTableList, &Merged, &Count);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  *NoOfEntries = MIN (*NoOfEntries, Count);
+  for (Index = 0; Index < *NoOfEntries; Index++) {
+    Entries[Index].Region = Merged[Index].Region;
+    Entries[Index].Offset = Merged[Index].Offset;
+    Entries[Index].Reads = Merged[Index].Reads;
+    Entries[Index].Writes = Merged[Index].Writes;
+    Entries[Index].ReadWidths = Merged[Index].ReadWidths;
+    Entries[Index].WriteWidths = Merged[Index].WriteWidths;
+  }
+
+  if (Merged != NULL) {
+    FreePool (Merged);
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+VOID
+HotAccessFormatWidths (
+  IN  UINT8  Widths,
+  OUT CHAR8  *Buffer
+  )
+{
+  UINTN  Bit;
+  UINTN  Length;
+
+  Length = 0;
+  for (Bit = 0; Bit < 4; Bit++) {
+    if (Widths & (1 << Bit)) {
+      if (Length != 0) {
+        Buffer[Length++] = '/';
+      }
+      Buffer[Length++] = (CHAR8)('0' + (1 << Bit));
+    }
+  }
+  if (Length == 0) {
+    Buffer[Length++] = '-';
+  }
+  Buffer[Length] = '\0';
+}
+
+VOID
+RegisterAccessIoHotAccessDump (
+  IN UINTN  Count
+  )
+{
+  REGISTER_ACCESS_IO_HOT_ACCESS       *Entries;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINTN                               Index;
+  CHAR8                               ReadWidths[8];
+  CHAR8                               WriteWidths[8];
+
+  if (Count == 0) {
+    return;
+  }
+
+  Entries = AllocatePool (Count * sizeof (REGISTER_ACCESS_IO_HOT_ACCESS));
+  if (Entries == NULL) {
+    return;
+  }
+
+  if (EFI_ERROR (RegisterAccessIoHotAccessGetTop (Entries, &Count))) {
+    FreePool (Entries);
+    return;
+  }
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  DEBUG ((DEBUG_INFO, "Hottest registers:\n"));
+  DEBUG ((DEBUG_INFO, "%-32a %-16a %-12a %-12a %-8a %-8a\n", "Region", "Offset", "Reads", "Writes", "RdWidth", "WrWidth"));
+  for (Index = 0; Index < Count; Index++) {
+    HotAccessFormatWidths (Entries[Index].ReadWidths, ReadWidths);
+    HotAccessFormatWidths (Entries[Index].WriteWidths, WriteWidths);
+    DEBUG ((
+      DEBUG_INFO,
+      "%-32a %016LX %-12Ld %-12Ld %-8a %-8a\n",
+      (Entries[Index].Region < RegionCount) ? Regions[Entries[Index].Region].Name : "?",
+      Entries[Index].Offset,
+      Entries[Index].Reads,
+      Entries[Index].Writes,
+      ReadWidths,
+      WriteWidths
+      ));
+  }
+
+  FreePool (Entries);
+}
\ No newline at end of file
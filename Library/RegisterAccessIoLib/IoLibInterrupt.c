@@ -0,0 +1,417 @@
+/** @file
+  Interrupt delivery of a simulation context.
+
+  Device models raise interrupts into a bounded queue of the context instead
+  of setting a status bit the driver has to poll. The queue is a ring of
+  slots with a sequence number each, so producers on any thread and the
+  consumer reserve slots with a compare exchange on the tail or head and never
+  take a lock. Full queue drops the interrupt, same as an overflowing MSI
+  mailbox, and counts it as lost.
+
+  Raising an interrupt notifies the virtual time of the context, so the
+  driver thread waiting for an interrupt wakes up as soon as a device model
+  on another thread raises one.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+#define REGISTER_ACCESS_IO_INTERRUPT_QUEUE_MASK  (REGISTER_ACCESS_IO_INTERRUPT_QUEUE_SIZE - 1)
+
+//
+// Head and tail are kept on separate cache lines so that producers and the
+// consumer don't invalidate each other's line on every interrupt.
+//
+#define REGISTER_ACCESS_IO_INTERRUPT_CACHE_LINE_SIZE  64
+
+typedef struct {
+  //
+  // Equals to the position of the slot in the ring when the slot is free and
+  // to the position + 1 when it holds an interrupt ready to be taken.
+  //
+  volatile UINT32               Sequence;
+  REGISTER_ACCESS_IO_INTERRUPT  Interrupt;
+} REGISTER_ACCESS_IO_INTERRUPT_SLOT;
+
+typedef struct {
+  REGISTER_ACCESS_IO_INTERRUPT_HANDLER  Handler;
+  VOID                                  *Context;
+} REGISTER_ACCESS_IO_INTERRUPT_VECTOR;
+
+typedef struct {
+  volatile UINT32                      Tail;
+  UINT8                                TailPad[REGISTER_ACCESS_IO_INTERRUPT_CACHE_LINE_SIZE - sizeof (UINT32)];
+  volatile UINT32                      Head;
+  UINT8                                HeadPad[REGISTER_ACCESS_IO_INTERRUPT_CACHE_LINE_SIZE - sizeof (UINT32)];
+  REGISTER_ACCESS_IO_INTERRUPT_SLOT    Slots[REGISTER_ACCESS_IO_INTERRUPT_QUEUE_SIZE];
+  REGISTER_ACCESS_IO_INTERRUPT_VECTOR  Vectors[REGISTER_ACCESS_IO_INTERRUPT_VECTORS];
+  //
+  // Updated by producers.
+  //
+  volatile UINT32                      Raised;
+  volatile UINT32                      Lost;
+  //
+  // Updated by the thread dispatching interrupts.
+  //
+  UINT64                               Dispatched;
+  UINT64                               Unhandled;
+  UINT64                               TotalLatency;
+  UINT64                               MaxLatency;
+} REGISTER_ACCESS_IO_INTERRUPTS;
+
+STATIC
+VOID
+InterruptQueueInitialize (
+  IN REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts
+  )
+{
+  UINT32  Index;
+
+  Interrupts->Head = 0;
+  Interrupts->Tail = 0;
+  for (Index = 0; Index < REGISTER_ACCESS_IO_INTERRUPT_QUEUE_SIZE; Index++) {
+    Interrupts->Slots[Index].Sequence = Index;
+  }
+}
+
+/**
+  Returns interrupts of the context.
+
+  @param[in] Context   Simulation context.
+  @param[in] Allocate  TRUE to allocate the interrupts of the context if it has none yet.
+
+  @return Interrupts or NULL if the context has none and they weren't allocated.
+**/
+STATIC
+REGISTER_ACCESS_IO_INTERRUPTS*
+InterruptsGetFromContext (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context,
+  IN BOOLEAN                         Allocate
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts;
+
+  if (Context->Interrupts != NULL || !Allocate) {
+    return (REGISTER_ACCESS_IO_INTERRUPTS*) Context->Interrupts;
+  }
+
+  Interrupts = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_INTERRUPTS));
+  if (Interrupts == NULL) {
+    return NULL;
+  }
+  InterruptQueueInitialize (Interrupts);
+
+  //
+  // Device models on other threads may race the driver to allocate the queue.
+  //
+  if (InterlockedCompareExchangePointer (&Context->Interrupts, NULL, Interrupts) != NULL) {
+    FreePool (Interrupts);
+  }
+
+  return (REGISTER_ACCESS_IO_INTERRUPTS*) Context->Interrupts;
+}
+
+/**
+  Returns interrupts of the calling thread's context.
+**/
+STATIC
+REGISTER_ACCESS_IO_INTERRUPTS*
+InterruptsGet (
+  IN BOOLEAN  Allocate
+  )
+{
+  return InterruptsGetFromContext (RegisterAccessIoSimContextGetCurrent (), Allocate);
+}
+
+/**
+  Appends interrupt to the queue.
+
+  @return FALSE if the queue is full.
+**/
+STATIC
+BOOLEAN
+InterruptQueuePush (
+  IN REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts,
+  IN REGISTER_ACCESS_IO_INTERRUPT   *Interrupt
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPT_SLOT  *Slot;
+  UINT32                             Position;
+  INT32                              Difference;
+
+  do {
+    Position = Interrupts->Tail;
+    Slot = &Interrupts->Slots[Position & REGISTER_ACCESS_IO_INTERRUPT_QUEUE_MASK];
+    Difference = (INT32) (Slot->Sequence - Position);
+    if (Difference == 0) {
+      if (InterlockedCompareExchange32 (&Interrupts->Tail, Position, Position + 1) == Position) {
+        break;
+      }
+    } else if (Difference < 0) {
+      //
+      // Slot still holds the interrupt from the previous lap.
+      //
+      return FALSE;
+    }
+  } while (TRUE);
+
+  CopyMem (&Slot->Interrupt, Interrupt, sizeof (REGISTER_ACCESS_IO_INTERRUPT));
+  MemoryFence ();
+  Slot->Sequence = Position + 1;
+  return TRUE;
+}
+
+/**
+  Takes the oldest interrupt off the queue.
+
+  @return FALSE if the queue is empty.
+**/
+STATIC
+BOOLEAN
+InterruptQueuePop (
+  IN  REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts,
+  OUT REGISTER_ACCESS_IO_INTERRUPT   *Interrupt
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPT_SLOT  *Slot;
+  UINT32                             Position;
+  INT32                              Difference;
+
+  do {
+    Position = Interrupts->Head;
+    Slot = &Interrupts->Slots[Position & REGISTER_ACCESS_IO_INTERRUPT_QUEUE_MASK];
+    Difference = (INT32) (Slot->Sequence - (Position + 1));
+    if (Difference == 0) {
+      if (InterlockedCompareExchange32 (&Interrupts->Head, Position, Position + 1) == Position) {
+        break;
+      }
+    } else if (Difference < 0) {
+      return FALSE;
+    }
+  } while (TRUE);
+
+  MemoryFence ();
+  CopyMem (Interrupt, &Slot->Interrupt, sizeof (REGISTER_ACCESS_IO_INTERRUPT));
+  MemoryFence ();
+  Slot->Sequence = Position + REGISTER_ACCESS_IO_INTERRUPT_QUEUE_SIZE;
+  return TRUE;
+}
+
+EFI_STATUS
+RegisterAccessIoInterruptRaise (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context OPTIONAL,
+  IN UINT32                          Vector,
+  IN UINT32                          Data
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts;
+  REGISTER_ACCESS_IO_INTERRUPT   Interrupt;
+
+  if (Vector >= REGISTER_ACCESS_IO_INTERRUPT_VECTORS) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Context == NULL) {
+    Context = RegisterAccessIoSimContextGetCurrent ();
+  }
+
+  Interrupts = InterruptsGetFromContext (Context, TRUE);
+  if (Interrupts == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Interrupt.Vector = Vector;
+  Interrupt.Data = Data;
+  Interrupt.Time = RegisterAccessIoSimTimeGetContextNow (Context);
+  InterlockedIncrement (&Interrupts->Raised);
+  if (!InterruptQueuePush (Interrupts, &Interrupt)) {
+    InterlockedIncrement (&Interrupts->Lost);
+    DEBUG ((DEBUG_ERROR, "Interrupt queue full, vector %d lost\n", Vector));
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  RegisterAccessIoSimTimeNotify (Context);
+  return EFI_SUCCESS;
+}
+
+BOOLEAN
+RegisterAccessIoInterruptPop (
+  OUT REGISTER_ACCESS_IO_INTERRUPT  *Interrupt
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts;
+
+  if (Interrupt == NULL) {
+    return FALSE;
+  }
+
+  Interrupts = InterruptsGet (FALSE);
+  if (Interrupts == NULL) {
+    return FALSE;
+  }
+
+  return InterruptQueuePop (Interrupts, Interrupt);
+}
+
+BOOLEAN
+RegisterAccessIoInterruptIsPending (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts;
+  UINT32                         Position;
+
+  Interrupts = InterruptsGet (FALSE);
+  if (Interrupts == NULL) {
+    return FALSE;
+  }
+
+  Position = Interrupts->Head;
+  return (Interrupts->Slots[Position & REGISTER_ACCESS_IO_INTERRUPT_QUEUE_MASK].Sequence == Position + 1);
+}
+
+EFI_STATUS
+RegisterAccessIoInterruptSetHandler (
+  IN UINT32                                Vector,
+  IN REGISTER_ACCESS_IO_INTERRUPT_HANDLER  Handler OPTIONAL,
+  IN VOID                                  *Context OPTIONAL
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts;
+
+  if (Vector >= REGISTER_ACCESS_IO_INTERRUPT_VECTORS) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Interrupts = InterruptsGet (TRUE);
+  if (Interrupts == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Interrupts->Vectors[Vector].Handler = Handler;
+  Interrupts->Vectors[Vector].Context = Context;
+  return EFI_SUCCESS;
+}
+
+UINTN
+RegisterAccessIoInterruptDispatch (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPTS        *Interrupts;
+  REGISTER_ACCESS_IO_INTERRUPT         Interrupt;
+  REGISTER_ACCESS_IO_INTERRUPT_VECTOR  *Vector;
+  UINT64                               Latency;
+  UINTN                                Count;
+
+  Interrupts = InterruptsGet (FALSE);
+  if (Interrupts == NULL) {
+    return 0;
+  }
+
+  Count = 0;
+  while (InterruptQueuePop (Interrupts, &Interrupt)) {
+    Latency = RegisterAccessIoSimTimeGetNow () - Interrupt.Time;
+    Interrupts->Dispatched++;
+    Interrupts->TotalLatency += Latency;
+    Interrupts->MaxLatency = MAX (Interrupts->MaxLatency, Latency);
+    Count++;
+
+    Vector = &Interrupts->Vectors[Interrupt.Vector];
+    if (Vector->Handler == NULL) {
+      Interrupts->Unhandled++;
+      DEBUG ((DEBUG_WARN, "Unhandled interrupt, vector %d\n", Interrupt.Vector));
+      continue;
+    }
+    Vector->Handler (&Interrupt, Vector->Context);
+  }
+
+  return Count;
+}
+
+EFI_STATUS
+RegisterAccessIoInterruptWait (
+  IN UINT64  Timeout
+  )
+{
+  UINT64  Waited;
+
+  //
+  // Every wait ends at the next device model event or notification, which
+  // may be the one raising the interrupt.
+  //
+  Waited = 0;
+  while (!RegisterAccessIoInterruptIsPending ()) {
+    if (Waited >= Timeout) {
+      return EFI_TIMEOUT;
+    }
+    Waited += RegisterAccessIoSimTimeWait (Timeout - Waited);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessIoInterruptGetStats (
+  OUT REGISTER_ACCESS_IO_INTERRUPT_STATS  *Stats
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts;
+
+  if (Stats == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (Stats, sizeof (REGISTER_ACCESS_IO_INTERRUPT_STATS));
+  Interrupts = InterruptsGet (FALSE);
+  if (Interrupts == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Stats->Raised = Interrupts->Raised;
+  Stats->Dispatched = Interrupts->Dispatched;
+  Stats->Unhandled = Interrupts->Unhandled;
+  Stats->Lost = Interrupts->Lost;
+  Stats->TotalLatency = Interrupts->TotalLatency;
+  Stats->MaxLatency = Interrupts->MaxLatency;
+  return EFI_SUCCESS;
+}
+
+VOID
+RegisterAccessIoInterruptReset (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_INTERRUPTS  *Interrupts;
+
+  Interrupts = InterruptsGet (FALSE);
+  if (Interrupts == NULL) {
+    return;
+  }
+
+  ZeroMem (Interrupts, sizeof (REGISTER_ACCESS_IO_INTERRUPTS));
+  InterruptQueueInitialize (Interrupts);
+}
+
+VOID
+RegisterAccessIoInterruptFree (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  )
+{
+  if (Context->Interrupts == NULL) {
+    return;
+  }
+
+  FreePool (Context->Interrupts);
+  Context->Interrupts = NULL;
+}
\ No newline at end of file
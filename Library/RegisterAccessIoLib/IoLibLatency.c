@@ -0,0 +1,364 @@
+/** @file
+  Latency histograms of register space calls.
+
+  Samples are kept in log-linear histograms: every power of 2 is split into
+  LATENCY_SUB_BUCKETS linear buckets so that the relative error of reported
+  percentiles is bounded regardless of the magnitude of the value. Every
+  thread keeps its own histograms per region, they are summed only when the
+  statistics are read.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+#define LATENCY_SUB_BUCKET_BITS  4
+#define LATENCY_SUB_BUCKETS      (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKETS          ((64 - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+#define LATENCY_PAGE_SHIFT  8
+#define LATENCY_PAGE_SIZE   (1 << LATENCY_PAGE_SHIFT)
+#define LATENCY_PAGE_COUNT  ((MAX_UINT16 + 1) >> LATENCY_PAGE_SHIFT)
+
+typedef struct {
+  UINT64  Count;
+  UINT64  Min;
+  UINT64  Max;
+  UINT64  Buckets[LATENCY_BUCKETS];
+} REGISTER_ACCESS_IO_LATENCY_HISTOGRAM;
+
+typedef struct _REGISTER_ACCESS_IO_LATENCY_SHARD REGISTER_ACCESS_IO_LATENCY_SHARD;
+
+struct _REGISTER_ACCESS_IO_LATENCY_SHARD {
+  REGISTER_ACCESS_IO_LATENCY_SHARD      *Next;
+  //
+  // Pages of histogram pointers indexed by region id, never reallocated so
+  // that they can be read while the thread records. Pages and histograms
+  // are allocated on the first sample.
+  //
+  REGISTER_ACCESS_IO_LATENCY_HISTOGRAM  **volatile Pages[LATENCY_PAGE_COUNT];
+};
+
+BOOLEAN  gRegisterAccessIoLatencyEnabled = FALSE;
+
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL REGISTER_ACCESS_IO_LATENCY_SHARD  *mLatencyShard = NULL;
+STATIC REGISTER_ACCESS_IO_LATENCY_SHARD  *volatile mLatencyShardList = NULL;
+
+STATIC
+UINTN
+LatencyBucketIndex (
+  IN UINT64  Ticks
+  )
+{
+  UINTN  Exponent;
+
+  if (Ticks < LATENCY_SUB_BUCKETS) {
+    return (UINTN) Ticks;
+  }
+
+  Exponent = (UINTN) HighBitSet64 (Ticks);
+  return (Exponent - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS +
+         (UINTN)(RShiftU64 (Ticks, Exponent - LATENCY_SUB_BUCKET_BITS) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/**
+  Returns the highest value that falls into the bucket.
+**/
+STATIC
+UINT64
+LatencyBucketMaxValue (
+  IN UINTN  Index
+  )
+{
+  UINTN   Exponent;
+  UINT64  Base;
+
+  if (Index < LATENCY_SUB_BUCKETS) {
+    return Index;
+  }
+
+  Exponent = Index / LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKET_BITS - 1;
+  Base = LShiftU64 (LATENCY_SUB_BUCKETS + (Index % LATENCY_SUB_BUCKETS), Exponent - LATENCY_SUB_BUCKET_BITS);
+  return Base + (LShiftU64 (1, Exponent - LATENCY_SUB_BUCKET_BITS) - 1);
+}
+
+STATIC
+REGISTER_ACCESS_IO_LATENCY_SHARD*
+LatencyAllocateShard (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_LATENCY_SHARD  *Shard;
+  REGISTER_ACCESS_IO_LATENCY_SHARD  *Head;
+
+  Shard = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_LATENCY_SHARD));
+  if (Shard == NULL) {
+    return NULL;
+  }
+
+  do {
+    Head = mLatencyShardList;
+    Shard->Next = Head;
+  } while (InterlockedCompareExchangePointer ((VOID *volatile *) &mLatencyShardList, Head, Shard) != Head);
+
+  return Shard;
+}
+
+/**
+  Returns histogram of the region in the shard of the calling thread.
+
+  @return Histogram or NULL if memory allocation failed.
+**/
+STATIC
+REGISTER_ACCESS_IO_LATENCY_HISTOGRAM*
+LatencyGetHistogram (
+  IN REGISTER_ACCESS_IO_LATENCY_SHARD  *Shard,
+  IN UINT16                            Region
+  )
+{
+  REGISTER_ACCESS_IO_LATENCY_HISTOGRAM  **Page;
+  REGISTER_ACCESS_IO_LATENCY_HISTOGRAM  *Histogram;
+
+  Page = Shard->Pages[Region >> LATENCY_PAGE_SHIFT];
+  if (Page == NULL) {
+    Page = AllocateZeroPool (LATENCY_PAGE_SIZE * sizeof (REGISTER_ACCESS_IO_LATENCY_HISTOGRAM*));
+    if (Page == NULL) {
+      return NULL;
+    }
+    MemoryFence ();
+    Shard->Pages[Region >> LATENCY_PAGE_SHIFT] = Page;
+  }
+
+  Histogram = Page[Region & (LATENCY_PAGE_SIZE - 1)];
+  if (Histogram == NULL) {
+    Histogram = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_LATENCY_HISTOGRAM));
+    if (Histogram == NULL) {
+      return NULL;
+    }
+    MemoryFence ();
+    Page[Region & (LATENCY_PAGE_SIZE - 1)] = Histogram;
+  }
+
+  return Histogram;
+}
+
+/**
+  Returns histogram of the region in the shard if the thread recorded any
+  sample of the region.
+**/
+STATIC
+REGISTER_ACCESS_IO_LATENCY_HISTOGRAM*
+LatencyFindHistogram (
+  IN REGISTER_ACCESS_IO_LATENCY_SHARD  *Shard,
+  IN UINT16                            Region
+  )
+{
+  REGISTER_ACCESS_IO_LATENCY_HISTOGRAM  **Page;
+
+  Page = Shard->Pages[Region >> LATENCY_PAGE_SHIFT];
+  if (Page == NULL) {
+    return NULL;
+  }
+
+  return Page[Region & (LATENCY_PAGE_SIZE - 1)];
+}
+
+VOID
+RegisterAccessIoLatencyRecord (
+  IN UINT16  Region,
+  IN UINT64  Ticks
+  )
+{
+  REGISTER_ACCESS_IO_LATENCY_SHARD      *Shard;
+  REGISTER_ACCESS_IO_LATENCY_HISTOGRAM  *Histogram;
+
+  Shard = mLatencyShard;
+  if (Shard == NULL) {
+    Shard = LatencyAllocateShard ();
+    if (Shard == NULL) {
+      return;
+    }
+    mLatencyShard = Shard;
+  }
+
+  Histogram = LatencyGetHistogram (Shard, Region);
+  if (Histogram == NULL) {
+    return;
+  }
+
+  if (Histogram->Count == 0 || Ticks < Histogram->Min) {
+    Histogram->Min = Ticks;
+  }
+  if (Ticks > Histogram->Max) {
+    Histogram->Max = Ticks;
+  }
+  Histogram->Count++;
+  Histogram->Buckets[LatencyBucketIndex (Ticks)]++;
+}
+
+UINT32
+RegisterAccessIoCallEnd (
+  IN UINT16  Region,
+  IN UINT64  Start
+  )
+{
+  UINT64  Ticks;
+
+  Ticks = RegisterAccessIoTraceGetTimestamp () - Start;
+  if (gRegisterAccessIoLatencyEnabled) {
+    RegisterAccessIoLatencyRecord (Region, Ticks);
+  }
+
+  return (UINT32) MIN (Ticks, MAX_UINT32);
+}
+
+VOID
+RegisterAccessIoLatencyEnable (
+  IN BOOLEAN  Enable
+  )
+{
+  gRegisterAccessIoLatencyEnabled = Enable;
+}
+
+VOID
+RegisterAccessIoLatencyReset (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_LATENCY_SHARD      *Shard;
+  REGISTER_ACCESS_IO_LATENCY_HISTOGRAM  **Page;
+  UINTN                                 PageIndex;
+  UINTN                                 Index;
+
+  for (Shard = mLatencyShardList; Shard != NULL; Shard = Shard->Next) {
+    for (PageIndex = 0; PageIndex < LATENCY_PAGE_COUNT; PageIndex++) {
+      Page = Shard->Pages[PageIndex];
+      if (Page == NULL) {
+        continue;
+      }
+      for (Index = 0; Index < LATENCY_PAGE_SIZE; Index++) {
+        if (Page[Index] != NULL) {
+          ZeroMem (Page[Index], sizeof (REGISTER_ACCESS_IO_LATENCY_HISTOGRAM));
+        }
+      }
+    }
+  }
+}
+
+STATIC
+UINT64
+LatencyPercentile (
+  IN REGISTER_ACCESS_IO_LATENCY_HISTOGRAM  *Histogram,
+  IN UINTN                                 Percentile
+  )
+{
+  UINT64  Rank;
+  UINT64  Seen;
+  UINTN   Index;
+
+  //
+  // Rank of the sample which is not smaller than Percentile% of the samples.
+  //
+  Rank = DivU64x32 (MultU64x32 (Histogram->Count, (UINT32) Percentile) + 99, 100);
+  if (Rank == 0) {
+    Rank = 1;
+  }
+
+  Seen = 0;
+  for (Index = 0; Index < LATENCY_BUCKETS; Index++) {
+    Seen += Histogram->Buckets[Index];
+    if (Seen >= Rank) {
+      return MAX (MIN (LatencyBucketMaxValue (Index), Histogram->Max), Histogram->Min);
+    }
+  }
+
+  return Histogram->Max;
+}
+
+EFI_STATUS
+RegisterAccessIoLatencyGetStats (
+  IN  UINT16                            Region,
+  OUT REGISTER_ACCESS_IO_LATENCY_STATS  *Stats
+  )
+{
+  REGISTER_ACCESS_IO_LATENCY_SHARD      *Shard;
+  REGISTER_ACCESS_IO_LATENCY_HISTOGRAM  *Histogram;
+  REGISTER_ACCESS_IO_LATENCY_HISTOGRAM  *Merged;
+  UINTN                                 Index;
+
+  if (Stats == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Merged = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_LATENCY_HISTOGRAM));
+  if (Merged == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Shard = mLatencyShardList; Shard != NULL; Shard = Shard->Next) {
+    Histogram = LatencyFindHistogram (Shard, Region);
+    if (Histogram == NULL || Histogram->Count == 0) {
+      continue;
+    }
+    if (Merged->Count == 0 || Histogram->Min < Merged->Min) {
+      Merged->Min = Histogram->Min;
+    }
+    Merged->Max = MAX (Merged->Max, Histogram->Max);
+    Merged->Count += Histogram->Count;
+    for (Index = 0; Index < LATENCY_BUCKETS; Index++) {
+      Merged->Buckets[Index] += Histogram->Buckets[Index];
+    }
+  }
+
+  if (Merged->Count == 0) {
+    FreePool (Merged);
+    return EFI_NOT_FOUND;
+  }
+
+  Stats->Count = Merged->Count;
+  Stats->Min = Merged->Min;
+  Stats->P50 = LatencyPercentile (Merged, 50);
+  Stats->P99 = LatencyPercentile (Merged, 99);
+  Stats->Max = Merged->Max;
+
+  FreePool (Merged);
+  return EFI_SUCCESS;
+}
+
+VOID
+RegisterAccessIoLatencyDump (
+  VOID
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINT32                              Region;
+  REGISTER_ACCESS_IO_LATENCY_STATS    Stats;
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  DEBUG ((DEBUG_INFO, "Register space latency (ticks):\n"));
+  DEBUG ((DEBUG_INFO, "%-32a %-12a %-12a %-12a %-12a\n", "Region", "Count", "P50", "P99", "Max"));
+  for (Region = 0; Region < RegionCount && Region <= MAX_UINT16; Region++) {
+    if (EFI_ERROR (RegisterAccessIoLatencyGetStats ((UINT16) Region, &Stats))) {
+      continue;
+    }
+    DEBUG ((
+      DEBUG_INFO,
+      "%-32a %-12Ld %-12Ld %-12Ld %-12Ld\n",
+      Regions[Region].Name,
+      Stats.Count,
+      Stats.P50,
+      Stats.P99,
+      Stats.Max
+      ));
+  }
+}
\ No newline at end of file
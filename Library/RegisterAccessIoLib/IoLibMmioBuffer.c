@@ -13,6 +13,7 @@
 #include <Library/DebugLib.h>
 #include <Library/BaseLib.h>
 #include <Library/PeiServicesTablePointerLib.h>
+#include <Library/RegisterAccessIoLib.h>
 
 #include "FakeNameDecorator.h"
 
@@ -42,17 +43,20 @@ FAKE_NAME_DECORATOR(MmioReadBuffer8) (
   OUT UINT8  *Buffer
   )
 {
-  UINT8  *ReturnBuffer;
+  UINT8    *ReturnBuffer;
+  BOOLEAN  CallSiteOwner;
 
   ASSERT ((Length - 1) <=  (MAX_ADDRESS - StartAddress));
   ASSERT ((Length - 1) <=  (MAX_ADDRESS - (UINTN)Buffer));
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   ReturnBuffer = Buffer;
 
   while (Length-- != 0) {
     *(Buffer++) = FAKE_NAME_DECORATOR(MmioRead8) (StartAddress++);
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return ReturnBuffer;
 }
 
@@ -86,7 +90,8 @@ FAKE_NAME_DECORATOR(MmioReadBuffer16) (
   OUT UINT16  *Buffer
   )
 {
-  UINT16  *ReturnBuffer;
+  UINT16   *ReturnBuffer;
+  BOOLEAN  CallSiteOwner;
 
   ASSERT ((StartAddress & (sizeof (UINT16) - 1)) == 0);
 
@@ -96,6 +101,7 @@ FAKE_NAME_DECORATOR(MmioReadBuffer16) (
   ASSERT ((Length & (sizeof (UINT16) - 1)) == 0);
   ASSERT (((UINTN)Buffer & (sizeof (UINT16) - 1)) == 0);
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   ReturnBuffer = Buffer;
 
   while (Length != 0) {
@@ -104,6 +110,7 @@ FAKE_NAME_DECORATOR(MmioReadBuffer16) (
     Length       -= sizeof (UINT16);
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return ReturnBuffer;
 }
 
@@ -137,7 +144,8 @@ FAKE_NAME_DECORATOR(MmioReadBuffer32) (
   OUT UINT32  *Buffer
   )
 {
-  UINT32  *ReturnBuffer;
+  UINT32   *ReturnBuffer;
+  BOOLEAN  CallSiteOwner;
 
   ASSERT ((StartAddress & (sizeof (UINT32) - 1)) == 0);
 
@@ -147,6 +155,7 @@ FAKE_NAME_DECORATOR(MmioReadBuffer32) (
   ASSERT ((Length & (sizeof (UINT32) - 1)) == 0);
   ASSERT (((UINTN)Buffer & (sizeof (UINT32) - 1)) == 0);
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   ReturnBuffer = Buffer;
 
   while (Length != 0) {
@@ -155,6 +164,7 @@ FAKE_NAME_DECORATOR(MmioReadBuffer32) (
     Length       -= sizeof (UINT32);
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return ReturnBuffer;
 }
 
@@ -188,7 +198,8 @@ FAKE_NAME_DECORATOR(MmioReadBuffer64) (
   OUT UINT64  *Buffer
   )
 {
-  UINT64  *ReturnBuffer;
+  UINT64   *ReturnBuffer;
+  BOOLEAN  CallSiteOwner;
 
   ASSERT ((StartAddress & (sizeof (UINT64) - 1)) == 0);
 
@@ -198,6 +209,7 @@ FAKE_NAME_DECORATOR(MmioReadBuffer64) (
   ASSERT ((Length & (sizeof (UINT64) - 1)) == 0);
   ASSERT (((UINTN)Buffer & (sizeof (UINT64) - 1)) == 0);
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   ReturnBuffer = Buffer;
 
   while (Length != 0) {
@@ -206,6 +218,7 @@ FAKE_NAME_DECORATOR(MmioReadBuffer64) (
     Length       -= sizeof (UINT64);
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return ReturnBuffer;
 }
 
@@ -235,17 +248,20 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer8) (
   IN  CONST UINT8  *Buffer
   )
 {
-  VOID  *ReturnBuffer;
+  VOID     *ReturnBuffer;
+  BOOLEAN  CallSiteOwner;
 
   ASSERT ((Length - 1) <=  (MAX_ADDRESS - StartAddress));
   ASSERT ((Length - 1) <=  (MAX_ADDRESS - (UINTN)Buffer));
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   ReturnBuffer = (UINT8 *)Buffer;
 
   while (Length-- != 0) {
     FAKE_NAME_DECORATOR(MmioWrite8) (StartAddress++, *(Buffer++));
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return ReturnBuffer;
 }
 
@@ -280,7 +296,8 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer16) (
   IN  CONST UINT16  *Buffer
   )
 {
-  UINT16  *ReturnBuffer;
+  UINT16   *ReturnBuffer;
+  BOOLEAN  CallSiteOwner;
 
   ASSERT ((StartAddress & (sizeof (UINT16) - 1)) == 0);
 
@@ -290,6 +307,7 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer16) (
   ASSERT ((Length & (sizeof (UINT16) - 1)) == 0);
   ASSERT (((UINTN)Buffer & (sizeof (UINT16) - 1)) == 0);
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   ReturnBuffer = (UINT16 *)Buffer;
 
   while (Length != 0) {
@@ -299,6 +317,7 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer16) (
     Length       -= sizeof (UINT16);
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return ReturnBuffer;
 }
 
@@ -333,7 +352,8 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer32) (
   IN  CONST UINT32  *Buffer
   )
 {
-  UINT32  *ReturnBuffer;
+  UINT32   *ReturnBuffer;
+  BOOLEAN  CallSiteOwner;
 
   ASSERT ((StartAddress & (sizeof (UINT32) - 1)) == 0);
 
@@ -343,6 +363,7 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer32) (
   ASSERT ((Length & (sizeof (UINT32) - 1)) == 0);
   ASSERT (((UINTN)Buffer & (sizeof (UINT32) - 1)) == 0);
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   ReturnBuffer = (UINT32 *)Buffer;
 
   while (Length != 0) {
@@ -352,6 +373,7 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer32) (
     Length       -= sizeof (UINT32);
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return ReturnBuffer;
 }
 
@@ -386,7 +408,8 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer64) (
   IN  CONST UINT64  *Buffer
   )
 {
-  UINT64  *ReturnBuffer;
+  UINT64   *ReturnBuffer;
+  BOOLEAN  CallSiteOwner;
 
   ASSERT ((StartAddress & (sizeof (UINT64) - 1)) == 0);
 
@@ -396,6 +419,7 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer64) (
   ASSERT ((Length & (sizeof (UINT64) - 1)) == 0);
   ASSERT (((UINTN)Buffer & (sizeof (UINT64) - 1)) == 0);
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   ReturnBuffer = (UINT64 *)Buffer;
 
   while (Length != 0) {
@@ -405,5 +429,6 @@ FAKE_NAME_DECORATOR(MmioWriteBuffer64) (
     Length       -= sizeof (UINT64);
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return ReturnBuffer;
 }
@@ -0,0 +1,303 @@
+/** @file
+  Posted writes for regions registered in RegisterAccessIoLib.
+
+  Writes to a region in posted mode are queued and forwarded to the register
+  space later, in the order they were issued, following PCIe ordering rules:
+  posted writes never pass each other, a read drains the writes posted to the
+  same device before it and a non-posted write drains all posted writes.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+typedef struct {
+  REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
+  UINT64                         Offset;
+  UINT64                         Value;
+  UINT32                         Size;
+} REGISTER_ACCESS_IO_POSTED_WRITE;
+
+typedef struct _REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE;
+
+struct _REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE {
+  REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE  *Next;
+  //
+  // Taken by the owning thread and by threads draining the queue when a
+  // region leaves posted mode.
+  //
+  SPIN_LOCK                              Lock;
+  UINT32                                 Count;
+  REGISTER_ACCESS_IO_POSTED_WRITE        Writes[REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE_SIZE];
+};
+
+BOOLEAN  gRegisterAccessIoPostedWritesEnabled = FALSE;
+
+//
+// Number of regions in posted mode. Queues are only checked while it is
+// non-zero.
+//
+STATIC UINT32  mPostedWriteRegions = 0;
+
+//
+// Every thread posts into its own queue, same as every CPU has its own path
+// to the devices. Queues are linked into a global list when the thread posts
+// its first write so that a region leaving posted mode can drain the writes
+// every thread queued to it.
+//
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE  *mPostedWriteQueue = NULL;
+STATIC REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE  *volatile mPostedWriteQueueList = NULL;
+
+STATIC
+REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE*
+PostedWriteAllocateQueue (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE  *Queue;
+  REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE  *Head;
+
+  Queue = RegisterAccessIoAllocateState (sizeof (REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE));
+  if (Queue == NULL) {
+    return NULL;
+  }
+  InitializeSpinLock (&Queue->Lock);
+
+  do {
+    Head = mPostedWriteQueueList;
+    Queue->Next = Head;
+  } while (InterlockedCompareExchangePointer ((VOID *volatile *) &mPostedWriteQueueList, Head, Queue) != Head);
+
+  return Queue;
+}
+
+/**
+  Forwards first Count queued writes to their register spaces. Consecutive
+  writes to the same region are forwarded under a single lock. Caller holds
+  the queue lock.
+
+  @param[in] Queue  Queue to drain.
+  @param[in] Count  Number of writes to forward.
+**/
+STATIC
+VOID
+PostedWriteDrainCount (
+  IN REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE  *Queue,
+  IN UINT32                                 Count
+  )
+{
+  REGISTER_ACCESS_IO_POSTED_WRITE  *PostedWrite;
+  REGISTER_ACCESS_IO_MEMORY_MAP    *MapEntry;
+  REGISTER_ACCESS_INTERFACE        *RegisterAccess;
+  UINT64                           Start;
+  UINT32                           Index;
+  EFI_STATUS                       Status;
+
+  Index = 0;
+  while (Index < Count) {
+    MapEntry = Queue->Writes[Index].MapEntry;
+    RegisterAccess = MapEntry->RegisterAccess;
+    REGISTER_ACCESS_IO_LOCK (&MapEntry->Lock);
+    Start = REGISTER_ACCESS_IO_CALL_START ();
+    while (Index < Count && Queue->Writes[Index].MapEntry == MapEntry) {
+      PostedWrite = &Queue->Writes[Index];
+      Status = RegisterAccess->Write (RegisterAccess, PostedWrite->Offset, PostedWrite->Size, PostedWrite->Value);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "%s: Posted write to %LX failed %r\n", RegisterAccess->Name, PostedWrite->Offset, Status));
+      }
+      Index++;
+    }
+    REGISTER_ACCESS_IO_CALL_END (MapEntry->TraceRegion, Start);
+    REGISTER_ACCESS_IO_UNLOCK (&MapEntry->Lock);
+  }
+
+  if (Count < Queue->Count) {
+    CopyMem (&Queue->Writes[0], &Queue->Writes[Count], (Queue->Count - Count) * sizeof (REGISTER_ACCESS_IO_POSTED_WRITE));
+  }
+  Queue->Count -= Count;
+}
+
+VOID
+RegisterAccessIoPostedWriteDrain (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry OPTIONAL
+  )
+{
+  REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE  *Queue;
+  UINT32                                 Count;
+
+  Queue = mPostedWriteQueue;
+  if (Queue == NULL || Queue->Count == 0) {
+    return;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&Queue->Lock);
+  if (MapEntry == NULL) {
+    PostedWriteDrainCount (Queue, Queue->Count);
+  } else {
+    //
+    // Writes posted to other devices before the last write to this device are
+    // forwarded as well since posted writes can't pass each other.
+    //
+    for (Count = Queue->Count; Count > 0; Count--) {
+      if (Queue->Writes[Count - 1].MapEntry->RegisterAccess == MapEntry->RegisterAccess) {
+        PostedWriteDrainCount (Queue, Count);
+        break;
+      }
+    }
+  }
+  REGISTER_ACCESS_IO_UNLOCK (&Queue->Lock);
+}
+
+/**
+  Forwards writes every thread posted to the region, together with the
+  writes posted before them, so that no queue refers to the region anymore.
+
+  @param[in] MapEntry  Region leaving posted mode.
+**/
+STATIC
+VOID
+PostedWriteDrainRegion (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry
+  )
+{
+  REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE  *Queue;
+  UINT32                                 Count;
+
+  for (Queue = mPostedWriteQueueList; Queue != NULL; Queue = Queue->Next) {
+    REGISTER_ACCESS_IO_LOCK (&Queue->Lock);
+    for (Count = Queue->Count; Count > 0; Count--) {
+      if (Queue->Writes[Count - 1].MapEntry == MapEntry) {
+        PostedWriteDrainCount (Queue, Count);
+        break;
+      }
+    }
+    REGISTER_ACCESS_IO_UNLOCK (&Queue->Lock);
+  }
+}
+
+EFI_STATUS
+RegisterAccessIoPostedWrite (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry,
+  IN UINT64                         Offset,
+  IN UINT32                         Size,
+  IN UINT64                         Value
+  )
+{
+  REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE  *Queue;
+  REGISTER_ACCESS_IO_POSTED_WRITE        *PostedWrite;
+
+  Queue = mPostedWriteQueue;
+  if (Queue == NULL) {
+    Queue = PostedWriteAllocateQueue ();
+    if (Queue == NULL) {
+      //
+      // Write can't be posted but must not be lost, caller issues it directly.
+      //
+      return EFI_ABORTED;
+    }
+    mPostedWriteQueue = Queue;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&Queue->Lock);
+  //
+  // Region left posted mode after the caller checked it. Its queued writes
+  // may already be drained, so this one must not be queued behind them.
+  //
+  if (!MapEntry->PostedWrites) {
+    REGISTER_ACCESS_IO_UNLOCK (&Queue->Lock);
+    return EFI_ABORTED;
+  }
+
+  if (Queue->Count == REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE_SIZE) {
+    PostedWriteDrainCount (Queue, Queue->Count);
+  }
+
+  PostedWrite = &Queue->Writes[Queue->Count];
+  PostedWrite->MapEntry = MapEntry;
+  PostedWrite->Offset = Offset;
+  PostedWrite->Size = Size;
+  PostedWrite->Value = Value;
+  Queue->Count++;
+  REGISTER_ACCESS_IO_UNLOCK (&Queue->Lock);
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessIoSetPostedWrites (
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN BOOLEAN                         Enable
+  )
+{
+  REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
+  UINT64                         Offset;
+
+  if (Type != RegisterAccessIoTypeMmio) {
+    return EFI_UNSUPPORTED;
+  }
+
+  MapEntry = RegisterAccessIoGetMapEntry (Address, Type, &Offset);
+  if (MapEntry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (MapEntry->PostedWrites == Enable) {
+    return EFI_SUCCESS;
+  }
+
+  if (Enable) {
+    MapEntry->PostedWrites = TRUE;
+    mPostedWriteRegions++;
+  } else {
+    //
+    // Writes already queued by other threads are forwarded here, later writes
+    // of those threads go straight to the register space.
+    //
+    MapEntry->PostedWrites = FALSE;
+    PostedWriteDrainRegion (MapEntry);
+    mPostedWriteRegions--;
+  }
+  gRegisterAccessIoPostedWritesEnabled = (mPostedWriteRegions != 0);
+
+  return EFI_SUCCESS;
+}
+
+VOID
+RegisterAccessIoPostedWriteUnregister (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry
+  )
+{
+  if (MapEntry->PostedWrites) {
+    MapEntry->PostedWrites = FALSE;
+    PostedWriteDrainRegion (MapEntry);
+    mPostedWriteRegions--;
+    gRegisterAccessIoPostedWritesEnabled = (mPostedWriteRegions != 0);
+  }
+}
+
+VOID
+RegisterAccessIoFlushPostedWrites (
+  VOID
+  )
+{
+  RegisterAccessIoPostedWriteDrain (NULL);
+}
+
+VOID
+RegisterAccessIoMemoryFence (
+  VOID
+  )
+{
+  RegisterAccessIoWriteCombineFlushPending ();
+  RegisterAccessIoPostedWriteDrain (NULL);
+}
\ No newline at end of file
@@ -0,0 +1,576 @@
+/** @file
+  Virtual time of a simulation context.
+
+  Every context has a clock in nanoseconds and a queue of events scheduled
+  by the device models, kept as a binary heap ordered by event time. The
+  clock advances by a fixed cost on every register access and jumps straight
+  to the next event when the driver waits, so timing dependent paths run at
+  host speed.
+
+  Device models running on other threads don't schedule events. Instead they
+  register as notifiers of the context and notify it when their state changes.
+  Wait with no event due blocks on the notification for at most the timeout
+  of host time and advances the clock by the host time spent.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+#if defined (_WIN32)
+//
+// windows.h clashes with the UEFI headers so only the one function is declared.
+//
+__declspec(dllimport) int __stdcall SwitchToThread (void);
+#define REGISTER_ACCESS_IO_SIM_TIME_YIELD()  SwitchToThread ()
+#else
+#include <sched.h>
+#define REGISTER_ACCESS_IO_SIM_TIME_YIELD()  sched_yield ()
+#endif
+
+#define REGISTER_ACCESS_IO_SIM_TIME_INITIAL_EVENTS  16
+
+typedef struct {
+  UINT64                                Time;
+  //
+  // Ids grow monotonically so they also order events scheduled for the same time.
+  //
+  UINT64                                Id;
+  REGISTER_ACCESS_IO_SIM_TIME_CALLBACK  Callback;
+  VOID                                  *Context;
+} REGISTER_ACCESS_IO_SIM_TIME_EVENT;
+
+typedef struct {
+  UINT64                             Now;
+  UINT64                             NextId;
+  UINT64                             AccessCost;
+  REGISTER_ACCESS_IO_SIM_TIME_EVENT  *Events;
+  UINTN                              Count;
+  UINTN                              Capacity;
+  SPIN_LOCK                          Lock;
+  volatile UINT32                    Notifiers;
+  volatile UINT32                    Notifications;
+  //
+  // Notification count seen by the last wait on the context. Notification
+  // which arrives between two waits, for example while the driver reads the
+  // device, ends the next wait immediately.
+  //
+  volatile UINT32                    SeenNotifications;
+} REGISTER_ACCESS_IO_SIM_TIME;
+
+//
+// Number of polls spent spinning on a notification before the waiting thread
+// starts to yield the CPU.
+//
+#define REGISTER_ACCESS_IO_SIM_TIME_SPIN_COUNT  1000
+
+//
+// Set while the thread runs an event callback. Time doesn't advance from
+// callbacks so that events always run in time order.
+//
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL BOOLEAN  mSimTimeInCallback = FALSE;
+
+/**
+  Returns virtual time of the context.
+
+  @param[in] Context   Simulation context.
+  @param[in] Allocate  TRUE to allocate the time of the context if it has none yet.
+
+  @return Virtual time or NULL if the context has none and it wasn't allocated.
+**/
+STATIC
+REGISTER_ACCESS_IO_SIM_TIME*
+SimTimeGetFromContext (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context,
+  IN BOOLEAN                         Allocate
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+
+  if (Context->SimTime != NULL || !Allocate) {
+    return (REGISTER_ACCESS_IO_SIM_TIME*) Context->SimTime;
+  }
+
+  SimTime = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_SIM_TIME));
+  if (SimTime == NULL) {
+    return NULL;
+  }
+  SimTime->NextId = 1;
+  SimTime->AccessCost = REGISTER_ACCESS_IO_SIM_TIME_DEFAULT_ACCESS_COST;
+  InitializeSpinLock (&SimTime->Lock);
+
+  //
+  // Threads sharing the context may race to allocate its time.
+  //
+  if (InterlockedCompareExchangePointer (&Context->SimTime, NULL, SimTime) != NULL) {
+    FreePool (SimTime);
+  }
+
+  return (REGISTER_ACCESS_IO_SIM_TIME*) Context->SimTime;
+}
+
+/**
+  Returns virtual time of the calling thread's context.
+**/
+STATIC
+REGISTER_ACCESS_IO_SIM_TIME*
+SimTimeGet (
+  IN BOOLEAN  Allocate
+  )
+{
+  return SimTimeGetFromContext (RegisterAccessIoSimContextGetCurrent (), Allocate);
+}
+
+STATIC
+BOOLEAN
+SimTimeEarlier (
+  IN REGISTER_ACCESS_IO_SIM_TIME_EVENT  *Event,
+  IN REGISTER_ACCESS_IO_SIM_TIME_EVENT  *Other
+  )
+{
+  if (Event->Time != Other->Time) {
+    return Event->Time < Other->Time;
+  }
+  return Event->Id < Other->Id;
+}
+
+STATIC
+VOID
+SimTimeSwap (
+  IN REGISTER_ACCESS_IO_SIM_TIME  *SimTime,
+  IN UINTN                        Index,
+  IN UINTN                        Other
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME_EVENT  Event;
+
+  Event = SimTime->Events[Index];
+  SimTime->Events[Index] = SimTime->Events[Other];
+  SimTime->Events[Other] = Event;
+}
+
+STATIC
+VOID
+SimTimeSiftUp (
+  IN REGISTER_ACCESS_IO_SIM_TIME  *SimTime,
+  IN UINTN                        Index
+  )
+{
+  UINTN  Parent;
+
+  while (Index > 0) {
+    Parent = (Index - 1) / 2;
+    if (!SimTimeEarlier (&SimTime->Events[Index], &SimTime->Events[Parent])) {
+      break;
+    }
+    SimTimeSwap (SimTime, Index, Parent);
+    Index = Parent;
+  }
+}
+
+STATIC
+VOID
+SimTimeSiftDown (
+  IN REGISTER_ACCESS_IO_SIM_TIME  *SimTime,
+  IN UINTN                        Index
+  )
+{
+  UINTN  Child;
+
+  while (TRUE) {
+    Child = 2 * Index + 1;
+    if (Child >= SimTime->Count) {
+      break;
+    }
+    if (Child + 1 < SimTime->Count && SimTimeEarlier (&SimTime->Events[Child + 1], &SimTime->Events[Child])) {
+      Child++;
+    }
+    if (!SimTimeEarlier (&SimTime->Events[Child], &SimTime->Events[Index])) {
+      break;
+    }
+    SimTimeSwap (SimTime, Index, Child);
+    Index = Child;
+  }
+}
+
+/**
+  Removes event at Index from the heap.
+**/
+STATIC
+VOID
+SimTimeRemove (
+  IN REGISTER_ACCESS_IO_SIM_TIME  *SimTime,
+  IN UINTN                        Index
+  )
+{
+  SimTime->Count--;
+  if (Index == SimTime->Count) {
+    return;
+  }
+
+  SimTime->Events[Index] = SimTime->Events[SimTime->Count];
+  SimTimeSiftDown (SimTime, Index);
+  SimTimeSiftUp (SimTime, Index);
+}
+
+UINT64
+RegisterAccessIoSimTimeGetNow (
+  VOID
+  )
+{
+  return RegisterAccessIoSimTimeGetContextNow (RegisterAccessIoSimContextGetCurrent ());
+}
+
+UINT64
+RegisterAccessIoSimTimeGetContextNow (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+  UINT64                       Now;
+
+  SimTime = SimTimeGetFromContext (Context, FALSE);
+  if (SimTime == NULL) {
+    return 0;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&SimTime->Lock);
+  Now = SimTime->Now;
+  REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+  return Now;
+}
+
+EFI_STATUS
+RegisterAccessIoSimTimeSchedule (
+  IN  UINT64                                Delay,
+  IN  REGISTER_ACCESS_IO_SIM_TIME_CALLBACK  Callback,
+  IN  VOID                                  *Context OPTIONAL,
+  OUT UINT64                                *EventId OPTIONAL
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME        *SimTime;
+  REGISTER_ACCESS_IO_SIM_TIME_EVENT  *Events;
+  REGISTER_ACCESS_IO_SIM_TIME_EVENT  *Event;
+  UINTN                              Capacity;
+
+  if (Callback == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SimTime = SimTimeGet (TRUE);
+  if (SimTime == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&SimTime->Lock);
+  if (SimTime->Count == SimTime->Capacity) {
+    Capacity = (SimTime->Capacity == 0) ? REGISTER_ACCESS_IO_SIM_TIME_INITIAL_EVENTS : SimTime->Capacity * 2;
+    Events = ReallocatePool (
+               SimTime->Capacity * sizeof (REGISTER_ACCESS_IO_SIM_TIME_EVENT),
+               Capacity * sizeof (REGISTER_ACCESS_IO_SIM_TIME_EVENT),
+               SimTime->Events
+               );
+    if (Events == NULL) {
+      REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+      return EFI_OUT_OF_RESOURCES;
+    }
+    SimTime->Events = Events;
+    SimTime->Capacity = Capacity;
+  }
+
+  Event = &SimTime->Events[SimTime->Count];
+  Event->Time = (Delay > MAX_UINT64 - SimTime->Now) ? MAX_UINT64 : SimTime->Now + Delay;
+  Event->Id = SimTime->NextId++;
+  Event->Callback = Callback;
+  Event->Context = Context;
+  SimTime->Count++;
+  SimTimeSiftUp (SimTime, SimTime->Count - 1);
+  if (EventId != NULL) {
+    *EventId = SimTime->NextId - 1;
+  }
+  REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessIoSimTimeCancel (
+  IN UINT64  EventId
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+  UINTN                        Index;
+
+  SimTime = SimTimeGet (FALSE);
+  if (SimTime == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&SimTime->Lock);
+  for (Index = 0; Index < SimTime->Count; Index++) {
+    if (SimTime->Events[Index].Id == EventId) {
+      SimTimeRemove (SimTime, Index);
+      REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+      return EFI_SUCCESS;
+    }
+  }
+  REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+
+  return EFI_NOT_FOUND;
+}
+
+VOID
+RegisterAccessIoSimTimeAdvance (
+  IN UINT64  Delay
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME        *SimTime;
+  REGISTER_ACCESS_IO_SIM_TIME_EVENT  Event;
+  UINT64                             Target;
+
+  if (mSimTimeInCallback) {
+    return;
+  }
+
+  SimTime = SimTimeGet (TRUE);
+  if (SimTime == NULL) {
+    return;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&SimTime->Lock);
+  Target = (Delay > MAX_UINT64 - SimTime->Now) ? MAX_UINT64 : SimTime->Now + Delay;
+  while (SimTime->Count != 0 && SimTime->Events[0].Time <= Target) {
+    Event = SimTime->Events[0];
+    SimTimeRemove (SimTime, 0);
+    SimTime->Now = MAX (SimTime->Now, Event.Time);
+
+    //
+    // Callback runs unlocked so that it can schedule and cancel events.
+    //
+    REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+    mSimTimeInCallback = TRUE;
+    Event.Callback (Event.Context);
+    mSimTimeInCallback = FALSE;
+    REGISTER_ACCESS_IO_LOCK (&SimTime->Lock);
+  }
+  SimTime->Now = MAX (SimTime->Now, Target);
+  REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+}
+
+/**
+  Blocks until a device on another thread notifies the context or Timeout of
+  host time passes. Returns immediately if the context was notified since the
+  previous wait of the thread.
+
+  @return Host time spent waiting in nanoseconds, at most Timeout.
+**/
+STATIC
+UINT64
+SimTimeWaitForNotification (
+  IN REGISTER_ACCESS_IO_SIM_TIME  *SimTime,
+  IN UINT64                       Timeout
+  )
+{
+  UINT64  Start;
+  UINT64  Elapsed;
+  UINT32  Notifications;
+  UINTN   Spins;
+
+  Start = RegisterAccessIoGetHostNanoseconds ();
+  Spins = 0;
+  do {
+    Elapsed = RegisterAccessIoGetHostNanoseconds () - Start;
+    Notifications = SimTime->Notifications;
+    if (Notifications != SimTime->SeenNotifications) {
+      SimTime->SeenNotifications = Notifications;
+      break;
+    }
+    if (Elapsed >= Timeout) {
+      break;
+    }
+    if (Spins < REGISTER_ACCESS_IO_SIM_TIME_SPIN_COUNT) {
+      Spins++;
+      CpuPause ();
+    } else {
+      REGISTER_ACCESS_IO_SIM_TIME_YIELD ();
+    }
+  } while (TRUE);
+
+  return MIN (Elapsed, Timeout);
+}
+
+UINT64
+RegisterAccessIoSimTimeWait (
+  IN UINT64  Timeout
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+  UINT64                       Delay;
+  BOOLEAN                      EventDue;
+
+  if (mSimTimeInCallback) {
+    return Timeout;
+  }
+
+  SimTime = SimTimeGet (TRUE);
+  if (SimTime == NULL) {
+    return Timeout;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&SimTime->Lock);
+  Delay = Timeout;
+  EventDue = (SimTime->Count != 0 && SimTime->Events[0].Time - SimTime->Now < Timeout);
+  if (EventDue) {
+    Delay = SimTime->Events[0].Time - SimTime->Now;
+  }
+  REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+
+  if (!EventDue && SimTime->Notifiers != 0) {
+    Delay = SimTimeWaitForNotification (SimTime, Timeout);
+  }
+
+  RegisterAccessIoSimTimeAdvance (Delay);
+  return Delay;
+}
+
+BOOLEAN
+RegisterAccessIoSimTimeIsIdle (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+  BOOLEAN                      Idle;
+
+  SimTime = SimTimeGet (FALSE);
+  if (SimTime == NULL) {
+    return TRUE;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&SimTime->Lock);
+  Idle = (SimTime->Count == 0 && SimTime->Notifiers == 0);
+  REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+  return Idle;
+}
+
+EFI_STATUS
+RegisterAccessIoSimTimeRegisterNotifier (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+
+  if (Context == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SimTime = SimTimeGetFromContext (Context, TRUE);
+  if (SimTime == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  InterlockedIncrement (&SimTime->Notifiers);
+  return EFI_SUCCESS;
+}
+
+VOID
+RegisterAccessIoSimTimeUnregisterNotifier (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+
+  SimTime = SimTimeGetFromContext (Context, FALSE);
+  if (SimTime != NULL && SimTime->Notifiers != 0) {
+    InterlockedDecrement (&SimTime->Notifiers);
+  }
+}
+
+VOID
+RegisterAccessIoSimTimeNotify (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+
+  SimTime = SimTimeGetFromContext (Context, FALSE);
+  if (SimTime != NULL) {
+    InterlockedIncrement (&SimTime->Notifications);
+  }
+}
+
+VOID
+RegisterAccessIoSimTimeSetAccessCost (
+  IN UINT64  Cost
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+
+  SimTime = SimTimeGet (TRUE);
+  if (SimTime == NULL) {
+    return;
+  }
+
+  SimTime->AccessCost = Cost;
+}
+
+VOID
+RegisterAccessIoSimTimeAccess (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+
+  //
+  // Context without time yet runs at the default cost, Advance allocates it.
+  //
+  SimTime = SimTimeGet (FALSE);
+  if (SimTime != NULL && SimTime->AccessCost == 0) {
+    return;
+  }
+
+  RegisterAccessIoSimTimeAdvance ((SimTime != NULL) ? SimTime->AccessCost : REGISTER_ACCESS_IO_SIM_TIME_DEFAULT_ACCESS_COST);
+}
+
+VOID
+RegisterAccessIoSimTimeReset (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+
+  SimTime = SimTimeGet (FALSE);
+  if (SimTime == NULL) {
+    return;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&SimTime->Lock);
+  SimTime->Count = 0;
+  SimTime->Now = 0;
+  REGISTER_ACCESS_IO_UNLOCK (&SimTime->Lock);
+}
+
+VOID
+RegisterAccessIoSimTimeFree (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  )
+{
+  REGISTER_ACCESS_IO_SIM_TIME  *SimTime;
+
+  SimTime = (REGISTER_ACCESS_IO_SIM_TIME*) Context->SimTime;
+  if (SimTime == NULL) {
+    return;
+  }
+
+  if (SimTime->Events != NULL) {
+    FreePool (SimTime->Events);
+  }
+  FreePool (SimTime);
+  Context->SimTime = NULL;
+}
\ No newline at end of file
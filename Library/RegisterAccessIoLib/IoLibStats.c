@@ -0,0 +1,376 @@
+/** @file
+  Live register access statistics per region.
+
+  Every thread counts into its own shard so counting never contends. Shards
+  are linked into a global list with a compare-exchange when the thread counts
+  its first access. Counters of a shard are kept in pages of regions which are
+  never reallocated so statistics can be collected while other threads count.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+#define STATS_PAGE_SHIFT  8
+#define STATS_PAGE_SIZE   (1 << STATS_PAGE_SHIFT)
+#define STATS_PAGE_COUNT  ((MAX_UINT16 + 1) >> STATS_PAGE_SHIFT)
+
+#define STATS_FILE_NAME_LENGTH  256
+
+typedef struct _REGISTER_ACCESS_IO_STATS_SHARD REGISTER_ACCESS_IO_STATS_SHARD;
+
+struct _REGISTER_ACCESS_IO_STATS_SHARD {
+  REGISTER_ACCESS_IO_STATS_SHARD  *Next;
+  //
+  // Region + 1 and offset of the last read of the thread. 0 if the last
+  // access was a write.
+  //
+  UINT32                          LastReadRegion;
+  UINT64                          LastReadOffset;
+  REGISTER_ACCESS_IO_STATS        *Pages[STATS_PAGE_COUNT];
+};
+
+BOOLEAN  gRegisterAccessIoStatsEnabled = FALSE;
+
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL REGISTER_ACCESS_IO_STATS_SHARD  *mStatsShard = NULL;
+STATIC REGISTER_ACCESS_IO_STATS_SHARD  *volatile mStatsShardList = NULL;
+
+STATIC CHAR8    mStatsExitFileName[STATS_FILE_NAME_LENGTH];
+STATIC BOOLEAN  mStatsExitHandlerRegistered = FALSE;
+
+STATIC
+REGISTER_ACCESS_IO_STATS_SHARD*
+StatsAllocateShard (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_STATS_SHARD  *Shard;
+  REGISTER_ACCESS_IO_STATS_SHARD  *Head;
+
+  Shard = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_STATS_SHARD));
+  if (Shard == NULL) {
+    return NULL;
+  }
+
+  do {
+    Head = mStatsShardList;
+    Shard->Next = Head;
+  } while (InterlockedCompareExchangePointer ((VOID *volatile *) &mStatsShardList, Head, Shard) != Head);
+
+  return Shard;
+}
+
+/**
+  Returns counters of the region in the shard of the calling thread.
+
+  @return Counters or NULL if memory allocation failed.
+**/
+STATIC
+REGISTER_ACCESS_IO_STATS*
+StatsGetCounters (
+  IN UINT16  Region
+  )
+{
+  REGISTER_ACCESS_IO_STATS_SHARD  *Shard;
+  REGISTER_ACCESS_IO_STATS        *Page;
+
+  Shard = mStatsShard;
+  if (Shard == NULL) {
+    Shard = StatsAllocateShard ();
+    if (Shard == NULL) {
+      return NULL;
+    }
+    mStatsShard = Shard;
+  }
+
+  Page = Shard->Pages[Region >> STATS_PAGE_SHIFT];
+  if (Page == NULL) {
+    Page = AllocateZeroPool (STATS_PAGE_SIZE * sizeof (REGISTER_ACCESS_IO_STATS));
+    if (Page == NULL) {
+      return NULL;
+    }
+    Shard->Pages[Region >> STATS_PAGE_SHIFT] = Page;
+  }
+
+  return &Page[Region & (STATS_PAGE_SIZE - 1)];
+}
+
+VOID
+RegisterAccessIoStatsCount (
+  IN UINT16   Region,
+  IN UINT64   Offset,
+  IN UINT32   Size,
+  IN BOOLEAN  IsWrite
+  )
+{
+  REGISTER_ACCESS_IO_STATS_SHARD  *Shard;
+  REGISTER_ACCESS_IO_STATS        *Stats;
+
+  Stats = StatsGetCounters (Region);
+  if (Stats == NULL) {
+    return;
+  }
+  Shard = mStatsShard;
+
+  if (IsWrite) {
+    Stats->Writes++;
+    Stats->WriteBytes += Size;
+    if (Shard->LastReadRegion == (UINT32) Region + 1 && Shard->LastReadOffset == Offset) {
+      Stats->ReadModifyWrites++;
+    }
+    Shard->LastReadRegion = 0;
+  } else {
+    Stats->Reads++;
+    Stats->ReadBytes += Size;
+    Shard->LastReadRegion = (UINT32) Region + 1;
+    Shard->LastReadOffset = Offset;
+  }
+
+  if (Size != 0 && (Offset & (Size - 1)) != 0) {
+    Stats->Misaligned++;
+  }
+}
+
+VOID
+RegisterAccessIoStatsCountMapMiss (
+  IN UINT16  Region
+  )
+{
+  REGISTER_ACCESS_IO_STATS  *Stats;
+
+  Stats = StatsGetCounters (Region);
+  if (Stats != NULL) {
+    Stats->MapMisses++;
+  }
+}
+
+VOID
+RegisterAccessIoStatsEnable (
+  IN BOOLEAN  Enable
+  )
+{
+  gRegisterAccessIoStatsEnabled = Enable;
+}
+
+VOID
+RegisterAccessIoStatsReset (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_STATS_SHARD  *Shard;
+  UINTN                           Index;
+
+  for (Shard = mStatsShardList; Shard != NULL; Shard = Shard->Next) {
+    Shard->LastReadRegion = 0;
+    for (Index = 0; Index < STATS_PAGE_COUNT; Index++) {
+      if (Shard->Pages[Index] != NULL) {
+        ZeroMem (Shard->Pages[Index], STATS_PAGE_SIZE * sizeof (REGISTER_ACCESS_IO_STATS));
+      }
+    }
+  }
+}
+
+/**
+  Adds counters of Source to Destination.
+**/
+STATIC
+VOID
+StatsAdd (
+  IN OUT REGISTER_ACCESS_IO_STATS        *Destination,
+  IN     CONST REGISTER_ACCESS_IO_STATS  *Source
+  )
+{
+  Destination->Reads += Source->Reads;
+  Destination->Writes += Source->Writes;
+  Destination->ReadBytes += Source->ReadBytes;
+  Destination->WriteBytes += Source->WriteBytes;
+  Destination->Misaligned += Source->Misaligned;
+  Destination->ReadModifyWrites += Source->ReadModifyWrites;
+  Destination->MapMisses += Source->MapMisses;
+}
+
+EFI_STATUS
+RegisterAccessIoStatsGet (
+  IN  UINT16                    Region,
+  OUT REGISTER_ACCESS_IO_STATS  *Stats
+  )
+{
+  REGISTER_ACCESS_IO_STATS_SHARD  *Shard;
+  REGISTER_ACCESS_IO_STATS        *Page;
+  UINT32                          RegionCount;
+
+  if (Stats == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  RegisterAccessIoTraceGetRegions (&RegionCount);
+  if (Region >= RegionCount) {
+    return EFI_NOT_FOUND;
+  }
+
+  ZeroMem (Stats, sizeof (REGISTER_ACCESS_IO_STATS));
+  for (Shard = mStatsShardList; Shard != NULL; Shard = Shard->Next) {
+    Page = Shard->Pages[Region >> STATS_PAGE_SHIFT];
+    if (Page != NULL) {
+      StatsAdd (Stats, &Page[Region & (STATS_PAGE_SIZE - 1)]);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+CONST CHAR8*
+RegisterAccessIoRegionTypeName (
+  IN UINT8  Type
+  )
+{
+  switch (Type) {
+    case RegisterAccessTraceRegionMmio:
+      return "MMIO";
+    case RegisterAccessTraceRegionIo:
+      return "IO";
+    case RegisterAccessTraceRegionPciFunction:
+      return "PCI";
+    case RegisterAccessTraceRegionUnmapped:
+    default:
+      return "Unmapped";
+  }
+}
+
+VOID
+RegisterAccessIoStatsDump (
+  VOID
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  REGISTER_ACCESS_IO_STATS            Stats;
+  UINT32                              RegionCount;
+  UINT32                              Region;
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  DEBUG ((DEBUG_INFO, "Register access statistics:\n"));
+  DEBUG ((DEBUG_INFO, "%-32a %-8a %-12a %-12a %-12a %-12a %-12a %-12a\n", "Region", "Type", "Reads", "Writes", "Bytes", "Misaligned", "RMW", "MapMisses"));
+  for (Region = 0; Region < RegionCount; Region++) {
+    if (EFI_ERROR (RegisterAccessIoStatsGet ((UINT16) Region, &Stats))) {
+      continue;
+    }
+    if (Stats.Reads == 0 && Stats.Writes == 0 && Stats.MapMisses == 0) {
+      continue;
+    }
+    DEBUG ((
+      DEBUG_INFO,
+      "%-32a %-8a %-12Ld %-12Ld %-12Ld %-12Ld %-12Ld %-12Ld\n",
+      Regions[Region].Name,
+      RegisterAccessIoRegionTypeName (Regions[Region].Type),
+      Stats.Reads,
+      Stats.Writes,
+      Stats.ReadBytes + Stats.WriteBytes,
+      Stats.Misaligned,
+      Stats.ReadModifyWrites,
+      Stats.MapMisses
+      ));
+  }
+}
+
+EFI_STATUS
+RegisterAccessIoStatsSave (
+  IN CONST CHAR8  *FileName
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  REGISTER_ACCESS_IO_STATS            Stats;
+  UINT32                              RegionCount;
+  UINT32                              Region;
+  FILE                                *File;
+  EFI_STATUS                          Status;
+
+  if (FileName == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  File = fopen (FileName, "w");
+  if (File == NULL) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  //
+  // Every region is listed, also the ones without accesses, so that files
+  // of different builds of the same driver can be compared line by line.
+  //
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  fprintf (File, "# Region\tType\tBase\tReads\tWrites\tReadBytes\tWriteBytes\tMisaligned\tReadModifyWrites\tMapMisses\n");
+  for (Region = 0; Region < RegionCount; Region++) {
+    if (EFI_ERROR (RegisterAccessIoStatsGet ((UINT16) Region, &Stats))) {
+      continue;
+    }
+    fprintf (
+      File,
+      "%s\t%s\t0x%llx\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n",
+      Regions[Region].Name,
+      RegisterAccessIoRegionTypeName (Regions[Region].Type),
+      (unsigned long long) Regions[Region].Base,
+      (unsigned long long) Stats.Reads,
+      (unsigned long long) Stats.Writes,
+      (unsigned long long) Stats.ReadBytes,
+      (unsigned long long) Stats.WriteBytes,
+      (unsigned long long) Stats.Misaligned,
+      (unsigned long long) Stats.ReadModifyWrites,
+      (unsigned long long) Stats.MapMisses
+      );
+  }
+
+  Status = (ferror (File) != 0) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+  if (fclose (File) != 0) {
+    Status = EFI_DEVICE_ERROR;
+  }
+
+  return Status;
+}
+
+STATIC
+VOID
+StatsExitHandler (
+  VOID
+  )
+{
+  if (mStatsExitFileName[0] != '\0') {
+    RegisterAccessIoStatsSave (mStatsExitFileName);
+  }
+}
+
+EFI_STATUS
+RegisterAccessIoStatsSaveAtExit (
+  IN CONST CHAR8  *FileName OPTIONAL
+  )
+{
+  if (FileName == NULL) {
+    mStatsExitFileName[0] = '\0';
+    return EFI_SUCCESS;
+  }
+
+  if (AsciiStrLen (FileName) >= STATS_FILE_NAME_LENGTH) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!mStatsExitHandlerRegistered) {
+    if (atexit (StatsExitHandler) != 0) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    mStatsExitHandlerRegistered = TRUE;
+  }
+
+  AsciiStrCpyS (mStatsExitFileName, STATS_FILE_NAME_LENGTH, FileName);
+  return EFI_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,683 @@
+/** @file
+  Register access trace recorder.
+
+  Every thread records into its own ring buffer so recording never takes a
+  lock. Buffers are linked into a global list with a compare-exchange when the
+  thread records its first access and are kept after the thread exits so the
+  trace can still be collected. When the buffer wraps the oldest records are
+  overwritten. Buffers are never freed as their threads may record into them
+  at any time. Reset only moves the start of every buffer up to its head and
+  remembers the access count, fields the recording thread never writes, so it
+  is safe while other threads record.
+
+  Head of a buffer is advanced after the record is written. Collecting
+  threads copy the records first and then drop the ones the recording thread
+  may have overwritten in the meantime, so no lock is needed to read a buffer
+  of a running thread.
+
+  Region table grows by doubling. A grown table is published once filled and
+  the old one is kept, as threads may still read it, so every region id below
+  the count read first resolves in either table.
+
+  In sampling mode every buffer carries its own countdown or next sample
+  timestamp so skipping an access costs a decrement or a timestamp compare and
+  a well predicted branch.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/RegisterAccessTraceFileLib.h>
+
+#include <stdio.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+typedef struct _REGISTER_ACCESS_IO_TRACE_BUFFER REGISTER_ACCESS_IO_TRACE_BUFFER;
+
+struct _REGISTER_ACCESS_IO_TRACE_BUFFER {
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *Next;
+  volatile UINT64                  Head;
+  UINT64                           Mask;
+  //
+  // Head and access count at the last reset. Records below Tail are dropped.
+  //
+  volatile UINT64                  Tail;
+  volatile UINT64                  ResetAccessCount;
+  //
+  // Accesses seen by the thread including the ones not recorded.
+  //
+  UINT64                           AccessCount;
+  //
+  // Accesses to skip before the next recorded one (every Nth sampling) or
+  // timestamp of the next recorded access (interval sampling).
+  //
+  UINT64                           NextSample;
+  REGISTER_ACCESS_TRACE_RECORD     Records[1];
+};
+
+//
+// Trace region table entry kept after the table was grown.
+//
+typedef struct _REGISTER_ACCESS_IO_TRACE_RETIRED_REGIONS {
+  struct _REGISTER_ACCESS_IO_TRACE_RETIRED_REGIONS  *Next;
+  REGISTER_ACCESS_TRACE_REGION                      *Regions;
+} REGISTER_ACCESS_IO_TRACE_RETIRED_REGIONS;
+
+BOOLEAN  gRegisterAccessIoTraceEnabled = FALSE;
+
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL REGISTER_ACCESS_IO_TRACE_BUFFER  *mTraceBuffer = NULL;
+STATIC REGISTER_ACCESS_IO_TRACE_BUFFER  *volatile mTraceBufferList = NULL;
+
+STATIC REGISTER_ACCESS_IO_TRACE_SAMPLING  mTraceSampling = RegisterAccessIoTraceSampleAll;
+STATIC UINT64                             mTraceSamplePeriod = 0;
+
+STATIC REGISTER_ACCESS_TRACE_REGION *volatile    mTraceRegions = NULL;
+STATIC volatile UINT32                            mTraceRegionCount = 0;
+STATIC UINT32                                     mTraceRegionCapacity = 0;
+STATIC volatile UINT32                            mTraceRegionLock = 0;
+STATIC REGISTER_ACCESS_IO_TRACE_RETIRED_REGIONS   *mTraceRetiredRegions = NULL;
+
+//
+// Timestamp counter and wall clock sampled when tracing was enabled. Used to
+// estimate timestamp frequency when the trace is saved.
+//
+STATIC UINT64  mTraceStartTicks = 0;
+STATIC UINT64  mTraceStartNanoseconds = 0;
+
+STATIC
+REGISTER_ACCESS_IO_TRACE_BUFFER*
+TraceAllocateBuffer (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *Buffer;
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *Head;
+  UINT32                           NoOfRecords;
+
+  NoOfRecords = GetPowerOfTwo32 (FixedPcdGet32 (PcdRegisterAccessTraceBufferSize));
+  if (NoOfRecords == 0) {
+    return NULL;
+  }
+
+  Buffer = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_TRACE_BUFFER) + (NoOfRecords - 1) * sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  if (Buffer == NULL) {
+    return NULL;
+  }
+  Buffer->Mask = NoOfRecords - 1;
+
+  do {
+    Head = mTraceBufferList;
+    Buffer->Next = Head;
+  } while (InterlockedCompareExchangePointer ((VOID *volatile *) &mTraceBufferList, Head, Buffer) != Head);
+
+  return Buffer;
+}
+
+UINT64
+RegisterAccessIoTraceGetTimestamp (
+  VOID
+  )
+{
+  return AsmReadTsc ();
+}
+
+VOID
+RegisterAccessIoTraceEnable (
+  IN BOOLEAN  Enable
+  )
+{
+  if (Enable && !gRegisterAccessIoTraceEnabled) {
+    mTraceStartTicks = RegisterAccessIoTraceGetTimestamp ();
+    mTraceStartNanoseconds = RegisterAccessIoGetHostNanoseconds ();
+  }
+  gRegisterAccessIoTraceEnabled = Enable;
+}
+
+VOID
+RegisterAccessIoTraceReset (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *Buffer;
+
+  //
+  // Buffers pushed while the list is walked hold only records taken after
+  // the reset started.
+  //
+  for (Buffer = mTraceBufferList; Buffer != NULL; Buffer = Buffer->Next) {
+    Buffer->ResetAccessCount = Buffer->AccessCount;
+    Buffer->Tail = Buffer->Head;
+  }
+}
+
+EFI_STATUS
+RegisterAccessIoTraceSetSampling (
+  IN REGISTER_ACCESS_IO_TRACE_SAMPLING  Sampling,
+  IN UINT64                             Period
+  )
+{
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *Buffer;
+
+  if (Sampling > RegisterAccessIoTraceSampleInterval) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (Sampling != RegisterAccessIoTraceSampleAll && Period == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  mTraceSampling = Sampling;
+  mTraceSamplePeriod = Period;
+  for (Buffer = mTraceBufferList; Buffer != NULL; Buffer = Buffer->Next) {
+    Buffer->NextSample = 0;
+  }
+
+  return EFI_SUCCESS;
+}
+
+UINT64
+RegisterAccessIoTraceGetAccessCount (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *Buffer;
+  UINT64                           AccessCount;
+
+  AccessCount = 0;
+  for (Buffer = mTraceBufferList; Buffer != NULL; Buffer = Buffer->Next) {
+    AccessCount += Buffer->AccessCount - Buffer->ResetAccessCount;
+  }
+
+  return AccessCount;
+}
+
+/**
+  Makes room for one more region in the region table. Called with the region
+  table lock held.
+
+  @retval EFI_SUCCESS           Table has room.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+STATIC
+EFI_STATUS
+TraceReserveRegion (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_TRACE_RETIRED_REGIONS  *Retired;
+  REGISTER_ACCESS_TRACE_REGION              *Regions;
+  UINT32                                    Capacity;
+
+  if (mTraceRegionCount < mTraceRegionCapacity) {
+    return EFI_SUCCESS;
+  }
+
+  Retired = NULL;
+  if (mTraceRegions != NULL) {
+    Retired = AllocatePool (sizeof (REGISTER_ACCESS_IO_TRACE_RETIRED_REGIONS));
+    if (Retired == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  Capacity = MAX (mTraceRegionCapacity * 2, 16);
+  Regions = AllocateZeroPool (Capacity * sizeof (REGISTER_ACCESS_TRACE_REGION));
+  if (Regions == NULL) {
+    if (Retired != NULL) {
+      FreePool (Retired);
+    }
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (mTraceRegions != NULL) {
+    CopyMem (Regions, mTraceRegions, mTraceRegionCount * sizeof (REGISTER_ACCESS_TRACE_REGION));
+    Retired->Regions = mTraceRegions;
+    Retired->Next = mTraceRetiredRegions;
+    mTraceRetiredRegions = Retired;
+  }
+  MemoryFence ();
+  mTraceRegions = Regions;
+  mTraceRegionCapacity = Capacity;
+
+  return EFI_SUCCESS;
+}
+
+UINT16
+RegisterAccessIoTraceRegisterRegion (
+  IN CONST CHAR16                       *Name,
+  IN REGISTER_ACCESS_TRACE_REGION_TYPE  Type,
+  IN UINT64                             Base,
+  IN UINT64                             Size
+  )
+{
+  REGISTER_ACCESS_TRACE_REGION  *Region;
+  UINTN                         Index;
+  UINT16                        RegionId;
+
+  while (InterlockedCompareExchange32 (&mTraceRegionLock, 0, 1) != 0) {
+    CpuPause ();
+  }
+
+  if (mTraceRegionCount == 0) {
+    if (EFI_ERROR (TraceReserveRegion ())) {
+      goto Unmapped;
+    }
+    mTraceRegions[REGISTER_ACCESS_TRACE_REGION_UNMAPPED].Type = RegisterAccessTraceRegionUnmapped;
+    AsciiStrCpyS (mTraceRegions[REGISTER_ACCESS_TRACE_REGION_UNMAPPED].Name, REGISTER_ACCESS_TRACE_REGION_NAME_LENGTH, "Unmapped");
+    MemoryFence ();
+    mTraceRegionCount = 1;
+  }
+
+  if (mTraceRegionCount > MAX_UINT16) {
+    DEBUG ((DEBUG_WARN, "Trace region table is full, accesses of %s are traced as unmapped\n", Name));
+    goto Unmapped;
+  }
+
+  //
+  // Region ids are never reused so records taken before the region was
+  // unregistered still resolve to the right region.
+  //
+  if (EFI_ERROR (TraceReserveRegion ())) {
+    DEBUG ((DEBUG_WARN, "Failed to add trace region, accesses of %s are traced as unmapped\n", Name));
+    goto Unmapped;
+  }
+
+  Region = &mTraceRegions[mTraceRegionCount];
+  ZeroMem (Region, sizeof (REGISTER_ACCESS_TRACE_REGION));
+  Region->Base = Base;
+  Region->Size = Size;
+  Region->Type = (UINT8) Type;
+  for (Index = 0; Name != NULL && Name[Index] != L'\0' && Index < REGISTER_ACCESS_TRACE_REGION_NAME_LENGTH - 1; Index++) {
+    Region->Name[Index] = (Name[Index] < 0x80) ? (CHAR8) Name[Index] : '?';
+  }
+  RegionId = (UINT16) mTraceRegionCount;
+  //
+  // Entry must be complete before the count makes it visible.
+  //
+  MemoryFence ();
+  mTraceRegionCount++;
+
+  RegisterAccessIoTraceFilterCompile ();
+  mTraceRegionLock = 0;
+
+  return RegionId;
+
+Unmapped:
+  mTraceRegionLock = 0;
+  return REGISTER_ACCESS_TRACE_REGION_UNMAPPED;
+}
+
+CONST REGISTER_ACCESS_TRACE_REGION*
+RegisterAccessIoTraceGetRegions (
+  OUT UINT32  *RegionCount
+  )
+{
+  //
+  // Count is read first, table published later holds every entry below it.
+  //
+  *RegionCount = mTraceRegionCount;
+  MemoryFence ();
+  return mTraceRegions;
+}
+
+BOOLEAN
+RegisterAccessIoTraceSampleNext (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *Buffer;
+
+  if (mTraceSampling != RegisterAccessIoTraceSampleEveryNth) {
+    return TRUE;
+  }
+
+  //
+  // Thread without a buffer records its first access.
+  //
+  Buffer = mTraceBuffer;
+  if (Buffer == NULL) {
+    return TRUE;
+  }
+
+  return (BOOLEAN)(Buffer->NextSample == 0);
+}
+
+VOID
+RegisterAccessIoTraceRecord (
+  IN REGISTER_ACCESS_TRACE_TYPE  Type,
+  IN UINT16                      Region,
+  IN UINT64                      Address,
+  IN UINT8                       Width,
+  IN UINT64                      Value,
+  IN UINT32                      Duration
+  )
+{
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *Buffer;
+  REGISTER_ACCESS_TRACE_RECORD     *Record;
+  UINT64                           Timestamp;
+
+  if (gRegisterAccessIoTraceFilterEnabled && !RegisterAccessIoTraceFilterMatch (Region, Type, Address, Value)) {
+    return;
+  }
+
+  Buffer = mTraceBuffer;
+  if (Buffer == NULL) {
+    Buffer = TraceAllocateBuffer ();
+    mTraceBuffer = Buffer;
+    if (Buffer == NULL) {
+      return;
+    }
+  }
+
+  Buffer->AccessCount++;
+  Timestamp = 0;
+  if (mTraceSampling == RegisterAccessIoTraceSampleEveryNth) {
+    if (Buffer->NextSample != 0) {
+      Buffer->NextSample--;
+      return;
+    }
+    Buffer->NextSample = mTraceSamplePeriod - 1;
+  } else if (mTraceSampling == RegisterAccessIoTraceSampleInterval) {
+    Timestamp = RegisterAccessIoTraceGetTimestamp ();
+    if (Timestamp < Buffer->NextSample) {
+      return;
+    }
+    Buffer->NextSample = Timestamp + mTraceSamplePeriod;
+  }
+
+  if (Timestamp == 0) {
+    Timestamp = RegisterAccessIoTraceGetTimestamp ();
+  }
+
+  Record = &Buffer->Records[Buffer->Head & Buffer->Mask];
+  Record->Timestamp = Timestamp - Duration;
+  Record->Address = Address;
+  Record->Value = Value;
+  Record->Duration = Duration;
+  Record->Region = Region;
+  Record->Type = (UINT8) Type;
+  Record->Width = Width;
+  //
+  // Record must be complete before collecting threads see it.
+  //
+  MemoryFence ();
+  Buffer->Head++;
+}
+
+EFI_STATUS
+RegisterAccessIoTraceGetRecords (
+  OUT REGISTER_ACCESS_TRACE_RECORD  **Records,
+  OUT UINTN                         *RecordCount
+  )
+{
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *List;
+  REGISTER_ACCESS_IO_TRACE_BUFFER  *Buffer;
+  REGISTER_ACCESS_IO_TRACE_BUFFER  **Buffers;
+  REGISTER_ACCESS_TRACE_RECORD     *Copy;
+  UINT64                           *Heads;
+  UINT64                           *Firsts;
+  UINTN                            *Cursor;
+  UINTN                            *End;
+  UINTN                            NoOfBuffers;
+  UINTN                            Total;
+  UINTN                            Index;
+  UINTN                            Oldest;
+  UINT64                           Head;
+  UINT64                           First;
+  UINT64                           Overwritten;
+  UINT64                           Record;
+
+  *Records = NULL;
+  *RecordCount = 0;
+  Copy = NULL;
+  Firsts = NULL;
+  Cursor = NULL;
+  End = NULL;
+
+  //
+  // Buffers of new threads are pushed in front of the head taken here.
+  //
+  List = mTraceBufferList;
+  NoOfBuffers = 0;
+  for (Buffer = List; Buffer != NULL; Buffer = Buffer->Next) {
+    NoOfBuffers++;
+  }
+  if (NoOfBuffers == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Buffers = AllocateZeroPool (NoOfBuffers * sizeof (REGISTER_ACCESS_IO_TRACE_BUFFER*));
+  Heads = AllocateZeroPool (NoOfBuffers * sizeof (UINT64));
+  Firsts = AllocateZeroPool (NoOfBuffers * sizeof (UINT64));
+  if (Buffers == NULL || Heads == NULL || Firsts == NULL) {
+    goto OutOfResources;
+  }
+
+  //
+  // Records appended after the heads are taken aren't collected, neither are
+  // the ones taken before the last reset.
+  //
+  Total = 0;
+  Index = 0;
+  for (Buffer = List; Buffer != NULL; Buffer = Buffer->Next, Index++) {
+    Buffers[Index] = Buffer;
+    Heads[Index] = Buffer->Head;
+    First = Heads[Index] - MIN (Heads[Index], Buffer->Mask + 1);
+    Firsts[Index] = MIN (MAX (First, Buffer->Tail), Heads[Index]);
+    Total += (UINTN) (Heads[Index] - Firsts[Index]);
+  }
+  MemoryFence ();
+
+  Cursor = AllocateZeroPool (NoOfBuffers * sizeof (UINTN));
+  End = AllocateZeroPool (NoOfBuffers * sizeof (UINTN));
+  Copy = AllocatePool (MAX (Total, 1) * sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  if (Cursor == NULL || End == NULL || Copy == NULL) {
+    goto OutOfResources;
+  }
+
+  //
+  // Buffers of running threads are copied without stopping them. Records
+  // the thread may have overwritten while they were copied, including the
+  // one it may be writing, are dropped from the front of the copy.
+  //
+  Total = 0;
+  for (Index = 0; Index < NoOfBuffers; Index++) {
+    Buffer = Buffers[Index];
+    Head = Heads[Index];
+    First = Firsts[Index];
+    for (Record = First; Record < Head; Record++) {
+      CopyMem (&Copy[Total + (UINTN) (Record - First)], &Buffer->Records[Record & Buffer->Mask], sizeof (REGISTER_ACCESS_TRACE_RECORD));
+    }
+    MemoryFence ();
+    Overwritten = Buffer->Head + 1;
+    Overwritten = Overwritten - MIN (Overwritten, Buffer->Mask + 1);
+    Cursor[Index] = Total + (UINTN) (MIN (MAX (Overwritten, First), Head) - First);
+    Total += (UINTN) (Head - First);
+    End[Index] = Total;
+  }
+
+  if (Total == 0) {
+    FreePool (Buffers);
+    FreePool (Heads);
+    FreePool (Firsts);
+    FreePool (Cursor);
+    FreePool (End);
+    FreePool (Copy);
+    return EFI_SUCCESS;
+  }
+
+  *Records = AllocatePool (Total * sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  if (*Records == NULL) {
+    goto OutOfResources;
+  }
+
+  //
+  // Every per-thread buffer is already ordered so a k-way merge gives
+  // a single stream ordered by timestamp. The only exception are records of
+  // operations enclosing other accesses (polls) which are stamped with their
+  // start but appended after the accesses they issued.
+  //
+  while (TRUE) {
+    Oldest = NoOfBuffers;
+    for (Index = 0; Index < NoOfBuffers; Index++) {
+      if (Cursor[Index] == End[Index]) {
+        continue;
+      }
+      if (Oldest == NoOfBuffers || Copy[Cursor[Index]].Timestamp < Copy[Cursor[Oldest]].Timestamp) {
+        Oldest = Index;
+      }
+    }
+    if (Oldest == NoOfBuffers) {
+      break;
+    }
+    CopyMem (&(*Records)[*RecordCount], &Copy[Cursor[Oldest]], sizeof (REGISTER_ACCESS_TRACE_RECORD));
+    Cursor[Oldest]++;
+    (*RecordCount)++;
+  }
+
+  FreePool (Buffers);
+  FreePool (Heads);
+  FreePool (Firsts);
+  FreePool (Cursor);
+  FreePool (End);
+  FreePool (Copy);
+  return EFI_SUCCESS;
+
+OutOfResources:
+  if (Buffers != NULL) {
+    FreePool (Buffers);
+  }
+  if (Heads != NULL) {
+    FreePool (Heads);
+  }
+  if (Firsts != NULL) {
+    FreePool (Firsts);
+  }
+  if (Cursor != NULL) {
+    FreePool (Cursor);
+  }
+  if (End != NULL) {
+    FreePool (End);
+  }
+  if (Copy != NULL) {
+    FreePool (Copy);
+  }
+  return EFI_OUT_OF_RESOURCES;
+}
+
+UINT64
+RegisterAccessIoTraceGetTicksPerSecond (
+  VOID
+  )
+{
+  UINT64  ElapsedTicks;
+  UINT64  ElapsedNanoseconds;
+
+  ElapsedTicks = RegisterAccessIoTraceGetTimestamp () - mTraceStartTicks;
+  ElapsedNanoseconds = RegisterAccessIoGetHostNanoseconds () - mTraceStartNanoseconds;
+  if (mTraceStartNanoseconds == 0 || ElapsedNanoseconds == 0) {
+    return 0;
+  }
+
+  return (UINT64)(((double) ElapsedTicks * 1000000000.0) / (double) ElapsedNanoseconds);
+}
+
+EFI_STATUS
+RegisterAccessIoTraceSave (
+  IN CONST CHAR8  *FileName
+  )
+{
+  REGISTER_ACCESS_TRACE_HEADER        Header;
+  REGISTER_ACCESS_TRACE_RECORD        *Records;
+  UINTN                               RecordCount;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  FILE                                *File;
+  EFI_STATUS                          Status;
+
+  if (FileName == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RegisterAccessIoTraceGetRecords (&Records, &RecordCount);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  ZeroMem (&Header, sizeof (Header));
+  Header.Signature = REGISTER_ACCESS_TRACE_SIGNATURE;
+  Header.Version = REGISTER_ACCESS_TRACE_VERSION;
+  Header.RegionCount = RegionCount;
+  Header.RecordCount = RecordCount;
+  Header.TicksPerSecond = RegisterAccessIoTraceGetTicksPerSecond ();
+
+  Status = EFI_SUCCESS;
+  File = fopen (FileName, "wb");
+  if (File == NULL) {
+    Status = EFI_DEVICE_ERROR;
+  } else {
+    if (fwrite (&Header, sizeof (Header), 1, File) != 1 ||
+        (RegionCount != 0 && fwrite (Regions, sizeof (REGISTER_ACCESS_TRACE_REGION), RegionCount, File) != RegionCount) ||
+        (RecordCount != 0 && fwrite (Records, sizeof (REGISTER_ACCESS_TRACE_RECORD), RecordCount, File) != RecordCount)) {
+      Status = EFI_DEVICE_ERROR;
+    }
+    fclose (File);
+  }
+
+  if (Records != NULL) {
+    FreePool (Records);
+  }
+
+  return Status;
+}
+
+EFI_STATUS
+RegisterAccessIoTraceSaveCompact (
+  IN CONST CHAR8  *FileName
+  )
+{
+  REGISTER_ACCESS_TRACE_WRITER        *Writer;
+  REGISTER_ACCESS_TRACE_RECORD        *Records;
+  UINTN                               RecordCount;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINTN                               Index;
+  EFI_STATUS                          Status;
+  EFI_STATUS                          CloseStatus;
+
+  if (FileName == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RegisterAccessIoTraceGetRecords (&Records, &RecordCount);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = RegisterAccessTraceWriterCreate (FileName, RegisterAccessIoTraceGetTicksPerSecond (), &Writer);
+  if (!EFI_ERROR (Status)) {
+    for (Index = 0; Index < RecordCount && !EFI_ERROR (Status); Index++) {
+      Status = RegisterAccessTraceWriterAppend (Writer, &Records[Index]);
+    }
+    Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+    CloseStatus = RegisterAccessTraceWriterClose (Writer, Regions, RegionCount);
+    if (!EFI_ERROR (Status)) {
+      Status = CloseStatus;
+    }
+  }
+
+  if (Records != NULL) {
+    FreePool (Records);
+  }
+
+  return Status;
+}
@@ -0,0 +1,296 @@
+/** @file
+  Export of register access traces to Chrome trace event format.
+
+  Every trace region becomes a thread (track) of a single process so that
+  accesses to each register space and every PCI function are shown on their own
+  row. Records with duration are exported as complete ("X") events, the rest as
+  thread scoped instant ("i") events. Timestamps are microseconds relative to
+  the first record.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/RegisterAccessTraceFileLib.h>
+
+#include <stdio.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+#define CHROME_TRACE_PID  1
+
+typedef struct {
+  CONST CHAR8  *Name;
+  CONST CHAR8  *Category;
+} CHROME_TRACE_EVENT_INFO;
+
+STATIC CONST CHROME_TRACE_EVENT_INFO  mChromeTraceEventInfo[RegisterAccessTraceTypeMax] = {
+  { "MMIO read",    "mmio" },
+  { "MMIO write",   "mmio" },
+  { "IO read",      "io"   },
+  { "IO write",     "io"   },
+  { "Config read",  "pci"  },
+  { "Config write", "pci"  },
+  { "PollMem",      "pci"  },
+  { "PollIo",       "pci"  },
+  { "Flush",        "pci"  },
+  { "Map",          "pci"  },
+  { "Unmap",        "pci"  }
+};
+
+STATIC CONST CHAR8  *mChromeTraceRegionTypeName[] = {
+  "MMIO",
+  "IO",
+  "PCI",
+  "Unmapped"
+};
+
+STATIC
+VOID
+ChromeTraceWriteString (
+  IN FILE         *File,
+  IN CONST CHAR8  *String,
+  IN UINTN        MaxLength
+  )
+{
+  UINTN  Index;
+
+  fputc ('"', File);
+  for (Index = 0; Index < MaxLength && String[Index] != '\0'; Index++) {
+    if (String[Index] == '"' || String[Index] == '\\') {
+      fprintf (File, "\\%c", String[Index]);
+    } else if ((UINT8) String[Index] < 0x20) {
+      fprintf (File, "\\u%04x", (UINT8) String[Index]);
+    } else {
+      fputc (String[Index], File);
+    }
+  }
+  fputc ('"', File);
+}
+
+STATIC
+VOID
+ChromeTraceWriteRegions (
+  IN FILE                                *File,
+  IN CONST REGISTER_ACCESS_TRACE_REGION  *Regions,
+  IN UINT32                              RegionCount
+  )
+{
+  CONST CHAR8  *TypeName;
+  UINT32       Region;
+
+  fprintf (File, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  fprintf (File, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Register access\"}}", CHROME_TRACE_PID);
+  for (Region = 0; Region < RegionCount; Region++) {
+    TypeName = (Regions[Region].Type < ARRAY_SIZE (mChromeTraceRegionTypeName)) ? mChromeTraceRegionTypeName[Regions[Region].Type] : "Unknown";
+    fprintf (File, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":", CHROME_TRACE_PID, Region);
+    ChromeTraceWriteString (File, Regions[Region].Name, sizeof (Regions[Region].Name));
+    fprintf (
+      File,
+      ",\"type\":\"%s\",\"base\":\"0x%llx\",\"size\":\"0x%llx\"}}",
+      TypeName,
+      (unsigned long long) Regions[Region].Base,
+      (unsigned long long) Regions[Region].Size
+      );
+    fprintf (File, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"sort_index\":%u}}", CHROME_TRACE_PID, Region, Region);
+  }
+}
+
+STATIC
+VOID
+ChromeTraceWriteRecord (
+  IN FILE                                *File,
+  IN CONST REGISTER_ACCESS_TRACE_RECORD  *Record,
+  IN UINT64                              FirstTimestamp,
+  IN double                              MicrosecondsPerTick
+  )
+{
+  CONST CHROME_TRACE_EVENT_INFO  *Info;
+
+  if (Record->Type >= RegisterAccessTraceTypeMax) {
+    return;
+  }
+
+  Info = &mChromeTraceEventInfo[Record->Type];
+  fprintf (
+    File,
+    ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,",
+    Info->Name,
+    Info->Category,
+    CHROME_TRACE_PID,
+    Record->Region,
+    (double)(Record->Timestamp - FirstTimestamp) * MicrosecondsPerTick
+    );
+  if (Record->Duration != 0) {
+    fprintf (File, "\"ph\":\"X\",\"dur\":%.3f,", (double) Record->Duration * MicrosecondsPerTick);
+  } else {
+    fprintf (File, "\"ph\":\"i\",\"s\":\"t\",");
+  }
+  fprintf (
+    File,
+    "\"args\":{\"address\":\"0x%llx\",\"width\":%u,\"value\":\"0x%llx\"}}",
+    (unsigned long long) Record->Address,
+    Record->Width,
+    (unsigned long long) Record->Value
+    );
+}
+
+STATIC
+EFI_STATUS
+ChromeTraceClose (
+  IN FILE  *File
+  )
+{
+  INT32  Result;
+
+  fprintf (File, "\n]}\n");
+  Result = ferror (File);
+  if (fclose (File) != 0 || Result != 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+//
+// Without known frequency ticks are shown as nanoseconds.
+//
+STATIC
+double
+ChromeTraceMicrosecondsPerTick (
+  IN UINT64  TicksPerSecond
+  )
+{
+  return (TicksPerSecond != 0) ? 1000000.0 / (double) TicksPerSecond : 0.001;
+}
+
+EFI_STATUS
+RegisterAccessIoTraceSaveChromeTrace (
+  IN CONST CHAR8  *FileName
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  REGISTER_ACCESS_TRACE_RECORD        *Records;
+  UINTN                               RecordCount;
+  UINTN                               Index;
+  UINT64                              FirstTimestamp;
+  double                              MicrosecondsPerTick;
+  FILE                                *File;
+  EFI_STATUS                          Status;
+
+  if (FileName == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RegisterAccessIoTraceGetRecords (&Records, &RecordCount);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  File = fopen (FileName, "w");
+  if (File == NULL) {
+    if (Records != NULL) {
+      FreePool (Records);
+    }
+    return EFI_DEVICE_ERROR;
+  }
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  MicrosecondsPerTick = ChromeTraceMicrosecondsPerTick (RegisterAccessIoTraceGetTicksPerSecond ());
+  FirstTimestamp = (RecordCount != 0) ? Records[0].Timestamp : 0;
+  for (Index = 1; Index < RecordCount; Index++) {
+    FirstTimestamp = MIN (FirstTimestamp, Records[Index].Timestamp);
+  }
+
+  ChromeTraceWriteRegions (File, Regions, RegionCount);
+  for (Index = 0; Index < RecordCount; Index++) {
+    ChromeTraceWriteRecord (File, &Records[Index], FirstTimestamp, MicrosecondsPerTick);
+  }
+  Status = ChromeTraceClose (File);
+
+  if (Records != NULL) {
+    FreePool (Records);
+  }
+
+  return Status;
+}
+
+EFI_STATUS
+RegisterAccessIoTraceConvertToChromeTrace (
+  IN CONST CHAR8  *TraceFileName,
+  IN CONST CHAR8  *JsonFileName
+  )
+{
+  REGISTER_ACCESS_TRACE_READER        *Reader;
+  REGISTER_ACCESS_TRACE_RECORD        Record;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINT64                              TicksPerSecond;
+  UINT64                              FirstTimestamp;
+  double                              MicrosecondsPerTick;
+  FILE                                *File;
+  EFI_STATUS                          Status;
+  EFI_STATUS                          CloseStatus;
+
+  if (TraceFileName == NULL || JsonFileName == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RegisterAccessTraceReaderOpen (TraceFileName, &Reader);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  RegisterAccessTraceReaderGetInfo (Reader, NULL, &TicksPerSecond, &Regions, &RegionCount);
+
+  //
+  // Records enclosing other accesses are stamped with their start so the
+  // oldest timestamp is not necessarily the first one.
+  //
+  FirstTimestamp = MAX_UINT64;
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  while (Status == EFI_SUCCESS) {
+    FirstTimestamp = MIN (FirstTimestamp, Record.Timestamp);
+    Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  }
+  if (Status != EFI_END_OF_FILE) {
+    RegisterAccessTraceReaderClose (Reader);
+    return Status;
+  }
+
+  Status = RegisterAccessTraceReaderSeek (Reader, 0);
+  if (EFI_ERROR (Status)) {
+    RegisterAccessTraceReaderClose (Reader);
+    return Status;
+  }
+
+  File = fopen (JsonFileName, "w");
+  if (File == NULL) {
+    RegisterAccessTraceReaderClose (Reader);
+    return EFI_DEVICE_ERROR;
+  }
+
+  ChromeTraceWriteRegions (File, Regions, RegionCount);
+  MicrosecondsPerTick = ChromeTraceMicrosecondsPerTick (TicksPerSecond);
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  while (Status == EFI_SUCCESS) {
+    ChromeTraceWriteRecord (File, &Record, FirstTimestamp, MicrosecondsPerTick);
+    Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  }
+  if (Status == EFI_END_OF_FILE) {
+    Status = EFI_SUCCESS;
+  }
+
+  CloseStatus = ChromeTraceClose (File);
+  if (!EFI_ERROR (Status)) {
+    Status = CloseStatus;
+  }
+
+  RegisterAccessTraceReaderClose (Reader);
+  return Status;
+}
\ No newline at end of file
@@ -0,0 +1,603 @@
+/** @file
+  Trace capture filters.
+
+  Filters are compiled into a decision table indexed by region id and access
+  type. Cells which don't depend on the address or value hold the final
+  decision so most accesses are resolved with a single table lookup. Remaining
+  cells point to a chain of address and value checks ending with an
+  unconditional entry. Address ranges are resolved against the bounds of MMIO
+  and IO regions during compilation so a range covering the whole region needs
+  no check at record time and a range outside of it is dropped from the chain.
+
+  Cells of new regions are compiled when the region is added to the trace
+  region table. Tables only grow while filters are set: a grown table is
+  published after it's filled and the table it replaces is kept until the
+  filters are changed so threads recording concurrently never see freed
+  memory. Identical chains are shared, found through a hash of the chain.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+#define TRACE_FILTER_TYPE_SHIFT  4
+#define TRACE_FILTER_TYPE_COUNT  (1 << TRACE_FILTER_TYPE_SHIFT)
+
+//
+// Values of the decision table cells. Other values are chain indices
+// offset by TRACE_FILTER_CHAIN.
+//
+#define TRACE_FILTER_DROP    0
+#define TRACE_FILTER_RECORD  1
+#define TRACE_FILTER_CHAIN   2
+
+//
+// Initial number of slots of the chain hash. Must be a power of 2.
+//
+#define TRACE_FILTER_HASH_SIZE  64
+
+typedef struct {
+  UINT64   AddressMin;
+  UINT64   AddressMax;
+  UINT64   ValueMask;
+  UINT64   ValueMatch;
+  BOOLEAN  Record;
+} TRACE_FILTER_CHECK;
+
+typedef struct {
+  UINT32  Hash;
+  //
+  // Index of the first check of the chain plus 1. 0 marks an empty slot.
+  //
+  UINT32  Start;
+  UINT32  Length;
+} TRACE_FILTER_HASH_ENTRY;
+
+//
+// Table replaced by a grown copy, freed once no thread can read it.
+//
+typedef struct _TRACE_FILTER_RETIRED {
+  struct _TRACE_FILTER_RETIRED  *Next;
+  VOID                          *Buffer;
+} TRACE_FILTER_RETIRED;
+
+BOOLEAN  gRegisterAccessIoTraceFilterEnabled = FALSE;
+
+//
+// Filters as set by the caller, kept to compile cells of regions added later.
+//
+STATIC REGISTER_ACCESS_IO_TRACE_FILTER  *mTraceFilters = NULL;
+STATIC UINTN                            mTraceFilterCount = 0;
+STATIC BOOLEAN                          mTraceFilterDefault = TRUE;
+
+//
+// Read by recording threads without a lock. Cells below mTraceFilterRegionCount
+// and checks they point to are never modified once published.
+//
+STATIC UINT32 *volatile              mTraceFilterTable = NULL;
+STATIC volatile UINT32               mTraceFilterRegionCount = 0;
+STATIC TRACE_FILTER_CHECK *volatile  mTraceFilterChecks = NULL;
+
+//
+// Owned by the compiling thread.
+//
+STATIC volatile UINT32           mTraceFilterCompiling = 0;
+STATIC UINT32                    mTraceFilterRegionCapacity = 0;
+STATIC UINTN                     mTraceFilterCheckCount = 0;
+STATIC UINTN                     mTraceFilterCheckCapacity = 0;
+STATIC TRACE_FILTER_HASH_ENTRY   *mTraceFilterHash = NULL;
+STATIC UINTN                     mTraceFilterHashSize = 0;
+STATIC UINTN                     mTraceFilterHashCount = 0;
+STATIC TRACE_FILTER_RETIRED      *mTraceFilterRetired = NULL;
+
+STATIC
+BOOLEAN
+TraceFilterMatchName (
+  IN CONST CHAR8  *Pattern,
+  IN CONST CHAR8  *Name
+  )
+{
+  UINTN  Length;
+
+  if (Pattern == NULL) {
+    return TRUE;
+  }
+
+  Length = AsciiStrLen (Pattern);
+  if (Length != 0 && Pattern[Length - 1] == '*') {
+    return AsciiStrnCmp (Pattern, Name, Length - 1) == 0;
+  }
+
+  return AsciiStrCmp (Pattern, Name) == 0;
+}
+
+STATIC
+VOID
+TraceFilterFree (
+  VOID
+  )
+{
+  TRACE_FILTER_RETIRED  *Retired;
+  UINTN                 Index;
+
+  gRegisterAccessIoTraceFilterEnabled = FALSE;
+  if (mTraceFilterTable != NULL) {
+    FreePool (mTraceFilterTable);
+    mTraceFilterTable = NULL;
+  }
+  if (mTraceFilterChecks != NULL) {
+    FreePool (mTraceFilterChecks);
+    mTraceFilterChecks = NULL;
+  }
+  if (mTraceFilterHash != NULL) {
+    FreePool (mTraceFilterHash);
+    mTraceFilterHash = NULL;
+  }
+  while (mTraceFilterRetired != NULL) {
+    Retired = mTraceFilterRetired;
+    mTraceFilterRetired = Retired->Next;
+    FreePool (Retired->Buffer);
+    FreePool (Retired);
+  }
+  mTraceFilterRegionCount = 0;
+  mTraceFilterRegionCapacity = 0;
+  mTraceFilterCheckCount = 0;
+  mTraceFilterCheckCapacity = 0;
+  mTraceFilterHashSize = 0;
+  mTraceFilterHashCount = 0;
+
+  if (mTraceFilters != NULL) {
+    for (Index = 0; Index < mTraceFilterCount; Index++) {
+      if (mTraceFilters[Index].RegionName != NULL) {
+        FreePool ((VOID *) mTraceFilters[Index].RegionName);
+      }
+    }
+    FreePool (mTraceFilters);
+    mTraceFilters = NULL;
+  }
+  mTraceFilterCount = 0;
+}
+
+/**
+  Keeps a replaced table until the filters are changed. If the list entry
+  can't be allocated the table is leaked rather than freed under a reader.
+**/
+STATIC
+VOID
+TraceFilterRetire (
+  IN VOID  *Buffer
+  )
+{
+  TRACE_FILTER_RETIRED  *Retired;
+
+  if (Buffer == NULL) {
+    return;
+  }
+
+  Retired = AllocatePool (sizeof (TRACE_FILTER_RETIRED));
+  if (Retired == NULL) {
+    return;
+  }
+  Retired->Buffer = Buffer;
+  Retired->Next = mTraceFilterRetired;
+  mTraceFilterRetired = Retired;
+}
+
+/**
+  Builds the check chain of a single region and access type into Chain.
+
+  @param[in]  Region  Region the chain is built for.
+  @param[in]  Type    Access type the chain is built for.
+  @param[out] Chain   Checks. Last check is unconditional. Must hold
+                      mTraceFilterCount + 1 entries.
+
+  @return Number of checks in the chain.
+**/
+STATIC
+UINTN
+TraceFilterBuildChain (
+  IN  CONST REGISTER_ACCESS_TRACE_REGION  *Region,
+  IN  UINT32                              Type,
+  OUT TRACE_FILTER_CHECK                  *Chain
+  )
+{
+  CONST REGISTER_ACCESS_IO_TRACE_FILTER  *Filter;
+  TRACE_FILTER_CHECK                     *Check;
+  UINT64                                 RegionMax;
+  BOOLEAN                                Bounded;
+  UINTN                                  Length;
+  UINTN                                  Index;
+
+  //
+  // Accesses of MMIO and IO regions always fall within the region. Other
+  // regions carry offsets or device addresses.
+  //
+  Bounded = (Region->Type == RegisterAccessTraceRegionMmio || Region->Type == RegisterAccessTraceRegionIo) && Region->Size != 0;
+  RegionMax = Region->Base + Region->Size - 1;
+
+  Length = 0;
+  for (Index = 0; Index < mTraceFilterCount; Index++) {
+    Filter = &mTraceFilters[Index];
+    if (Filter->Types != 0 && (Filter->Types & (BIT0 << Type)) == 0) {
+      continue;
+    }
+    if (!TraceFilterMatchName (Filter->RegionName, Region->Name)) {
+      continue;
+    }
+
+    //
+    // Chains are hashed and compared as bytes so padding must be zero.
+    //
+    Check = &Chain[Length];
+    ZeroMem (Check, sizeof (TRACE_FILTER_CHECK));
+    if (Filter->MatchAddress) {
+      Check->AddressMin = Filter->AddressMin;
+      Check->AddressMax = Filter->AddressMax;
+    } else {
+      Check->AddressMax = MAX_UINT64;
+    }
+    Check->ValueMask = Filter->ValueMask;
+    Check->ValueMatch = Filter->ValueMatch;
+    Check->Record = (Filter->Action == RegisterAccessIoTraceFilterRecord);
+
+    if (Bounded) {
+      if (Check->AddressMin > RegionMax || Check->AddressMax < Region->Base) {
+        continue;
+      }
+      if (Check->AddressMin <= Region->Base && Check->AddressMax >= RegionMax) {
+        Check->AddressMin = 0;
+        Check->AddressMax = MAX_UINT64;
+      }
+    }
+
+    Length++;
+    if (Check->AddressMin == 0 && Check->AddressMax == MAX_UINT64 && Check->ValueMask == 0) {
+      return Length;
+    }
+  }
+
+  Check = &Chain[Length];
+  ZeroMem (Check, sizeof (TRACE_FILTER_CHECK));
+  Check->AddressMax = MAX_UINT64;
+  Check->Record = mTraceFilterDefault;
+  return Length + 1;
+}
+
+/**
+  FNV-1a hash of the chain.
+**/
+STATIC
+UINT32
+TraceFilterHashChain (
+  IN CONST TRACE_FILTER_CHECK  *Chain,
+  IN UINTN                     Length
+  )
+{
+  CONST UINT8  *Bytes;
+  UINTN        Index;
+  UINT32       Hash;
+
+  Bytes = (CONST UINT8 *) Chain;
+  Hash = 0x811C9DC5;
+  for (Index = 0; Index < Length * sizeof (TRACE_FILTER_CHECK); Index++) {
+    Hash = (Hash ^ Bytes[Index]) * 0x01000193;
+  }
+
+  return Hash;
+}
+
+/**
+  Inserts a chain into the hash without checking for duplicates.
+**/
+STATIC
+VOID
+TraceFilterHashInsert (
+  IN OUT TRACE_FILTER_HASH_ENTRY        *Hash,
+  IN     UINTN                          HashSize,
+  IN     CONST TRACE_FILTER_HASH_ENTRY  *Entry
+  )
+{
+  UINTN  Slot;
+
+  for (Slot = Entry->Hash & (HashSize - 1); Hash[Slot].Start != 0; Slot = (Slot + 1) & (HashSize - 1)) {
+  }
+  Hash[Slot] = *Entry;
+}
+
+/**
+  Grows the chain hash so it stays at most half full after one more insert.
+
+  @retval EFI_SUCCESS           Hash has room.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+STATIC
+EFI_STATUS
+TraceFilterHashReserve (
+  VOID
+  )
+{
+  TRACE_FILTER_HASH_ENTRY  *Hash;
+  UINTN                    HashSize;
+  UINTN                    Index;
+
+  if ((mTraceFilterHashCount + 1) * 2 <= mTraceFilterHashSize) {
+    return EFI_SUCCESS;
+  }
+
+  HashSize = MAX (mTraceFilterHashSize * 2, TRACE_FILTER_HASH_SIZE);
+  Hash = AllocateZeroPool (HashSize * sizeof (TRACE_FILTER_HASH_ENTRY));
+  if (Hash == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < mTraceFilterHashSize; Index++) {
+    if (mTraceFilterHash[Index].Start != 0) {
+      TraceFilterHashInsert (Hash, HashSize, &mTraceFilterHash[Index]);
+    }
+  }
+  if (mTraceFilterHash != NULL) {
+    FreePool (mTraceFilterHash);
+  }
+  mTraceFilterHash = Hash;
+  mTraceFilterHashSize = HashSize;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Finds chain in the check array or appends it. Appended checks are written
+  past mTraceFilterCheckCount so readers of published cells are unaffected.
+  A grown check array is published once filled.
+
+  @param[in]  Chain   Checks of the chain.
+  @param[in]  Length  Number of checks in the chain.
+  @param[out] Start   Index of the first check of the chain.
+
+  @retval EFI_SUCCESS           Chain found or appended.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+STATIC
+EFI_STATUS
+TraceFilterAddChain (
+  IN  CONST TRACE_FILTER_CHECK  *Chain,
+  IN  UINTN                     Length,
+  OUT UINTN                     *Start
+  )
+{
+  TRACE_FILTER_HASH_ENTRY  Entry;
+  TRACE_FILTER_CHECK       *Checks;
+  UINTN                    Capacity;
+  UINTN                    Slot;
+  EFI_STATUS               Status;
+
+  Entry.Hash = TraceFilterHashChain (Chain, Length);
+  Entry.Length = (UINT32) Length;
+  for (Slot = Entry.Hash & (mTraceFilterHashSize - 1);
+       mTraceFilterHashSize != 0 && mTraceFilterHash[Slot].Start != 0;
+       Slot = (Slot + 1) & (mTraceFilterHashSize - 1))
+  {
+    if (mTraceFilterHash[Slot].Hash == Entry.Hash && mTraceFilterHash[Slot].Length == Entry.Length &&
+        CompareMem (&mTraceFilterChecks[mTraceFilterHash[Slot].Start - 1], Chain, Length * sizeof (TRACE_FILTER_CHECK)) == 0)
+    {
+      *Start = mTraceFilterHash[Slot].Start - 1;
+      return EFI_SUCCESS;
+    }
+  }
+
+  Status = TraceFilterHashReserve ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (mTraceFilterCheckCount + Length > mTraceFilterCheckCapacity) {
+    Capacity = MAX (mTraceFilterCheckCapacity * 2, mTraceFilterCheckCount + Length);
+    Checks = AllocatePool (Capacity * sizeof (TRACE_FILTER_CHECK));
+    if (Checks == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    if (mTraceFilterChecks != NULL) {
+      CopyMem (Checks, mTraceFilterChecks, mTraceFilterCheckCount * sizeof (TRACE_FILTER_CHECK));
+    }
+    MemoryFence ();
+    TraceFilterRetire (mTraceFilterChecks);
+    mTraceFilterChecks = Checks;
+    mTraceFilterCheckCapacity = Capacity;
+  }
+
+  CopyMem (&mTraceFilterChecks[mTraceFilterCheckCount], Chain, Length * sizeof (TRACE_FILTER_CHECK));
+  Entry.Start = (UINT32)(mTraceFilterCheckCount + 1);
+  TraceFilterHashInsert (mTraceFilterHash, mTraceFilterHashSize, &Entry);
+  mTraceFilterHashCount++;
+  *Start = mTraceFilterCheckCount;
+  mTraceFilterCheckCount += Length;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessIoTraceFilterCompile (
+  VOID
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINT32                              Capacity;
+  UINT32                              *Table;
+  TRACE_FILTER_CHECK                  *Chain;
+  UINTN                               Length;
+  UINTN                               Start;
+  UINT32                              Region;
+  UINT32                              Type;
+  EFI_STATUS                          Status;
+
+  if (mTraceFilters == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Chain = AllocatePool ((mTraceFilterCount + 1) * sizeof (TRACE_FILTER_CHECK));
+  if (Chain == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Regions may be registered from several threads.
+  //
+  while (InterlockedCompareExchange32 (&mTraceFilterCompiling, 0, 1) != 0) {
+    CpuPause ();
+  }
+
+  Status = EFI_SUCCESS;
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  if (RegionCount > mTraceFilterRegionCapacity) {
+    Capacity = MAX (MAX (mTraceFilterRegionCapacity * 2, RegionCount), 16);
+    Table = AllocateZeroPool (Capacity * TRACE_FILTER_TYPE_COUNT * sizeof (UINT32));
+    if (Table == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Exit;
+    }
+    if (mTraceFilterTable != NULL) {
+      CopyMem (Table, mTraceFilterTable, mTraceFilterRegionCount * TRACE_FILTER_TYPE_COUNT * sizeof (UINT32));
+    }
+    MemoryFence ();
+    TraceFilterRetire (mTraceFilterTable);
+    mTraceFilterTable = Table;
+    mTraceFilterRegionCapacity = Capacity;
+  }
+
+  //
+  // Only cells of regions added since the last compilation are filled, cells
+  // already published stay valid as region ids are never reused.
+  //
+  Table = mTraceFilterTable;
+  for (Region = mTraceFilterRegionCount; Region < RegionCount; Region++) {
+    for (Type = 0; Type < RegisterAccessTraceTypeMax; Type++) {
+      Length = TraceFilterBuildChain (&Regions[Region], Type, Chain);
+      if (Length == 1 && Chain[0].AddressMin == 0 && Chain[0].AddressMax == MAX_UINT64 && Chain[0].ValueMask == 0) {
+        Table[(Region << TRACE_FILTER_TYPE_SHIFT) | Type] = Chain[0].Record ? TRACE_FILTER_RECORD : TRACE_FILTER_DROP;
+      } else {
+        Status = TraceFilterAddChain (Chain, Length, &Start);
+        if (EFI_ERROR (Status)) {
+          goto Exit;
+        }
+        Table[(Region << TRACE_FILTER_TYPE_SHIFT) | Type] = (UINT32)(TRACE_FILTER_CHAIN + Start);
+      }
+    }
+  }
+
+  //
+  // Publish cells and checks before the count which makes them visible.
+  //
+  MemoryFence ();
+  mTraceFilterRegionCount = RegionCount;
+  gRegisterAccessIoTraceFilterEnabled = TRUE;
+
+Exit:
+  mTraceFilterCompiling = 0;
+  FreePool (Chain);
+  return Status;
+}
+
+BOOLEAN
+RegisterAccessIoTraceFilterMatch (
+  IN UINT16                      Region,
+  IN REGISTER_ACCESS_TRACE_TYPE  Type,
+  IN UINT64                      Address,
+  IN UINT64                      Value
+  )
+{
+  CONST TRACE_FILTER_CHECK  *Check;
+  UINT32                    Cell;
+
+  //
+  // Count is read before the table, a table published later still holds
+  // every cell below the count.
+  //
+  if (Region >= mTraceFilterRegionCount || (UINT32) Type >= RegisterAccessTraceTypeMax) {
+    return mTraceFilterDefault;
+  }
+
+  MemoryFence ();
+  Cell = mTraceFilterTable[((UINT32) Region << TRACE_FILTER_TYPE_SHIFT) | Type];
+  if (Cell < TRACE_FILTER_CHAIN) {
+    return (BOOLEAN)(Cell == TRACE_FILTER_RECORD);
+  }
+
+  for (Check = &mTraceFilterChecks[Cell - TRACE_FILTER_CHAIN]; ; Check++) {
+    if (Address >= Check->AddressMin && Address <= Check->AddressMax && (Value & Check->ValueMask) == Check->ValueMatch) {
+      return Check->Record;
+    }
+  }
+}
+
+EFI_STATUS
+RegisterAccessIoTraceSetFilters (
+  IN CONST REGISTER_ACCESS_IO_TRACE_FILTER  *Filters OPTIONAL,
+  IN UINTN                                  FilterCount
+  )
+{
+  UINTN       Index;
+  EFI_STATUS  Status;
+
+  if (FilterCount != 0 && Filters == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Index = 0; Index < FilterCount; Index++) {
+    if (Filters[Index].Action > RegisterAccessIoTraceFilterDrop ||
+        (Filters[Index].MatchAddress && Filters[Index].AddressMin > Filters[Index].AddressMax) ||
+        (Filters[Index].ValueMatch & ~Filters[Index].ValueMask) != 0)
+    {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  TraceFilterFree ();
+  if (FilterCount == 0) {
+    return EFI_SUCCESS;
+  }
+
+  mTraceFilters = AllocateCopyPool (FilterCount * sizeof (REGISTER_ACCESS_IO_TRACE_FILTER), Filters);
+  if (mTraceFilters == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  mTraceFilterCount = FilterCount;
+
+  //
+  // Accesses not matched by any filter are recorded only if all filters drop.
+  //
+  mTraceFilterDefault = TRUE;
+  for (Index = 0; Index < FilterCount; Index++) {
+    if (Filters[Index].Action == RegisterAccessIoTraceFilterRecord) {
+      mTraceFilterDefault = FALSE;
+    }
+    if (Filters[Index].RegionName != NULL) {
+      mTraceFilters[Index].RegionName = AllocateCopyPool (AsciiStrSize (Filters[Index].RegionName), Filters[Index].RegionName);
+      if (mTraceFilters[Index].RegionName == NULL) {
+        //
+        // Don't free caller's strings on cleanup.
+        //
+        for ( ; Index < FilterCount; Index++) {
+          mTraceFilters[Index].RegionName = NULL;
+        }
+        TraceFilterFree ();
+        return EFI_OUT_OF_RESOURCES;
+      }
+    }
+  }
+
+  Status = RegisterAccessIoTraceFilterCompile ();
+  if (EFI_ERROR (Status)) {
+    TraceFilterFree ();
+  }
+
+  return Status;
+}
\ No newline at end of file
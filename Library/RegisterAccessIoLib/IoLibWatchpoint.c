@@ -0,0 +1,349 @@
+/** @file
+  Watchpoints on register addresses.
+
+  Every address space has a bitmap with a bit per 4KB page hashed by the page
+  number. Bit is set for every page touched by a watchpoint, so an access to
+  an unwatched address costs a single bit test. Accesses to pages with the bit
+  set, including pages aliasing with the watched ones, are matched against the
+  watchpoint table.
+
+  Watchpoints are changed while other threads access registers, so accessing
+  threads never see a table being modified. Every change builds a new table,
+  publishes it and keeps the old one for the lifetime of the process as
+  readers may still walk it. Bits of
+  the new table are set in the bitmap before it is published and bits only
+  the old table needed are cleared after, so a page watched by both is never
+  missed.
+
+  Reads are reported after the value was read since the value isn't known
+  before. Writes are reported before the register space sees them so that the
+  callback observes the device state the write is about to change.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+//
+// Accesses are at most 8 bytes wide so an access starting up to 7 bytes below
+// the watched range can still overlap it.
+//
+#define WATCHPOINT_MAX_ACCESS_SIZE  8
+
+typedef struct {
+  BOOLEAN                        InUse;
+  REGISTER_ACCESS_IO_WATCHPOINT  Watchpoint;
+} REGISTER_ACCESS_IO_WATCHPOINT_ENTRY;
+
+typedef struct _REGISTER_ACCESS_IO_WATCHPOINT_TABLE REGISTER_ACCESS_IO_WATCHPOINT_TABLE;
+
+struct _REGISTER_ACCESS_IO_WATCHPOINT_TABLE {
+  //
+  // Links tables replaced by newer ones.
+  //
+  REGISTER_ACCESS_IO_WATCHPOINT_TABLE  *Retired;
+  REGISTER_ACCESS_IO_WATCHPOINT_ENTRY  Watchpoints[REGISTER_ACCESS_IO_MAX_WATCHPOINTS];
+};
+
+BOOLEAN  gRegisterAccessIoWatchpointEnabled = FALSE;
+UINT8    gRegisterAccessIoWatchpointPages[REGISTER_ACCESS_IO_WATCHPOINT_ADDRESS_SPACES][REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BITMAP_SIZE];
+
+STATIC REGISTER_ACCESS_IO_WATCHPOINT_TABLE *volatile  mWatchpointTable = NULL;
+
+//
+// Owned by the thread changing watchpoints.
+//
+STATIC volatile UINT32                       mWatchpointLock = 0;
+STATIC REGISTER_ACCESS_IO_WATCHPOINT_TABLE  *mWatchpointRetired = NULL;
+STATIC UINT8                                mWatchpointPages[REGISTER_ACCESS_IO_WATCHPOINT_ADDRESS_SPACES][REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BITMAP_SIZE];
+
+//
+// Set while a watchpoint callback runs so that register accesses done by the
+// callback itself don't trigger watchpoints.
+//
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL BOOLEAN  mWatchpointInCallback = FALSE;
+
+STATIC
+VOID
+WatchpointLock (
+  VOID
+  )
+{
+  while (InterlockedCompareExchange32 (&mWatchpointLock, 0, 1) != 0) {
+    CpuPause ();
+  }
+}
+
+STATIC
+VOID
+WatchpointUnlock (
+  VOID
+  )
+{
+  MemoryFence ();
+  mWatchpointLock = 0;
+}
+
+/**
+  Builds page bitmaps of the table into mWatchpointPages.
+
+  @param[in] Table  Watchpoint table.
+
+  @retval TRUE   Table holds at least one watchpoint.
+  @retval FALSE  Table is empty.
+**/
+STATIC
+BOOLEAN
+WatchpointBuildPages (
+  IN CONST REGISTER_ACCESS_IO_WATCHPOINT_TABLE  *Table
+  )
+{
+  CONST REGISTER_ACCESS_IO_WATCHPOINT  *Watchpoint;
+  UINT64                               Page;
+  UINT64                               FirstPage;
+  UINT64                               LastPage;
+  UINTN                                Index;
+  UINTN                                Bit;
+  BOOLEAN                              Armed;
+
+  ZeroMem (mWatchpointPages, sizeof (mWatchpointPages));
+  Armed = FALSE;
+  for (Index = 0; Index < REGISTER_ACCESS_IO_MAX_WATCHPOINTS; Index++) {
+    if (!Table->Watchpoints[Index].InUse) {
+      continue;
+    }
+    Watchpoint = &Table->Watchpoints[Index].Watchpoint;
+    FirstPage = RShiftU64 (
+                  (Watchpoint->AddressMin >= WATCHPOINT_MAX_ACCESS_SIZE - 1) ? Watchpoint->AddressMin - (WATCHPOINT_MAX_ACCESS_SIZE - 1) : 0,
+                  REGISTER_ACCESS_IO_WATCHPOINT_PAGE_SHIFT
+                  );
+    LastPage = RShiftU64 (Watchpoint->AddressMax, REGISTER_ACCESS_IO_WATCHPOINT_PAGE_SHIFT);
+    //
+    // Once the range wraps around the bitmap every bit is set anyway.
+    //
+    if (LastPage - FirstPage >= REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BITMAP_SIZE * 8) {
+      LastPage = FirstPage + REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BITMAP_SIZE * 8 - 1;
+    }
+    for (Page = FirstPage; Page <= LastPage; Page++) {
+      Bit = (UINTN) Page & (REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BITMAP_SIZE * 8 - 1);
+      mWatchpointPages[Watchpoint->Type][Bit / 8] |= (UINT8) (1 << (Bit % 8));
+    }
+    Armed = TRUE;
+  }
+
+  return Armed;
+}
+
+/**
+  Publishes new watchpoint table and retires the current one. Caller holds
+  the watchpoint lock.
+
+  @param[in] Table  Table to publish.
+**/
+STATIC
+VOID
+WatchpointPublish (
+  IN REGISTER_ACCESS_IO_WATCHPOINT_TABLE  *Table
+  )
+{
+  UINTN    Space;
+  UINTN    Index;
+  BOOLEAN  Armed;
+
+  Armed = WatchpointBuildPages (Table);
+
+  //
+  // Pages of the new table are watched before anyone can see the table.
+  //
+  for (Space = 0; Space < REGISTER_ACCESS_IO_WATCHPOINT_ADDRESS_SPACES; Space++) {
+    for (Index = 0; Index < REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BITMAP_SIZE; Index++) {
+      gRegisterAccessIoWatchpointPages[Space][Index] |= mWatchpointPages[Space][Index];
+    }
+  }
+  MemoryFence ();
+  if (mWatchpointTable != NULL) {
+    mWatchpointTable->Retired = mWatchpointRetired;
+    mWatchpointRetired = mWatchpointTable;
+  }
+  mWatchpointTable = Table;
+  gRegisterAccessIoWatchpointEnabled = Armed;
+
+  //
+  // Only bits needed by the old table alone are cleared.
+  //
+  MemoryFence ();
+  CopyMem (gRegisterAccessIoWatchpointPages, mWatchpointPages, sizeof (gRegisterAccessIoWatchpointPages));
+}
+
+/**
+  Allocates a copy of the current watchpoint table. Caller holds the
+  watchpoint lock.
+
+  @return Copy of the table or NULL if out of resources.
+**/
+STATIC
+REGISTER_ACCESS_IO_WATCHPOINT_TABLE*
+WatchpointCopyTable (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_WATCHPOINT_TABLE  *Table;
+
+  Table = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_WATCHPOINT_TABLE));
+  if (Table != NULL && mWatchpointTable != NULL) {
+    CopyMem (Table->Watchpoints, mWatchpointTable->Watchpoints, sizeof (Table->Watchpoints));
+  }
+
+  return Table;
+}
+
+EFI_STATUS
+RegisterAccessIoWatchpointAdd (
+  IN  CONST REGISTER_ACCESS_IO_WATCHPOINT  *Watchpoint,
+  OUT UINTN                                *Id
+  )
+{
+  REGISTER_ACCESS_IO_WATCHPOINT_TABLE  *Table;
+  UINTN                                Index;
+
+  if (Watchpoint == NULL || Id == NULL || Watchpoint->AddressMin > Watchpoint->AddressMax ||
+      (UINTN) Watchpoint->Type >= REGISTER_ACCESS_IO_WATCHPOINT_ADDRESS_SPACES ||
+      (Watchpoint->Access & (REGISTER_ACCESS_IO_WATCH_READ | REGISTER_ACCESS_IO_WATCH_WRITE)) == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  WatchpointLock ();
+  Table = WatchpointCopyTable ();
+  if (Table == NULL) {
+    WatchpointUnlock ();
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < REGISTER_ACCESS_IO_MAX_WATCHPOINTS; Index++) {
+    if (!Table->Watchpoints[Index].InUse) {
+      CopyMem (&Table->Watchpoints[Index].Watchpoint, Watchpoint, sizeof (REGISTER_ACCESS_IO_WATCHPOINT));
+      Table->Watchpoints[Index].InUse = TRUE;
+      WatchpointPublish (Table);
+      WatchpointUnlock ();
+      *Id = Index;
+      return EFI_SUCCESS;
+    }
+  }
+
+  WatchpointUnlock ();
+  FreePool (Table);
+  return EFI_OUT_OF_RESOURCES;
+}
+
+EFI_STATUS
+RegisterAccessIoWatchpointRemove (
+  IN UINTN  Id
+  )
+{
+  REGISTER_ACCESS_IO_WATCHPOINT_TABLE  *Table;
+
+  WatchpointLock ();
+  if (Id >= REGISTER_ACCESS_IO_MAX_WATCHPOINTS || mWatchpointTable == NULL || !mWatchpointTable->Watchpoints[Id].InUse) {
+    WatchpointUnlock ();
+    return EFI_NOT_FOUND;
+  }
+
+  Table = WatchpointCopyTable ();
+  if (Table == NULL) {
+    WatchpointUnlock ();
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Table->Watchpoints[Id].InUse = FALSE;
+  WatchpointPublish (Table);
+  WatchpointUnlock ();
+
+  return EFI_SUCCESS;
+}
+
+VOID
+RegisterAccessIoWatchpointRemoveAll (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_WATCHPOINT_TABLE  *Table;
+
+  WatchpointLock ();
+  if (mWatchpointTable != NULL) {
+    Table = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_WATCHPOINT_TABLE));
+    if (Table != NULL) {
+      WatchpointPublish (Table);
+    } else {
+      //
+      // Table can't be replaced, stop matching accesses until the next change
+      // of watchpoints so that none of them fires again.
+      //
+      gRegisterAccessIoWatchpointEnabled = FALSE;
+    }
+  }
+  WatchpointUnlock ();
+}
+
+VOID
+RegisterAccessIoWatchpointCheck (
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN UINT32                          Size,
+  IN UINT64                          Value,
+  IN BOOLEAN                         IsWrite
+  )
+{
+  CONST REGISTER_ACCESS_IO_WATCHPOINT_TABLE  *Table;
+  CONST REGISTER_ACCESS_IO_WATCHPOINT        *Watchpoint;
+  UINT64                                     LastAddress;
+  UINTN                                      Index;
+
+  if (mWatchpointInCallback) {
+    return;
+  }
+
+  Table = mWatchpointTable;
+  if (Table == NULL) {
+    return;
+  }
+
+  LastAddress = Address + MAX (Size, 1) - 1;
+  for (Index = 0; Index < REGISTER_ACCESS_IO_MAX_WATCHPOINTS; Index++) {
+    if (!Table->Watchpoints[Index].InUse) {
+      continue;
+    }
+    Watchpoint = &Table->Watchpoints[Index].Watchpoint;
+    if (Watchpoint->Type != Type ||
+        (Watchpoint->Access & (IsWrite ? REGISTER_ACCESS_IO_WATCH_WRITE : REGISTER_ACCESS_IO_WATCH_READ)) == 0 ||
+        LastAddress < Watchpoint->AddressMin || Address > Watchpoint->AddressMax ||
+        (Value & Watchpoint->ValueMask) != Watchpoint->ValueMatch) {
+      continue;
+    }
+
+    DEBUG ((
+      DEBUG_INFO,
+      "Watchpoint %u hit: %a %a 0x%LX size %u value 0x%LX\n",
+      (UINT32) Index,
+      (Type == RegisterAccessIoTypeIo) ? "IO" : "MMIO",
+      IsWrite ? "write" : "read",
+      Address,
+      Size,
+      Value
+      ));
+    if (Watchpoint->Callback == NULL) {
+      CpuBreakpoint ();
+      continue;
+    }
+    mWatchpointInCallback = TRUE;
+    Watchpoint->Callback (Watchpoint->Context, Index, Type, Address, Size, Value, IsWrite);
+    mWatchpointInCallback = FALSE;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,362 @@
+/** @file
+  Write combining support for regions registered in RegisterAccessIoLib.
+
+  Writes to a region with write combining enabled are buffered in a line
+  sized buffer and forwarded to the register space as a single block write
+  when the line is complete, when a non-contiguous write arrives, on any read,
+  on access to a different region or on explicit flush.
+
+  Every thread buffers into a line of its own, same as every CPU has its own
+  write combining buffers.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include <stdlib.h>
+
+#include "RegisterAccessIoLibInternal.h"
+
+typedef struct _REGISTER_ACCESS_IO_WRITE_COMBINE_STATE REGISTER_ACCESS_IO_WRITE_COMBINE_STATE;
+
+struct _REGISTER_ACCESS_IO_WRITE_COMBINE_STATE {
+  REGISTER_ACCESS_IO_WRITE_COMBINE_STATE   *Next;
+  //
+  // Taken by the owning thread and by threads flushing the line when a region
+  // leaves write combining mode.
+  //
+  SPIN_LOCK                                Lock;
+  //
+  // Only one region can hold buffered data of a thread at any time. Access to
+  // any other region flushes it which keeps ordering between regions intact.
+  //
+  REGISTER_ACCESS_IO_MEMORY_MAP            *Pending;
+  REGISTER_ACCESS_IO_WRITE_COMBINE_BUFFER  Buffer;
+};
+
+//
+// States are linked into a global list when the thread issues its first
+// combined write so that a region leaving write combining mode can flush the
+// data every thread buffered for it.
+//
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL REGISTER_ACCESS_IO_WRITE_COMBINE_STATE  *mWriteCombineState = NULL;
+STATIC REGISTER_ACCESS_IO_WRITE_COMBINE_STATE  *volatile mWriteCombineStateList = NULL;
+STATIC volatile UINT32                          mWriteCombineExitHandlerRegistered = 0;
+
+/**
+  Frees the write combining state of every thread at process exit.
+
+  States can't be freed when a region leaves write combining mode since the
+  owning threads keep using them for any other region.
+**/
+STATIC
+VOID
+WriteCombineExitHandler (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_WRITE_COMBINE_STATE  *State;
+  REGISTER_ACCESS_IO_WRITE_COMBINE_STATE  *Next;
+
+  State = mWriteCombineStateList;
+  mWriteCombineStateList = NULL;
+  mWriteCombineState     = NULL;
+  while (State != NULL) {
+    Next = State->Next;
+    FreePool (State);
+    State = Next;
+  }
+}
+
+STATIC
+REGISTER_ACCESS_IO_WRITE_COMBINE_STATE*
+WriteCombineAllocateState (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_WRITE_COMBINE_STATE  *State;
+  REGISTER_ACCESS_IO_WRITE_COMBINE_STATE  *Head;
+
+  if (InterlockedCompareExchange32 ((UINT32 *) &mWriteCombineExitHandlerRegistered, 0, 1) == 0) {
+    if (atexit (WriteCombineExitHandler) != 0) {
+      //
+      // States would leak at exit, which only matters to leak checkers.
+      //
+      DEBUG ((DEBUG_WARN, "%a: Failed to register exit handler\n", __func__));
+    }
+  }
+
+  State = RegisterAccessIoAllocateState (sizeof (REGISTER_ACCESS_IO_WRITE_COMBINE_STATE));
+  if (State == NULL) {
+    return NULL;
+  }
+  InitializeSpinLock (&State->Lock);
+
+  do {
+    Head = mWriteCombineStateList;
+    State->Next = Head;
+  } while (InterlockedCompareExchangePointer ((VOID *volatile *) &mWriteCombineStateList, Head, State) != Head);
+
+  return State;
+}
+
+STATIC
+UINT32
+WriteCombineChunkSize (
+  IN UINT64  Offset,
+  IN UINT32  Length
+  )
+{
+  UINT32  ChunkSize;
+
+  ChunkSize = 8;
+  while (ChunkSize > 1 && ((Offset % ChunkSize) != 0 || ChunkSize > Length)) {
+    ChunkSize = ChunkSize >> 1;
+  }
+
+  return ChunkSize;
+}
+
+/**
+  Forwards the buffered line to the region holding it under the region lock.
+  Caller holds the lock of the state.
+
+  @param[in] State  Write combining state of a thread.
+
+  @retval EFI_SUCCESS  Line forwarded or nothing was buffered.
+  @retval Others       First error returned by the register space. Rest of the
+                       line is still forwarded.
+**/
+STATIC
+EFI_STATUS
+WriteCombineFlushState (
+  IN REGISTER_ACCESS_IO_WRITE_COMBINE_STATE  *State
+  )
+{
+  REGISTER_ACCESS_IO_WRITE_COMBINE_BUFFER  *Buffer;
+  REGISTER_ACCESS_IO_MEMORY_MAP            *MapEntry;
+  REGISTER_ACCESS_INTERFACE                *RegisterAccess;
+  UINT32                                   Position;
+  UINT32                                   ChunkSize;
+  UINT64                                   Value;
+  UINT64                                   Start;
+  EFI_STATUS                               Status;
+  EFI_STATUS                               WriteStatus;
+
+  MapEntry = State->Pending;
+  Buffer = &State->Buffer;
+  State->Pending = NULL;
+  if (MapEntry == NULL || Buffer->Length == 0) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Whole line is forwarded as a single register space transaction.
+  //
+  REGISTER_ACCESS_IO_LOCK (&MapEntry->Lock);
+  Start = REGISTER_ACCESS_IO_CALL_START ();
+  RegisterAccess = MapEntry->RegisterAccess;
+  if (RegisterAccess->WriteBlock != NULL) {
+    Status = RegisterAccess->WriteBlock (RegisterAccess, Buffer->Offset, Buffer->Length, Buffer->Data);
+  } else {
+    Status = EFI_SUCCESS;
+    Position = 0;
+    while (Position < Buffer->Length) {
+      ChunkSize = WriteCombineChunkSize (Buffer->Offset + Position, Buffer->Length - Position);
+      Value = 0;
+      CopyMem (&Value, &Buffer->Data[Position], ChunkSize);
+      WriteStatus = RegisterAccess->Write (RegisterAccess, Buffer->Offset + Position, ChunkSize, Value);
+      if (EFI_ERROR (WriteStatus) && !EFI_ERROR (Status)) {
+        Status = WriteStatus;
+      }
+      Position += ChunkSize;
+    }
+  }
+  REGISTER_ACCESS_IO_CALL_END (MapEntry->TraceRegion, Start);
+  REGISTER_ACCESS_IO_UNLOCK (&MapEntry->Lock);
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((
+      DEBUG_ERROR,
+      "%s: write combined line at 0x%LX length %u failed %r\n",
+      MapEntry->RegisterAccess->Name,
+      Buffer->Offset,
+      Buffer->Length,
+      Status
+      ));
+  }
+  Buffer->Length = 0;
+
+  return Status;
+}
+
+EFI_STATUS
+RegisterAccessIoWriteCombineFlushPending (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_WRITE_COMBINE_STATE  *State;
+  EFI_STATUS                              Status;
+
+  Status = EFI_SUCCESS;
+  State = mWriteCombineState;
+  if (State != NULL && State->Pending != NULL) {
+    REGISTER_ACCESS_IO_LOCK (&State->Lock);
+    Status = WriteCombineFlushState (State);
+    REGISTER_ACCESS_IO_UNLOCK (&State->Lock);
+  }
+
+  return Status;
+}
+
+EFI_STATUS
+RegisterAccessIoWriteCombine (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry,
+  IN UINT64                         Offset,
+  IN UINT32                         Size,
+  IN UINT64                         Value
+  )
+{
+  REGISTER_ACCESS_IO_WRITE_COMBINE_STATE   *State;
+  REGISTER_ACCESS_IO_WRITE_COMBINE_BUFFER  *Buffer;
+  UINT64                                   LineOffset;
+  UINT64                                   Start;
+  EFI_STATUS                               Status;
+  EFI_STATUS                               FlushStatus;
+
+  State = mWriteCombineState;
+  if (State == NULL) {
+    State = WriteCombineAllocateState ();
+    if (State == NULL) {
+      //
+      // Write goes straight to the register space, which is still correct,
+      // only not combined.
+      //
+      return EFI_ABORTED;
+    }
+    mWriteCombineState = State;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&State->Lock);
+  //
+  // Region left write combining mode after the caller checked it. Its
+  // buffered data may already be flushed, so this write must not be buffered.
+  //
+  if (!MapEntry->WriteCombine) {
+    REGISTER_ACCESS_IO_UNLOCK (&State->Lock);
+    return EFI_ABORTED;
+  }
+
+  //
+  // Errors of previously buffered writes are reported by the write which
+  // forwards them, there is no one else left to report them to.
+  //
+  FlushStatus = EFI_SUCCESS;
+  Buffer = &State->Buffer;
+  LineOffset = Offset % REGISTER_ACCESS_IO_WRITE_COMBINE_LINE_SIZE;
+  if (State->Pending != NULL) {
+    if (State->Pending != MapEntry ||
+        Offset != Buffer->Offset + Buffer->Length ||
+        LineOffset + Size > REGISTER_ACCESS_IO_WRITE_COMBINE_LINE_SIZE) {
+      FlushStatus = WriteCombineFlushState (State);
+    }
+  }
+
+  //
+  // Write crossing the line boundary can't be combined, forward it as is.
+  //
+  if (LineOffset + Size > REGISTER_ACCESS_IO_WRITE_COMBINE_LINE_SIZE) {
+    REGISTER_ACCESS_IO_LOCK (&MapEntry->Lock);
+    Start = REGISTER_ACCESS_IO_CALL_START ();
+    Status = MapEntry->RegisterAccess->Write (MapEntry->RegisterAccess, Offset, Size, Value);
+    REGISTER_ACCESS_IO_CALL_END (MapEntry->TraceRegion, Start);
+    REGISTER_ACCESS_IO_UNLOCK (&MapEntry->Lock);
+    REGISTER_ACCESS_IO_UNLOCK (&State->Lock);
+    return EFI_ERROR (FlushStatus) ? FlushStatus : Status;
+  }
+
+  if (Buffer->Length == 0) {
+    Buffer->Offset = Offset;
+  }
+  CopyMem (&Buffer->Data[Buffer->Length], &Value, Size);
+  Buffer->Length += Size;
+  State->Pending = MapEntry;
+
+  Status = EFI_SUCCESS;
+  if (LineOffset + Size == REGISTER_ACCESS_IO_WRITE_COMBINE_LINE_SIZE) {
+    Status = WriteCombineFlushState (State);
+  }
+  REGISTER_ACCESS_IO_UNLOCK (&State->Lock);
+
+  return EFI_ERROR (FlushStatus) ? FlushStatus : Status;
+}
+
+VOID
+RegisterAccessIoWriteCombineUnregister (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry
+  )
+{
+  REGISTER_ACCESS_IO_WRITE_COMBINE_STATE  *State;
+
+  if (!MapEntry->WriteCombine) {
+    return;
+  }
+
+  REGISTER_ACCESS_IO_LOCK (&MapEntry->Lock);
+  MapEntry->WriteCombine = FALSE;
+  REGISTER_ACCESS_IO_UNLOCK (&MapEntry->Lock);
+
+  for (State = mWriteCombineStateList; State != NULL; State = State->Next) {
+    REGISTER_ACCESS_IO_LOCK (&State->Lock);
+    if (State->Pending == MapEntry) {
+      WriteCombineFlushState (State);
+    }
+    REGISTER_ACCESS_IO_UNLOCK (&State->Lock);
+  }
+}
+
+EFI_STATUS
+RegisterAccessIoSetWriteCombining (
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN BOOLEAN                         Enable
+  )
+{
+  REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
+  UINT64                         Offset;
+
+  if (Type != RegisterAccessIoTypeMmio) {
+    return EFI_UNSUPPORTED;
+  }
+
+  MapEntry = RegisterAccessIoGetMapEntry (Address, Type, &Offset);
+  if (MapEntry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (Enable) {
+    REGISTER_ACCESS_IO_LOCK (&MapEntry->Lock);
+    MapEntry->WriteCombine = TRUE;
+    REGISTER_ACCESS_IO_UNLOCK (&MapEntry->Lock);
+  } else {
+    RegisterAccessIoWriteCombineUnregister (MapEntry);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessIoFlushWriteCombining (
+  VOID
+  )
+{
+  return RegisterAccessIoWriteCombineFlushPending ();
+}
\ No newline at end of file
@@ -11,46 +11,174 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
 #include <Library/GmockIoLib.hpp>
 
 #include "FakeNameDecorator.h"
+#include "RegisterAccessIoLibInternal.h"
 
-typedef struct {
-  UINT64               Address;
-  UINT64               Size;
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  LIST_ENTRY           Link;
-} REGISTER_ACCESS_IO_MEMORY_MAP;
+//
+// Context of threads which didn't select any. Keeps tests simulating a single
+// platform working without any setup.
+//
+STATIC REGISTER_ACCESS_IO_SIM_CONTEXT  mDefaultSimContext = { NULL, NULL, { { FALSE, NULL, 0 } }, SPIN_LOCK_RELEASED, NULL, NULL, NULL };
+STATIC REGISTER_ACCESS_IO_THREAD_LOCAL REGISTER_ACCESS_IO_SIM_CONTEXT  *mSimContext = NULL;
 
-REGISTER_ACCESS_IO_MEMORY_MAP  *mIoMap = NULL;
-REGISTER_ACCESS_IO_MEMORY_MAP  *mMemMap = NULL;
+BOOLEAN  gRegisterAccessIoThreadSafe = FALSE;
+UINT32   gRegisterAccessIoFailStateAllocations = 0;
 
-REGISTER_ACCESS_INTERFACE*
-RegisterAccessIoGetRegisterSpace (
-  IN UINT64               Address,
+VOID*
+RegisterAccessIoAllocateState (
+  IN UINTN  Size
+  )
+{
+  UINT32  Remaining;
+
+  do {
+    Remaining = gRegisterAccessIoFailStateAllocations;
+    if (Remaining == 0) {
+      return AllocateZeroPool (Size);
+    }
+  } while (InterlockedCompareExchange32 (&gRegisterAccessIoFailStateAllocations, Remaining, Remaining - 1) != Remaining);
+
+  return NULL;
+}
+
+VOID
+RegisterAccessIoSetThreadSafe (
+  IN BOOLEAN  Enable
+  )
+{
+  gRegisterAccessIoThreadSafe = Enable;
+}
+
+REGISTER_ACCESS_IO_SIM_CONTEXT*
+RegisterAccessIoSimContextGetCurrent (
+  VOID
+  )
+{
+  return (mSimContext != NULL) ? mSimContext : &mDefaultSimContext;
+}
+
+REGISTER_ACCESS_IO_SIM_CONTEXT*
+RegisterAccessIoSimContextSelect (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context OPTIONAL
+  )
+{
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *Previous;
+
+  //
+  // Writes buffered by this thread belong to the regions of the context
+  // being left.
+  //
+  RegisterAccessIoMemoryFence ();
+
+  Previous = mSimContext;
+  mSimContext = Context;
+  return Previous;
+}
+
+EFI_STATUS
+RegisterAccessIoSimContextCreate (
+  OUT REGISTER_ACCESS_IO_SIM_CONTEXT  **Context
+  )
+{
+  if (Context == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Context = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_SIM_CONTEXT));
+  if (*Context == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  InitializeSpinLock (&(*Context)->DmaMappingLock);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Frees all regions of the map and the map itself.
+**/
+STATIC
+VOID
+RegisterAccessIoFreeMap (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MemoryMap
+  )
+{
+  LIST_ENTRY                     *Entry;
+  LIST_ENTRY                     *Next;
+  REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
+
+  if (MemoryMap == NULL) {
+    return;
+  }
+
+  BASE_LIST_FOR_EACH_SAFE (Entry, Next, &MemoryMap->Link) {
+    MapEntry = BASE_CR (Entry, REGISTER_ACCESS_IO_MEMORY_MAP, Link);
+    RegisterAccessIoPostedWriteUnregister (MapEntry);
+    RegisterAccessIoWriteCombineUnregister (MapEntry);
+    RemoveEntryList (Entry);
+    FreePool (MapEntry);
+  }
+  FreePool (MemoryMap);
+}
+
+EFI_STATUS
+RegisterAccessIoSimContextDestroy (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  )
+{
+  if (Context == NULL || Context == &mDefaultSimContext) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mSimContext == Context) {
+    RegisterAccessIoSimContextSelect (NULL);
+  }
+
+  RegisterAccessIoFreeMap ((REGISTER_ACCESS_IO_MEMORY_MAP*) Context->IoMap);
+  RegisterAccessIoFreeMap ((REGISTER_ACCESS_IO_MEMORY_MAP*) Context->MemMap);
+  RegisterAccessIoSimTimeFree (Context);
+  RegisterAccessIoInterruptFree (Context);
+  FreePool (Context);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns map of the address space in the context selected by the calling thread.
+**/
+STATIC
+REGISTER_ACCESS_IO_MEMORY_MAP**
+RegisterAccessIoGetMap (
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  MemoryType
+  )
+{
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *Context;
+
+  Context = RegisterAccessIoSimContextGetCurrent ();
+  if (MemoryType == RegisterAccessIoTypeIo) {
+    return (REGISTER_ACCESS_IO_MEMORY_MAP**) &Context->IoMap;
+  }
+
+  return (REGISTER_ACCESS_IO_MEMORY_MAP**) &Context->MemMap;
+}
+
+REGISTER_ACCESS_IO_MEMORY_MAP*
+RegisterAccessIoGetMapEntry (
+  IN UINT64                          Address,
   IN REGISTER_ACCESS_IO_MEMORY_TYPE  MemoryType,
-  OUT UINT64              *Offset
-)
+  OUT UINT64                         *Offset
+  )
 {
   REGISTER_ACCESS_IO_MEMORY_MAP  *MemoryMap;
   LIST_ENTRY  *Entry;
   LIST_ENTRY  *Next;
   REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
 
-  switch (MemoryType) {
-    case RegisterAccessIoTypeIo:
-      if (mIoMap == NULL) {
-        return NULL;
-      }
-      MemoryMap = mIoMap;
-      break;
-    case RegisterAccessIoTypeMmio:
-    default:
-      if (mMemMap == NULL) {
-        return NULL;
-      }
-      MemoryMap = mMemMap;
-      break;
+  MemoryMap = *RegisterAccessIoGetMap (MemoryType);
+  if (MemoryMap == NULL) {
+    return NULL;
   }
 
   BASE_LIST_FOR_EACH_SAFE (Entry, Next, &MemoryMap->Link) {
@@ -58,13 +186,209 @@ RegisterAccessIoGetRegisterSpace (
     if (Address >= MapEntry->Address &&
         Address < MapEntry->Address + MapEntry->Size) {
       *Offset = Address - MapEntry->Address;
-      return MapEntry->RegisterAccess;
+      return MapEntry;
     }
   }
 
   return NULL;
 }
 
+REGISTER_ACCESS_INTERFACE*
+RegisterAccessIoGetRegisterSpace (
+  IN UINT64               Address,
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  MemoryType,
+  OUT UINT64              *Offset
+)
+{
+  REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
+
+  MapEntry = RegisterAccessIoGetMapEntry (Address, MemoryType, Offset);
+  if (MapEntry == NULL) {
+    return NULL;
+  }
+
+  return MapEntry->RegisterAccess;
+}
+
+EFI_STATUS
+RegisterAccessIoGetTraceRegion (
+  IN  REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN  UINT64                          Address,
+  OUT UINT16                          *TraceRegion
+  )
+{
+  REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
+  UINT64                         Offset;
+
+  if (TraceRegion == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  MapEntry = RegisterAccessIoGetMapEntry (Address, Type, &Offset);
+  if (MapEntry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  *TraceRegion = MapEntry->TraceRegion;
+  return EFI_SUCCESS;
+}
+
+STATIC
+UINT64
+RegisterAccessIoRead (
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN UINT32                          Size,
+  IN VOID                            *CallSite
+  )
+{
+  REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
+  UINT64                         Offset;
+  UINT64                         Value;
+  UINT64                         Start;
+  UINT32                         Duration;
+
+  REGISTER_ACCESS_IO_SIM_TIME_ACCESS ();
+
+  //
+  // Reads are never combined and push out any buffered writes so that
+  // driver observes the effects of its earlier writes.
+  //
+  RegisterAccessIoWriteCombineFlushPending ();
+
+  MapEntry = RegisterAccessIoGetMapEntry (Address, Type, &Offset);
+  if (MapEntry == NULL) {
+    Value = MAX_UINT64;
+    REGISTER_ACCESS_IO_HOT_ACCESS (REGISTER_ACCESS_TRACE_REGION_UNMAPPED, Address, Size, FALSE);
+    REGISTER_ACCESS_IO_CALL_SITE_COUNT (CallSite, REGISTER_ACCESS_TRACE_REGION_UNMAPPED, Address, FALSE);
+    REGISTER_ACCESS_IO_STATS_COUNT (REGISTER_ACCESS_TRACE_REGION_UNMAPPED, Address, Size, FALSE);
+    REGISTER_ACCESS_IO_COVERAGE (REGISTER_ACCESS_TRACE_REGION_UNMAPPED, Address, Size, FALSE);
+    REGISTER_ACCESS_IO_STATS_MAP_MISS (REGISTER_ACCESS_TRACE_REGION_UNMAPPED);
+    REGISTER_ACCESS_IO_TRACE (
+      (Type == RegisterAccessIoTypeIo) ? RegisterAccessTraceIoRead : RegisterAccessTraceMmioRead,
+      REGISTER_ACCESS_TRACE_REGION_UNMAPPED,
+      Address,
+      (UINT8) Size,
+      Value,
+      0
+      );
+    REGISTER_ACCESS_IO_WATCHPOINT (Type, Address, Size, Value, FALSE);
+    return Value;
+  }
+
+  REGISTER_ACCESS_IO_POSTED_WRITE_DRAIN (MapEntry);
+  REGISTER_ACCESS_IO_LOCK (&MapEntry->Lock);
+  Start = REGISTER_ACCESS_IO_CALL_START ();
+  MapEntry->RegisterAccess->Read (MapEntry->RegisterAccess, Offset, Size, &Value);
+  Duration = REGISTER_ACCESS_IO_CALL_END (MapEntry->TraceRegion, Start);
+  REGISTER_ACCESS_IO_UNLOCK (&MapEntry->Lock);
+  REGISTER_ACCESS_IO_HOT_ACCESS (MapEntry->TraceRegion, Offset, Size, FALSE);
+  REGISTER_ACCESS_IO_CALL_SITE_COUNT (CallSite, MapEntry->TraceRegion, Offset, FALSE);
+  REGISTER_ACCESS_IO_STATS_COUNT (MapEntry->TraceRegion, Offset, Size, FALSE);
+  REGISTER_ACCESS_IO_COVERAGE (MapEntry->TraceRegion, Offset, Size, FALSE);
+  REGISTER_ACCESS_IO_TRACE (
+    (Type == RegisterAccessIoTypeIo) ? RegisterAccessTraceIoRead : RegisterAccessTraceMmioRead,
+    MapEntry->TraceRegion,
+    Address,
+    (UINT8) Size,
+    Value,
+    Duration
+    );
+  REGISTER_ACCESS_IO_WATCHPOINT (Type, Address, Size, Value, FALSE);
+  return Value;
+}
+
+STATIC
+EFI_STATUS
+RegisterAccessIoWrite (
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN UINT32                          Size,
+  IN UINT64                          Value,
+  IN VOID                            *CallSite
+  )
+{
+  REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
+  UINT64                         Offset;
+  UINT64                         Start;
+  UINT32                         Duration;
+  REGISTER_ACCESS_TRACE_TYPE     TraceType;
+  EFI_STATUS                     Status;
+
+  REGISTER_ACCESS_IO_SIM_TIME_ACCESS ();
+  REGISTER_ACCESS_IO_WATCHPOINT (Type, Address, Size, Value, TRUE);
+  TraceType = (Type == RegisterAccessIoTypeIo) ? RegisterAccessTraceIoWrite : RegisterAccessTraceMmioWrite;
+  MapEntry = RegisterAccessIoGetMapEntry (Address, Type, &Offset);
+  REGISTER_ACCESS_IO_HOT_ACCESS (
+    (MapEntry != NULL) ? MapEntry->TraceRegion : REGISTER_ACCESS_TRACE_REGION_UNMAPPED,
+    (MapEntry != NULL) ? Offset : Address,
+    Size,
+    TRUE
+    );
+  REGISTER_ACCESS_IO_CALL_SITE_COUNT (
+    CallSite,
+    (MapEntry != NULL) ? MapEntry->TraceRegion : REGISTER_ACCESS_TRACE_REGION_UNMAPPED,
+    (MapEntry != NULL) ? Offset : Address,
+    TRUE
+    );
+  REGISTER_ACCESS_IO_STATS_COUNT (
+    (MapEntry != NULL) ? MapEntry->TraceRegion : REGISTER_ACCESS_TRACE_REGION_UNMAPPED,
+    (MapEntry != NULL) ? Offset : Address,
+    Size,
+    TRUE
+    );
+  REGISTER_ACCESS_IO_COVERAGE (
+    (MapEntry != NULL) ? MapEntry->TraceRegion : REGISTER_ACCESS_TRACE_REGION_UNMAPPED,
+    (MapEntry != NULL) ? Offset : Address,
+    Size,
+    TRUE
+    );
+  if (MapEntry != NULL && MapEntry->WriteCombine) {
+    REGISTER_ACCESS_IO_POSTED_WRITE_DRAIN (NULL);
+    Status = RegisterAccessIoWriteCombine (MapEntry, Offset, Size, Value);
+    if (Status != EFI_ABORTED) {
+      REGISTER_ACCESS_IO_TRACE (TraceType, MapEntry->TraceRegion, Address, (UINT8) Size, Value, 0);
+      return Status;
+    }
+  }
+
+  RegisterAccessIoWriteCombineFlushPending ();
+  if (MapEntry != NULL && MapEntry->PostedWrites) {
+    Status = RegisterAccessIoPostedWrite (MapEntry, Offset, Size, Value);
+    if (Status != EFI_ABORTED) {
+      REGISTER_ACCESS_IO_TRACE (TraceType, MapEntry->TraceRegion, Address, (UINT8) Size, Value, 0);
+      return Status;
+    }
+  }
+
+  //
+  // Non-posted write can't pass writes posted before it.
+  //
+  REGISTER_ACCESS_IO_POSTED_WRITE_DRAIN (NULL);
+  if (MapEntry == NULL) {
+    REGISTER_ACCESS_IO_STATS_MAP_MISS (REGISTER_ACCESS_TRACE_REGION_UNMAPPED);
+    REGISTER_ACCESS_IO_TRACE (TraceType, REGISTER_ACCESS_TRACE_REGION_UNMAPPED, Address, (UINT8) Size, Value, 0);
+    //
+    // Distinct from anything a register space returns so that callers can
+    // tell an unmapped address apart from a failed write.
+    //
+    return EFI_NO_MAPPING;
+  }
+
+  //
+  // Write is recorded once it completes so that the record carries the time
+  // spent in the register space.
+  //
+  REGISTER_ACCESS_IO_LOCK (&MapEntry->Lock);
+  Start = REGISTER_ACCESS_IO_CALL_START ();
+  Status = MapEntry->RegisterAccess->Write (MapEntry->RegisterAccess, Offset, Size, Value);
+  Duration = REGISTER_ACCESS_IO_CALL_END (MapEntry->TraceRegion, Start);
+  REGISTER_ACCESS_IO_UNLOCK (&MapEntry->Lock);
+  REGISTER_ACCESS_IO_TRACE (TraceType, MapEntry->TraceRegion, Address, (UINT8) Size, Value, Duration);
+
+  return Status;
+}
+
 EFI_STATUS
 RegisterAccessIoRegisterMmioAtAddress (
   IN REGISTER_ACCESS_INTERFACE *RegisterAccess,
@@ -76,15 +400,7 @@ RegisterAccessIoRegisterMmioAtAddress (
   REGISTER_ACCESS_IO_MEMORY_MAP  **Map;
   REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
 
-  switch (Type) {
-    case RegisterAccessIoTypeIo:
-      Map = &mIoMap;
-      break;
-    case RegisterAccessIoTypeMmio:
-    default:
-      Map = &mMemMap;
-      break;
-  }
+  Map = RegisterAccessIoGetMap (Type);
 
   if (*Map == NULL) {
     *Map = AllocateZeroPool (sizeof (REGISTER_ACCESS_IO_MEMORY_MAP));
@@ -101,6 +417,21 @@ RegisterAccessIoRegisterMmioAtAddress (
   MapEntry->Address = Address;
   MapEntry->Size = Size;
   MapEntry->RegisterAccess = RegisterAccess;
+  InitializeSpinLock (&MapEntry->Lock);
+  MapEntry->TraceRegion = RegisterAccessIoTraceRegisterRegion (
+                            RegisterAccess->Name,
+                            (Type == RegisterAccessIoTypeIo) ? RegisterAccessTraceRegionIo : RegisterAccessTraceRegionMmio,
+                            Address,
+                            Size
+                            );
+  if (MapEntry->TraceRegion == REGISTER_ACCESS_TRACE_REGION_UNMAPPED) {
+    //
+    // Statistics, coverage and latency of the region would be merged into
+    // the unmapped accesses.
+    //
+    FreePool (MapEntry);
+    return EFI_OUT_OF_RESOURCES;
+  }
   InsertTailList (&(*Map)->Link, &MapEntry->Link);
 
   return EFI_SUCCESS;
@@ -117,25 +448,16 @@ RegisterAccessIoUnRegisterMmioAtAddress (
   LIST_ENTRY  *Next;
   REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry;
 
-  switch (MemoryType) {
-    case RegisterAccessIoTypeIo:
-      if (mIoMap == NULL) {
-        return EFI_NOT_FOUND;
-      }
-      MemoryMap = mIoMap;
-      break;
-    case RegisterAccessIoTypeMmio:
-    default:
-      if (mMemMap == NULL) {
-        return EFI_NOT_FOUND;
-      }
-      MemoryMap = mMemMap;
-      break;
+  MemoryMap = *RegisterAccessIoGetMap (MemoryType);
+  if (MemoryMap == NULL) {
+    return EFI_NOT_FOUND;
   }
 
   BASE_LIST_FOR_EACH_SAFE (Entry, Next, &MemoryMap->Link) {
     MapEntry = BASE_CR (Entry, REGISTER_ACCESS_IO_MEMORY_MAP, Link);
     if (Address == MapEntry->Address) {
+      RegisterAccessIoPostedWriteUnregister (MapEntry);
+      RegisterAccessIoWriteCombineUnregister (MapEntry);
       RemoveEntryList (Entry);
       FreePool (MapEntry);
       return EFI_SUCCESS;
@@ -165,17 +487,7 @@ FAKE_NAME_DECORATOR(IoRead8) (
   IN      UINTN  Port
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Value;
-  UINT64               Offset;
-
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Port, RegisterAccessIoTypeIo, &Offset);
-  if (RegisterAccess == NULL) {
-    return 0xFF;
-  }
-
-  RegisterAccess->Read (RegisterAccess, Offset, 1, &Value);
-  return (UINT8) Value;
+  return (UINT8) RegisterAccessIoRead (RegisterAccessIoTypeIo, Port, 1, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
 }
 
 
@@ -201,17 +513,13 @@ FAKE_NAME_DECORATOR(IoWrite8) (
   IN      UINT8  Value
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64                Val;
-  UINT64               Offset;
+  EFI_STATUS  Status;
 
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Port, RegisterAccessIoTypeIo, &Offset);
-  if (RegisterAccess == NULL) {
+  Status = RegisterAccessIoWrite (RegisterAccessIoTypeIo, Port, 1, Value, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
+  if (Status == EFI_NO_MAPPING) {
     return 0xFF;
   }
 
-  Val = Value;
-  RegisterAccess->Write (RegisterAccess, Offset, 1, Val);
   return Value;
 }
 
@@ -236,17 +544,7 @@ FAKE_NAME_DECORATOR(IoRead16) (
   IN      UINTN  Port
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Value;
-  UINT64               Offset;
-
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Port, RegisterAccessIoTypeIo, &Offset);
-  if (RegisterAccess == NULL) {
-    return 0xFFFF;
-  }
-
-  RegisterAccess->Read (RegisterAccess, Offset, 2, &Value);
-  return (UINT16) Value;
+  return (UINT16) RegisterAccessIoRead (RegisterAccessIoTypeIo, Port, 2, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
 }
 
 /**
@@ -272,17 +570,13 @@ FAKE_NAME_DECORATOR(IoWrite16) (
   IN      UINT16  Value
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64                Val;
-  UINT64                Offset;
+  EFI_STATUS  Status;
 
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Port, RegisterAccessIoTypeIo, &Offset);
-  if (RegisterAccess == NULL) {
+  Status = RegisterAccessIoWrite (RegisterAccessIoTypeIo, Port, 2, Value, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
+  if (Status == EFI_NO_MAPPING) {
     return 0xFFFF;
   }
 
-  Val = Value;
-  RegisterAccess->Write (RegisterAccess, Offset, 2, Val);
   return Value;
 }
 
@@ -307,17 +601,7 @@ FAKE_NAME_DECORATOR(IoRead32) (
   IN      UINTN  Port
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Value;
-  UINT64               Offset;
-
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Port, RegisterAccessIoTypeIo, &Offset);
-  if (RegisterAccess == NULL) {
-    return 0xFFFFFFFF;
-  }
-
-  RegisterAccess->Read (RegisterAccess, Offset, 4, &Value);
-  return (UINT32) Value;
+  return (UINT32) RegisterAccessIoRead (RegisterAccessIoTypeIo, Port, 4, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
 }
 
 /**
@@ -343,17 +627,13 @@ FAKE_NAME_DECORATOR(IoWrite32) (
   IN      UINT32  Value
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64                Val;
-  UINT64               Offset;
+  EFI_STATUS  Status;
 
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Port, RegisterAccessIoTypeIo, &Offset);
-  if (RegisterAccess == NULL) {
+  Status = RegisterAccessIoWrite (RegisterAccessIoTypeIo, Port, 4, Value, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
+  if (Status == EFI_NO_MAPPING) {
     return 0xFFFFFFFF;
   }
 
-  Val = Value;
-  RegisterAccess->Write (RegisterAccess, Offset, 4, Val);
   return Value;
 }
 
@@ -378,17 +658,7 @@ FAKE_NAME_DECORATOR(IoRead64) (
   IN      UINTN  Port
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Value;
-  UINT64               Offset;
-
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Port, RegisterAccessIoTypeIo, &Offset);
-  if (RegisterAccess == NULL) {
-    return 0xFFFFFFFFFFFFFFFF;
-  }
-
-  RegisterAccess->Read (RegisterAccess, Offset, 8, &Value);
-  return (UINT64) Value;
+  return (UINT64) RegisterAccessIoRead (RegisterAccessIoTypeIo, Port, 8, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
 }
 
 /**
@@ -414,15 +684,13 @@ FAKE_NAME_DECORATOR(IoWrite64) (
   IN      UINT64  Value
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Offset;
+  EFI_STATUS  Status;
 
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Port, RegisterAccessIoTypeIo, &Offset);
-  if (RegisterAccess == NULL) {
+  Status = RegisterAccessIoWrite (RegisterAccessIoTypeIo, Port, 8, Value, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
+  if (Status == EFI_NO_MAPPING) {
     return 0xFFFFFFFFFFFFFFFF;
   }
 
-  RegisterAccess->Write (RegisterAccess, Offset, 8, Value);
   return Value;
 }
 
@@ -446,17 +714,7 @@ FAKE_NAME_DECORATOR(MmioRead8) (
   IN      UINTN  Address
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Value;
-  UINT64               Offset;
-
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Address, RegisterAccessIoTypeMmio, &Offset);
-  if (RegisterAccess == NULL) {
-    return 0xFF;
-  }
-
-  RegisterAccess->Read (RegisterAccess, Offset, 1, &Value);
-  return (UINT8) Value;
+  return (UINT8) RegisterAccessIoRead (RegisterAccessIoTypeMmio, Address, 1, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
 }
 
 /**
@@ -481,17 +739,13 @@ FAKE_NAME_DECORATOR(MmioWrite8) (
   IN      UINT8  Value
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Val;
-  UINT64               Offset;
+  EFI_STATUS  Status;
 
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Address, RegisterAccessIoTypeMmio, &Offset);
-  if (RegisterAccess == NULL) {
+  Status = RegisterAccessIoWrite (RegisterAccessIoTypeMmio, Address, 1, Value, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
+  if (Status == EFI_NO_MAPPING) {
     return 0xFF;
   }
 
-  Val = Value;
-  RegisterAccess->Write (RegisterAccess, Offset, 1, Val);
   return (UINT8) Value;
 }
 
@@ -516,17 +770,7 @@ FAKE_NAME_DECORATOR(MmioRead16) (
   IN      UINTN  Address
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Value;
-  UINT64               Offset;
-
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Address, RegisterAccessIoTypeMmio, &Offset);
-  if (RegisterAccess == NULL) {
-    return 0xFFFF;
-  }
-
-  RegisterAccess->Read (RegisterAccess, Offset, 2, &Value);
-  return (UINT16) Value;
+  return (UINT16) RegisterAccessIoRead (RegisterAccessIoTypeMmio, Address, 2, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
 }
 
 /**
@@ -552,17 +796,13 @@ FAKE_NAME_DECORATOR(MmioWrite16) (
   IN      UINT16  Value
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Val;
-  UINT64               Offset;
+  EFI_STATUS  Status;
 
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Address, RegisterAccessIoTypeMmio, &Offset);
-  if (RegisterAccess == NULL) {
+  Status = RegisterAccessIoWrite (RegisterAccessIoTypeMmio, Address, 2, Value, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
+  if (Status == EFI_NO_MAPPING) {
     return 0xFFFF;
   }
 
-  Val = Value;
-  RegisterAccess->Write (RegisterAccess, Offset, 2, Val);
   return (UINT16) Value;
 }
 
@@ -587,17 +827,7 @@ FAKE_NAME_DECORATOR(MmioRead32) (
   IN      UINTN  Address
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Value;
-  UINT64               Offset;
-
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Address, RegisterAccessIoTypeMmio, &Offset);
-  if (RegisterAccess == NULL) {
-    return 0xFFFFFFFF;
-  }
-
-  RegisterAccess->Read (RegisterAccess, Offset, 4, &Value);
-  return (UINT32) Value;
+  return (UINT32) RegisterAccessIoRead (RegisterAccessIoTypeMmio, Address, 4, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
 }
 
 /**
@@ -623,17 +853,13 @@ FAKE_NAME_DECORATOR(MmioWrite32) (
   IN      UINT32  Value
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Val;
-  UINT64               Offset;
+  EFI_STATUS  Status;
 
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Address, RegisterAccessIoTypeMmio, &Offset);
-  if (RegisterAccess == NULL) {
+  Status = RegisterAccessIoWrite (RegisterAccessIoTypeMmio, Address, 4, Value, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
+  if (Status == EFI_NO_MAPPING) {
     return 0xFFFFFFFF;
   }
 
-  Val = Value;
-  RegisterAccess->Write (RegisterAccess, Offset, 4, Val);
   return (UINT32) Value;
 }
 
@@ -658,17 +884,7 @@ FAKE_NAME_DECORATOR(MmioRead64) (
   IN      UINTN  Address
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Value;
-  UINT64               Offset;
-
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Address, RegisterAccessIoTypeMmio, &Offset);
-  if (RegisterAccess == NULL) {
-    return 0xFFFFFFFFFFFFFFFF;
-  }
-
-  RegisterAccess->Read (RegisterAccess, Offset, 8, &Value);
-  return Value;
+  return RegisterAccessIoRead (RegisterAccessIoTypeMmio, Address, 8, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
 }
 
 /**
@@ -692,17 +908,13 @@ FAKE_NAME_DECORATOR(MmioWrite64) (
   IN      UINT64  Value
   )
 {
-  REGISTER_ACCESS_INTERFACE  *RegisterAccess;
-  UINT64               Val;
-  UINT64               Offset;
+  EFI_STATUS  Status;
 
-  RegisterAccess = RegisterAccessIoGetRegisterSpace (Address, RegisterAccessIoTypeMmio, &Offset);
-  if (RegisterAccess == NULL) {
+  Status = RegisterAccessIoWrite (RegisterAccessIoTypeMmio, Address, 8, Value, REGISTER_ACCESS_IO_RETURN_ADDRESS ());
+  if (Status == EFI_NO_MAPPING) {
     return 0xFFFFFFFFFFFFFFFF;
   }
 
-  Val = Value;
-  RegisterAccess->Write (RegisterAccess, Offset, 8, Val);
   return Value;
 }
 
@@ -731,12 +943,15 @@ FAKE_NAME_DECORATOR(IoReadFifo8) (
   OUT     VOID   *Buffer
   )
 {
-  UINT8   *Uint8Buffer;
+  UINT8    *Uint8Buffer;
+  BOOLEAN  CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   Uint8Buffer = (UINT8*) Buffer;
   for (UINTN Index = 0; Index < Count; Index++) {
     Uint8Buffer[Index] = FAKE_NAME_DECORATOR(IoRead8) (Port);
   }
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
 }
 
 /**
@@ -764,12 +979,15 @@ FAKE_NAME_DECORATOR(IoWriteFifo8) (
   IN      VOID   *Buffer
   )
 {
-  UINT8   *Uint8Buffer;
+  UINT8    *Uint8Buffer;
+  BOOLEAN  CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   Uint8Buffer = (UINT8*) Buffer;
   for (UINTN Index = 0; Index < Count; Index++) {
     FAKE_NAME_DECORATOR(IoWrite8) (Port, Uint8Buffer[Index]);
   }
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
 }
 
 /**
@@ -798,11 +1016,14 @@ FAKE_NAME_DECORATOR(IoReadFifo16) (
   )
 {
   UINT16   *Uint16Buffer;
+  BOOLEAN  CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   Uint16Buffer = (UINT16*) Buffer;
   for (UINTN Index = 0; Index < Count; Index++) {
     Uint16Buffer[Index] = FAKE_NAME_DECORATOR(IoRead16) (Port);
   }
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
 }
 
 /**
@@ -831,11 +1052,14 @@ FAKE_NAME_DECORATOR(IoWriteFifo16) (
   )
 {
   UINT16   *Uint16Buffer;
+  BOOLEAN  CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   Uint16Buffer = (UINT16*) Buffer;
   for (UINTN Index = 0; Index < Count; Index++) {
     FAKE_NAME_DECORATOR(IoWrite16) (Port, Uint16Buffer[Index]);
   }
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
 }
 
 /**
@@ -864,11 +1088,14 @@ FAKE_NAME_DECORATOR(IoReadFifo32) (
   )
 {
   UINT32   *Uint32Buffer;
+  BOOLEAN  CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   Uint32Buffer = (UINT32*) Buffer;
   for (UINTN Index = 0; Index < Count; Index++) {
     Uint32Buffer[Index] = FAKE_NAME_DECORATOR(IoRead32) (Port);
   }
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
 }
 
 /**
@@ -897,9 +1124,12 @@ FAKE_NAME_DECORATOR(IoWriteFifo32) (
   )
 {
   UINT32   *Uint32Buffer;
+  BOOLEAN  CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   Uint32Buffer = (UINT32*) Buffer;
   for (UINTN Index = 0; Index < Count; Index++) {
     FAKE_NAME_DECORATOR(IoWrite32) (Port, Uint32Buffer[Index]);
   }
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
 }
\ No newline at end of file
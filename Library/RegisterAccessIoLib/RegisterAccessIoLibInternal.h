@@ -0,0 +1,506 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _REGISTER_ACCESS_IO_LIB_INTERNAL_H_
+#define _REGISTER_ACCESS_IO_LIB_INTERNAL_H_
+
+#include <Library/RegisterAccessIoLib.h>
+
+#include <time.h>
+
+#if defined (_MSC_VER)
+#define REGISTER_ACCESS_IO_THREAD_LOCAL  __declspec(thread)
+#else
+#define REGISTER_ACCESS_IO_THREAD_LOCAL  __thread
+#endif
+
+/**
+  Returns host time in nanoseconds for measuring host intervals. Uses the
+  monotonic clock so that wall clock adjustments don't skew the intervals.
+  Windows C runtime has no monotonic timespec clock and falls back to UTC.
+
+  @return Host time in nanoseconds or 0 if the clock couldn't be read.
+**/
+STATIC inline
+UINT64
+RegisterAccessIoGetHostNanoseconds (
+  VOID
+  )
+{
+  struct timespec  Time;
+
+#if defined (_WIN32)
+  if (timespec_get (&Time, TIME_UTC) == 0) {
+    return 0;
+  }
+#else
+  if (clock_gettime (CLOCK_MONOTONIC, &Time) != 0) {
+    return 0;
+  }
+#endif
+
+  return (UINT64) Time.tv_sec * 1000000000ULL + (UINT64) Time.tv_nsec;
+}
+
+typedef struct {
+  UINT64  Offset;
+  UINT32  Length;
+  UINT8   Data[REGISTER_ACCESS_IO_WRITE_COMBINE_LINE_SIZE];
+} REGISTER_ACCESS_IO_WRITE_COMBINE_BUFFER;
+
+//
+// Number of upcoming per-thread state allocations which fail. Lets unit tests
+// reach the paths taken when the library runs out of memory.
+//
+extern UINT32  gRegisterAccessIoFailStateAllocations;
+
+/**
+  Allocates zeroed per-thread state of a feature.
+
+  @param[in] Size  Size of the state in bytes.
+
+  @return Allocated state or NULL.
+**/
+VOID*
+RegisterAccessIoAllocateState (
+  IN UINTN  Size
+  );
+
+typedef struct {
+  UINT64                                   Address;
+  UINT64                                   Size;
+  REGISTER_ACCESS_INTERFACE                *RegisterAccess;
+  BOOLEAN                                  WriteCombine;
+  BOOLEAN                                  PostedWrites;
+  UINT16                                   TraceRegion;
+  SPIN_LOCK                                Lock;
+  LIST_ENTRY                               Link;
+} REGISTER_ACCESS_IO_MEMORY_MAP;
+
+REGISTER_ACCESS_IO_MEMORY_MAP*
+RegisterAccessIoGetMapEntry (
+  IN UINT64                          Address,
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  MemoryType,
+  OUT UINT64                         *Offset
+  );
+
+/**
+  Buffers a write to a region with write combining enabled.
+
+  Write is appended to the pending line of the calling thread if it is
+  contiguous with the data already buffered for the same region. Otherwise
+  pending data is flushed first.
+
+  @param[in] MapEntry  Region with write combining enabled.
+  @param[in] Offset    Offset of the write within the region.
+  @param[in] Size      Size of the write in bytes.
+  @param[in] Value     Value to write.
+
+  @retval EFI_ABORTED  Write was not buffered and must be forwarded to the
+                       register space, e.g. region left write combining mode.
+  @return Status of the write to the register space if one was required.
+**/
+EFI_STATUS
+RegisterAccessIoWriteCombine (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry,
+  IN UINT64                         Offset,
+  IN UINT32                         Size,
+  IN UINT64                         Value
+  );
+
+/**
+  Disables write combining for the region and flushes the data every thread
+  buffered for it.
+
+  @param[in] MapEntry  Region being unregistered or leaving write combining mode.
+**/
+VOID
+RegisterAccessIoWriteCombineUnregister (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry
+  );
+
+/**
+  Flushes buffered writes of the calling thread to whichever region holds them.
+
+  @retval EFI_SUCCESS  Buffered writes forwarded or nothing was buffered.
+  @retval Others       Register space failed the write.
+**/
+EFI_STATUS
+RegisterAccessIoWriteCombineFlushPending (
+  VOID
+  );
+
+extern BOOLEAN  gRegisterAccessIoPostedWritesEnabled;
+
+//
+// Drains posted writes. Costs a single branch when no region posts writes.
+//
+#define REGISTER_ACCESS_IO_POSTED_WRITE_DRAIN(MapEntry) \
+  do { \
+    if (gRegisterAccessIoPostedWritesEnabled) { \
+      RegisterAccessIoPostedWriteDrain (MapEntry); \
+    } \
+  } while (FALSE)
+
+/**
+  Queues a write to a region in posted mode. Drains the queue first if it is full.
+
+  @param[in] MapEntry  Region in posted mode.
+  @param[in] Offset    Offset of the write within the region.
+  @param[in] Size      Size of the write in bytes.
+  @param[in] Value     Value to write.
+
+  @retval EFI_SUCCESS  Write queued.
+  @retval EFI_ABORTED  Region is no longer in posted mode or the queue of the
+                       thread couldn't be allocated, write must be forwarded
+                       to the register space.
+**/
+EFI_STATUS
+RegisterAccessIoPostedWrite (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry,
+  IN UINT64                         Offset,
+  IN UINT32                         Size,
+  IN UINT64                         Value
+  );
+
+/**
+  Forwards writes posted by the calling thread up to and including the last
+  one targeting the register space of MapEntry.
+
+  @param[in] MapEntry  Region being read or NULL to drain all posted writes.
+**/
+VOID
+RegisterAccessIoPostedWriteDrain (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry OPTIONAL
+  );
+
+/**
+  Disables posting for the region being unregistered and forwards the writes
+  every thread posted to it.
+
+  @param[in] MapEntry  Region being unregistered.
+**/
+VOID
+RegisterAccessIoPostedWriteUnregister (
+  IN REGISTER_ACCESS_IO_MEMORY_MAP  *MapEntry
+  );
+
+typedef struct {
+  UINT64  CallSite;
+  UINT64  Offset;
+  UINT64  Reads;
+  UINT64  Writes;
+  UINT16  Region;
+  UINT8   ReadWidths;
+  UINT8   WriteWidths;
+} REGISTER_ACCESS_IO_COUNTER;
+
+typedef struct _REGISTER_ACCESS_IO_COUNTER_ARRAY REGISTER_ACCESS_IO_COUNTER_ARRAY;
+typedef struct _REGISTER_ACCESS_IO_COUNTER_TABLE REGISTER_ACCESS_IO_COUNTER_TABLE;
+
+//
+// Access counter table of a single thread.
+//
+struct _REGISTER_ACCESS_IO_COUNTER_TABLE {
+  REGISTER_ACCESS_IO_COUNTER_TABLE           *Next;
+  UINTN                                      Used;
+  REGISTER_ACCESS_IO_COUNTER_ARRAY *volatile  Array;
+};
+
+/**
+  Returns the counter of the access in the table of the calling thread. The
+  counter is added if it wasn't seen before.
+
+  @param[in, out] Table     Table of the calling thread. Allocated and linked
+                            into List on the first call.
+  @param[in, out] List      Tables of all threads counting for the feature.
+  @param[in]      CallSite  Call site of the access, 0 if not tracked.
+  @param[in]      Region    Trace region id of the region.
+  @param[in]      Offset    Offset within the region.
+
+  @return Counter or NULL if memory allocation failed.
+**/
+REGISTER_ACCESS_IO_COUNTER*
+RegisterAccessIoCounterGet (
+  IN OUT REGISTER_ACCESS_IO_COUNTER_TABLE           **Table,
+  IN OUT REGISTER_ACCESS_IO_COUNTER_TABLE *volatile  *List,
+  IN     UINT64                                      CallSite,
+  IN     UINT16                                      Region,
+  IN     UINT64                                      Offset
+  );
+
+/**
+  Drops counters of all tables in the list.
+
+  @param[in] List  Tables of all threads counting for the feature.
+**/
+VOID
+RegisterAccessIoCounterReset (
+  IN REGISTER_ACCESS_IO_COUNTER_TABLE  *List
+  );
+
+/**
+  Merges tables of all threads into a single array sorted from the most
+  frequent access. Safe to call while other threads count.
+
+  @param[in]  List     Tables of all threads counting for the feature.
+  @param[out] Entries  Merged counters or NULL if there are none. Caller frees it.
+  @param[out] Count    Number of merged counters.
+
+  @retval EFI_SUCCESS           Counters merged.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory.
+**/
+EFI_STATUS
+RegisterAccessIoCounterMerge (
+  IN  REGISTER_ACCESS_IO_COUNTER_TABLE  *List,
+  OUT REGISTER_ACCESS_IO_COUNTER        **Entries,
+  OUT UINTN                             *Count
+  );
+
+extern BOOLEAN  gRegisterAccessIoHotAccessEnabled;
+
+//
+// Counts register access. Costs a single branch when counting is disabled.
+//
+#define REGISTER_ACCESS_IO_HOT_ACCESS(Region, Offset, Width, IsWrite) \
+  do { \
+    if (gRegisterAccessIoHotAccessEnabled) { \
+      RegisterAccessIoHotAccessCount ((Region), (Offset), (Width), (IsWrite)); \
+    } \
+  } while (FALSE)
+
+/**
+  Increments the counter of the register in the table of the calling thread.
+
+  @param[in] Region   Trace region id of the region.
+  @param[in] Offset   Offset within the region.
+  @param[in] Width    Width of the access in bytes.
+  @param[in] IsWrite  TRUE for write access.
+**/
+VOID
+RegisterAccessIoHotAccessCount (
+  IN UINT16   Region,
+  IN UINT64   Offset,
+  IN UINT32   Width,
+  IN BOOLEAN  IsWrite
+  );
+
+//
+// Counts register access per call site. Costs a single branch when counting is disabled.
+//
+#define REGISTER_ACCESS_IO_CALL_SITE_COUNT(CallSite, Region, Offset, IsWrite) \
+  do { \
+    if (gRegisterAccessIoCallSiteEnabled) { \
+      RegisterAccessIoCallSiteCount ((CallSite), (Region), (Offset), (IsWrite)); \
+    } \
+  } while (FALSE)
+
+/**
+  Increments the counter of the call site and register in the table of the
+  calling thread. Call site set with REGISTER_ACCESS_IO_CALL_SITE_ENTER takes
+  precedence over CallSite.
+
+  @param[in] CallSite  Return address of the leaf IoLib function.
+  @param[in] Region    Trace region id of the region.
+  @param[in] Offset    Offset within the region.
+  @param[in] IsWrite   TRUE for write access.
+**/
+VOID
+RegisterAccessIoCallSiteCount (
+  IN VOID     *CallSite,
+  IN UINT16   Region,
+  IN UINT64   Offset,
+  IN BOOLEAN  IsWrite
+  );
+
+extern BOOLEAN  gRegisterAccessIoTraceFilterEnabled;
+
+/**
+  Compiles filter decision table cells of regions added to the trace region
+  table since the last call. Does nothing if no filters are set. Safe to call
+  while other threads record.
+
+  @retval EFI_SUCCESS           Table updated.
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory. New regions use the
+                                default decision until the next call.
+**/
+EFI_STATUS
+RegisterAccessIoTraceFilterCompile (
+  VOID
+  );
+
+/**
+  Evaluates trace filters for the access.
+
+  @param[in] Region   Trace region id of the access.
+  @param[in] Type     Type of the access.
+  @param[in] Address  Address of the access as stored in the record.
+  @param[in] Value    Value of the access.
+
+  @return TRUE if the access should be recorded.
+**/
+BOOLEAN
+RegisterAccessIoTraceFilterMatch (
+  IN UINT16                      Region,
+  IN REGISTER_ACCESS_TRACE_TYPE  Type,
+  IN UINT64                      Address,
+  IN UINT64                      Value
+  );
+
+/**
+  Returns short name of the trace region type used in reports.
+
+  @param[in] Type  REGISTER_ACCESS_TRACE_REGION_TYPE value.
+**/
+CONST CHAR8*
+RegisterAccessIoRegionTypeName (
+  IN UINT8  Type
+  );
+
+#define REGISTER_ACCESS_IO_WATCHPOINT_PAGE_SHIFT        12
+#define REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BITMAP_SIZE  SIZE_8KB
+#define REGISTER_ACCESS_IO_WATCHPOINT_ADDRESS_SPACES    2
+
+extern BOOLEAN  gRegisterAccessIoWatchpointEnabled;
+extern UINT8    gRegisterAccessIoWatchpointPages[REGISTER_ACCESS_IO_WATCHPOINT_ADDRESS_SPACES][REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BITMAP_SIZE];
+
+#define REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BIT(Address) \
+  ((UINTN) RShiftU64 ((Address), REGISTER_ACCESS_IO_WATCHPOINT_PAGE_SHIFT) & (REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BITMAP_SIZE * 8 - 1))
+
+//
+// Matches access against watchpoints. Costs a single branch when no watchpoint
+// is armed and a bit test when the page of the access is not watched.
+//
+#define REGISTER_ACCESS_IO_WATCHPOINT(Type, Address, Size, Value, IsWrite) \
+  do { \
+    if (gRegisterAccessIoWatchpointEnabled && \
+        (gRegisterAccessIoWatchpointPages[(Type)][REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BIT (Address) / 8] & \
+         (1 << (REGISTER_ACCESS_IO_WATCHPOINT_PAGE_BIT (Address) % 8))) != 0) { \
+      RegisterAccessIoWatchpointCheck ((Type), (Address), (Size), (Value), (IsWrite)); \
+    } \
+  } while (FALSE)
+
+/**
+  Calls watchpoints matching the access.
+
+  @param[in] Type     Address space of the access.
+  @param[in] Address  Address of the access.
+  @param[in] Size     Size of the access in bytes.
+  @param[in] Value    Value read or about to be written.
+  @param[in] IsWrite  TRUE for write access.
+**/
+VOID
+RegisterAccessIoWatchpointCheck (
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN UINT32                          Size,
+  IN UINT64                          Value,
+  IN BOOLEAN                         IsWrite
+  );
+
+extern BOOLEAN  gRegisterAccessIoLatencyEnabled;
+
+/**
+  Checks whether the next access of the calling thread which passes the trace
+  filters would be recorded by the sampling mode. Doesn't change the sampling
+  state.
+
+  @return FALSE if every Nth sampling skips the next access. TRUE otherwise,
+          interval sampling needs the timestamp to decide.
+**/
+BOOLEAN
+RegisterAccessIoTraceSampleNext (
+  VOID
+  );
+
+//
+// Timestamp to be passed to REGISTER_ACCESS_IO_CALL_END. 0 when neither latency
+// histograms are enabled nor the access would be traced, so accesses skipped
+// by sampling don't read the timestamp counter.
+//
+#define REGISTER_ACCESS_IO_CALL_START() \
+  ((gRegisterAccessIoLatencyEnabled || (gRegisterAccessIoTraceEnabled && RegisterAccessIoTraceSampleNext ())) ? \
+   RegisterAccessIoTraceGetTimestamp () : 0)
+
+//
+// Evaluates to the duration of the register space call in ticks (0 when timing
+// is disabled) and adds it to the latency histogram of the region.
+//
+#define REGISTER_ACCESS_IO_CALL_END(Region, Start) \
+  (((Start) != 0) ? RegisterAccessIoCallEnd ((Region), (Start)) : 0)
+
+/**
+  Adds sample to the latency histogram of the region in the calling thread.
+
+  @param[in] Region  Trace region id of the region.
+  @param[in] Ticks   Duration of the register space call.
+**/
+VOID
+RegisterAccessIoLatencyRecord (
+  IN UINT16  Region,
+  IN UINT64  Ticks
+  );
+
+/**
+  Completes timing of register space call started with REGISTER_ACCESS_IO_CALL_START.
+
+  @param[in] Region  Trace region id of the region.
+  @param[in] Start   Timestamp taken before the call.
+
+  @return Duration of the call in ticks saturated to 32 bits.
+**/
+UINT32
+RegisterAccessIoCallEnd (
+  IN UINT16  Region,
+  IN UINT64  Start
+  );
+
+//
+// Advances virtual time by the access cost of the calling thread's context.
+// Context with the access cost of 0 only pays the lookup of its time.
+//
+#define REGISTER_ACCESS_IO_SIM_TIME_ACCESS()  RegisterAccessIoSimTimeAccess ()
+
+/**
+  Advances virtual time of the calling thread's context by its access cost.
+**/
+VOID
+RegisterAccessIoSimTimeAccess (
+  VOID
+  );
+
+/**
+  Frees the event queue of a simulation context being destroyed.
+
+  @param[in] Context  Simulation context.
+**/
+VOID
+RegisterAccessIoSimTimeFree (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  );
+
+/**
+  Returns virtual time of a simulation context which may belong to another thread.
+
+  @param[in] Context  Simulation context.
+**/
+UINT64
+RegisterAccessIoSimTimeGetContextNow (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  );
+
+/**
+  Frees the interrupt queue of a simulation context being destroyed.
+
+  @param[in] Context  Simulation context.
+**/
+VOID
+RegisterAccessIoInterruptFree (
+  IN REGISTER_ACCESS_IO_SIM_CONTEXT  *Context
+  );
+
+#endif
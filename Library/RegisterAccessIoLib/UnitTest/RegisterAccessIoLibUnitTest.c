@@ -16,6 +16,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/RegisterAccessIoLib.h>
 #include <IndustryStandard/Pci.h>
 
+#include "../RegisterAccessIoLibInternal.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+
 #define UNIT_TEST_NAME     "RegisterAccessIoLib unit tests"
 #define UNIT_TEST_VERSION  "0.1"
 
@@ -66,6 +72,7 @@ typedef struct {
   UINT32  WriteRegister;
   UINT32  FifoTestRegister;
   UINT32  FifoCount;
+  UINT32  WriteCount;
   UINT32  RwBuffer[REGISTER_ACCESS_IO_LIB_TEST_DEVICE_BUFFER_NO_OF_DWORDS];
   REGISTER_ACCESS_INTERFACE  *RegisterAccess;
 } REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT;
@@ -129,6 +136,7 @@ TestRegisterAccessIoDeviceWrite (
     return;
   }
 
+  Device->WriteCount++;
   ByteMask = ByteEnableToBitMask (ByteEnable);
   if (Address >= REGISTER_ACCESS_IO_LIB_TEST_DEVICE_BUFFER_REG_ADDRESS &&
       Address <= REGISTER_ACCESS_IO_LIB_TEST_DEVICE_BUFFER_REG_ADDRESS + (4 * REGISTER_ACCESS_IO_LIB_TEST_DEVICE_BUFFER_NO_OF_DWORDS)) {
@@ -415,6 +423,1618 @@ RegisterAccessIoBufferRw32Test (
   return UNIT_TEST_PASSED;
 }
 
+STATIC
+EFI_STATUS
+RegisterAccessIoFailingWrite (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64                     Address,
+  IN UINT32                     Size,
+  IN UINT64                     Value
+  )
+{
+  return EFI_DEVICE_ERROR;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoWriteErrorTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT  *Device;
+  REGISTER_SPACE_WRITE                    Write;
+  REGISTER_SPACE_WRITE_BLOCK              WriteBlock;
+  UINT32                                  Val32;
+  EFI_STATUS                              Status;
+
+  Device = DEVICE_FROM_CONTEXT (Context);
+
+  //
+  // Only unmapped writes return all ones.
+  //
+  Val32 = MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_SIZE, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_EQUAL (Val32, 0xFFFFFFFF);
+
+  Write = Device->RegisterAccess->Write;
+  WriteBlock = Device->RegisterAccess->WriteBlock;
+  Device->RegisterAccess->Write = RegisterAccessIoFailingWrite;
+  Device->RegisterAccess->WriteBlock = NULL;
+
+  //
+  // Write the register space failed still returns the written value.
+  //
+  Val32 = MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_EQUAL (Val32, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+
+  //
+  // Failure of a write combined line is returned by the flush.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetWriteCombining (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, TRUE));
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  Status = RegisterAccessIoFlushWriteCombining ();
+  UT_ASSERT_EQUAL (Status, EFI_DEVICE_ERROR);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoFlushWriteCombining ());
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetWriteCombining (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, FALSE));
+
+  Device->RegisterAccess->Write = Write;
+  Device->RegisterAccess->WriteBlock = WriteBlock;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Writes a register and exits without flushing the write, leaving it in the
+  write combining buffer or posted write queue of the thread.
+**/
+STATIC
+int
+RegisterAccessIoBufferedWriteTestWorker (
+  VOID  *Argument
+  )
+{
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, (UINT32)(UINTN) Argument);
+  return 0;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoWriteCombiningTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                   Status;
+  UINT32                       Val32;
+  REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT  *Device;
+  thrd_t                       Thread;
+
+  Device = DEVICE_FROM_CONTEXT (Context);
+
+  Status = RegisterAccessIoSetWriteCombining (RegisterAccessIoTypeIo, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_IO_ADDRESS, TRUE);
+  UT_ASSERT_EQUAL (Status, EFI_UNSUPPORTED);
+
+  Status = RegisterAccessIoSetWriteCombining (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, TRUE);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+
+  //
+  // Byte writes are held in the line buffer until explicit flush and then
+  // delivered as a single write per DWORD.
+  //
+  Device->WriteCount = 0;
+  MmioWriteBuffer8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_BUFFER_REG_ADDRESS, sizeof (gUint32TestBuffer), (UINT8*) gUint32TestBuffer);
+  UT_ASSERT_EQUAL (Device->WriteCount, 0);
+
+  RegisterAccessIoFlushWriteCombining ();
+  UT_ASSERT_EQUAL (Device->WriteCount, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_BUFFER_NO_OF_DWORDS);
+  UT_ASSERT_MEM_EQUAL (&Device->RwBuffer, &gUint32TestBuffer, sizeof (gUint32TestBuffer));
+
+  //
+  // Read has to observe buffered write.
+  //
+  Device->WriteCount = 0;
+  MmioWrite16 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL16);
+  UT_ASSERT_EQUAL (Device->WriteCount, 0);
+  Val32 = MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  UT_ASSERT_EQUAL (Val32, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_VALUE);
+  UT_ASSERT_EQUAL (Device->WriteCount, 1);
+  UT_ASSERT_EQUAL (Device->WriteRegister & 0xFFFF, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL16);
+
+  //
+  // Non-contiguous write flushes the pending data.
+  //
+  Device->WriteCount = 0;
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_BUFFER_REG_ADDRESS, 0);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_EQUAL (Device->WriteCount, 1);
+  UT_ASSERT_EQUAL (Device->RwBuffer[0], 0);
+
+  Status = RegisterAccessIoSetWriteCombining (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, FALSE);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (Device->WriteCount, 2);
+  UT_ASSERT_EQUAL (Device->WriteRegister, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+
+  //
+  // Every thread buffers into its own line. Disabling write combining
+  // flushes lines of other threads as well.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetWriteCombining (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, TRUE));
+  Device->WriteCount = 0;
+  RegisterAccessIoSetThreadSafe (TRUE);
+  UT_ASSERT_EQUAL (thrd_create (&Thread, RegisterAccessIoBufferedWriteTestWorker, (VOID*)(UINTN) REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32), thrd_success);
+  thrd_join (Thread, NULL);
+  RegisterAccessIoFlushWriteCombining ();
+  UT_ASSERT_EQUAL (Device->WriteCount, 0);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetWriteCombining (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, FALSE));
+  RegisterAccessIoSetThreadSafe (FALSE);
+  UT_ASSERT_EQUAL (Device->WriteCount, 1);
+  UT_ASSERT_EQUAL (Device->WriteRegister, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoPostedWriteTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT  *Device;
+  thrd_t                                  Thread;
+  UINT32                                  Index;
+
+  Device = DEVICE_FROM_CONTEXT (Context);
+
+  UT_ASSERT_EQUAL (RegisterAccessIoSetPostedWrites (RegisterAccessIoTypeIo, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_IO_ADDRESS, TRUE), EFI_UNSUPPORTED);
+  UT_ASSERT_EQUAL (RegisterAccessIoSetPostedWrites (RegisterAccessIoTypeMmio, 0, TRUE), EFI_NOT_FOUND);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetPostedWrites (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, TRUE));
+
+  //
+  // Read of the device drains writes posted before it in order.
+  //
+  Device->WriteCount = 0;
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, 1);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, 2);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_EQUAL (Device->WriteCount, 0);
+  UT_ASSERT_EQUAL (MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS), REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_VALUE);
+  UT_ASSERT_EQUAL (Device->WriteCount, 3);
+  UT_ASSERT_EQUAL (Device->WriteRegister, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+
+  //
+  // Non-posted IO write can't pass the posted MMIO write.
+  //
+  Device->WriteCount = 0;
+  Device->FifoCount = 0;
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS, 1);
+  IoWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_IO_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS, 2);
+  UT_ASSERT_EQUAL (Device->FifoCount, 2);
+  UT_ASSERT_EQUAL (Device->FifoTestRegister, 2);
+
+  //
+  // Full queue is drained before the next write is posted.
+  //
+  Device->WriteCount = 0;
+  for (Index = 0; Index <= REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE_SIZE; Index++) {
+    MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, Index);
+  }
+  UT_ASSERT_EQUAL (Device->WriteCount, REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE_SIZE);
+  RegisterAccessIoMemoryFence ();
+  UT_ASSERT_EQUAL (Device->WriteCount, REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE_SIZE + 1);
+  UT_ASSERT_EQUAL (Device->WriteRegister, REGISTER_ACCESS_IO_POSTED_WRITE_QUEUE_SIZE);
+
+  //
+  // Disabling posted writes drains the queue.
+  //
+  Device->WriteCount = 0;
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, 0);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetPostedWrites (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, FALSE));
+  UT_ASSERT_EQUAL (Device->WriteCount, 1);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, 0);
+  UT_ASSERT_EQUAL (Device->WriteCount, 2);
+
+  //
+  // Disabling posted writes drains writes queued by other threads as well.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetPostedWrites (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, TRUE));
+  Device->WriteCount = 0;
+  RegisterAccessIoSetThreadSafe (TRUE);
+  UT_ASSERT_EQUAL (thrd_create (&Thread, RegisterAccessIoBufferedWriteTestWorker, (VOID*)(UINTN) REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32), thrd_success);
+  thrd_join (Thread, NULL);
+  UT_ASSERT_EQUAL (Device->WriteCount, 0);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetPostedWrites (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, FALSE));
+  RegisterAccessIoSetThreadSafe (FALSE);
+  UT_ASSERT_EQUAL (Device->WriteCount, 1);
+  UT_ASSERT_EQUAL (Device->WriteRegister, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+
+  //
+  // Write of a thread which fails to allocate its queue is issued directly.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetPostedWrites (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, TRUE));
+  Device->WriteCount = 0;
+  Device->WriteRegister = 0;
+  gRegisterAccessIoFailStateAllocations = 1;
+  RegisterAccessIoSetThreadSafe (TRUE);
+  UT_ASSERT_EQUAL (thrd_create (&Thread, RegisterAccessIoBufferedWriteTestWorker, (VOID*)(UINTN) REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32), thrd_success);
+  thrd_join (Thread, NULL);
+  RegisterAccessIoSetThreadSafe (FALSE);
+  UT_ASSERT_EQUAL (gRegisterAccessIoFailStateAllocations, 0);
+  UT_ASSERT_EQUAL (Device->WriteCount, 1);
+  UT_ASSERT_EQUAL (Device->WriteRegister, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetPostedWrites (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, FALSE));
+  UT_ASSERT_EQUAL (Device->WriteCount, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoTraceTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                          Status;
+  REGISTER_ACCESS_TRACE_RECORD        *Records;
+  UINTN                               RecordCount;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINTN                               Index;
+
+  RegisterAccessIoTraceReset ();
+  RegisterAccessIoTraceEnable (TRUE);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  IoRead8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_IO_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  MmioRead16 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS - 2);
+  RegisterAccessIoTraceEnable (FALSE);
+
+  //
+  // Accesses done with tracing disabled are not recorded.
+  //
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+
+  Status = RegisterAccessIoTraceGetRecords (&Records, &RecordCount);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RecordCount, 4);
+
+  for (Index = 1; Index < RecordCount; Index++) {
+    UT_ASSERT_TRUE (Records[Index].Timestamp >= Records[Index - 1].Timestamp);
+  }
+
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  UT_ASSERT_TRUE (Records[0].Region < RegionCount);
+  UT_ASSERT_EQUAL (Regions[Records[0].Region].Type, RegisterAccessTraceRegionMmio);
+  UT_ASSERT_EQUAL (Regions[Records[0].Region].Base, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS);
+
+  UT_ASSERT_EQUAL (Records[0].Type, RegisterAccessTraceMmioWrite);
+  UT_ASSERT_EQUAL (Records[0].Address, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS);
+  UT_ASSERT_EQUAL (Records[0].Width, 4);
+  UT_ASSERT_EQUAL (Records[0].Value, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+
+  UT_ASSERT_EQUAL (Records[1].Type, RegisterAccessTraceMmioRead);
+  UT_ASSERT_EQUAL (Records[1].Region, Records[0].Region);
+  UT_ASSERT_EQUAL (Records[1].Value, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_VALUE);
+
+  UT_ASSERT_EQUAL (Records[2].Type, RegisterAccessTraceIoRead);
+  UT_ASSERT_EQUAL (Regions[Records[2].Region].Type, RegisterAccessTraceRegionIo);
+  UT_ASSERT_EQUAL (Records[2].Width, 1);
+  UT_ASSERT_EQUAL (Records[2].Value, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_VALUE & 0xFF);
+
+  UT_ASSERT_EQUAL (Records[3].Type, RegisterAccessTraceMmioRead);
+  UT_ASSERT_EQUAL (Records[3].Region, REGISTER_ACCESS_TRACE_REGION_UNMAPPED);
+  UT_ASSERT_EQUAL (Records[3].Width, 2);
+
+  FreePool (Records);
+
+  Status = RegisterAccessIoTraceSave ("RegisterAccessIoLibUnitTest.trace");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  RegisterAccessIoTraceReset ();
+  Status = RegisterAccessIoTraceGetRecords (&Records, &RecordCount);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RecordCount, 0);
+  if (Records != NULL) {
+    FreePool (Records);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoTraceSamplingTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                    Status;
+  REGISTER_ACCESS_TRACE_RECORD  *Records;
+  UINTN                         RecordCount;
+  UINTN                         Index;
+
+  Status = RegisterAccessIoTraceSetSampling (RegisterAccessIoTraceSampleEveryNth, 0);
+  UT_ASSERT_EQUAL (Status, EFI_INVALID_PARAMETER);
+
+  RegisterAccessIoTraceReset ();
+  Status = RegisterAccessIoTraceSetSampling (RegisterAccessIoTraceSampleEveryNth, 4);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoTraceEnable (TRUE);
+  for (Index = 0; Index < 10; Index++) {
+    MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, (UINT32) Index);
+  }
+  RegisterAccessIoTraceEnable (FALSE);
+
+  //
+  // 1st, 5th and 9th access are recorded.
+  //
+  Status = RegisterAccessIoTraceGetRecords (&Records, &RecordCount);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RecordCount, 3);
+  UT_ASSERT_EQUAL (Records[0].Value, 0);
+  UT_ASSERT_EQUAL (Records[1].Value, 4);
+  UT_ASSERT_EQUAL (Records[2].Value, 8);
+  UT_ASSERT_EQUAL (RegisterAccessIoTraceGetAccessCount (), 10);
+  FreePool (Records);
+
+  //
+  // With an interval longer than the test only the first access is recorded.
+  //
+  RegisterAccessIoTraceReset ();
+  Status = RegisterAccessIoTraceSetSampling (RegisterAccessIoTraceSampleInterval, LShiftU64 (1, 62));
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoTraceEnable (TRUE);
+  for (Index = 0; Index < 10; Index++) {
+    MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  }
+  RegisterAccessIoTraceEnable (FALSE);
+
+  Status = RegisterAccessIoTraceGetRecords (&Records, &RecordCount);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RecordCount, 1);
+  UT_ASSERT_EQUAL (RegisterAccessIoTraceGetAccessCount (), 10);
+  FreePool (Records);
+
+  Status = RegisterAccessIoTraceSetSampling (RegisterAccessIoTraceSampleAll, 0);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoTraceReset ();
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoTraceFilterTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                       Status;
+  REGISTER_ACCESS_TRACE_RECORD     *Records;
+  UINTN                            RecordCount;
+  REGISTER_ACCESS_IO_TRACE_FILTER  Filters[3];
+
+  ZeroMem (Filters, sizeof (Filters));
+  Filters[0].Action = RegisterAccessIoTraceFilterDrop;
+  Filters[0].Types = (BIT0 << RegisterAccessTraceIoRead) | (BIT0 << RegisterAccessTraceIoWrite);
+  Filters[1].Action = RegisterAccessIoTraceFilterRecord;
+  Filters[1].RegionName = "RegisterAccessIoLibTest*";
+  Filters[1].MatchAddress = TRUE;
+  Filters[1].AddressMin = REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS;
+  Filters[1].AddressMax = Filters[1].AddressMin + 3;
+  Filters[2].Action = RegisterAccessIoTraceFilterRecord;
+  Filters[2].Types = BIT0 << RegisterAccessTraceMmioWrite;
+  Filters[2].ValueMask = 0xFF;
+  Filters[2].ValueMatch = REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL8;
+
+  Filters[2].ValueMatch = 0x100;
+  Status = RegisterAccessIoTraceSetFilters (Filters, ARRAY_SIZE (Filters));
+  UT_ASSERT_EQUAL (Status, EFI_INVALID_PARAMETER);
+  Filters[2].ValueMatch = REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL8;
+
+  Status = RegisterAccessIoTraceSetFilters (Filters, ARRAY_SIZE (Filters));
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  RegisterAccessIoTraceReset ();
+  RegisterAccessIoTraceEnable (TRUE);
+  IoRead8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_IO_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS, 0x1200);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  MmioRead16 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS - 2);
+  RegisterAccessIoTraceEnable (FALSE);
+
+  //
+  // IO access is dropped by the first filter, accesses matching no filter are
+  // dropped as there are recording filters.
+  //
+  Status = RegisterAccessIoTraceGetRecords (&Records, &RecordCount);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RecordCount, 2);
+  UT_ASSERT_EQUAL (Records[0].Type, RegisterAccessTraceMmioRead);
+  UT_ASSERT_EQUAL (Records[0].Address, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS);
+  UT_ASSERT_EQUAL (Records[1].Type, RegisterAccessTraceMmioWrite);
+  UT_ASSERT_EQUAL (Records[1].Value, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_EQUAL (RegisterAccessIoTraceGetAccessCount (), 2);
+  FreePool (Records);
+
+  //
+  // Range of a single address 0 doesn't match other addresses.
+  //
+  ZeroMem (Filters, sizeof (Filters));
+  Filters[0].Action = RegisterAccessIoTraceFilterRecord;
+  Filters[0].RegionName = "Unmapped";
+  Filters[0].MatchAddress = TRUE;
+  Status = RegisterAccessIoTraceSetFilters (Filters, 1);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  RegisterAccessIoTraceReset ();
+  RegisterAccessIoTraceEnable (TRUE);
+  MmioRead16 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS - 2);
+  MmioRead8 (0);
+  RegisterAccessIoTraceEnable (FALSE);
+
+  Status = RegisterAccessIoTraceGetRecords (&Records, &RecordCount);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RecordCount, 1);
+  UT_ASSERT_EQUAL (Records[0].Address, 0);
+  FreePool (Records);
+
+  Status = RegisterAccessIoTraceSetFilters (NULL, 0);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoTraceReset ();
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Counts lines of the file which contain Pattern. Exporter writes one event per line.
+**/
+STATIC
+UINTN
+RegisterAccessIoCountLines (
+  IN CONST CHAR8  *FileName,
+  IN CONST CHAR8  *Pattern
+  )
+{
+  FILE   *File;
+  CHAR8  Line[512];
+  UINTN  Count;
+
+  File = fopen (FileName, "r");
+  if (File == NULL) {
+    return 0;
+  }
+
+  Count = 0;
+  while (fgets (Line, sizeof (Line), File) != NULL) {
+    if (strstr (Line, Pattern) != NULL) {
+      Count++;
+    }
+  }
+
+  fclose (File);
+  return Count;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoTraceChromeTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      RegionCount;
+
+  RegisterAccessIoTraceReset ();
+  RegisterAccessIoTraceEnable (TRUE);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  IoRead8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_IO_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  MmioRead16 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS - 2);
+  RegisterAccessIoTraceEnable (FALSE);
+
+  Status = RegisterAccessIoTraceSaveChromeTrace ("RegisterAccessIoLibUnitTest.json");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  //
+  // Every region gets a named track. Accesses which reached register space
+  // are complete events, access to unmapped address is an instant event.
+  //
+  RegisterAccessIoTraceGetRegions (&RegionCount);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTest.json", "\"thread_name\""), RegionCount);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTest.json", "\"ph\":\"X\""), 3);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTest.json", "\"ph\":\"i\""), 1);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTest.json", "\"name\":\"MMIO read\""), 2);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTest.json", "\"name\":\"IO read\",\"cat\":\"io\""), 1);
+
+  Status = RegisterAccessIoTraceSave ("RegisterAccessIoLibUnitTestChrome.trace");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = RegisterAccessIoTraceConvertToChromeTrace ("RegisterAccessIoLibUnitTestChrome.trace", "RegisterAccessIoLibUnitTestConverted.json");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTestConverted.json", "\"ph\":\"X\""), 3);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTestConverted.json", "\"ph\":\"i\""), 1);
+
+  Status = RegisterAccessIoTraceSaveCompact ("RegisterAccessIoLibUnitTestChrome.ctrace");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = RegisterAccessIoTraceConvertToChromeTrace ("RegisterAccessIoLibUnitTestChrome.ctrace", "RegisterAccessIoLibUnitTestConverted.json");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTestConverted.json", "\"ph\":\"X\""), 3);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTestConverted.json", "\"thread_name\""), RegionCount);
+
+  Status = RegisterAccessIoTraceConvertToChromeTrace ("RegisterAccessIoLibUnitTest.json", "RegisterAccessIoLibUnitTestConverted.json");
+  UT_ASSERT_EQUAL (Status, EFI_VOLUME_CORRUPTED);
+
+  RegisterAccessIoTraceReset ();
+  return UNIT_TEST_PASSED;
+}
+
+#define REGISTER_ACCESS_IO_LIB_TEST_UNMAPPED_ADDRESS  0x20000000
+#define REGISTER_ACCESS_IO_LIB_TEST_NO_OF_COUNTERS     1024
+
+/**
+  Reads distinct unmapped addresses so that the counter table of the thread grows.
+**/
+STATIC
+int
+RegisterAccessIoCounterGrowTestWorker (
+  VOID  *Argument
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < REGISTER_ACCESS_IO_LIB_TEST_NO_OF_COUNTERS; Index++) {
+    MmioRead8 (REGISTER_ACCESS_IO_LIB_TEST_UNMAPPED_ADDRESS + Index);
+  }
+  return 0;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoHotAccessTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                     Status;
+  REGISTER_ACCESS_IO_HOT_ACCESS  Entries[3];
+  REGISTER_ACCESS_IO_HOT_ACCESS  *AllEntries;
+  UINTN                          NoOfEntries;
+  UINTN                          Index;
+  thrd_t                         Thread;
+
+  RegisterAccessIoHotAccessReset ();
+  RegisterAccessIoHotAccessEnable (TRUE);
+  for (Index = 0; Index < 10; Index++) {
+    MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  }
+  MmioRead8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  for (Index = 0; Index < 5; Index++) {
+    MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  }
+  MmioRead16 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS);
+  IoRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_IO_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  RegisterAccessIoHotAccessEnable (FALSE);
+
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS);
+
+  NoOfEntries = ARRAY_SIZE (Entries);
+  Status = RegisterAccessIoHotAccessGetTop (Entries, &NoOfEntries);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NoOfEntries, 3);
+
+  UT_ASSERT_EQUAL (Entries[0].Offset, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  UT_ASSERT_EQUAL (Entries[0].Reads, 11);
+  UT_ASSERT_EQUAL (Entries[0].Writes, 0);
+  UT_ASSERT_EQUAL (Entries[0].ReadWidths, BIT0 | BIT2);
+
+  UT_ASSERT_EQUAL (Entries[1].Offset, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS);
+  UT_ASSERT_EQUAL (Entries[1].Reads, 1);
+  UT_ASSERT_EQUAL (Entries[1].Writes, 5);
+  UT_ASSERT_EQUAL (Entries[1].ReadWidths, BIT1);
+  UT_ASSERT_EQUAL (Entries[1].WriteWidths, BIT2);
+
+  //
+  // IO access at the same offset is counted separately as it hits a different region.
+  //
+  UT_ASSERT_EQUAL (Entries[2].Offset, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  UT_ASSERT_EQUAL (Entries[2].Reads, 1);
+  UT_ASSERT_NOT_EQUAL (Entries[2].Region, Entries[0].Region);
+
+  RegisterAccessIoHotAccessDump (ARRAY_SIZE (Entries));
+
+  RegisterAccessIoHotAccessReset ();
+  NoOfEntries = ARRAY_SIZE (Entries);
+  Status = RegisterAccessIoHotAccessGetTop (Entries, &NoOfEntries);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NoOfEntries, 0);
+
+  //
+  // Counters are merged while the table of another thread grows.
+  //
+  AllEntries = AllocatePool (REGISTER_ACCESS_IO_LIB_TEST_NO_OF_COUNTERS * sizeof (REGISTER_ACCESS_IO_HOT_ACCESS));
+  UT_ASSERT_NOT_NULL (AllEntries);
+  RegisterAccessIoSetThreadSafe (TRUE);
+  RegisterAccessIoHotAccessEnable (TRUE);
+  UT_ASSERT_EQUAL (thrd_create (&Thread, RegisterAccessIoCounterGrowTestWorker, NULL), thrd_success);
+  for (Index = 0; Index < 100; Index++) {
+    NoOfEntries = REGISTER_ACCESS_IO_LIB_TEST_NO_OF_COUNTERS;
+    UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoHotAccessGetTop (AllEntries, &NoOfEntries));
+  }
+  thrd_join (Thread, NULL);
+  RegisterAccessIoHotAccessEnable (FALSE);
+  RegisterAccessIoSetThreadSafe (FALSE);
+
+  NoOfEntries = REGISTER_ACCESS_IO_LIB_TEST_NO_OF_COUNTERS;
+  Status = RegisterAccessIoHotAccessGetTop (AllEntries, &NoOfEntries);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NoOfEntries, REGISTER_ACCESS_IO_LIB_TEST_NO_OF_COUNTERS);
+  for (Index = 0; Index < NoOfEntries; Index++) {
+    UT_ASSERT_EQUAL (AllEntries[Index].Reads, 1);
+  }
+  FreePool (AllEntries);
+  RegisterAccessIoHotAccessReset ();
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoLatencyTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                          Status;
+  REGISTER_ACCESS_IO_LATENCY_STATS    Stats;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINT32                              Region;
+  UINTN                               Index;
+
+  RegisterAccessIoLatencyReset ();
+  RegisterAccessIoLatencyEnable (TRUE);
+  for (Index = 0; Index < 100; Index++) {
+    MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+    MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  }
+  RegisterAccessIoLatencyEnable (FALSE);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+
+  //
+  // Find the region of the MMIO registration done by the test prerequisite.
+  //
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  for (Region = RegionCount - 1; Region > 0; Region--) {
+    if (Regions[Region].Type == RegisterAccessTraceRegionMmio && Regions[Region].Base == REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS) {
+      break;
+    }
+  }
+  UT_ASSERT_NOT_EQUAL (Region, 0);
+
+  Status = RegisterAccessIoLatencyGetStats ((UINT16) Region, &Stats);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Stats.Count, 200);
+  UT_ASSERT_TRUE (Stats.Min <= Stats.P50);
+  UT_ASSERT_TRUE (Stats.P50 <= Stats.P99);
+  UT_ASSERT_TRUE (Stats.P99 <= Stats.Max);
+
+  RegisterAccessIoLatencyDump ();
+
+  RegisterAccessIoLatencyReset ();
+  Status = RegisterAccessIoLatencyGetStats ((UINT16) Region, &Stats);
+  UT_ASSERT_EQUAL (Status, EFI_NOT_FOUND);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoCallSiteTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                    Status;
+  REGISTER_ACCESS_IO_CALL_SITE  Entries[4];
+  UINTN                         NoOfEntries;
+  UINTN                         Index;
+
+  RegisterAccessIoCallSiteReset ();
+  RegisterAccessIoCallSiteEnable (TRUE);
+  for (Index = 0; Index < 100; Index++) {
+    MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  }
+  MmioOr32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, BIT0);
+  MmioOr32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, BIT1);
+  RegisterAccessIoCallSiteEnable (FALSE);
+
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+
+  NoOfEntries = ARRAY_SIZE (Entries);
+  Status = RegisterAccessIoCallSiteGetTop (Entries, &NoOfEntries);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NoOfEntries, 3);
+
+  UT_ASSERT_EQUAL (Entries[0].Offset, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  UT_ASSERT_EQUAL (Entries[0].Reads, 100);
+  UT_ASSERT_EQUAL (Entries[0].Writes, 0);
+
+  //
+  // Read and write issued by MmioOr32 are attributed to its caller, so each
+  // call gets its own entry holding both accesses.
+  //
+  for (Index = 1; Index < 3; Index++) {
+    UT_ASSERT_EQUAL (Entries[Index].Offset, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS);
+    UT_ASSERT_EQUAL (Entries[Index].Reads, 1);
+    UT_ASSERT_EQUAL (Entries[Index].Writes, 1);
+    UT_ASSERT_NOT_EQUAL (Entries[Index].CallSite, Entries[0].CallSite);
+  }
+  UT_ASSERT_NOT_EQUAL (Entries[1].CallSite, Entries[2].CallSite);
+
+  RegisterAccessIoCallSiteDump (ARRAY_SIZE (Entries));
+
+  Status = RegisterAccessIoCallSiteSave ("RegisterAccessIoLibUnitTest.callsites");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTest.callsites", "\t0x"), 3);
+
+  RegisterAccessIoCallSiteReset ();
+  NoOfEntries = ARRAY_SIZE (Entries);
+  Status = RegisterAccessIoCallSiteGetTop (Entries, &NoOfEntries);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NoOfEntries, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoStatsTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                          Status;
+  REGISTER_ACCESS_IO_STATS            Stats;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINT32                              Region;
+
+  RegisterAccessIoStatsReset ();
+  RegisterAccessIoStatsEnable (TRUE);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  MmioRead16 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS + 1);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  MmioOr32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, BIT0);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_SIZE);
+  RegisterAccessIoStatsEnable (FALSE);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+
+  //
+  // Find the region of the MMIO registration done by the test prerequisite.
+  //
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  for (Region = RegionCount - 1; Region > 0; Region--) {
+    if (Regions[Region].Type == RegisterAccessTraceRegionMmio && Regions[Region].Base == REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS) {
+      break;
+    }
+  }
+  UT_ASSERT_NOT_EQUAL (Region, 0);
+
+  Status = RegisterAccessIoStatsGet ((UINT16) Region, &Stats);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Stats.Reads, 3);
+  UT_ASSERT_EQUAL (Stats.Writes, 2);
+  UT_ASSERT_EQUAL (Stats.ReadBytes, 10);
+  UT_ASSERT_EQUAL (Stats.WriteBytes, 8);
+  UT_ASSERT_EQUAL (Stats.Misaligned, 1);
+  UT_ASSERT_EQUAL (Stats.ReadModifyWrites, 1);
+  UT_ASSERT_EQUAL (Stats.MapMisses, 0);
+
+  Status = RegisterAccessIoStatsGet (REGISTER_ACCESS_TRACE_REGION_UNMAPPED, &Stats);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Stats.Reads, 1);
+  UT_ASSERT_EQUAL (Stats.MapMisses, 1);
+
+  Status = RegisterAccessIoStatsGet ((UINT16) RegionCount, &Stats);
+  UT_ASSERT_EQUAL (Status, EFI_NOT_FOUND);
+
+  RegisterAccessIoStatsDump ();
+
+  Status = RegisterAccessIoStatsSave ("RegisterAccessIoLibUnitTest.stats");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (RegisterAccessIoCountLines ("RegisterAccessIoLibUnitTest.stats", "\t0x"), RegionCount);
+
+  Status = RegisterAccessIoStatsSaveAtExit ("RegisterAccessIoLibUnitTest.stats");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  RegisterAccessIoStatsReset ();
+  Status = RegisterAccessIoStatsGet ((UINT16) Region, &Stats);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Stats.Reads + Stats.Writes, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoCoverageTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                           Status;
+  REGISTER_ACCESS_IO_COVERAGE_SUMMARY  Summary;
+  REGISTER_ACCESS_IO_COVERAGE_SUMMARY  Summaries[4];
+  UINTN                                NoOfSummaries;
+  CONST REGISTER_ACCESS_TRACE_REGION   *Regions;
+  UINT32                               RegionCount;
+  UINT32                               Region;
+  UINTN                                Index;
+  CONST CHAR8                          *InputFiles[2];
+
+  RegisterAccessIoCoverageReset ();
+  RegisterAccessIoCoverageEnable (TRUE);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  MmioRead8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS + 2);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  RegisterAccessIoCoverageEnable (FALSE);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS);
+
+  //
+  // Find the region of the MMIO registration done by the test prerequisite.
+  //
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  for (Region = RegionCount - 1; Region > 0; Region--) {
+    if (Regions[Region].Type == RegisterAccessTraceRegionMmio && Regions[Region].Base == REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS) {
+      break;
+    }
+  }
+  UT_ASSERT_NOT_EQUAL (Region, 0);
+
+  Status = RegisterAccessIoCoverageGet ((UINT16) Region, &Summary);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Summary.Registers, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_SIZE / sizeof (UINT32));
+  UT_ASSERT_EQUAL (Summary.Read, 1);
+  UT_ASSERT_EQUAL (Summary.Written, 1);
+  UT_ASSERT_EQUAL (Summary.Accessed, 2);
+
+  Status = RegisterAccessIoCoverageSave ("RegisterAccessIoLibUnitTest.coverage1");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  //
+  // Coverage of a second test binary.
+  //
+  RegisterAccessIoCoverageReset ();
+  RegisterAccessIoCoverageEnable (TRUE);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_BUFFER_REG_ADDRESS);
+  RegisterAccessIoCoverageEnable (FALSE);
+  Status = RegisterAccessIoCoverageSave ("RegisterAccessIoLibUnitTest.coverage2");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoCoverageReset ();
+
+  InputFiles[0] = "RegisterAccessIoLibUnitTest.coverage1";
+  InputFiles[1] = "RegisterAccessIoLibUnitTest.coverage2";
+  Status = RegisterAccessIoCoverageMerge (InputFiles, ARRAY_SIZE (InputFiles), "RegisterAccessIoLibUnitTest.coverage");
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  NoOfSummaries = ARRAY_SIZE (Summaries);
+  Status = RegisterAccessIoCoverageReport ("RegisterAccessIoLibUnitTest.coverage", Summaries, &NoOfSummaries);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NoOfSummaries, 2);
+  for (Index = 0; Index < NoOfSummaries; Index++) {
+    if (Summaries[Index].Type == RegisterAccessTraceRegionMmio) {
+      UT_ASSERT_EQUAL (Summaries[Index].Read, 2);
+      UT_ASSERT_EQUAL (Summaries[Index].Written, 1);
+      UT_ASSERT_EQUAL (Summaries[Index].Accessed, 3);
+    } else {
+      UT_ASSERT_EQUAL (Summaries[Index].Type, RegisterAccessTraceRegionIo);
+      UT_ASSERT_EQUAL (Summaries[Index].Accessed, 0);
+    }
+  }
+
+  Status = RegisterAccessIoCoverageReport ("RegisterAccessIoLibUnitTest.trace", NULL, NULL);
+  UT_ASSERT_EQUAL (Status, EFI_VOLUME_CORRUPTED);
+
+  return UNIT_TEST_PASSED;
+}
+
+typedef struct {
+  UINTN    Hits;
+  UINT64   Address;
+  UINT64   Value;
+  BOOLEAN  IsWrite;
+} TEST_WATCHPOINT_HITS;
+
+VOID
+TestWatchpointCallback (
+  IN VOID                            *Context,
+  IN UINTN                           Id,
+  IN REGISTER_ACCESS_IO_MEMORY_TYPE  Type,
+  IN UINT64                          Address,
+  IN UINT32                          Size,
+  IN UINT64                          Value,
+  IN BOOLEAN                         IsWrite
+  )
+{
+  TEST_WATCHPOINT_HITS  *Hits;
+
+  Hits = (TEST_WATCHPOINT_HITS*) Context;
+  Hits->Hits++;
+  Hits->Address = Address;
+  Hits->Value = Value;
+  Hits->IsWrite = IsWrite;
+
+  //
+  // Accesses from the callback must not trigger the watchpoint again.
+  //
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS);
+}
+
+#define REGISTER_ACCESS_IO_WATCHPOINT_TEST_ACCESSES  10000
+
+STATIC
+int
+RegisterAccessIoWatchpointTestWorker (
+  VOID  *Argument
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < REGISTER_ACCESS_IO_WATCHPOINT_TEST_ACCESSES; Index++) {
+    MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, (UINT32) Index);
+  }
+
+  return 0;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoWatchpointTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                     Status;
+  REGISTER_ACCESS_IO_WATCHPOINT  Watchpoint;
+  TEST_WATCHPOINT_HITS           RegisterHits;
+  TEST_WATCHPOINT_HITS           ValueHits;
+  UINTN                          RegisterId;
+  UINTN                          ValueId;
+  UINTN                          Index;
+  thrd_t                         Thread;
+  int                            Result;
+
+  ZeroMem (&RegisterHits, sizeof (RegisterHits));
+  ZeroMem (&ValueHits, sizeof (ValueHits));
+
+  ZeroMem (&Watchpoint, sizeof (Watchpoint));
+  Watchpoint.Type = RegisterAccessIoTypeMmio;
+  Watchpoint.AddressMin = REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS;
+  Watchpoint.AddressMax = Watchpoint.AddressMin + sizeof (UINT32) - 1;
+  Watchpoint.Access = REGISTER_ACCESS_IO_WATCH_READ | REGISTER_ACCESS_IO_WATCH_WRITE;
+  Watchpoint.Callback = TestWatchpointCallback;
+  Watchpoint.Context = &RegisterHits;
+  Status = RegisterAccessIoWatchpointAdd (&Watchpoint, &RegisterId);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Watchpoint.AddressMin = REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS;
+  Watchpoint.AddressMax = Watchpoint.AddressMin;
+  Watchpoint.Access = REGISTER_ACCESS_IO_WATCH_WRITE;
+  Watchpoint.ValueMask = 0xFF;
+  Watchpoint.ValueMatch = REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL8;
+  Watchpoint.Context = &ValueHits;
+  Status = RegisterAccessIoWatchpointAdd (&Watchpoint, &ValueId);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_EQUAL (RegisterHits.Hits, 1);
+  UT_ASSERT_EQUAL (RegisterHits.Address, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS);
+  UT_ASSERT_EQUAL (RegisterHits.Value, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_TRUE (RegisterHits.IsWrite);
+
+  //
+  // Accesses partially overlapping the range match, accesses next to it or
+  // to the same address in the other address space don't.
+  //
+  MmioRead8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS + 3);
+  UT_ASSERT_EQUAL (RegisterHits.Hits, 2);
+  UT_ASSERT_FALSE (RegisterHits.IsWrite);
+  MmioRead64 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  UT_ASSERT_EQUAL (RegisterHits.Hits, 3);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  IoWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_IO_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_EQUAL (RegisterHits.Hits, 3);
+
+  MmioWrite8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS, 0x11);
+  UT_ASSERT_EQUAL (ValueHits.Hits, 0);
+  MmioWrite8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL8);
+  UT_ASSERT_EQUAL (ValueHits.Hits, 1);
+  UT_ASSERT_EQUAL (ValueHits.Value, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL8);
+
+  Status = RegisterAccessIoWatchpointRemove (RegisterId);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = RegisterAccessIoWatchpointRemove (RegisterId);
+  UT_ASSERT_EQUAL (Status, EFI_NOT_FOUND);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_EQUAL (RegisterHits.Hits, 3);
+
+  //
+  // Watchpoints change while another thread accesses registers. Watchpoint
+  // armed for the whole time sees every access.
+  //
+  ZeroMem (&RegisterHits, sizeof (RegisterHits));
+  Watchpoint.AddressMin = REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS;
+  Watchpoint.AddressMax = Watchpoint.AddressMin + sizeof (UINT32) - 1;
+  Watchpoint.ValueMask = 0;
+  Watchpoint.ValueMatch = 0;
+  Watchpoint.Context = &RegisterHits;
+  Status = RegisterAccessIoWatchpointAdd (&Watchpoint, &RegisterId);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoSetThreadSafe (TRUE);
+  UT_ASSERT_EQUAL (thrd_create (&Thread, RegisterAccessIoWatchpointTestWorker, NULL), thrd_success);
+  Watchpoint.AddressMin = REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS;
+  Watchpoint.AddressMax = Watchpoint.AddressMin;
+  Watchpoint.Context = &ValueHits;
+  for (Index = 0; Index < 100; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoWatchpointRemove (ValueId));
+    UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoWatchpointAdd (&Watchpoint, &ValueId));
+  }
+  thrd_join (Thread, &Result);
+  RegisterAccessIoSetThreadSafe (FALSE);
+  UT_ASSERT_EQUAL (Result, 0);
+  UT_ASSERT_EQUAL (RegisterHits.Hits, REGISTER_ACCESS_IO_WATCHPOINT_TEST_ACCESSES);
+
+  RegisterAccessIoWatchpointRemoveAll ();
+  MmioWrite8 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL8);
+  UT_ASSERT_EQUAL (ValueHits.Hits, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+#define REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS   4
+#define REGISTER_ACCESS_IO_THREAD_SAFE_TEST_ACCESSES  10000
+
+STATIC
+int
+RegisterAccessIoThreadSafeTestWorker (
+  VOID  *Argument
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < REGISTER_ACCESS_IO_THREAD_SAFE_TEST_ACCESSES; Index++) {
+    MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_FIFO_TEST_REG_ADDRESS, (UINT32) Index);
+    if (MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS) != REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_VALUE) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoThreadSafeTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT  *Device;
+  thrd_t                                  Threads[REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS];
+  int                                     Result;
+  UINTN                                   Index;
+  UINTN                                   Failures;
+  REGISTER_ACCESS_TRACE_RECORD            *Records;
+  UINTN                                   RecordCount;
+  UINTN                                   Record;
+  UINTN                                   Collection;
+
+  Device = DEVICE_FROM_CONTEXT (Context);
+
+  //
+  // Test device counts writes without any synchronization of its own so
+  // every lost update shows up as a missing count.
+  //
+  RegisterAccessIoSetThreadSafe (TRUE);
+  Device->WriteCount = 0;
+  Device->FifoCount = 0;
+  for (Index = 0; Index < REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS; Index++) {
+    UT_ASSERT_EQUAL (thrd_create (&Threads[Index], RegisterAccessIoThreadSafeTestWorker, NULL), thrd_success);
+  }
+  Failures = 0;
+  for (Index = 0; Index < REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS; Index++) {
+    thrd_join (Threads[Index], &Result);
+    Failures += (Result != 0) ? 1 : 0;
+  }
+  RegisterAccessIoSetThreadSafe (FALSE);
+
+  UT_ASSERT_EQUAL (Failures, 0);
+  UT_ASSERT_EQUAL (Device->WriteCount, REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS * REGISTER_ACCESS_IO_THREAD_SAFE_TEST_ACCESSES);
+  UT_ASSERT_EQUAL (Device->FifoCount, REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS * REGISTER_ACCESS_IO_THREAD_SAFE_TEST_ACCESSES);
+
+  //
+  // Write combining buffers are per thread and the shared line is flushed
+  // under the region lock.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetWriteCombining (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, TRUE));
+  RegisterAccessIoSetThreadSafe (TRUE);
+  Device->WriteCount = 0;
+  for (Index = 0; Index < REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS; Index++) {
+    UT_ASSERT_EQUAL (thrd_create (&Threads[Index], RegisterAccessIoThreadSafeTestWorker, NULL), thrd_success);
+  }
+  for (Index = 0; Index < REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS; Index++) {
+    thrd_join (Threads[Index], &Result);
+    Failures += (Result != 0) ? 1 : 0;
+  }
+  RegisterAccessIoSetThreadSafe (FALSE);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSetWriteCombining (RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, FALSE));
+
+  UT_ASSERT_EQUAL (Failures, 0);
+  UT_ASSERT_EQUAL (Device->WriteCount, REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS * REGISTER_ACCESS_IO_THREAD_SAFE_TEST_ACCESSES);
+
+  //
+  // Trace is collected while the threads are recording.
+  //
+  RegisterAccessIoTraceReset ();
+  RegisterAccessIoTraceEnable (TRUE);
+  for (Index = 0; Index < REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS; Index++) {
+    UT_ASSERT_EQUAL (thrd_create (&Threads[Index], RegisterAccessIoThreadSafeTestWorker, NULL), thrd_success);
+  }
+  for (Collection = 0; Collection < 4; Collection++) {
+    UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoTraceGetRecords (&Records, &RecordCount));
+    for (Record = 0; Record < RecordCount; Record++) {
+      UT_ASSERT_EQUAL (Records[Record].Width, 4);
+      UT_ASSERT_TRUE (Records[Record].Type == RegisterAccessTraceMmioWrite || Records[Record].Type == RegisterAccessTraceMmioRead);
+      UT_ASSERT_TRUE (Record == 0 || Records[Record].Timestamp >= Records[Record - 1].Timestamp);
+    }
+    if (Records != NULL) {
+      FreePool (Records);
+    }
+  }
+  for (Index = 0; Index < REGISTER_ACCESS_IO_THREAD_SAFE_TEST_THREADS; Index++) {
+    thrd_join (Threads[Index], &Result);
+    Failures += (Result != 0) ? 1 : 0;
+  }
+  RegisterAccessIoTraceEnable (FALSE);
+  RegisterAccessIoTraceReset ();
+  UT_ASSERT_EQUAL (Failures, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+#define REGISTER_ACCESS_IO_SIM_CONTEXT_TEST_THREADS   2
+#define REGISTER_ACCESS_IO_SIM_CONTEXT_TEST_ACCESSES  1000
+
+/**
+  Runs a device registered at the same address as the default context device
+  in a context of its own.
+
+  @param[in] Argument  Value the thread writes to its device.
+
+  @return 0 if thread only ever saw its own device.
+**/
+STATIC
+int
+RegisterAccessIoSimContextTestWorker (
+  VOID  *Argument
+  )
+{
+  REGISTER_ACCESS_IO_SIM_CONTEXT          *SimContext;
+  REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT  Device;
+  UINT32                                  Value;
+  UINTN                                   Index;
+  int                                     Result;
+
+  Value = (UINT32)(UINTN) Argument;
+  ZeroMem (&Device, sizeof (Device));
+  if (EFI_ERROR (RegisterAccessIoSimContextCreate (&SimContext))) {
+    return 1;
+  }
+  RegisterAccessIoSimContextSelect (SimContext);
+
+  Result = 1;
+  if (!EFI_ERROR (FakeRegisterSpaceCreate (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_NAME, FakeRegisterSpaceAlignmentDword, TestRegisterAccessIoDeviceWrite, TestRegisterAccessIoDeviceRead, &Device, &Device.RegisterAccess))) {
+    if (!EFI_ERROR (RegisterAccessIoRegisterMmioAtAddress (Device.RegisterAccess, RegisterAccessIoTypeMmio, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS, REGISTER_ACCESS_IO_LIB_TEST_DEVICE_SIZE))) {
+      Result = 0;
+      for (Index = 0; Index < REGISTER_ACCESS_IO_SIM_CONTEXT_TEST_ACCESSES; Index++) {
+        MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, Value);
+        if (Device.WriteRegister != Value) {
+          Result = 1;
+          break;
+        }
+      }
+      if (Device.WriteCount != REGISTER_ACCESS_IO_SIM_CONTEXT_TEST_ACCESSES) {
+        Result = 1;
+      }
+    }
+    FakeRegisterSpaceDestroy (Device.RegisterAccess);
+  }
+
+  //
+  // Destroying the context drops its registrations.
+  //
+  if (EFI_ERROR (RegisterAccessIoSimContextDestroy (SimContext))) {
+    Result = 1;
+  }
+  if (RegisterAccessIoSimContextGetCurrent () == SimContext) {
+    Result = 1;
+  }
+
+  return Result;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoSimContextTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT  *Device;
+  REGISTER_ACCESS_IO_SIM_CONTEXT          *DefaultContext;
+  REGISTER_ACCESS_IO_SIM_CONTEXT          *SimContext;
+  thrd_t                                  Threads[REGISTER_ACCESS_IO_SIM_CONTEXT_TEST_THREADS];
+  int                                     Result;
+  UINTN                                   Index;
+  UINTN                                   Failures;
+
+  Device = DEVICE_FROM_CONTEXT (Context);
+  DefaultContext = RegisterAccessIoSimContextGetCurrent ();
+  UT_ASSERT_NOT_NULL (DefaultContext);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimContextDestroy (NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimContextDestroy (DefaultContext), EFI_INVALID_PARAMETER);
+
+  //
+  // New context starts empty. Device registered in the default context is
+  // not visible in it.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimContextCreate (&SimContext));
+  UT_ASSERT_EQUAL (RegisterAccessIoSimContextSelect (SimContext), NULL);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimContextGetCurrent (), SimContext);
+  UT_ASSERT_NOT_EQUAL (MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS), REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_VALUE);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimContextSelect (NULL), SimContext);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimContextGetCurrent (), DefaultContext);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimContextDestroy (SimContext));
+
+  //
+  // Contexts on other threads register devices at the same address without
+  // affecting each other or the default context.
+  //
+  Device->WriteRegister = 0;
+  Device->WriteCount = 0;
+  for (Index = 0; Index < REGISTER_ACCESS_IO_SIM_CONTEXT_TEST_THREADS; Index++) {
+    UT_ASSERT_EQUAL (thrd_create (&Threads[Index], RegisterAccessIoSimContextTestWorker, (VOID*)(Index + 1)), thrd_success);
+  }
+  Failures = 0;
+  for (Index = 0; Index < REGISTER_ACCESS_IO_SIM_CONTEXT_TEST_THREADS; Index++) {
+    thrd_join (Threads[Index], &Result);
+    Failures += (Result != 0) ? 1 : 0;
+  }
+
+  UT_ASSERT_EQUAL (Failures, 0);
+  UT_ASSERT_EQUAL (Device->WriteRegister, 0);
+  UT_ASSERT_EQUAL (Device->WriteCount, 0);
+  UT_ASSERT_EQUAL (MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS), REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_VALUE);
+
+  return UNIT_TEST_PASSED;
+}
+
+#define REGISTER_ACCESS_IO_SIM_TIME_TEST_EVENTS          4
+#define REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME  50000
+#define REGISTER_ACCESS_IO_SIM_TIME_TEST_POLL_INTERVAL    1000
+
+typedef struct {
+  UINTN   Tags[REGISTER_ACCESS_IO_SIM_TIME_TEST_EVENTS];
+  UINT64  Times[REGISTER_ACCESS_IO_SIM_TIME_TEST_EVENTS];
+  UINTN   Count;
+} SIM_TIME_TEST_LOG;
+
+typedef struct {
+  SIM_TIME_TEST_LOG  *Log;
+  UINTN              Tag;
+} SIM_TIME_TEST_EVENT;
+
+VOID
+RegisterAccessIoSimTimeTestEvent (
+  IN VOID  *Context
+  )
+{
+  SIM_TIME_TEST_EVENT  *Event;
+
+  Event = (SIM_TIME_TEST_EVENT*) Context;
+  if (Event->Log->Count < REGISTER_ACCESS_IO_SIM_TIME_TEST_EVENTS) {
+    Event->Log->Tags[Event->Log->Count] = Event->Tag;
+    Event->Log->Times[Event->Log->Count] = RegisterAccessIoSimTimeGetNow ();
+  }
+  Event->Log->Count++;
+}
+
+VOID
+RegisterAccessIoSimTimeTestCompletion (
+  IN VOID  *Context
+  )
+{
+  ((REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT*) Context)->WriteRegister = REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoSimTimeTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT  *Device;
+  SIM_TIME_TEST_LOG                       Log;
+  SIM_TIME_TEST_EVENT                     Events[REGISTER_ACCESS_IO_SIM_TIME_TEST_EVENTS];
+  UINT64                                  CancelledId;
+  UINT64                                  Start;
+  UINTN                                   Index;
+  REGISTER_ACCESS_IO_SIM_CONTEXT          *SimContext;
+  REGISTER_ACCESS_IO_SIM_CONTEXT          *PreviousContext;
+
+  Device = DEVICE_FROM_CONTEXT (Context);
+  ZeroMem (&Log, sizeof (Log));
+  for (Index = 0; Index < REGISTER_ACCESS_IO_SIM_TIME_TEST_EVENTS; Index++) {
+    Events[Index].Log = &Log;
+    Events[Index].Tag = Index;
+  }
+
+  RegisterAccessIoSimTimeSetAccessCost (0);
+  RegisterAccessIoSimTimeReset ();
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow (), 0);
+
+  //
+  // Events run in time order, events scheduled for the same time in the
+  // order they were scheduled.
+  //
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeSchedule (0, NULL, NULL, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeSchedule (30000, RegisterAccessIoSimTimeTestEvent, &Events[0], NULL));
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeSchedule (10000, RegisterAccessIoSimTimeTestEvent, &Events[1], NULL));
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeSchedule (20000, RegisterAccessIoSimTimeTestEvent, &Events[3], &CancelledId));
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeSchedule (10000, RegisterAccessIoSimTimeTestEvent, &Events[2], NULL));
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeCancel (CancelledId));
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeCancel (CancelledId), EFI_NOT_FOUND);
+
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeWait (5000), 5000);
+  UT_ASSERT_EQUAL (Log.Count, 0);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeWait (1000000), 5000);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow (), 10000);
+  UT_ASSERT_EQUAL (Log.Count, 2);
+  UT_ASSERT_EQUAL (Log.Tags[0], 1);
+  UT_ASSERT_EQUAL (Log.Tags[1], 2);
+  UT_ASSERT_EQUAL (Log.Times[1], 10000);
+
+  RegisterAccessIoSimTimeAdvance (100000);
+  UT_ASSERT_EQUAL (Log.Count, 3);
+  UT_ASSERT_EQUAL (Log.Tags[2], 0);
+  UT_ASSERT_EQUAL (Log.Times[2], 30000);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow (), 110000);
+
+  //
+  // Every access takes the access cost.
+  //
+  RegisterAccessIoSimTimeSetAccessCost (100);
+  Start = RegisterAccessIoSimTimeGetNow ();
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  MmioWrite32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG1_ADDRESS, 0);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow () - Start, 200);
+
+  //
+  // Access cost belongs to the context, other contexts keep the default.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimContextCreate (&SimContext));
+  PreviousContext = RegisterAccessIoSimContextSelect (SimContext);
+  MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow (), REGISTER_ACCESS_IO_SIM_TIME_DEFAULT_ACCESS_COST);
+  RegisterAccessIoSimContextSelect (PreviousContext);
+  RegisterAccessIoSimContextDestroy (SimContext);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow () - Start, 200);
+
+  //
+  // Driver polling for a device operation completes as soon as the device
+  // model event fires.
+  //
+  Start = RegisterAccessIoSimTimeGetNow ();
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeSchedule (REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME, RegisterAccessIoSimTimeTestCompletion, Device, NULL));
+  for (Index = 0; Index < REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME; Index++) {
+    if (Device->WriteRegister == REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32) {
+      break;
+    }
+    MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+    RegisterAccessIoSimTimeWait (REGISTER_ACCESS_IO_SIM_TIME_TEST_POLL_INTERVAL);
+  }
+  UT_ASSERT_EQUAL (Device->WriteRegister, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  UT_ASSERT_TRUE (RegisterAccessIoSimTimeGetNow () - Start >= REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME);
+  UT_ASSERT_TRUE (RegisterAccessIoSimTimeGetNow () - Start < REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME + REGISTER_ACCESS_IO_SIM_TIME_TEST_POLL_INTERVAL);
+
+  RegisterAccessIoSimTimeSetAccessCost (REGISTER_ACCESS_IO_SIM_TIME_DEFAULT_ACCESS_COST);
+  RegisterAccessIoSimTimeReset ();
+
+  return UNIT_TEST_PASSED;
+}
+
+#define REGISTER_ACCESS_IO_INTERRUPT_TEST_VECTOR          5
+#define REGISTER_ACCESS_IO_INTERRUPT_TEST_DATA            0xFEE00000
+#define REGISTER_ACCESS_IO_INTERRUPT_TEST_THREADS         2
+#define REGISTER_ACCESS_IO_INTERRUPT_TEST_INTERRUPTS      10000
+#define REGISTER_ACCESS_IO_INTERRUPT_TEST_HOST_TIMEOUT    1000000000ULL
+
+typedef struct {
+  UINTN   Count;
+  UINT32  Vector;
+  UINT32  Data;
+  //
+  // Data of the last interrupt of each producer thread. Producers use thread
+  // index as the vector and raise data in increasing order.
+  //
+  UINT32  LastData[REGISTER_ACCESS_IO_INTERRUPT_TEST_THREADS];
+  UINTN   OutOfOrder;
+} INTERRUPT_TEST_LOG;
+
+VOID
+RegisterAccessIoInterruptTestHandler (
+  IN REGISTER_ACCESS_IO_INTERRUPT  *Interrupt,
+  IN VOID                          *Context
+  )
+{
+  INTERRUPT_TEST_LOG  *Log;
+
+  Log = (INTERRUPT_TEST_LOG*) Context;
+  Log->Count++;
+  Log->Vector = Interrupt->Vector;
+  Log->Data = Interrupt->Data;
+  if (Interrupt->Vector < REGISTER_ACCESS_IO_INTERRUPT_TEST_THREADS) {
+    if (Interrupt->Data != Log->LastData[Interrupt->Vector] + 1) {
+      Log->OutOfOrder++;
+    }
+    Log->LastData[Interrupt->Vector] = Interrupt->Data;
+  }
+}
+
+VOID
+RegisterAccessIoInterruptTestCompletion (
+  IN VOID  *Context
+  )
+{
+  ((REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT*) Context)->WriteRegister = REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32;
+  RegisterAccessIoInterruptRaise (NULL, REGISTER_ACCESS_IO_INTERRUPT_TEST_VECTOR, REGISTER_ACCESS_IO_INTERRUPT_TEST_DATA);
+}
+
+/**
+  Device model on its own thread raising interrupts into the context of the
+  driver. Retries interrupts lost to a full queue.
+
+  @param[in] Argument  Index of the thread, used as the vector.
+**/
+STATIC
+int
+RegisterAccessIoInterruptTestProducer (
+  VOID  *Argument
+  )
+{
+  UINT32  Vector;
+  UINT32  Data;
+
+  Vector = (UINT32)(UINTN) Argument;
+  for (Data = 1; Data <= REGISTER_ACCESS_IO_INTERRUPT_TEST_INTERRUPTS; Data++) {
+    while (RegisterAccessIoInterruptRaise (NULL, Vector, Data) == EFI_OUT_OF_RESOURCES) {
+      thrd_yield ();
+    }
+  }
+
+  return 0;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessIoInterruptTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_IO_TEST_DEVICE_CONTEXT  *Device;
+  REGISTER_ACCESS_IO_SIM_CONTEXT          *SimContext;
+  REGISTER_ACCESS_IO_INTERRUPT_STATS      Stats;
+  REGISTER_ACCESS_IO_INTERRUPT            Interrupt;
+  INTERRUPT_TEST_LOG                      Log;
+  thrd_t                                  Threads[REGISTER_ACCESS_IO_INTERRUPT_TEST_THREADS];
+  UINT64                                  Start;
+  UINTN                                   PollReads;
+  UINTN                                   Index;
+
+  Device = DEVICE_FROM_CONTEXT (Context);
+  SimContext = RegisterAccessIoSimContextGetCurrent ();
+  ZeroMem (&Log, sizeof (Log));
+  RegisterAccessIoSimTimeReset ();
+  RegisterAccessIoInterruptReset ();
+
+  UT_ASSERT_EQUAL (RegisterAccessIoInterruptRaise (NULL, REGISTER_ACCESS_IO_INTERRUPT_VECTORS, 0), EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (RegisterAccessIoInterruptSetHandler (REGISTER_ACCESS_IO_INTERRUPT_VECTORS, RegisterAccessIoInterruptTestHandler, &Log), EFI_INVALID_PARAMETER);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoInterruptSetHandler (REGISTER_ACCESS_IO_INTERRUPT_TEST_VECTOR, RegisterAccessIoInterruptTestHandler, &Log));
+  UT_ASSERT_FALSE (RegisterAccessIoInterruptIsPending ());
+  UT_ASSERT_EQUAL (RegisterAccessIoInterruptWait (1000), EFI_TIMEOUT);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow (), 1000);
+
+  //
+  // Driver polling the device for completion pays a register read per poll.
+  //
+  Device->WriteRegister = 0;
+  PollReads = 0;
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeSchedule (REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME, RegisterAccessIoSimTimeTestCompletion, Device, NULL));
+  while (Device->WriteRegister != REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32) {
+    MmioRead32 (REGISTER_ACCESS_IO_LIB_TEST_DEVICE_MEM_ADDRESS + REGISTER_ACCESS_IO_LIB_TEST_DEVICE_REG0_ADDRESS);
+    RegisterAccessIoSimTimeWait (REGISTER_ACCESS_IO_SIM_TIME_TEST_POLL_INTERVAL);
+    PollReads++;
+  }
+  UT_ASSERT_TRUE (PollReads >= REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME / (REGISTER_ACCESS_IO_SIM_TIME_TEST_POLL_INTERVAL + REGISTER_ACCESS_IO_SIM_TIME_DEFAULT_ACCESS_COST));
+
+  //
+  // Driver waiting for the interrupt reads nothing and wakes up exactly when
+  // the device completes.
+  //
+  Device->WriteRegister = 0;
+  Start = RegisterAccessIoSimTimeGetNow ();
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeSchedule (REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME, RegisterAccessIoInterruptTestCompletion, Device, NULL));
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoInterruptWait (REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME * 2));
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow () - Start, REGISTER_ACCESS_IO_SIM_TIME_TEST_COMPLETION_TIME);
+  UT_ASSERT_EQUAL (Device->WriteRegister, REGISTER_ACCESS_IO_LIB_WRITE_TEST_VAL32);
+  RegisterAccessIoSimTimeAdvance (REGISTER_ACCESS_IO_SIM_TIME_TEST_POLL_INTERVAL);
+  UT_ASSERT_EQUAL (RegisterAccessIoInterruptDispatch (), 1);
+  UT_ASSERT_EQUAL (Log.Count, 1);
+  UT_ASSERT_EQUAL (Log.Vector, REGISTER_ACCESS_IO_INTERRUPT_TEST_VECTOR);
+  UT_ASSERT_EQUAL (Log.Data, REGISTER_ACCESS_IO_INTERRUPT_TEST_DATA);
+  UT_ASSERT_FALSE (RegisterAccessIoInterruptIsPending ());
+
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoInterruptGetStats (&Stats));
+  UT_ASSERT_EQUAL (Stats.Raised, 1);
+  UT_ASSERT_EQUAL (Stats.Dispatched, 1);
+  UT_ASSERT_EQUAL (Stats.TotalLatency, REGISTER_ACCESS_IO_SIM_TIME_TEST_POLL_INTERVAL);
+  UT_ASSERT_EQUAL (Stats.MaxLatency, REGISTER_ACCESS_IO_SIM_TIME_TEST_POLL_INTERVAL);
+
+  //
+  // Interrupts without a handler are counted. Full queue loses interrupts.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoInterruptRaise (NULL, REGISTER_ACCESS_IO_INTERRUPT_TEST_VECTOR + 1, 0));
+  UT_ASSERT_EQUAL (RegisterAccessIoInterruptDispatch (), 1);
+  UT_ASSERT_EQUAL (Log.Count, 1);
+  for (Index = 0; Index < REGISTER_ACCESS_IO_INTERRUPT_QUEUE_SIZE; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoInterruptRaise (SimContext, REGISTER_ACCESS_IO_INTERRUPT_TEST_VECTOR, (UINT32) Index));
+  }
+  UT_ASSERT_EQUAL (RegisterAccessIoInterruptRaise (SimContext, REGISTER_ACCESS_IO_INTERRUPT_TEST_VECTOR, 0), EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_TRUE (RegisterAccessIoInterruptPop (&Interrupt));
+  UT_ASSERT_EQUAL (Interrupt.Data, 0);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoInterruptGetStats (&Stats));
+  UT_ASSERT_EQUAL (Stats.Unhandled, 1);
+  UT_ASSERT_EQUAL (Stats.Lost, 1);
+  RegisterAccessIoInterruptReset ();
+  UT_ASSERT_FALSE (RegisterAccessIoInterruptIsPending ());
+
+  //
+  // Device models on other threads raise interrupts concurrently while the
+  // driver dispatches them. Every interrupt arrives once and in the order its
+  // device raised it.
+  //
+  ZeroMem (&Log, sizeof (Log));
+  for (Index = 0; Index < REGISTER_ACCESS_IO_INTERRUPT_TEST_THREADS; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoInterruptSetHandler ((UINT32) Index, RegisterAccessIoInterruptTestHandler, &Log));
+  }
+  RegisterAccessIoSetThreadSafe (TRUE);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeRegisterNotifier (SimContext));
+  for (Index = 0; Index < REGISTER_ACCESS_IO_INTERRUPT_TEST_THREADS; Index++) {
+    UT_ASSERT_EQUAL (thrd_create (&Threads[Index], RegisterAccessIoInterruptTestProducer, (VOID*) Index), thrd_success);
+  }
+  while (Log.Count < REGISTER_ACCESS_IO_INTERRUPT_TEST_THREADS * REGISTER_ACCESS_IO_INTERRUPT_TEST_INTERRUPTS) {
+    if (RegisterAccessIoInterruptWait (REGISTER_ACCESS_IO_INTERRUPT_TEST_HOST_TIMEOUT) == EFI_TIMEOUT) {
+      break;
+    }
+    RegisterAccessIoInterruptDispatch ();
+  }
+  for (Index = 0; Index < REGISTER_ACCESS_IO_INTERRUPT_TEST_THREADS; Index++) {
+    thrd_join (Threads[Index], NULL);
+  }
+  RegisterAccessIoSimTimeUnregisterNotifier (SimContext);
+  RegisterAccessIoSetThreadSafe (FALSE);
+
+  UT_ASSERT_EQUAL (Log.Count, REGISTER_ACCESS_IO_INTERRUPT_TEST_THREADS * REGISTER_ACCESS_IO_INTERRUPT_TEST_INTERRUPTS);
+  UT_ASSERT_EQUAL (Log.OutOfOrder, 0);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoInterruptGetStats (&Stats));
+  UT_ASSERT_EQUAL (Stats.Raised - Stats.Lost, Stats.Dispatched);
+
+  RegisterAccessIoInterruptReset ();
+  RegisterAccessIoSimTimeReset ();
+
+  return UNIT_TEST_PASSED;
+}
+
 EFI_STATUS
 EFIAPI
 UefiTestMain (
@@ -449,6 +2069,23 @@ UefiTestMain (
   AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoBufferRw8Test", "RegisterAccessIoBufferRw8Test", RegisterAccessIoBufferRw8Test, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
   AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoBufferRw16Test", "RegisterAccessIoBufferRw16Test", RegisterAccessIoBufferRw16Test, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
   AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoBufferRw32Test", "RegisterAccessIoBufferRw32Test", RegisterAccessIoBufferRw32Test, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoWriteCombiningTest", "RegisterAccessIoWriteCombiningTest", RegisterAccessIoWriteCombiningTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoWriteErrorTest", "RegisterAccessIoWriteErrorTest", RegisterAccessIoWriteErrorTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoPostedWriteTest", "RegisterAccessIoPostedWriteTest", RegisterAccessIoPostedWriteTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoTraceTest", "RegisterAccessIoTraceTest", RegisterAccessIoTraceTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoTraceSamplingTest", "RegisterAccessIoTraceSamplingTest", RegisterAccessIoTraceSamplingTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoTraceFilterTest", "RegisterAccessIoTraceFilterTest", RegisterAccessIoTraceFilterTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoTraceChromeTest", "RegisterAccessIoTraceChromeTest", RegisterAccessIoTraceChromeTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoHotAccessTest", "RegisterAccessIoHotAccessTest", RegisterAccessIoHotAccessTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoLatencyTest", "RegisterAccessIoLatencyTest", RegisterAccessIoLatencyTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoCallSiteTest", "RegisterAccessIoCallSiteTest", RegisterAccessIoCallSiteTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoStatsTest", "RegisterAccessIoStatsTest", RegisterAccessIoStatsTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoCoverageTest", "RegisterAccessIoCoverageTest", RegisterAccessIoCoverageTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoWatchpointTest", "RegisterAccessIoWatchpointTest", RegisterAccessIoWatchpointTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoThreadSafeTest", "RegisterAccessIoThreadSafeTest", RegisterAccessIoThreadSafeTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoSimContextTest", "RegisterAccessIoSimContextTest", RegisterAccessIoSimContextTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoSimTimeTest", "RegisterAccessIoSimTimeTest", RegisterAccessIoSimTimeTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
+  AddTestCase (RegisterAccessIoLibTest, "RegisterAccessIoInterruptTest", "RegisterAccessIoInterruptTest", RegisterAccessIoInterruptTest, RegisterAccessIoTestPrerequisite, RegisterAccessIoTestCleanup, &TestContext);
 
   Status = RunAllTestSuites (Framework);
   if (Framework) {
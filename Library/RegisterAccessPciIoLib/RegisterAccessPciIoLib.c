@@ -9,6 +9,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/UefiLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/PcdLib.h>
 #include <Library/RegisterAccessPciSegmentLib.h>
 #include <Library/RegisterAccessPciLib.h>
 
@@ -48,6 +50,93 @@ UINT8  mOutStride[] = {
   0  // EfiPciWidthFillUint64
 };
 
+STATIC
+VOID
+PciIoTraceTimed (
+  IN REGISTER_ACCESS_PCI_DEVICE  *PciDev,
+  IN REGISTER_ACCESS_TRACE_TYPE  Type,
+  IN UINT64                      Address,
+  IN UINT8                       Width,
+  IN UINT64                      Value,
+  IN UINT64                      Start
+  )
+{
+  UINT64  Elapsed;
+
+  if (!gRegisterAccessIoTraceEnabled) {
+    return;
+  }
+
+  Elapsed = RegisterAccessIoTraceGetTimestamp () - Start;
+  RegisterAccessIoTraceRecord (Type, PciDev->TraceRegion, Address, Width, Value, (UINT32) MIN (Elapsed, MAX_UINT32));
+}
+
+STATIC
+VOID
+PciIoTraceConfig (
+  IN REGISTER_ACCESS_PCI_DEVICE  *PciDev,
+  IN REGISTER_ACCESS_TRACE_TYPE  Type,
+  IN UINT64                      Offset,
+  IN UINTN                       Size,
+  IN UINT8                       *Buffer
+  )
+{
+  UINT64  Value;
+
+  if (!gRegisterAccessIoTraceEnabled) {
+    return;
+  }
+
+  Value = 0;
+  CopyMem (&Value, Buffer, MIN (Size, sizeof (Value)));
+  RegisterAccessIoTraceRecord (Type, PciDev->TraceRegion, Offset, (UINT8) Size, Value, 0);
+}
+
+//
+// Virtual time between reads of a poll when only the reads themselves can
+// change the device state.
+//
+#define REGISTER_ACCESS_PCI_IO_POLL_INTERVAL  10000
+
+/**
+  Waits before the next read of a poll. Jumps straight to the next device
+  event or blocks on a notification of a device running on another thread.
+
+  @param[in]     PollStart  Virtual time the poll started at.
+  @param[in]     Timeout    Timeout of the poll in nanoseconds.
+  @param[in,out] Waited     Time spent waiting by the poll so far.
+
+  @return TRUE if the poll timed out.
+**/
+STATIC
+BOOLEAN
+PciIoPollWait (
+  IN     UINT64  PollStart,
+  IN     UINT64  Timeout,
+  IN OUT UINT64  *Waited
+  )
+{
+  UINT64  Elapsed;
+  UINT64  Remaining;
+
+  //
+  // Waits don't advance time when called from a device event callback so
+  // the time spent waiting is counted as well.
+  //
+  Elapsed = MAX (RegisterAccessIoSimTimeGetNow () - PollStart, *Waited);
+  if (Elapsed >= Timeout) {
+    return TRUE;
+  }
+
+  Remaining = Timeout - Elapsed;
+  if (RegisterAccessIoSimTimeIsIdle ()) {
+    Remaining = MIN (Remaining, REGISTER_ACCESS_PCI_IO_POLL_INTERVAL);
+  }
+  *Waited += RegisterAccessIoSimTimeWait (Remaining);
+
+  return FALSE;
+}
+
 EFI_STATUS
 EFIAPI
 RegisterAccessPciIoPollMem (
@@ -61,33 +150,49 @@ RegisterAccessPciIoPollMem (
   OUT UINT64                       *Result
   )
 {
-  EFI_STATUS Status;
+  EFI_STATUS                  Status;
+  REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+  UINT64                      Start;
+  UINT64                      Timeout;
+  UINT64                      PollStart;
+  UINT64                      Waited;
+  BOOLEAN                     CallSiteOwner;
 
   if (This == NULL || Result == NULL) {
     return EFI_INVALID_PARAMETER;
   }
- 
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  PciDev = ((REGISTER_ACCESS_PCI_IO*) This)->PciDev;
+  Start = gRegisterAccessIoTraceEnabled ? RegisterAccessIoTraceGetTimestamp () : 0;
+
   //
-  // On simulation any update to registers should be instantainous but keep it
-  // implemented similar to HW implementation anyway. Might be useful if in the
-  // future simulation runs on a separate thread.
+  // Delay is in 100 ns units and runs on the virtual time of the simulation
+  // context.
   //
+  Timeout = (Delay > DivU64x32 (MAX_UINT64, 100)) ? MAX_UINT64 : MultU64x32 (Delay, 100);
+  PollStart = RegisterAccessIoSimTimeGetNow ();
+  Waited = 0;
   *Result = 0;
   do {
     Status = This->Mem.Read (This, Width, BarIndex, Offset, 1, Result);
     if (EFI_ERROR (Status)) {
-      return Status;
+      break;
     }
 
     if ((*Result & Mask) == Value) {
-      return EFI_SUCCESS;
+      break;
     }
 
-    if (Delay <= 100) {
-      return EFI_TIMEOUT;
+    if (PciIoPollWait (PollStart, Timeout, &Waited)) {
+      Status = EFI_TIMEOUT;
+      break;
     }
-    Delay -= 100;
   } while (TRUE);
+
+  PciIoTraceTimed (PciDev, RegisterAccessTracePciPollMem, PciDev->BarAddress[BarIndex] + Offset, (UINT8)(1 << (Width & 0x03)), *Result, Start);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Status;
 }
 
 EFI_STATUS
@@ -103,33 +208,49 @@ RegisterAccessPciIoPollIo (
   OUT UINT64                       *Result
   )
 {
-  EFI_STATUS Status;
+  EFI_STATUS                  Status;
+  REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+  UINT64                      Start;
+  UINT64                      Timeout;
+  UINT64                      PollStart;
+  UINT64                      Waited;
+  BOOLEAN                     CallSiteOwner;
 
   if (This == NULL || Result == NULL) {
     return EFI_INVALID_PARAMETER;
   }
- 
+
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
+  PciDev = ((REGISTER_ACCESS_PCI_IO*) This)->PciDev;
+  Start = gRegisterAccessIoTraceEnabled ? RegisterAccessIoTraceGetTimestamp () : 0;
+
   //
-  // On simulation any update to registers should be instantainous but keep it
-  // implemented similar to HW implementation anyway. Might be useful if in the
-  // future simulation runs on a separate thread.
+  // Delay is in 100 ns units and runs on the virtual time of the simulation
+  // context.
   //
+  Timeout = (Delay > DivU64x32 (MAX_UINT64, 100)) ? MAX_UINT64 : MultU64x32 (Delay, 100);
+  PollStart = RegisterAccessIoSimTimeGetNow ();
+  Waited = 0;
   *Result = 0;
   do {
     Status = This->Io.Read (This, Width, BarIndex, Offset, 1, Result);
     if (EFI_ERROR (Status)) {
-      return Status;
+      break;
     }
 
     if ((*Result & Mask) == Value) {
-      return EFI_SUCCESS;
+      break;
     }
 
-    if (Delay <= 100) {
-      return EFI_TIMEOUT;
+    if (PciIoPollWait (PollStart, Timeout, &Waited)) {
+      Status = EFI_TIMEOUT;
+      break;
     }
-    Delay -= 100;
   } while (TRUE);
+
+  PciIoTraceTimed (PciDev, RegisterAccessTracePciPollIo, PciDev->BarAddress[BarIndex] + Offset, (UINT8)(1 << (Width & 0x03)), *Result, Start);
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
+  return Status;
 }
 
 EFI_STATUS
@@ -150,7 +271,9 @@ RegisterAccessPciIoReadMem (
   UINT64                    Address;
   REGISTER_ACCESS_PCI_IO  *PciIo;
   REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+  BOOLEAN                     CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   PciIo = (REGISTER_ACCESS_PCI_IO*) This;
   PciDev = PciIo->PciDev;
   Address = PciDev->BarAddress[BarIndex] + Offset;
@@ -169,6 +292,7 @@ RegisterAccessPciIoReadMem (
     }
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return EFI_SUCCESS;
 }
 
@@ -190,7 +314,9 @@ RegisterAccessPciIoWriteMem (
   UINT64                    Address;
   REGISTER_ACCESS_PCI_IO  *PciIo;
   REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+  BOOLEAN                     CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   PciIo = (REGISTER_ACCESS_PCI_IO*) This;
   PciDev = PciIo->PciDev;
   Address = PciDev->BarAddress[BarIndex] + Offset;
@@ -209,6 +335,7 @@ RegisterAccessPciIoWriteMem (
     }
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return EFI_SUCCESS;
 }
 
@@ -230,7 +357,9 @@ RegisterAccessPciIoReadIo (
   UINT64                    Address;
   REGISTER_ACCESS_PCI_IO  *PciIo;
   REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+  BOOLEAN                     CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   PciIo = (REGISTER_ACCESS_PCI_IO*) This;
   PciDev = PciIo->PciDev;
   Address = PciDev->BarAddress[BarIndex] + Offset;
@@ -246,12 +375,15 @@ RegisterAccessPciIoReadIo (
     switch (OperationWidth) {
       case EfiPciIoWidthUint8:
         IoReadFifo8 ((UINTN)Address, Count, Buffer);
+        REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
         return EFI_SUCCESS;
       case EfiPciIoWidthUint16:
         IoReadFifo16 ((UINTN)Address, Count, Buffer);
+        REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
         return EFI_SUCCESS;
       case EfiPciIoWidthUint32:
         IoReadFifo32 ((UINTN)Address, Count, Buffer);
+        REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
         return EFI_SUCCESS;
       default:
         //
@@ -273,6 +405,7 @@ RegisterAccessPciIoReadIo (
     }
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return EFI_SUCCESS;
 }
 
@@ -294,7 +427,9 @@ RegisterAccessPciIoWriteIo (
   UINT64                    Address;
   REGISTER_ACCESS_PCI_IO  *PciIo;
   REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+  BOOLEAN                     CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   PciIo = (REGISTER_ACCESS_PCI_IO*) This;
   PciDev = PciIo->PciDev;
   Address = PciDev->BarAddress[BarIndex] + Offset;
@@ -310,12 +445,15 @@ RegisterAccessPciIoWriteIo (
     switch (OperationWidth) {
       case EfiPciIoWidthUint8:
         IoWriteFifo8 ((UINTN)Address, Count, Buffer);
+        REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
         return EFI_SUCCESS;
       case EfiPciIoWidthUint16:
         IoWriteFifo16 ((UINTN)Address, Count, Buffer);
+        REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
         return EFI_SUCCESS;
       case EfiPciIoWidthUint32:
         IoWriteFifo32 ((UINTN)Address, Count, Buffer);
+        REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
         return EFI_SUCCESS;
       default:
         //
@@ -337,6 +475,7 @@ RegisterAccessPciIoWriteIo (
     }
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return EFI_SUCCESS;
 }
 
@@ -357,7 +496,9 @@ RegisterAccessPciIoConfigRead (
   UINT64                                       Address;
   REGISTER_ACCESS_PCI_IO  *PciIo;
   REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+  BOOLEAN                                      CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   PciIo = (REGISTER_ACCESS_PCI_IO*) This;
   PciDev = PciIo->PciDev;
 
@@ -367,8 +508,10 @@ RegisterAccessPciIoConfigRead (
   Address = PciDev->PciSegmentBase + Offset;
   for (Uint8Buffer = Buffer; Count > 0; Address += InStride, Uint8Buffer += OutStride, Count--) {
     PciSegmentReadBuffer (Address, Size, Uint8Buffer);
+    PciIoTraceConfig (PciDev, RegisterAccessTracePciConfigRead, Address - PciDev->PciSegmentBase, Size, Uint8Buffer);
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return EFI_SUCCESS;
 }
 
@@ -389,7 +532,9 @@ RegisterAccessPciIoConfigWrite (
   UINT64                                       Address;
   REGISTER_ACCESS_PCI_IO  *PciIo;
   REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+  BOOLEAN                                      CallSiteOwner;
 
+  REGISTER_ACCESS_IO_CALL_SITE_ENTER (CallSiteOwner);
   PciIo = (REGISTER_ACCESS_PCI_IO*) This;
   PciDev = PciIo->PciDev;
   Address = PciDev->PciSegmentBase + Offset;
@@ -397,9 +542,11 @@ RegisterAccessPciIoConfigWrite (
   OutStride = mOutStride[Width];
   Size      = (UINTN)(1 << (Width & 0x03));
   for (Uint8Buffer = Buffer; Count > 0; Address += InStride, Uint8Buffer += OutStride, Count--) {
+    PciIoTraceConfig (PciDev, RegisterAccessTracePciConfigWrite, Address - PciDev->PciSegmentBase, Size, Uint8Buffer);
     PciSegmentWriteBuffer (Address, Size, Uint8Buffer);
   }
 
+  REGISTER_ACCESS_IO_CALL_SITE_EXIT (CallSiteOwner);
   return EFI_SUCCESS;
 }
 
@@ -418,19 +565,11 @@ RegisterAccessPciIoCopyMem (
   return EFI_UNSUPPORTED;
 }
 
-typedef struct {
-  BOOLEAN  Used;
-  VOID*   HostAddress;
-  UINT32   DeviceAddress;
-} DEVICE_MEMORY_MAPPING;
-
-DEVICE_MEMORY_MAPPING  gDeviceMemoryMapping[5] = {
-  {0, 0, 0x10},
-  {0, 0, 0x20},
-  {0, 0, 0x30},
-  {0, 0, 0x40},
-  {0, 0, 0x50}
-};
+//
+// Device address of the DMA mapping slot. Slots live in the simulation context
+// selected by the calling thread.
+//
+#define REGISTER_ACCESS_PCI_IO_DMA_DEVICE_ADDRESS(Index)  (((UINT32) (Index) + 1) * 0x10)
 
 EFI_STATUS
 EFIAPI
@@ -443,17 +582,35 @@ RegisterAccessPciIoMap (
   OUT    VOID                           **Mapping
   )
 {
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *Context;
+  REGISTER_ACCESS_IO_DMA_MAPPING  *DmaMapping;
+
   DEBUG ((DEBUG_INFO, "Calling to map address %LX\n", HostAddress));
-  for (UINT8 Index = 0; Index < ARRAY_SIZE (gDeviceMemoryMapping); Index++) {
-    if (gDeviceMemoryMapping[Index].Used == FALSE) {
-      gDeviceMemoryMapping[Index].Used = TRUE;
-      *DeviceAddress = (EFI_PHYSICAL_ADDRESS)gDeviceMemoryMapping[Index].DeviceAddress;
-      gDeviceMemoryMapping[Index].HostAddress = HostAddress;
-      *Mapping = &gDeviceMemoryMapping[Index];
+  Context = RegisterAccessIoSimContextGetCurrent ();
+  REGISTER_ACCESS_IO_LOCK (&Context->DmaMappingLock);
+  for (UINT8 Index = 0; Index < ARRAY_SIZE (Context->DmaMappings); Index++) {
+    DmaMapping = &Context->DmaMappings[Index];
+    if (DmaMapping->Used == FALSE) {
+      DmaMapping->Used = TRUE;
+      DmaMapping->DeviceAddress = REGISTER_ACCESS_PCI_IO_DMA_DEVICE_ADDRESS (Index);
+      DmaMapping->HostAddress = HostAddress;
+      *DeviceAddress = (EFI_PHYSICAL_ADDRESS) DmaMapping->DeviceAddress;
+      *Mapping = DmaMapping;
+      REGISTER_ACCESS_IO_UNLOCK (&Context->DmaMappingLock);
+      REGISTER_ACCESS_IO_TRACE (
+        RegisterAccessTracePciMap,
+        ((REGISTER_ACCESS_PCI_IO*) This)->PciDev->TraceRegion,
+        *DeviceAddress,
+        0,
+        (UINT64)(UINTN) HostAddress,
+        0
+        );
       return EFI_SUCCESS;
     }
   }
+  REGISTER_ACCESS_IO_UNLOCK (&Context->DmaMappingLock);
 
+  REGISTER_ACCESS_IO_STATS_MAP_MISS (((REGISTER_ACCESS_PCI_IO*) This)->PciDev->TraceRegion);
   return EFI_OUT_OF_RESOURCES;
 }
 
@@ -464,11 +621,23 @@ RegisterAccessPciIoUnmap (
   IN  VOID                         *Mapping
   )
 {
-  DEVICE_MEMORY_MAPPING  *DeviceMapping;
-
-  DeviceMapping = (DEVICE_MEMORY_MAPPING*) Mapping;
-  DeviceMapping->HostAddress = 0;
-  DeviceMapping->Used = FALSE;
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *Context;
+  REGISTER_ACCESS_IO_DMA_MAPPING  *DmaMapping;
+
+  DmaMapping = (REGISTER_ACCESS_IO_DMA_MAPPING*) Mapping;
+  REGISTER_ACCESS_IO_TRACE (
+    RegisterAccessTracePciUnmap,
+    ((REGISTER_ACCESS_PCI_IO*) This)->PciDev->TraceRegion,
+    DmaMapping->DeviceAddress,
+    0,
+    (UINT64)(UINTN) DmaMapping->HostAddress,
+    0
+    );
+  Context = RegisterAccessIoSimContextGetCurrent ();
+  REGISTER_ACCESS_IO_LOCK (&Context->DmaMappingLock);
+  DmaMapping->HostAddress = NULL;
+  DmaMapping->Used = FALSE;
+  REGISTER_ACCESS_IO_UNLOCK (&Context->DmaMappingLock);
 
   return EFI_SUCCESS;
 }
@@ -480,14 +649,22 @@ RegisterAccessPciIoGetHostAddressFromDeviceAddress (
   OUT VOID   **HostAddress
   )
 {
-  for (UINT8 Index = 0; Index < ARRAY_SIZE(gDeviceMemoryMapping); Index++) {
-    if (gDeviceMemoryMapping[Index].Used && gDeviceMemoryMapping[Index].DeviceAddress == DeviceAddress) {
-      *HostAddress = (VOID*)gDeviceMemoryMapping[Index].HostAddress;
-      return EFI_SUCCESS;
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *Context;
+  EFI_STATUS                      Status;
+
+  Status = EFI_NOT_FOUND;
+  Context = RegisterAccessIoSimContextGetCurrent ();
+  REGISTER_ACCESS_IO_LOCK (&Context->DmaMappingLock);
+  for (UINT8 Index = 0; Index < ARRAY_SIZE (Context->DmaMappings); Index++) {
+    if (Context->DmaMappings[Index].Used && Context->DmaMappings[Index].DeviceAddress == DeviceAddress) {
+      *HostAddress = Context->DmaMappings[Index].HostAddress;
+      Status = EFI_SUCCESS;
+      break;
     }
   }
+  REGISTER_ACCESS_IO_UNLOCK (&Context->DmaMappingLock);
 
-  return EFI_NOT_FOUND;
+  return Status;
 }
 
 EFI_STATUS
@@ -521,7 +698,12 @@ RegisterAccessPciIoFlush (
   IN EFI_PCI_IO_PROTOCOL  *This
   )
 {
-  return EFI_UNSUPPORTED;
+  EFI_STATUS  Status;
+
+  REGISTER_ACCESS_IO_TRACE (RegisterAccessTracePciFlush, ((REGISTER_ACCESS_PCI_IO*) This)->PciDev->TraceRegion, 0, 0, 0, 0);
+  Status = RegisterAccessIoFlushWriteCombining ();
+  RegisterAccessIoFlushPostedWrites ();
+  return Status;
 }
 
 EFI_STATUS
@@ -582,7 +764,28 @@ RegisterAccessPciIoSetBarAttributes (
   IN OUT UINT64                       *Length
   )
 {
-  return EFI_UNSUPPORTED;
+  REGISTER_ACCESS_PCI_IO  *PciIo;
+  REGISTER_ACCESS_PCI_DEVICE  *PciDev;
+
+  PciIo = (REGISTER_ACCESS_PCI_IO*) This;
+  PciDev = PciIo->PciDev;
+
+  if (BarIndex >= REGISTER_SPACE_PCI_LIB_MAX_SUPPORTED_BARS || PciDev->Bar[BarIndex] == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Only write combining is modeled and it always applies to the whole BAR.
+  //
+  if ((Attributes & ~((UINT64) EFI_PCI_IO_ATTRIBUTE_MEMORY_WRITE_COMBINE)) != 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  return RegisterAccessIoSetWriteCombining (
+           PciDev->BarType[BarIndex],
+           PciDev->BarAddress[BarIndex],
+           (Attributes & EFI_PCI_IO_ATTRIBUTE_MEMORY_WRITE_COMBINE) != 0
+           );
 }
 
 EFI_STATUS
@@ -646,8 +849,10 @@ RegisterAccessPciDeviceInitialize (
   OUT REGISTER_ACCESS_PCI_DEVICE     **PciDev
   )
 {
+  EFI_STATUS  Status;
+
   *PciDev = AllocateZeroPool (sizeof (REGISTER_ACCESS_PCI_DEVICE));
-  if (PciDev == NULL) {
+  if (*PciDev == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
 
@@ -664,9 +869,24 @@ RegisterAccessPciDeviceInitialize (
     0
   );
 
-  RegisterAccessPciSegmentRegisterAtPciSegmentAddress (ConfigSpace, (*PciDev)->PciSegmentBase);
+  Status = RegisterAccessPciSegmentRegisterAtPciSegmentAddress (ConfigSpace, (*PciDev)->PciSegmentBase);
+  if (EFI_ERROR (Status)) {
+    FreePool (*PciDev);
+    *PciDev = NULL;
+    return Status;
+  }
 
+  //
+  // Config accesses reach the config space through its MMIO region which
+  // counts them. PciIo operations are traced under the same region so every
+  // config access is accounted to a single region.
+  //
   (*PciDev)->ConfigSpace = ConfigSpace;
+  RegisterAccessIoGetTraceRegion (
+    RegisterAccessIoTypeMmio,
+    PcdGet64 (PcdPciExpressBaseAddress) + (*PciDev)->PciSegmentBase,
+    &(*PciDev)->TraceRegion
+    );
 
   return EFI_SUCCESS;
 }
@@ -681,13 +901,58 @@ RegisterAccessPciDeviceRegisterBar (
   IN UINT64                 BarSize
   )
 {
-  if (PciDev == NULL || BarIndex > REGISTER_SPACE_PCI_LIB_MAX_SUPPORTED_BARS) {
+  EFI_STATUS  Status;
+
+  if (PciDev == NULL || BarIndex >= REGISTER_SPACE_PCI_LIB_MAX_SUPPORTED_BARS) {
     return EFI_INVALID_PARAMETER;
   }
+
+  Status = RegisterAccessIoRegisterMmioAtAddress (BarRegisterSpace, BarType, BarAddress, BarSize);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
   PciDev->Bar[BarIndex] = BarRegisterSpace;
   PciDev->BarAddress[BarIndex] = BarAddress;
   PciDev->BarType[BarIndex] = BarType;
-  RegisterAccessIoRegisterMmioAtAddress (BarRegisterSpace, BarType, BarAddress, BarSize);
+
+  return RegisterAccessIoGetTraceRegion (BarType, BarAddress, &PciDev->BarTraceRegion[BarIndex]);
+}
+
+EFI_STATUS
+RegisterAccessPciDeviceGetStats (
+  IN  REGISTER_ACCESS_PCI_DEVICE  *PciDev,
+  OUT REGISTER_ACCESS_IO_STATS    *Stats
+  )
+{
+  REGISTER_ACCESS_IO_STATS  BarStats;
+  EFI_STATUS                Status;
+
+  if (PciDev == NULL || Stats == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RegisterAccessIoStatsGet (PciDev->TraceRegion, Stats);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (UINTN Index = 0; Index < REGISTER_SPACE_PCI_LIB_MAX_SUPPORTED_BARS; Index++) {
+    if (PciDev->Bar[Index] == NULL) {
+      continue;
+    }
+    Status = RegisterAccessIoStatsGet (PciDev->BarTraceRegion[Index], &BarStats);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+    Stats->Reads += BarStats.Reads;
+    Stats->Writes += BarStats.Writes;
+    Stats->ReadBytes += BarStats.ReadBytes;
+    Stats->WriteBytes += BarStats.WriteBytes;
+    Stats->Misaligned += BarStats.Misaligned;
+    Stats->ReadModifyWrites += BarStats.ReadModifyWrites;
+    Stats->MapMisses += BarStats.MapMisses;
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -12,6 +12,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/UnitTestLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 #include <Library/FakeRegisterSpaceLib.h>
 #include <Library/RegisterAccessPciLib.h>
 #include <IndustryStandard/Pci.h>
@@ -61,6 +62,7 @@ typedef struct {
   UINT32  DmaAddress;
   UINT32  DmaControl;
   UINT32  PollRegisterCount;
+  UINT32  PollReadCount;
   UINT8   MemoryBlock[512];
   //
   // IO BAR
@@ -165,6 +167,7 @@ TestPciDeviceBarRead (
       *Value = Device->Result;
       break;
     case TEST_PCI_DEVICE_BAR_POLL_REGISTER:
+      Device->PollReadCount++;
       if (Device->PollRegisterCount == 0) {
         *Value = 1;
       } else {
@@ -651,6 +654,17 @@ RegisterAccessPciIoDmaTest (
   return UNIT_TEST_PASSED;
 }
 
+/**
+  Completes the operation polled for by the test.
+**/
+VOID
+TestPciDeviceCompletePoll (
+  IN VOID  *Context
+  )
+{
+  ((TEST_PCI_DEVICE_CONTEXT*) Context)->PollRegisterCount = 0;
+}
+
 UNIT_TEST_STATUS
 EFIAPI
 RegisterAccessPciIoPollTest (
@@ -662,6 +676,8 @@ RegisterAccessPciIoPollTest (
   EFI_PCI_IO_PROTOCOL  *PciIo;
   TEST_PCI_DEVICE_CONTEXT  DevContext;
   UINT64                   Result;
+  UINT64                   Start;
+  UINT64                   EventId;
 
   Status = CreateTestPciDevice (&PciDev, &DevContext);
   if (EFI_ERROR (Status)) {
@@ -690,6 +706,34 @@ RegisterAccessPciIoPollTest (
   UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
   UT_ASSERT_EQUAL (Result, 0x1);
 
+  //
+  // Poll skips virtual time ahead to the device event completing the
+  // operation and reads the register only before and after it.
+  //
+  DevContext.PollRegisterCount = MAX_UINT32;
+  DevContext.PollReadCount = 0;
+  Start = RegisterAccessIoSimTimeGetNow ();
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeSchedule (1000000, TestPciDeviceCompletePoll, &DevContext, NULL));
+  Status = PciIo->PollMem (PciIo, EfiPciIoWidthUint32, 0, TEST_PCI_DEVICE_BAR_POLL_REGISTER, 0xFF, 0x1, 100 * 10000, &Result);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (DevContext.PollReadCount, 2);
+  UT_ASSERT_TRUE (RegisterAccessIoSimTimeGetNow () - Start >= 1000000);
+  UT_ASSERT_TRUE (RegisterAccessIoSimTimeGetNow () - Start < 1100000);
+
+  //
+  // Timeout matches Delay even when the device event comes later.
+  //
+  DevContext.PollRegisterCount = MAX_UINT32;
+  DevContext.PollReadCount = 0;
+  Start = RegisterAccessIoSimTimeGetNow ();
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeSchedule (10000000, TestPciDeviceCompletePoll, &DevContext, &EventId));
+  Status = PciIo->PollMem (PciIo, EfiPciIoWidthUint32, 0, TEST_PCI_DEVICE_BAR_POLL_REGISTER, 0xFF, 0x1, 10000, &Result);
+  UT_ASSERT_EQUAL (Status, EFI_TIMEOUT);
+  UT_ASSERT_EQUAL (DevContext.PollReadCount, 2);
+  UT_ASSERT_TRUE (RegisterAccessIoSimTimeGetNow () - Start >= 1000000);
+  UT_ASSERT_TRUE (RegisterAccessIoSimTimeGetNow () - Start < 1100000);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimTimeCancel (EventId));
+
   DestroyTestPciDevice (PciDev, &DevContext);
 
   return UNIT_TEST_PASSED;
@@ -732,6 +776,147 @@ RegisterAccessPciIoGetLocationTest (
   return UNIT_TEST_PASSED;
 }
 
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessPciIoWriteCombiningTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS           Status;
+  REGISTER_ACCESS_PCI_DEVICE      *PciDev;
+  EFI_PCI_IO_PROTOCOL  *PciIo;
+  TEST_PCI_DEVICE_CONTEXT  DevContext;
+  UINT32                   Addends[2];
+  UINT32                   Result;
+
+  Status = CreateTestPciDevice (&PciDev, &DevContext);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = RegisterAccessPciIoCreate (PciDev, &PciIo);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = PciIo->SetBarAttributes (PciIo, EFI_PCI_IO_ATTRIBUTE_MEMORY_WRITE_COMBINE, 0, NULL, NULL);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+
+  //
+  // Device ignores byte enables so the addends are only correct if the byte
+  // writes were combined into full DWORD writes.
+  //
+  Addends[0] = 0x01020304;
+  Addends[1] = 0x10203040;
+  Status = PciIo->Mem.Write (PciIo, EfiPciIoWidthUint8, 0, TEST_PCI_DEVICE_BAR_ADDEND1_REG, sizeof (Addends), Addends);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (DevContext.Addend1, 0);
+  UT_ASSERT_EQUAL (DevContext.Addend2, 0);
+
+  Status = PciIo->Flush (PciIo);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (DevContext.Addend1, Addends[0]);
+  UT_ASSERT_EQUAL (DevContext.Addend2, Addends[1]);
+
+  Status = PciIo->Mem.Read (PciIo, EfiPciIoWidthUint32, 0, TEST_PCI_DEVICE_BAR_RESULT_REG, 1, &Result);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (Result, 0x11223344);
+
+  Status = PciIo->SetBarAttributes (PciIo, 0, 0, NULL, NULL);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+
+  DestroyTestPciDevice (PciDev, &DevContext);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessPciIoStatsTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS           Status;
+  REGISTER_ACCESS_PCI_DEVICE      *PciDev;
+  EFI_PCI_IO_PROTOCOL  *PciIo;
+  TEST_PCI_DEVICE_CONTEXT  DevContext;
+  REGISTER_ACCESS_IO_STATS  Stats;
+  UINT32                   Val32;
+  UINT16                   Region;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                   RegionCount;
+  UINT32                   Index;
+  UINT64                   Reads;
+
+  Status = CreateTestPciDevice (&PciDev, &DevContext);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = RegisterAccessPciIoCreate (PciDev, &PciIo);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  RegisterAccessIoStatsReset ();
+  RegisterAccessIoStatsEnable (TRUE);
+  Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint32, PCI_VENDOR_ID_OFFSET, 1, &Val32);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  Val32 = 5;
+  Status = PciIo->Mem.Write (PciIo, EfiPciIoWidthUint32, 0, TEST_PCI_DEVICE_BAR_ADDEND1_REG, 1, &Val32);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  Status = PciIo->Mem.Write (PciIo, EfiPciIoWidthUint32, 0, TEST_PCI_DEVICE_BAR_ADDEND2_REG, 1, &Val32);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  Status = PciIo->Io.Read (PciIo, EfiPciIoWidthUint32, 1, TEST_PCI_DEVICE_IO_BAR_RESULT_REG, 1, &Val32);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  RegisterAccessIoStatsEnable (FALSE);
+
+  Status = RegisterAccessPciDeviceGetStats (PciDev, &Stats);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (Stats.Reads, 2);
+  UT_ASSERT_EQUAL (Stats.Writes, 2);
+  UT_ASSERT_EQUAL (Stats.ReadBytes, 8);
+  UT_ASSERT_EQUAL (Stats.WriteBytes, 8);
+  UT_ASSERT_EQUAL (Stats.MapMisses, 0);
+
+  Status = RegisterAccessIoGetTraceRegion (RegisterAccessIoTypeIo, 0x1000, &Region);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (PciDev->BarTraceRegion[1], Region);
+  Status = RegisterAccessIoGetTraceRegion (RegisterAccessIoTypeMmio, 0x1000, &Region);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (PciDev->BarTraceRegion[0], Region);
+
+  //
+  // Config read is counted once, under the config space region of the function.
+  //
+  RegisterAccessIoStatsReset ();
+  RegisterAccessIoStatsEnable (TRUE);
+  Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint32, PCI_VENDOR_ID_OFFSET, 1, &Val32);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  RegisterAccessIoStatsEnable (FALSE);
+
+  Status = RegisterAccessIoGetTraceRegion (RegisterAccessIoTypeMmio, PcdGet64 (PcdPciExpressBaseAddress) + PciDev->PciSegmentBase, &Region);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (PciDev->TraceRegion, Region);
+  Regions = RegisterAccessIoTraceGetRegions (&RegionCount);
+  UT_ASSERT_NOT_NULL (Regions);
+  Reads = 0;
+  for (Index = 0; Index < RegionCount; Index++) {
+    if (!EFI_ERROR (RegisterAccessIoStatsGet ((UINT16) Index, &Stats))) {
+      Reads += Stats.Reads;
+    }
+  }
+  UT_ASSERT_EQUAL (Reads, 1);
+  Status = RegisterAccessPciDeviceGetStats (PciDev, &Stats);
+  UT_ASSERT_EQUAL (Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (Stats.Reads, 1);
+
+  RegisterAccessIoStatsReset ();
+  DestroyTestPciDevice (PciDev, &DevContext);
+
+  return UNIT_TEST_PASSED;
+}
+
 EFI_STATUS
 EFIAPI
 UefiTestMain (
@@ -765,6 +950,8 @@ UefiTestMain (
   AddTestCase (RegisterAccessPciLibTest, "RegisterAccessPciIoDmaTest", "RegisterAccessPciIoDmaTest", RegisterAccessPciIoDmaTest, NULL, NULL, NULL);
   AddTestCase (RegisterAccessPciLibTest, "RegisterAccessPciIoPollTest", "RegisterAccessPciIoPollTest", RegisterAccessPciIoPollTest, NULL, NULL, NULL);
   AddTestCase (RegisterAccessPciLibTest, "RegisterAccessPciIoGetLocationTest", "RegisterAccessPciIoGetLocationTest", RegisterAccessPciIoGetLocationTest, NULL, NULL, NULL);
+  AddTestCase (RegisterAccessPciLibTest, "RegisterAccessPciIoWriteCombiningTest", "RegisterAccessPciIoWriteCombiningTest", RegisterAccessPciIoWriteCombiningTest, NULL, NULL, NULL);
+  AddTestCase (RegisterAccessPciLibTest, "RegisterAccessPciIoStatsTest", "RegisterAccessPciIoStatsTest", RegisterAccessPciIoStatsTest, NULL, NULL, NULL);
 
   Status = RunAllTestSuites (Framework);
   if (Framework) {
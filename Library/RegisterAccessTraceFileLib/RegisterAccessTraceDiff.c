@@ -0,0 +1,653 @@
+/** @file
+  Streaming comparison of two register access traces.
+
+  Both traces are read through a ring of Window + ResyncLength records. As long
+  as the accesses at the head of both rings match they are consumed one by one
+  so matching traces are compared in linear time. On a mismatch the accesses of
+  the second ring are indexed by hash and the first ring is scanned for the
+  pair of positions with the lowest sum at which ResyncLength accesses match,
+  which is the shortest edit within the window.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/RegisterAccessTraceFileLib.h>
+
+#define TRACE_DIFF_MAX_WINDOW  0x100000
+
+typedef struct {
+  REGISTER_ACCESS_TRACE_RECORD  Record;
+  //
+  // Region id translated to the region numbering of the first trace.
+  //
+  UINT32                        Region;
+  UINT64                        Key;
+} TRACE_DIFF_ENTRY;
+
+typedef struct {
+  REGISTER_ACCESS_TRACE_READER  *Reader;
+  UINT32                        *RegionMap;
+  UINT32                        RegionCount;
+  TRACE_DIFF_ENTRY              *Entries;
+  UINT32                        Mask;
+  UINT32                        Head;
+  UINT32                        Count;
+  //
+  // Index of the head entry within the trace.
+  //
+  UINT64                        Index;
+  BOOLEAN                       End;
+} TRACE_DIFF_STREAM;
+
+typedef struct {
+  TRACE_DIFF_STREAM  Stream[2];
+  UINT32             Flags;
+  UINT32             Window;
+  UINT32             ResyncLength;
+  //
+  // Hash index of the second stream window. Buckets hold position + 1 of the
+  // first entry of the chain, 0 terminates the chain.
+  //
+  UINT32             *Buckets;
+  UINT32             BucketMask;
+  UINT32             *Next;
+} TRACE_DIFF_CONTEXT;
+
+STATIC CONST CHAR8  *mTraceDiffTypeName[RegisterAccessTraceTypeMax] = {
+  "MmioRead",
+  "MmioWrite",
+  "IoRead",
+  "IoWrite",
+  "PciConfigRead",
+  "PciConfigWrite",
+  "PciPollMem",
+  "PciPollIo",
+  "PciFlush",
+  "PciMap",
+  "PciUnmap"
+};
+
+STATIC
+BOOLEAN
+TraceDiffIsRead (
+  IN UINT8  Type
+  )
+{
+  switch (Type) {
+    case RegisterAccessTraceMmioRead:
+    case RegisterAccessTraceIoRead:
+    case RegisterAccessTracePciConfigRead:
+    case RegisterAccessTracePciPollMem:
+    case RegisterAccessTracePciPollIo:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+STATIC
+UINT32
+TraceDiffRoundUpPowerOfTwo (
+  IN UINT32  Value
+  )
+{
+  UINT32  Result;
+
+  Result = 1;
+  while (Result < Value) {
+    Result <<= 1;
+  }
+
+  return Result;
+}
+
+STATIC
+EFI_STATUS
+TraceDiffOpenStream (
+  IN  CONST CHAR8                         *FileName,
+  IN  CONST REGISTER_ACCESS_TRACE_REGION  *ReferenceRegions OPTIONAL,
+  IN  UINT32                              ReferenceRegionCount,
+  IN  UINT32                              Capacity,
+  OUT TRACE_DIFF_STREAM                   *Stream
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  EFI_STATUS                          Status;
+  UINT32                              Region;
+  UINT32                              Reference;
+
+  ZeroMem (Stream, sizeof (TRACE_DIFF_STREAM));
+  Status = RegisterAccessTraceReaderOpen (FileName, &Stream->Reader);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Stream->Entries = AllocatePool (Capacity * sizeof (TRACE_DIFF_ENTRY));
+  if (Stream->Entries == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Stream->Mask = Capacity - 1;
+
+  RegisterAccessTraceReaderGetInfo (Stream->Reader, NULL, NULL, &Regions, &Stream->RegionCount);
+  if (Stream->RegionCount == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Stream->RegionMap = AllocatePool (Stream->RegionCount * sizeof (UINT32));
+  if (Stream->RegionMap == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Regions are numbered in registration order which may change between the
+  // runs. Regions missing from the reference trace get ids past its table.
+  //
+  for (Region = 0; Region < Stream->RegionCount; Region++) {
+    Stream->RegionMap[Region] = Region;
+    if (ReferenceRegions == NULL) {
+      continue;
+    }
+    Stream->RegionMap[Region] = ReferenceRegionCount + Region;
+    for (Reference = 0; Reference < ReferenceRegionCount; Reference++) {
+      if (ReferenceRegions[Reference].Type == Regions[Region].Type &&
+          AsciiStrnCmp (ReferenceRegions[Reference].Name, Regions[Region].Name, REGISTER_ACCESS_TRACE_REGION_NAME_LENGTH) == 0) {
+        Stream->RegionMap[Region] = Reference;
+        break;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+VOID
+TraceDiffCloseStream (
+  IN TRACE_DIFF_STREAM  *Stream
+  )
+{
+  if (Stream->Reader != NULL) {
+    RegisterAccessTraceReaderClose (Stream->Reader);
+  }
+  if (Stream->Entries != NULL) {
+    FreePool (Stream->Entries);
+  }
+  if (Stream->RegionMap != NULL) {
+    FreePool (Stream->RegionMap);
+  }
+}
+
+STATIC
+EFI_STATUS
+TraceDiffFill (
+  IN TRACE_DIFF_STREAM  *Stream,
+  IN UINT32             Count
+  )
+{
+  TRACE_DIFF_ENTRY  *Entry;
+  EFI_STATUS        Status;
+
+  while (Stream->Count < Count && !Stream->End) {
+    Entry = &Stream->Entries[(Stream->Head + Stream->Count) & Stream->Mask];
+    Status = RegisterAccessTraceReaderNext (Stream->Reader, &Entry->Record);
+    if (Status == EFI_END_OF_FILE) {
+      Stream->End = TRUE;
+      break;
+    } else if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Entry->Region = (Entry->Record.Region < Stream->RegionCount) ? Stream->RegionMap[Entry->Record.Region] : Entry->Record.Region;
+    Entry->Key = (Entry->Record.Address * 0x9E3779B97F4A7C15ULL) ^
+                 LShiftU64 (Entry->Region, 16) ^
+                 LShiftU64 (Entry->Record.Width, 8) ^
+                 Entry->Record.Type;
+    Entry->Key ^= RShiftU64 (Entry->Key, 29);
+    Stream->Count++;
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+TRACE_DIFF_ENTRY*
+TraceDiffPeek (
+  IN TRACE_DIFF_STREAM  *Stream,
+  IN UINT32             Offset
+  )
+{
+  if (Offset >= Stream->Count) {
+    return NULL;
+  }
+
+  return &Stream->Entries[(Stream->Head + Offset) & Stream->Mask];
+}
+
+STATIC
+VOID
+TraceDiffAdvance (
+  IN TRACE_DIFF_STREAM  *Stream,
+  IN UINT32             Count
+  )
+{
+  Stream->Head = (Stream->Head + Count) & Stream->Mask;
+  Stream->Count -= Count;
+  Stream->Index += Count;
+}
+
+STATIC
+EFI_STATUS
+TraceDiffDrain (
+  IN  TRACE_DIFF_STREAM  *Stream,
+  IN  UINT32             Window,
+  OUT UINT64             *Count
+  )
+{
+  EFI_STATUS  Status;
+
+  *Count = 0;
+  do {
+    Status = TraceDiffFill (Stream, Window);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    *Count += Stream->Count;
+    TraceDiffAdvance (Stream, Stream->Count);
+  } while (!Stream->End);
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+BOOLEAN
+TraceDiffSameAccess (
+  IN CONST TRACE_DIFF_ENTRY  *First,
+  IN CONST TRACE_DIFF_ENTRY  *Second
+  )
+{
+  return First->Key == Second->Key &&
+         First->Region == Second->Region &&
+         First->Record.Address == Second->Record.Address &&
+         First->Record.Type == Second->Record.Type &&
+         First->Record.Width == Second->Record.Width;
+}
+
+STATIC
+BOOLEAN
+TraceDiffSameValue (
+  IN CONST TRACE_DIFF_CONTEXT  *Context,
+  IN CONST TRACE_DIFF_ENTRY    *First,
+  IN CONST TRACE_DIFF_ENTRY    *Second
+  )
+{
+  if ((Context->Flags & REGISTER_ACCESS_TRACE_DIFF_IGNORE_READ_VALUES) != 0 && TraceDiffIsRead (First->Record.Type)) {
+    return TRUE;
+  }
+
+  return First->Record.Value == Second->Record.Value;
+}
+
+STATIC
+BOOLEAN
+TraceDiffRunMatches (
+  IN TRACE_DIFF_CONTEXT  *Context,
+  IN UINT32              FirstOffset,
+  IN UINT32              SecondOffset
+  )
+{
+  TRACE_DIFF_ENTRY  *First;
+  TRACE_DIFF_ENTRY  *Second;
+  UINT32            Index;
+
+  for (Index = 0; Index < Context->ResyncLength; Index++) {
+    First = TraceDiffPeek (&Context->Stream[0], FirstOffset + Index);
+    Second = TraceDiffPeek (&Context->Stream[1], SecondOffset + Index);
+    if (First == NULL && Second == NULL) {
+      //
+      // Both traces end within the run.
+      //
+      return TRUE;
+    }
+    if (First == NULL || Second == NULL || !TraceDiffSameAccess (First, Second)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Finds the closest point at which the streams are aligned again. Both streams
+  must be filled with Window + ResyncLength entries.
+
+  @retval TRUE   Alignment found, skipping Deleted entries of the first stream
+                 and Inserted entries of the second aligns the streams.
+  @retval FALSE  Streams can't be aligned within the window.
+**/
+STATIC
+BOOLEAN
+TraceDiffResync (
+  IN  TRACE_DIFF_CONTEXT  *Context,
+  OUT UINT32              *Deleted,
+  OUT UINT32              *Inserted
+  )
+{
+  TRACE_DIFF_ENTRY  *Entry;
+  UINT32            FirstLimit;
+  UINT32            SecondLimit;
+  UINT32            FirstOffset;
+  UINT32            SecondOffset;
+  UINT32            Position;
+  UINT32            Bucket;
+  UINT32            Best;
+
+  FirstLimit = MIN (Context->Stream[0].Count, Context->Window);
+  SecondLimit = MIN (Context->Stream[1].Count, Context->Window);
+
+  //
+  // Chains are built backwards so that they hold ascending positions.
+  //
+  ZeroMem (Context->Buckets, (Context->BucketMask + 1) * sizeof (UINT32));
+  for (SecondOffset = SecondLimit; SecondOffset > 0; SecondOffset--) {
+    Entry = TraceDiffPeek (&Context->Stream[1], SecondOffset - 1);
+    Bucket = (UINT32) Entry->Key & Context->BucketMask;
+    Context->Next[SecondOffset - 1] = Context->Buckets[Bucket];
+    Context->Buckets[Bucket] = SecondOffset;
+  }
+
+  Best = MAX_UINT32;
+  for (FirstOffset = 0; FirstOffset < FirstLimit && FirstOffset < Best; FirstOffset++) {
+    Entry = TraceDiffPeek (&Context->Stream[0], FirstOffset);
+    Position = Context->Buckets[(UINT32) Entry->Key & Context->BucketMask];
+    while (Position != 0) {
+      SecondOffset = Position - 1;
+      if (FirstOffset + SecondOffset >= Best) {
+        break;
+      }
+      if ((FirstOffset != 0 || SecondOffset != 0) && TraceDiffRunMatches (Context, FirstOffset, SecondOffset)) {
+        Best = FirstOffset + SecondOffset;
+        *Deleted = FirstOffset;
+        *Inserted = SecondOffset;
+        break;
+      }
+      Position = Context->Next[SecondOffset];
+    }
+  }
+
+  return Best != MAX_UINT32;
+}
+
+STATIC
+VOID
+TraceDiffRecordFirst (
+  IN OUT REGISTER_ACCESS_TRACE_DIFF_RESULT  *Result,
+  IN     TRACE_DIFF_CONTEXT                 *Context,
+  IN     REGISTER_ACCESS_TRACE_DIFF_KIND    Kind,
+  IN     UINT64                             Deleted,
+  IN     UINT64                             Inserted
+  )
+{
+  TRACE_DIFF_ENTRY  *Entry;
+  UINTN             Index;
+
+  if (Result->FirstKind != RegisterAccessTraceDiffNone) {
+    return;
+  }
+
+  Result->FirstKind = Kind;
+  Result->FirstDeletedLength = Deleted;
+  Result->FirstInsertedLength = Inserted;
+  for (Index = 0; Index < ARRAY_SIZE (Context->Stream); Index++) {
+    Result->FirstIndex[Index] = Context->Stream[Index].Index;
+    Entry = TraceDiffPeek (&Context->Stream[Index], 0);
+    if (Entry != NULL) {
+      CopyMem (&Result->FirstRecord[Index], &Entry->Record, sizeof (REGISTER_ACCESS_TRACE_RECORD));
+    }
+  }
+}
+
+STATIC
+EFI_STATUS
+TraceDiffRun (
+  IN  TRACE_DIFF_CONTEXT                 *Context,
+  OUT REGISTER_ACCESS_TRACE_DIFF_RESULT  *Result
+  )
+{
+  TRACE_DIFF_STREAM                *First;
+  TRACE_DIFF_STREAM                *Second;
+  TRACE_DIFF_ENTRY                 *FirstEntry;
+  TRACE_DIFF_ENTRY                 *SecondEntry;
+  REGISTER_ACCESS_TRACE_DIFF_KIND  Kind;
+  UINT32                           Deleted;
+  UINT32                           Inserted;
+  UINT64                           Remaining;
+  BOOLEAN                          IsFirst;
+  EFI_STATUS                       Status;
+
+  First = &Context->Stream[0];
+  Second = &Context->Stream[1];
+
+  while (TRUE) {
+    Status = TraceDiffFill (First, 1);
+    if (!EFI_ERROR (Status)) {
+      Status = TraceDiffFill (Second, 1);
+    }
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    FirstEntry = TraceDiffPeek (First, 0);
+    SecondEntry = TraceDiffPeek (Second, 0);
+    if (FirstEntry == NULL && SecondEntry == NULL) {
+      break;
+    }
+
+    if (FirstEntry != NULL && SecondEntry != NULL && TraceDiffSameAccess (FirstEntry, SecondEntry)) {
+      if (TraceDiffSameValue (Context, FirstEntry, SecondEntry)) {
+        Result->MatchedCount++;
+      } else {
+        Result->ValueMismatchCount++;
+        TraceDiffRecordFirst (Result, Context, RegisterAccessTraceDiffValue, 0, 0);
+        if ((Context->Flags & REGISTER_ACCESS_TRACE_DIFF_STOP_AT_FIRST) != 0) {
+          break;
+        }
+      }
+      TraceDiffAdvance (First, 1);
+      TraceDiffAdvance (Second, 1);
+      continue;
+    }
+
+    //
+    // Remainder of the longer trace doesn't need alignment.
+    //
+    if (FirstEntry == NULL || SecondEntry == NULL) {
+      Kind = (FirstEntry == NULL) ? RegisterAccessTraceDiffInserted : RegisterAccessTraceDiffDeleted;
+      IsFirst = (Result->FirstKind == RegisterAccessTraceDiffNone);
+      TraceDiffRecordFirst (Result, Context, Kind, 0, 0);
+      Status = TraceDiffDrain ((FirstEntry == NULL) ? Second : First, Context->Window, &Remaining);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+      if (FirstEntry == NULL) {
+        Result->InsertedCount += Remaining;
+        Result->FirstInsertedLength = IsFirst ? Remaining : Result->FirstInsertedLength;
+      } else {
+        Result->DeletedCount += Remaining;
+        Result->FirstDeletedLength = IsFirst ? Remaining : Result->FirstDeletedLength;
+      }
+      break;
+    }
+
+    Status = TraceDiffFill (First, Context->Window + Context->ResyncLength);
+    if (!EFI_ERROR (Status)) {
+      Status = TraceDiffFill (Second, Context->Window + Context->ResyncLength);
+    }
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if (TraceDiffResync (Context, &Deleted, &Inserted)) {
+      Result->ResyncCount++;
+    } else {
+      Result->ResyncFailureCount++;
+      Deleted = MIN (First->Count, Context->Window);
+      Inserted = MIN (Second->Count, Context->Window);
+    }
+
+    if (Deleted == 0) {
+      Kind = RegisterAccessTraceDiffInserted;
+    } else if (Inserted == 0) {
+      Kind = RegisterAccessTraceDiffDeleted;
+    } else {
+      Kind = RegisterAccessTraceDiffReplaced;
+    }
+    TraceDiffRecordFirst (Result, Context, Kind, Deleted, Inserted);
+    Result->DeletedCount += Deleted;
+    Result->InsertedCount += Inserted;
+    if ((Context->Flags & REGISTER_ACCESS_TRACE_DIFF_STOP_AT_FIRST) != 0) {
+      break;
+    }
+    TraceDiffAdvance (First, Deleted);
+    TraceDiffAdvance (Second, Inserted);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessTraceDiff (
+  IN  CONST CHAR8                               *FirstFileName,
+  IN  CONST CHAR8                               *SecondFileName,
+  IN  CONST REGISTER_ACCESS_TRACE_DIFF_OPTIONS  *Options OPTIONAL,
+  OUT REGISTER_ACCESS_TRACE_DIFF_RESULT         *Result
+  )
+{
+  TRACE_DIFF_CONTEXT                  Context;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINT32                              Capacity;
+  UINTN                               Index;
+  EFI_STATUS                          Status;
+
+  if (FirstFileName == NULL || SecondFileName == NULL || Result == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (&Context, sizeof (Context));
+  ZeroMem (Result, sizeof (REGISTER_ACCESS_TRACE_DIFF_RESULT));
+  Context.Window = REGISTER_ACCESS_TRACE_DIFF_DEFAULT_WINDOW;
+  Context.ResyncLength = REGISTER_ACCESS_TRACE_DIFF_DEFAULT_RESYNC_LENGTH;
+  if (Options != NULL) {
+    Context.Flags = Options->Flags;
+    if (Options->Window != 0) {
+      Context.Window = MIN (Options->Window, TRACE_DIFF_MAX_WINDOW);
+    }
+    if (Options->ResyncLength != 0) {
+      Context.ResyncLength = MIN (Options->ResyncLength, TRACE_DIFF_MAX_WINDOW);
+    }
+  }
+
+  Capacity = TraceDiffRoundUpPowerOfTwo (Context.Window + Context.ResyncLength);
+  Status = TraceDiffOpenStream (FirstFileName, NULL, 0, Capacity, &Context.Stream[0]);
+  if (!EFI_ERROR (Status)) {
+    RegisterAccessTraceReaderGetInfo (Context.Stream[0].Reader, NULL, NULL, &Regions, &RegionCount);
+    Status = TraceDiffOpenStream (SecondFileName, Regions, RegionCount, Capacity, &Context.Stream[1]);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Context.BucketMask = TraceDiffRoundUpPowerOfTwo (Context.Window * 2) - 1;
+    Context.Buckets = AllocatePool ((Context.BucketMask + 1) * sizeof (UINT32));
+    Context.Next = AllocatePool (Context.Window * sizeof (UINT32));
+    if (Context.Buckets == NULL || Context.Next == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  if (!EFI_ERROR (Status)) {
+    for (Index = 0; Index < ARRAY_SIZE (Context.Stream); Index++) {
+      RegisterAccessTraceReaderGetInfo (Context.Stream[Index].Reader, &Result->RecordCount[Index], NULL, NULL, NULL);
+    }
+    Status = TraceDiffRun (&Context, Result);
+  }
+
+  for (Index = 0; Index < ARRAY_SIZE (Context.Stream); Index++) {
+    TraceDiffCloseStream (&Context.Stream[Index]);
+  }
+  if (Context.Buckets != NULL) {
+    FreePool (Context.Buckets);
+  }
+  if (Context.Next != NULL) {
+    FreePool (Context.Next);
+  }
+
+  return Status;
+}
+
+STATIC
+VOID
+TraceDiffPrintRecord (
+  IN CONST CHAR8                         *Label,
+  IN UINT64                              Index,
+  IN UINT64                              RecordCount,
+  IN CONST REGISTER_ACCESS_TRACE_RECORD  *Record
+  )
+{
+  if (Index >= RecordCount) {
+    DEBUG ((DEBUG_INFO, "  %-8a #%ld <end of trace>\n", Label, Index));
+    return;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "  %-8a #%ld %-16a region %d address 0x%lx width %d value 0x%lx\n",
+    Label,
+    Index,
+    (Record->Type < RegisterAccessTraceTypeMax) ? mTraceDiffTypeName[Record->Type] : "Unknown",
+    Record->Region,
+    Record->Address,
+    Record->Width,
+    Record->Value
+    ));
+}
+
+VOID
+RegisterAccessTraceDiffPrint (
+  IN CONST REGISTER_ACCESS_TRACE_DIFF_RESULT  *Result
+  )
+{
+  STATIC CONST CHAR8  *KindName[] = { "None", "Value mismatch", "Deleted", "Inserted", "Replaced" };
+
+  if (Result == NULL) {
+    return;
+  }
+
+  if (Result->FirstKind == RegisterAccessTraceDiffNone) {
+    DEBUG ((DEBUG_INFO, "Traces match, %ld records compared\n", Result->MatchedCount));
+    return;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "First divergence: %a, %ld deleted, %ld inserted\n",
+    (Result->FirstKind < ARRAY_SIZE (KindName)) ? KindName[Result->FirstKind] : "Unknown",
+    Result->FirstDeletedLength,
+    Result->FirstInsertedLength
+    ));
+  TraceDiffPrintRecord ("First", Result->FirstIndex[0], Result->RecordCount[0], &Result->FirstRecord[0]);
+  TraceDiffPrintRecord ("Second", Result->FirstIndex[1], Result->RecordCount[1], &Result->FirstRecord[1]);
+
+  DEBUG ((DEBUG_INFO, "%-32a %ld / %ld\n", "Records", Result->RecordCount[0], Result->RecordCount[1]));
+  DEBUG ((DEBUG_INFO, "%-32a %ld\n", "Matched", Result->MatchedCount));
+  DEBUG ((DEBUG_INFO, "%-32a %ld\n", "Value mismatches", Result->ValueMismatchCount));
+  DEBUG ((DEBUG_INFO, "%-32a %ld\n", "Deleted", Result->DeletedCount));
+  DEBUG ((DEBUG_INFO, "%-32a %ld\n", "Inserted", Result->InsertedCount));
+  DEBUG ((DEBUG_INFO, "%-32a %ld\n", "Resynchronizations", Result->ResyncCount));
+  DEBUG ((DEBUG_INFO, "%-32a %ld\n", "Resynchronization failures", Result->ResyncFailureCount));
+}
\ No newline at end of file
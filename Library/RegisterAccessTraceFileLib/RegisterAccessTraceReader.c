@@ -0,0 +1,664 @@
+/** @file
+  Reader of register access traces.
+
+  Trace file is memory mapped. Records of raw traces are returned in place,
+  compact traces are decoded one record at a time from the current block.
+  Seeking uses the block index so only the block holding the target record
+  has to be decoded.
+
+  Records are stored in the order they were appended which is not the order
+  of their timestamps, e.g. poll records are stamped when the poll starts and
+  appended when it completes. Seeking by timestamp therefore searches the
+  running maximum of timestamps kept per chunk of records.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/RegisterAccessTraceFileLib.h>
+
+#if defined (_WIN32)
+#include <stdio.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+struct _REGISTER_ACCESS_TRACE_READER {
+  VOID                                       *Mapping;
+  UINTN                                      MappingSize;
+  BOOLEAN                                    Compact;
+  UINT64                                     RecordCount;
+  UINT64                                     TicksPerSecond;
+  CONST REGISTER_ACCESS_TRACE_REGION         *Regions;
+  UINT32                                     RegionCount;
+  //
+  // Index of the record returned by the next call to RegisterAccessTraceReaderNext.
+  //
+  UINT64                                     Position;
+  //
+  // Raw trace.
+  //
+  CONST REGISTER_ACCESS_TRACE_RECORD         *Records;
+  //
+  // Compact trace. Decoder state of the current block.
+  //
+  CONST REGISTER_ACCESS_TRACE_COMPACT_BLOCK  *Blocks;
+  UINT64                                     BlockCount;
+  UINT64                                     Block;
+  CONST UINT8                                *Cursor;
+  CONST UINT8                                *BlockEnd;
+  UINT32                                     BlockRemaining;
+  UINT64                                     PrevTimestamp;
+  UINT16                                     PrevRegion;
+  UINT64                                     PrevAddress[REGISTER_ACCESS_TRACE_COMPACT_ADDRESS_SLOTS];
+  //
+  // Highest timestamp of all records up to the end of every chunk. Chunks are
+  // the blocks of compact traces and TRACE_READER_RAW_CHUNK_RECORDS records of
+  // raw ones. Built on the first timestamp seek.
+  //
+  UINT64                                     *MaxTimestamps;
+  UINT64                                     ChunkCount;
+};
+
+#define TRACE_READER_RAW_CHUNK_RECORDS  4096
+
+STATIC CONST UINT8  mTraceWidth[] = { 0, 1, 2, 4, 8 };
+
+STATIC
+VOID*
+TraceMapFile (
+  IN  CONST CHAR8  *FileName,
+  OUT UINTN        *Size
+  )
+{
+#if defined (_WIN32)
+  FILE     *File;
+  VOID     *Buffer;
+  __int64  FileSize;
+
+  //
+  // Trace is read into memory. 64 bit file position functions are used so
+  // that traces larger than 2GB can be opened.
+  //
+  File = fopen (FileName, "rb");
+  if (File == NULL) {
+    return NULL;
+  }
+
+  Buffer = NULL;
+  if (_fseeki64 (File, 0, SEEK_END) == 0) {
+    FileSize = _ftelli64 (File);
+    if (FileSize > 0 && (UINT64) FileSize <= MAX_UINTN && _fseeki64 (File, 0, SEEK_SET) == 0) {
+      Buffer = AllocatePool ((UINTN) FileSize);
+      if (Buffer != NULL && fread (Buffer, 1, (size_t) FileSize, File) != (size_t) FileSize) {
+        FreePool (Buffer);
+        Buffer = NULL;
+      }
+      *Size = (UINTN) FileSize;
+    }
+  }
+
+  fclose (File);
+  return Buffer;
+#else
+  int          File;
+  struct stat  FileStat;
+  VOID         *Mapping;
+
+  File = open (FileName, O_RDONLY);
+  if (File < 0) {
+    return NULL;
+  }
+
+  Mapping = NULL;
+  if (fstat (File, &FileStat) == 0 && FileStat.st_size > 0 && (UINT64) FileStat.st_size <= MAX_UINTN) {
+    Mapping = mmap (NULL, (size_t) FileStat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+    if (Mapping == MAP_FAILED) {
+      Mapping = NULL;
+    }
+    *Size = (UINTN) FileStat.st_size;
+  }
+
+  close (File);
+  return Mapping;
+#endif
+}
+
+STATIC
+VOID
+TraceUnmapFile (
+  IN VOID   *Mapping,
+  IN UINTN  Size
+  )
+{
+#if defined (_WIN32)
+  FreePool (Mapping);
+#else
+  munmap (Mapping, Size);
+#endif
+}
+
+STATIC
+BOOLEAN
+TraceReadVarint (
+  IN OUT CONST UINT8  **Cursor,
+  IN     CONST UINT8  *End,
+  OUT    UINT64       *Value
+  )
+{
+  UINTN  Shift;
+
+  *Value = 0;
+  for (Shift = 0; Shift < 64; Shift += 7) {
+    if (*Cursor >= End) {
+      return FALSE;
+    }
+    *Value |= LShiftU64 (**Cursor & 0x7F, Shift);
+    if ((*(*Cursor)++ & 0x80) == 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+STATIC
+BOOLEAN
+TraceReadSignedVarint (
+  IN OUT CONST UINT8  **Cursor,
+  IN     CONST UINT8  *End,
+  OUT    UINT64       *Delta
+  )
+{
+  UINT64  Value;
+
+  if (!TraceReadVarint (Cursor, End, &Value)) {
+    return FALSE;
+  }
+
+  *Delta = RShiftU64 (Value, 1) ^ (0 - (Value & 1));
+  return TRUE;
+}
+
+STATIC
+VOID
+TraceLoadBlock (
+  IN REGISTER_ACCESS_TRACE_READER  *Reader,
+  IN UINT64                        Block
+  )
+{
+  Reader->Block = Block;
+  Reader->Cursor = (CONST UINT8 *) Reader->Mapping + Reader->Blocks[Block].Offset;
+  Reader->BlockEnd = Reader->Cursor + Reader->Blocks[Block].Size;
+  Reader->BlockRemaining = Reader->Blocks[Block].RecordCount;
+  Reader->PrevTimestamp = Reader->Blocks[Block].FirstTimestamp;
+  Reader->PrevRegion = 0;
+  ZeroMem (Reader->PrevAddress, sizeof (Reader->PrevAddress));
+  Reader->Position = Reader->Blocks[Block].FirstRecord;
+}
+
+STATIC
+EFI_STATUS
+TraceDecodeRecord (
+  IN  REGISTER_ACCESS_TRACE_READER  *Reader,
+  OUT REGISTER_ACCESS_TRACE_RECORD  *Record
+  )
+{
+  CONST UINT8  *Cursor;
+  UINT8        Tag;
+  UINT8        WidthCode;
+  UINT64       Value;
+  UINT64       Delta;
+  UINTN        Slot;
+
+  while (Reader->BlockRemaining == 0) {
+    if (Reader->Block + 1 >= Reader->BlockCount) {
+      return EFI_END_OF_FILE;
+    }
+    TraceLoadBlock (Reader, Reader->Block + 1);
+  }
+
+  Cursor = Reader->Cursor;
+  if (Cursor >= Reader->BlockEnd) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Tag = *Cursor++;
+  Record->Type = Tag & REGISTER_ACCESS_TRACE_COMPACT_TAG_TYPE_MASK;
+  WidthCode = (Tag >> REGISTER_ACCESS_TRACE_COMPACT_TAG_WIDTH_SHIFT) & REGISTER_ACCESS_TRACE_COMPACT_TAG_WIDTH_MASK;
+  if (WidthCode == REGISTER_ACCESS_TRACE_COMPACT_TAG_WIDTH_EXPLICIT) {
+    if (Cursor >= Reader->BlockEnd) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    Record->Width = *Cursor++;
+  } else if (WidthCode < ARRAY_SIZE (mTraceWidth)) {
+    Record->Width = mTraceWidth[WidthCode];
+  } else {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  if ((Tag & REGISTER_ACCESS_TRACE_COMPACT_TAG_REGION) != 0) {
+    if (!TraceReadVarint (&Cursor, Reader->BlockEnd, &Value) || Value > MAX_UINT16) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    Reader->PrevRegion = (UINT16) Value;
+  }
+  Record->Region = Reader->PrevRegion;
+  Slot = Record->Region % REGISTER_ACCESS_TRACE_COMPACT_ADDRESS_SLOTS;
+
+  if (!TraceReadSignedVarint (&Cursor, Reader->BlockEnd, &Delta)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+  Record->Timestamp = Reader->PrevTimestamp + Delta;
+
+  if (!TraceReadSignedVarint (&Cursor, Reader->BlockEnd, &Delta)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+  Record->Address = Reader->PrevAddress[Slot] + Delta;
+
+  if (!TraceReadVarint (&Cursor, Reader->BlockEnd, &Record->Value)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  if (!TraceReadVarint (&Cursor, Reader->BlockEnd, &Value) || Value > MAX_UINT32) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+  Record->Duration = (UINT32) Value;
+
+  Reader->PrevTimestamp = Record->Timestamp;
+  Reader->PrevAddress[Slot] = Record->Address;
+  Reader->Cursor = Cursor;
+  Reader->BlockRemaining--;
+  Reader->Position++;
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+TraceOpenRaw (
+  IN REGISTER_ACCESS_TRACE_READER  *Reader
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_HEADER  *Header;
+  UINT64                              Size;
+
+  Header = Reader->Mapping;
+  if (Header->Version != REGISTER_ACCESS_TRACE_VERSION ||
+      Header->RecordCount > MAX_UINTN / sizeof (REGISTER_ACCESS_TRACE_RECORD)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Size = sizeof (REGISTER_ACCESS_TRACE_HEADER) +
+         (UINT64) Header->RegionCount * sizeof (REGISTER_ACCESS_TRACE_REGION) +
+         Header->RecordCount * sizeof (REGISTER_ACCESS_TRACE_RECORD);
+  if (Size > Reader->MappingSize) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Reader->RecordCount = Header->RecordCount;
+  Reader->TicksPerSecond = Header->TicksPerSecond;
+  Reader->RegionCount = Header->RegionCount;
+  Reader->Regions = (CONST REGISTER_ACCESS_TRACE_REGION *)(Header + 1);
+  Reader->Records = (CONST REGISTER_ACCESS_TRACE_RECORD *)(Reader->Regions + Header->RegionCount);
+  Reader->ChunkCount = DivU64x32 (Reader->RecordCount + TRACE_READER_RAW_CHUNK_RECORDS - 1, TRACE_READER_RAW_CHUNK_RECORDS);
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+TraceOpenCompact (
+  IN REGISTER_ACCESS_TRACE_READER  *Reader
+  )
+{
+  CONST REGISTER_ACCESS_TRACE_COMPACT_HEADER  *Header;
+  UINT64                                      Size;
+  UINT64                                      Block;
+  UINT64                                      RecordCount;
+
+  if (Reader->MappingSize < sizeof (REGISTER_ACCESS_TRACE_COMPACT_HEADER)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Header = Reader->Mapping;
+  if (Header->Version != REGISTER_ACCESS_TRACE_COMPACT_VERSION ||
+      Header->IndexOffset > Reader->MappingSize ||
+      Header->BlockCount > Reader->MappingSize / sizeof (REGISTER_ACCESS_TRACE_COMPACT_BLOCK)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Size = Header->BlockCount * sizeof (REGISTER_ACCESS_TRACE_COMPACT_BLOCK) +
+         (UINT64) Header->RegionCount * sizeof (REGISTER_ACCESS_TRACE_REGION);
+  if (Size > Reader->MappingSize - Header->IndexOffset) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Reader->Compact = TRUE;
+  Reader->TicksPerSecond = Header->TicksPerSecond;
+  Reader->BlockCount = Header->BlockCount;
+  Reader->Blocks = (CONST REGISTER_ACCESS_TRACE_COMPACT_BLOCK *)((CONST UINT8 *) Reader->Mapping + Header->IndexOffset);
+  Reader->RegionCount = Header->RegionCount;
+  Reader->Regions = (CONST REGISTER_ACCESS_TRACE_REGION *)(Reader->Blocks + Header->BlockCount);
+
+  //
+  // Blocks have to lie before the index and cover the records contiguously
+  // so that seeking can trust FirstRecord.
+  //
+  RecordCount = 0;
+  for (Block = 0; Block < Reader->BlockCount; Block++) {
+    if (Reader->Blocks[Block].Offset < sizeof (REGISTER_ACCESS_TRACE_COMPACT_HEADER) ||
+        Reader->Blocks[Block].Offset > Header->IndexOffset ||
+        Reader->Blocks[Block].Size > Header->IndexOffset - Reader->Blocks[Block].Offset ||
+        Reader->Blocks[Block].FirstRecord != RecordCount) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    RecordCount += Reader->Blocks[Block].RecordCount;
+  }
+  if (RecordCount != Header->RecordCount) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+  Reader->RecordCount = RecordCount;
+  Reader->ChunkCount = Reader->BlockCount;
+
+  if (Reader->BlockCount != 0) {
+    TraceLoadBlock (Reader, 0);
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+UINT64
+TraceChunkFirstRecord (
+  IN REGISTER_ACCESS_TRACE_READER  *Reader,
+  IN UINT64                        Chunk
+  )
+{
+  if (Reader->Compact) {
+    return Reader->Blocks[Chunk].FirstRecord;
+  }
+
+  return MultU64x32 (Chunk, TRACE_READER_RAW_CHUNK_RECORDS);
+}
+
+/**
+  Reads the whole trace once and stores the running maximum of timestamps at
+  the end of every chunk. Reader position is not preserved.
+**/
+STATIC
+EFI_STATUS
+TraceBuildTimestampIndex (
+  IN REGISTER_ACCESS_TRACE_READER  *Reader
+  )
+{
+  REGISTER_ACCESS_TRACE_RECORD  Record;
+  UINT64                        *MaxTimestamps;
+  UINT64                        MaxTimestamp;
+  UINT64                        Chunk;
+  UINT64                        End;
+  EFI_STATUS                    Status;
+
+  if (Reader->ChunkCount > MAX_UINTN / sizeof (UINT64)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  MaxTimestamps = AllocatePool ((UINTN) Reader->ChunkCount * sizeof (UINT64));
+  if (MaxTimestamps == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = RegisterAccessTraceReaderSeek (Reader, 0);
+  MaxTimestamp = 0;
+  for (Chunk = 0; Chunk < Reader->ChunkCount && !EFI_ERROR (Status); Chunk++) {
+    End = (Chunk + 1 < Reader->ChunkCount) ? TraceChunkFirstRecord (Reader, Chunk + 1) : Reader->RecordCount;
+    while (Reader->Position < End) {
+      Status = RegisterAccessTraceReaderNext (Reader, &Record);
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+      MaxTimestamp = MAX (MaxTimestamp, Record.Timestamp);
+    }
+    MaxTimestamps[Chunk] = MaxTimestamp;
+  }
+
+  if (EFI_ERROR (Status)) {
+    FreePool (MaxTimestamps);
+    return (Status == EFI_END_OF_FILE) ? EFI_VOLUME_CORRUPTED : Status;
+  }
+
+  Reader->MaxTimestamps = MaxTimestamps;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessTraceReaderOpen (
+  IN  CONST CHAR8                   *FileName,
+  OUT REGISTER_ACCESS_TRACE_READER  **Reader
+  )
+{
+  REGISTER_ACCESS_TRACE_READER  *NewReader;
+  UINT64                        Signature;
+  EFI_STATUS                    Status;
+
+  if (FileName == NULL || Reader == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  NewReader = AllocateZeroPool (sizeof (REGISTER_ACCESS_TRACE_READER));
+  if (NewReader == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewReader->Mapping = TraceMapFile (FileName, &NewReader->MappingSize);
+  if (NewReader->Mapping == NULL) {
+    FreePool (NewReader);
+    return EFI_NOT_FOUND;
+  }
+
+  Status = EFI_VOLUME_CORRUPTED;
+  if (NewReader->MappingSize >= sizeof (REGISTER_ACCESS_TRACE_HEADER)) {
+    Signature = ReadUnaligned64 (NewReader->Mapping);
+    if (Signature == REGISTER_ACCESS_TRACE_SIGNATURE) {
+      Status = TraceOpenRaw (NewReader);
+    } else if (Signature == REGISTER_ACCESS_TRACE_COMPACT_SIGNATURE) {
+      Status = TraceOpenCompact (NewReader);
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    RegisterAccessTraceReaderClose (NewReader);
+    return Status;
+  }
+
+  *Reader = NewReader;
+  return EFI_SUCCESS;
+}
+
+VOID
+RegisterAccessTraceReaderGetInfo (
+  IN  REGISTER_ACCESS_TRACE_READER        *Reader,
+  OUT UINT64                              *RecordCount OPTIONAL,
+  OUT UINT64                              *TicksPerSecond OPTIONAL,
+  OUT CONST REGISTER_ACCESS_TRACE_REGION  **Regions OPTIONAL,
+  OUT UINT32                              *RegionCount OPTIONAL
+  )
+{
+  if (RecordCount != NULL) {
+    *RecordCount = Reader->RecordCount;
+  }
+  if (TicksPerSecond != NULL) {
+    *TicksPerSecond = Reader->TicksPerSecond;
+  }
+  if (Regions != NULL) {
+    *Regions = Reader->Regions;
+  }
+  if (RegionCount != NULL) {
+    *RegionCount = Reader->RegionCount;
+  }
+}
+
+EFI_STATUS
+RegisterAccessTraceReaderNext (
+  IN  REGISTER_ACCESS_TRACE_READER  *Reader,
+  OUT REGISTER_ACCESS_TRACE_RECORD  *Record
+  )
+{
+  if (Reader->Position >= Reader->RecordCount) {
+    return EFI_END_OF_FILE;
+  }
+
+  if (Reader->Compact) {
+    return TraceDecodeRecord (Reader, Record);
+  }
+
+  CopyMem (Record, &Reader->Records[Reader->Position], sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  Reader->Position++;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessTraceReaderSeek (
+  IN REGISTER_ACCESS_TRACE_READER  *Reader,
+  IN UINT64                        Index
+  )
+{
+  REGISTER_ACCESS_TRACE_RECORD  Record;
+  UINT64                        Low;
+  UINT64                        High;
+  UINT64                        Middle;
+  EFI_STATUS                    Status;
+
+  if (Index > Reader->RecordCount) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!Reader->Compact || Reader->BlockCount == 0) {
+    Reader->Position = Index;
+    return EFI_SUCCESS;
+  }
+
+  if (Index == Reader->RecordCount) {
+    TraceLoadBlock (Reader, Reader->BlockCount - 1);
+    Reader->Position = Index;
+    Reader->BlockRemaining = 0;
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Last block starting at or before Index.
+  //
+  Low = 0;
+  High = Reader->BlockCount - 1;
+  while (Low < High) {
+    Middle = Low + (High - Low + 1) / 2;
+    if (Reader->Blocks[Middle].FirstRecord <= Index) {
+      Low = Middle;
+    } else {
+      High = Middle - 1;
+    }
+  }
+
+  if (Reader->Block != Low || Reader->Position > Index) {
+    TraceLoadBlock (Reader, Low);
+  }
+  while (Reader->Position < Index) {
+    Status = TraceDecodeRecord (Reader, &Record);
+    if (EFI_ERROR (Status)) {
+      return (Status == EFI_END_OF_FILE) ? EFI_VOLUME_CORRUPTED : Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessTraceReaderSeekTimestamp (
+  IN  REGISTER_ACCESS_TRACE_READER  *Reader,
+  IN  UINT64                        Timestamp,
+  OUT UINT64                        *Index OPTIONAL
+  )
+{
+  REGISTER_ACCESS_TRACE_RECORD  Record;
+  UINT64                        Low;
+  UINT64                        High;
+  UINT64                        Middle;
+  UINT64                        Target;
+  EFI_STATUS                    Status;
+
+  if (Reader->MaxTimestamps == NULL && Reader->ChunkCount != 0) {
+    Status = TraceBuildTimestampIndex (Reader);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  //
+  // Running maximum is monotonic so the first chunk reaching Timestamp is
+  // found with a binary search. All records before it are older and the
+  // chunk holds the first record not older than Timestamp.
+  //
+  Low = 0;
+  High = Reader->ChunkCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Reader->MaxTimestamps[Middle] < Timestamp) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  Target = Reader->RecordCount;
+  if (Low < Reader->ChunkCount) {
+    Status = RegisterAccessTraceReaderSeek (Reader, TraceChunkFirstRecord (Reader, Low));
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    do {
+      Status = RegisterAccessTraceReaderNext (Reader, &Record);
+      if (EFI_ERROR (Status)) {
+        return (Status == EFI_END_OF_FILE) ? EFI_VOLUME_CORRUPTED : Status;
+      }
+    } while (Record.Timestamp < Timestamp);
+    Target = Reader->Position - 1;
+  }
+
+  Status = RegisterAccessTraceReaderSeek (Reader, Target);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Index != NULL) {
+    *Index = Target;
+  }
+
+  return EFI_SUCCESS;
+}
+
+VOID
+RegisterAccessTraceReaderClose (
+  IN REGISTER_ACCESS_TRACE_READER  *Reader
+  )
+{
+  if (Reader == NULL) {
+    return;
+  }
+
+  if (Reader->MaxTimestamps != NULL) {
+    FreePool (Reader->MaxTimestamps);
+  }
+  if (Reader->Mapping != NULL) {
+    TraceUnmapFile (Reader->Mapping, Reader->MappingSize);
+  }
+  FreePool (Reader);
+}
\ No newline at end of file
@@ -0,0 +1,292 @@
+/** @file
+  Streaming writer of compact register access traces.
+
+  Records are delta encoded into a block buffer which is written out once it
+  holds REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS records. Block index and
+  region table are written when the writer is closed and the header is patched
+  with their location.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/RegisterAccessTraceFileLib.h>
+
+#include <stdio.h>
+
+//
+// Tag, explicit width, region, timestamp, address, value and duration.
+//
+#define TRACE_WRITER_MAX_RECORD_SIZE  (1 + 1 + 3 + 10 + 10 + 10 + 5)
+
+struct _REGISTER_ACCESS_TRACE_WRITER {
+  FILE                                  *File;
+  REGISTER_ACCESS_TRACE_COMPACT_HEADER  Header;
+  REGISTER_ACCESS_TRACE_COMPACT_BLOCK   *Blocks;
+  UINTN                                 MaxBlocks;
+  UINT64                                FileOffset;
+  //
+  // Block being encoded.
+  //
+  UINT8                                 *Buffer;
+  UINT32                                BufferLength;
+  UINT32                                BlockRecords;
+  UINT64                                FirstTimestamp;
+  UINT64                                PrevTimestamp;
+  UINT16                                PrevRegion;
+  UINT64                                PrevAddress[REGISTER_ACCESS_TRACE_COMPACT_ADDRESS_SLOTS];
+};
+
+STATIC
+UINT8*
+TraceWriteVarint (
+  IN UINT8   *Buffer,
+  IN UINT64  Value
+  )
+{
+  while (Value >= 0x80) {
+    *Buffer++ = (UINT8)(Value | 0x80);
+    Value = RShiftU64 (Value, 7);
+  }
+  *Buffer++ = (UINT8) Value;
+  return Buffer;
+}
+
+STATIC
+UINT8*
+TraceWriteSignedVarint (
+  IN UINT8   *Buffer,
+  IN UINT64  Delta
+  )
+{
+  //
+  // Zigzag encoding keeps small negative deltas short.
+  //
+  return TraceWriteVarint (Buffer, LShiftU64 (Delta, 1) ^ (((Delta & BIT63) != 0) ? MAX_UINT64 : 0));
+}
+
+STATIC
+UINT8
+TraceWidthCode (
+  IN UINT8  Width
+  )
+{
+  switch (Width) {
+    case 0:
+      return 0;
+    case 1:
+      return 1;
+    case 2:
+      return 2;
+    case 4:
+      return 3;
+    case 8:
+      return 4;
+    default:
+      return REGISTER_ACCESS_TRACE_COMPACT_TAG_WIDTH_EXPLICIT;
+  }
+}
+
+STATIC
+EFI_STATUS
+TraceWriterFlushBlock (
+  IN REGISTER_ACCESS_TRACE_WRITER  *Writer
+  )
+{
+  REGISTER_ACCESS_TRACE_COMPACT_BLOCK  *Blocks;
+  UINTN                                MaxBlocks;
+
+  if (Writer->BlockRecords == 0) {
+    return EFI_SUCCESS;
+  }
+
+  if (Writer->Header.BlockCount == Writer->MaxBlocks) {
+    MaxBlocks = MAX (Writer->MaxBlocks * 2, 16);
+    Blocks = ReallocatePool (
+               Writer->MaxBlocks * sizeof (REGISTER_ACCESS_TRACE_COMPACT_BLOCK),
+               MaxBlocks * sizeof (REGISTER_ACCESS_TRACE_COMPACT_BLOCK),
+               Writer->Blocks
+               );
+    if (Blocks == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Writer->Blocks = Blocks;
+    Writer->MaxBlocks = MaxBlocks;
+  }
+
+  if (fwrite (Writer->Buffer, 1, Writer->BufferLength, Writer->File) != Writer->BufferLength) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  Blocks = &Writer->Blocks[Writer->Header.BlockCount];
+  Blocks->Offset = Writer->FileOffset;
+  Blocks->Size = Writer->BufferLength;
+  Blocks->RecordCount = Writer->BlockRecords;
+  Blocks->FirstRecord = Writer->Header.RecordCount;
+  Blocks->FirstTimestamp = Writer->FirstTimestamp;
+
+  Writer->Header.BlockCount++;
+  Writer->Header.RecordCount += Writer->BlockRecords;
+  Writer->FileOffset += Writer->BufferLength;
+  Writer->BufferLength = 0;
+  Writer->BlockRecords = 0;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessTraceWriterCreate (
+  IN  CONST CHAR8                   *FileName,
+  IN  UINT64                        TicksPerSecond,
+  OUT REGISTER_ACCESS_TRACE_WRITER  **Writer
+  )
+{
+  REGISTER_ACCESS_TRACE_WRITER  *NewWriter;
+
+  if (FileName == NULL || Writer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  NewWriter = AllocateZeroPool (sizeof (REGISTER_ACCESS_TRACE_WRITER));
+  if (NewWriter == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewWriter->Buffer = AllocatePool (REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS * TRACE_WRITER_MAX_RECORD_SIZE);
+  if (NewWriter->Buffer == NULL) {
+    FreePool (NewWriter);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewWriter->File = fopen (FileName, "wb");
+  if (NewWriter->File == NULL) {
+    FreePool (NewWriter->Buffer);
+    FreePool (NewWriter);
+    return EFI_DEVICE_ERROR;
+  }
+
+  NewWriter->Header.Signature = REGISTER_ACCESS_TRACE_COMPACT_SIGNATURE;
+  NewWriter->Header.Version = REGISTER_ACCESS_TRACE_COMPACT_VERSION;
+  NewWriter->Header.TicksPerSecond = TicksPerSecond;
+
+  //
+  // Header is rewritten on close once the index location is known.
+  //
+  if (fwrite (&NewWriter->Header, sizeof (NewWriter->Header), 1, NewWriter->File) != 1) {
+    fclose (NewWriter->File);
+    FreePool (NewWriter->Buffer);
+    FreePool (NewWriter);
+    return EFI_DEVICE_ERROR;
+  }
+  NewWriter->FileOffset = sizeof (NewWriter->Header);
+
+  *Writer = NewWriter;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessTraceWriterAppend (
+  IN REGISTER_ACCESS_TRACE_WRITER        *Writer,
+  IN CONST REGISTER_ACCESS_TRACE_RECORD  *Record
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Cursor;
+  UINT8       WidthCode;
+  UINTN       Slot;
+
+  if (Writer == NULL || Record == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Writer->BlockRecords == REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS) {
+    Status = TraceWriterFlushBlock (Writer);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  if (Writer->BlockRecords == 0) {
+    Writer->FirstTimestamp = Record->Timestamp;
+    Writer->PrevTimestamp = Record->Timestamp;
+    Writer->PrevRegion = 0;
+    ZeroMem (Writer->PrevAddress, sizeof (Writer->PrevAddress));
+  }
+
+  Cursor = &Writer->Buffer[Writer->BufferLength];
+  WidthCode = TraceWidthCode (Record->Width);
+  *Cursor = (UINT8)((Record->Type & REGISTER_ACCESS_TRACE_COMPACT_TAG_TYPE_MASK) | (WidthCode << REGISTER_ACCESS_TRACE_COMPACT_TAG_WIDTH_SHIFT));
+  if (Record->Region != Writer->PrevRegion) {
+    *Cursor |= REGISTER_ACCESS_TRACE_COMPACT_TAG_REGION;
+  }
+  Cursor++;
+  if (WidthCode == REGISTER_ACCESS_TRACE_COMPACT_TAG_WIDTH_EXPLICIT) {
+    *Cursor++ = Record->Width;
+  }
+  if (Record->Region != Writer->PrevRegion) {
+    Cursor = TraceWriteVarint (Cursor, Record->Region);
+    Writer->PrevRegion = Record->Region;
+  }
+
+  Slot = Record->Region % REGISTER_ACCESS_TRACE_COMPACT_ADDRESS_SLOTS;
+  Cursor = TraceWriteSignedVarint (Cursor, Record->Timestamp - Writer->PrevTimestamp);
+  Cursor = TraceWriteSignedVarint (Cursor, Record->Address - Writer->PrevAddress[Slot]);
+  Cursor = TraceWriteVarint (Cursor, Record->Value);
+  Cursor = TraceWriteVarint (Cursor, Record->Duration);
+  Writer->PrevTimestamp = Record->Timestamp;
+  Writer->PrevAddress[Slot] = Record->Address;
+
+  Writer->BufferLength = (UINT32)(Cursor - Writer->Buffer);
+  Writer->BlockRecords++;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+RegisterAccessTraceWriterClose (
+  IN REGISTER_ACCESS_TRACE_WRITER        *Writer,
+  IN CONST REGISTER_ACCESS_TRACE_REGION  *Regions OPTIONAL,
+  IN UINT32                              RegionCount
+  )
+{
+  EFI_STATUS  Status;
+
+  if (Writer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Regions == NULL) {
+    RegionCount = 0;
+  }
+
+  Status = TraceWriterFlushBlock (Writer);
+  if (!EFI_ERROR (Status)) {
+    Writer->Header.IndexOffset = Writer->FileOffset;
+    Writer->Header.RegionCount = RegionCount;
+    if ((Writer->Header.BlockCount != 0 &&
+         fwrite (Writer->Blocks, sizeof (REGISTER_ACCESS_TRACE_COMPACT_BLOCK), (UINTN) Writer->Header.BlockCount, Writer->File) != Writer->Header.BlockCount) ||
+        (RegionCount != 0 && fwrite (Regions, sizeof (REGISTER_ACCESS_TRACE_REGION), RegionCount, Writer->File) != RegionCount) ||
+        fseek (Writer->File, 0, SEEK_SET) != 0 ||
+        fwrite (&Writer->Header, sizeof (Writer->Header), 1, Writer->File) != 1) {
+      Status = EFI_DEVICE_ERROR;
+    }
+  }
+
+  if (fclose (Writer->File) != 0 && !EFI_ERROR (Status)) {
+    Status = EFI_DEVICE_ERROR;
+  }
+
+  if (Writer->Blocks != NULL) {
+    FreePool (Writer->Blocks);
+  }
+  FreePool (Writer->Buffer);
+  FreePool (Writer);
+
+  return Status;
+}
\ No newline at end of file
@@ -0,0 +1,705 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/RegisterAccessTraceFileLib.h>
+
+#include <stdio.h>
+
+#define UNIT_TEST_NAME     "RegisterAccessTraceFileLib unit tests"
+#define UNIT_TEST_VERSION  "0.1"
+
+#define TRACE_TEST_COMPACT_FILE    "RegisterAccessTraceFileLibUnitTest.ctrace"
+#define TRACE_TEST_MONOTONIC_FILE  "RegisterAccessTraceFileLibUnitTestMonotonic.ctrace"
+#define TRACE_TEST_RAW_FILE        "RegisterAccessTraceFileLibUnitTest.trace"
+#define TRACE_TEST_CORRUPTED_FILE  "RegisterAccessTraceFileLibUnitTestCorrupted.ctrace"
+#define TRACE_TEST_DIFF_FIRST_FILE   "RegisterAccessTraceFileLibUnitTestDiff1.ctrace"
+#define TRACE_TEST_DIFF_SECOND_FILE  "RegisterAccessTraceFileLibUnitTestDiff2.ctrace"
+#define TRACE_TEST_UNSORTED_FILE     "RegisterAccessTraceFileLibUnitTestUnsorted.ctrace"
+#define TRACE_TEST_UNSORTED_RAW_FILE "RegisterAccessTraceFileLibUnitTestUnsorted.trace"
+
+//
+// Spans several blocks with the last one partially filled.
+//
+#define TRACE_TEST_RECORD_COUNT     (REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS * 4 + 123)
+#define TRACE_TEST_TICKS_PER_SECOND  2000000000ULL
+#define TRACE_TEST_DIFF_RECORD_COUNT  20000
+#define TRACE_TEST_REGION_COUNT       258
+#define TRACE_TEST_UNSORTED_RECORD_COUNT  (REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS * 3)
+
+//
+// Regions 1 and 257 share address slot in the encoder.
+//
+STATIC CONST UINT16  mTraceTestRegion[] = { 0, 1, 2, 257 };
+STATIC CONST UINT64  mTraceTestBase[]   = { 0xFED00000, 0x10000000, 0x1000, 0x80000000 };
+STATIC CONST UINT8   mTraceTestWidth[]  = { 1, 2, 4, 8, 0, 3 };
+
+STATIC
+VOID
+TraceTestMakeRecord (
+  IN  UINT64                        Index,
+  IN  BOOLEAN                       Monotonic,
+  OUT REGISTER_ACCESS_TRACE_RECORD  *Record
+  )
+{
+  UINTN  Region;
+
+  ZeroMem (Record, sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  Region = (UINTN)(Index % ARRAY_SIZE (mTraceTestRegion));
+  Record->Timestamp = 1000000 + Index * 37;
+  if (!Monotonic && (Index % 100) == 99) {
+    //
+    // Poll records are stamped with their start and go back in time.
+    //
+    Record->Timestamp -= 5000;
+  }
+  Record->Region = mTraceTestRegion[Region];
+  Record->Type = (UINT8)(Index % RegisterAccessTraceTypeMax);
+  Record->Width = mTraceTestWidth[Index % ARRAY_SIZE (mTraceTestWidth)];
+  Record->Address = mTraceTestBase[Region] + ((Index * 12) % 0x300);
+  Record->Value = ((Index % 7) == 0) ? MAX_UINT64 : (Index % 0x10000);
+  Record->Duration = ((Index % 3) == 0) ? 0 : (UINT32)(Index % 1000);
+  if ((Index % 1000) == 1) {
+    Record->Duration = MAX_UINT32;
+  }
+}
+
+STATIC
+VOID
+TraceTestMakeRegions (
+  OUT REGISTER_ACCESS_TRACE_REGION  *Regions,
+  IN  UINT32                        RegionCount
+  )
+{
+  UINT32  Index;
+
+  ZeroMem (Regions, RegionCount * sizeof (REGISTER_ACCESS_TRACE_REGION));
+  for (Index = 0; Index < RegionCount; Index++) {
+    Regions[Index].Base = Index * 0x1000;
+    Regions[Index].Size = 0x1000;
+    Regions[Index].Type = RegisterAccessTraceRegionMmio;
+    AsciiSPrint (Regions[Index].Name, sizeof (Regions[Index].Name), "Region%d", Index);
+  }
+}
+
+STATIC
+EFI_STATUS
+TraceTestWriteCompact (
+  IN CONST CHAR8  *FileName,
+  IN BOOLEAN      Monotonic
+  )
+{
+  REGISTER_ACCESS_TRACE_WRITER  *Writer;
+  REGISTER_ACCESS_TRACE_RECORD  Record;
+  REGISTER_ACCESS_TRACE_REGION  Regions[TRACE_TEST_REGION_COUNT];
+  UINT64                        Index;
+  EFI_STATUS                    Status;
+
+  Status = RegisterAccessTraceWriterCreate (FileName, TRACE_TEST_TICKS_PER_SECOND, &Writer);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Index = 0; Index < TRACE_TEST_RECORD_COUNT; Index++) {
+    TraceTestMakeRecord (Index, Monotonic, &Record);
+    Status = RegisterAccessTraceWriterAppend (Writer, &Record);
+    if (EFI_ERROR (Status)) {
+      RegisterAccessTraceWriterClose (Writer, NULL, 0);
+      return Status;
+    }
+  }
+
+  TraceTestMakeRegions (Regions, ARRAY_SIZE (Regions));
+  return RegisterAccessTraceWriterClose (Writer, Regions, ARRAY_SIZE (Regions));
+}
+
+STATIC
+UINT64
+TraceTestFileSize (
+  IN CONST CHAR8  *FileName
+  )
+{
+  FILE    *File;
+  UINT64  Size;
+
+  File = fopen (FileName, "rb");
+  if (File == NULL) {
+    return 0;
+  }
+
+  fseek (File, 0, SEEK_END);
+  Size = (UINT64) ftell (File);
+  fclose (File);
+  return Size;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessTraceCompactRoundTripTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_TRACE_READER        *Reader;
+  REGISTER_ACCESS_TRACE_RECORD        Record;
+  REGISTER_ACCESS_TRACE_RECORD        Expected;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  UINT64                              RecordCount;
+  UINT64                              TicksPerSecond;
+  UINT64                              Index;
+  EFI_STATUS                          Status;
+
+  Status = TraceTestWriteCompact (TRACE_TEST_COMPACT_FILE, FALSE);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  //
+  // Typical record takes a fraction of the raw record size.
+  //
+  UT_ASSERT_TRUE (TraceTestFileSize (TRACE_TEST_COMPACT_FILE) < TRACE_TEST_RECORD_COUNT * sizeof (REGISTER_ACCESS_TRACE_RECORD) / 2);
+
+  Status = RegisterAccessTraceReaderOpen (TRACE_TEST_COMPACT_FILE, &Reader);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  RegisterAccessTraceReaderGetInfo (Reader, &RecordCount, &TicksPerSecond, &Regions, &RegionCount);
+  UT_ASSERT_EQUAL (RecordCount, TRACE_TEST_RECORD_COUNT);
+  UT_ASSERT_EQUAL (TicksPerSecond, TRACE_TEST_TICKS_PER_SECOND);
+  UT_ASSERT_EQUAL (RegionCount, TRACE_TEST_REGION_COUNT);
+  UT_ASSERT_EQUAL (Regions[257].Base, 257 * 0x1000);
+  UT_ASSERT_EQUAL (AsciiStrCmp (Regions[257].Name, "Region257"), 0);
+
+  for (Index = 0; Index < TRACE_TEST_RECORD_COUNT; Index++) {
+    Status = RegisterAccessTraceReaderNext (Reader, &Record);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    TraceTestMakeRecord (Index, FALSE, &Expected);
+    UT_ASSERT_MEM_EQUAL (&Record, &Expected, sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  }
+
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  UT_ASSERT_EQUAL (Status, EFI_END_OF_FILE);
+
+  RegisterAccessTraceReaderClose (Reader);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessTraceCompactSeekTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINT64           SeekIndex[] = { 12345, 0, REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS - 1, REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS, 12346, 12300, TRACE_TEST_RECORD_COUNT - 1 };
+  REGISTER_ACCESS_TRACE_READER  *Reader;
+  REGISTER_ACCESS_TRACE_RECORD  Record;
+  REGISTER_ACCESS_TRACE_RECORD  Expected;
+  UINT64                        Index;
+  UINTN                         Seek;
+  EFI_STATUS                    Status;
+
+  Status = TraceTestWriteCompact (TRACE_TEST_MONOTONIC_FILE, TRUE);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Status = RegisterAccessTraceReaderOpen (TRACE_TEST_MONOTONIC_FILE, &Reader);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  for (Seek = 0; Seek < ARRAY_SIZE (SeekIndex); Seek++) {
+    Status = RegisterAccessTraceReaderSeek (Reader, SeekIndex[Seek]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    Status = RegisterAccessTraceReaderNext (Reader, &Record);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    TraceTestMakeRecord (SeekIndex[Seek], TRUE, &Expected);
+    UT_ASSERT_MEM_EQUAL (&Record, &Expected, sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  }
+
+  Status = RegisterAccessTraceReaderSeek (Reader, TRACE_TEST_RECORD_COUNT);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  UT_ASSERT_EQUAL (Status, EFI_END_OF_FILE);
+  Status = RegisterAccessTraceReaderSeek (Reader, TRACE_TEST_RECORD_COUNT + 1);
+  UT_ASSERT_EQUAL (Status, EFI_INVALID_PARAMETER);
+
+  //
+  // Exact timestamp, timestamp between records and timestamps outside of the trace.
+  //
+  TraceTestMakeRecord (9000, TRUE, &Expected);
+  Status = RegisterAccessTraceReaderSeekTimestamp (Reader, Expected.Timestamp, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Index, 9000);
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_MEM_EQUAL (&Record, &Expected, sizeof (REGISTER_ACCESS_TRACE_RECORD));
+
+  Status = RegisterAccessTraceReaderSeekTimestamp (Reader, Expected.Timestamp - 1, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Index, 9000);
+
+  TraceTestMakeRecord (REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS * 2, TRUE, &Expected);
+  Status = RegisterAccessTraceReaderSeekTimestamp (Reader, Expected.Timestamp, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Index, REGISTER_ACCESS_TRACE_COMPACT_BLOCK_RECORDS * 2);
+
+  Status = RegisterAccessTraceReaderSeekTimestamp (Reader, 0, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Index, 0);
+
+  Status = RegisterAccessTraceReaderSeekTimestamp (Reader, MAX_UINT64, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Index, TRACE_TEST_RECORD_COUNT);
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  UT_ASSERT_EQUAL (Status, EFI_END_OF_FILE);
+
+  RegisterAccessTraceReaderClose (Reader);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessTraceRawReadTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_TRACE_HEADER        Header;
+  REGISTER_ACCESS_TRACE_REGION        Regions[2];
+  CONST REGISTER_ACCESS_TRACE_REGION  *ReadRegions;
+  UINT32                              RegionCount;
+  REGISTER_ACCESS_TRACE_READER        *Reader;
+  REGISTER_ACCESS_TRACE_RECORD        Record;
+  REGISTER_ACCESS_TRACE_RECORD        Expected;
+  UINT64                              RecordCount;
+  UINT64                              Index;
+  FILE                                *File;
+  EFI_STATUS                          Status;
+
+  ZeroMem (&Header, sizeof (Header));
+  Header.Signature = REGISTER_ACCESS_TRACE_SIGNATURE;
+  Header.Version = REGISTER_ACCESS_TRACE_VERSION;
+  Header.RegionCount = ARRAY_SIZE (Regions);
+  Header.RecordCount = 1000;
+  TraceTestMakeRegions (Regions, ARRAY_SIZE (Regions));
+
+  File = fopen (TRACE_TEST_RAW_FILE, "wb");
+  UT_ASSERT_NOT_NULL (File);
+  fwrite (&Header, sizeof (Header), 1, File);
+  fwrite (Regions, sizeof (Regions), 1, File);
+  for (Index = 0; Index < Header.RecordCount; Index++) {
+    TraceTestMakeRecord (Index, TRUE, &Record);
+    fwrite (&Record, sizeof (Record), 1, File);
+  }
+  fclose (File);
+
+  Status = RegisterAccessTraceReaderOpen (TRACE_TEST_RAW_FILE, &Reader);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  RegisterAccessTraceReaderGetInfo (Reader, &RecordCount, NULL, &ReadRegions, &RegionCount);
+  UT_ASSERT_EQUAL (RecordCount, 1000);
+  UT_ASSERT_EQUAL (RegionCount, 2);
+  UT_ASSERT_EQUAL (AsciiStrCmp (ReadRegions[1].Name, "Region1"), 0);
+
+  for (Index = 0; Index < RecordCount; Index++) {
+    Status = RegisterAccessTraceReaderNext (Reader, &Record);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    TraceTestMakeRecord (Index, TRUE, &Expected);
+    UT_ASSERT_MEM_EQUAL (&Record, &Expected, sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  }
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  UT_ASSERT_EQUAL (Status, EFI_END_OF_FILE);
+
+  TraceTestMakeRecord (500, TRUE, &Expected);
+  Status = RegisterAccessTraceReaderSeekTimestamp (Reader, Expected.Timestamp - 1, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Index, 500);
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_MEM_EQUAL (&Record, &Expected, sizeof (REGISTER_ACCESS_TRACE_RECORD));
+
+  RegisterAccessTraceReaderClose (Reader);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessTraceCorruptedTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_TRACE_READER  *Reader;
+  UINT8                         Buffer[256];
+  FILE                          *File;
+  UINTN                         Size;
+  EFI_STATUS                    Status;
+
+  Status = RegisterAccessTraceReaderOpen ("RegisterAccessTraceFileLibUnitTestMissing.ctrace", &Reader);
+  UT_ASSERT_EQUAL (Status, EFI_NOT_FOUND);
+
+  //
+  // Truncated file has its index cut off.
+  //
+  Status = TraceTestWriteCompact (TRACE_TEST_CORRUPTED_FILE, TRUE);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  File = fopen (TRACE_TEST_CORRUPTED_FILE, "rb");
+  UT_ASSERT_NOT_NULL (File);
+  Size = fread (Buffer, 1, sizeof (Buffer), File);
+  fclose (File);
+  UT_ASSERT_EQUAL (Size, sizeof (Buffer));
+
+  File = fopen (TRACE_TEST_CORRUPTED_FILE, "wb");
+  UT_ASSERT_NOT_NULL (File);
+  fwrite (Buffer, 1, sizeof (Buffer), File);
+  fclose (File);
+  Status = RegisterAccessTraceReaderOpen (TRACE_TEST_CORRUPTED_FILE, &Reader);
+  UT_ASSERT_EQUAL (Status, EFI_VOLUME_CORRUPTED);
+
+  SetMem (Buffer, sizeof (Buffer), 0xA5);
+  File = fopen (TRACE_TEST_CORRUPTED_FILE, "wb");
+  UT_ASSERT_NOT_NULL (File);
+  fwrite (Buffer, 1, sizeof (Buffer), File);
+  fclose (File);
+  Status = RegisterAccessTraceReaderOpen (TRACE_TEST_CORRUPTED_FILE, &Reader);
+  UT_ASSERT_EQUAL (Status, EFI_VOLUME_CORRUPTED);
+
+  return UNIT_TEST_PASSED;
+}
+
+STATIC
+EFI_STATUS
+TraceTestWriteRecords (
+  IN CONST CHAR8                         *FileName,
+  IN CONST REGISTER_ACCESS_TRACE_RECORD  *Records,
+  IN UINTN                               RecordCount,
+  IN CONST REGISTER_ACCESS_TRACE_REGION  *Regions,
+  IN UINT32                              RegionCount
+  )
+{
+  REGISTER_ACCESS_TRACE_WRITER  *Writer;
+  UINTN                         Index;
+  EFI_STATUS                    Status;
+
+  Status = RegisterAccessTraceWriterCreate (FileName, TRACE_TEST_TICKS_PER_SECOND, &Writer);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Index = 0; Index < RecordCount; Index++) {
+    Status = RegisterAccessTraceWriterAppend (Writer, &Records[Index]);
+    if (EFI_ERROR (Status)) {
+      RegisterAccessTraceWriterClose (Writer, NULL, 0);
+      return Status;
+    }
+  }
+
+  return RegisterAccessTraceWriterClose (Writer, Regions, RegionCount);
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessTraceUnsortedSeekTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST CHAR8            *FileNames[] = { TRACE_TEST_UNSORTED_FILE, TRACE_TEST_UNSORTED_RAW_FILE };
+  REGISTER_ACCESS_TRACE_HEADER  Header;
+  REGISTER_ACCESS_TRACE_REGION  Region;
+  REGISTER_ACCESS_TRACE_RECORD  *Records;
+  REGISTER_ACCESS_TRACE_READER  *Reader;
+  UINT64                        Index;
+  UINTN                         File;
+  FILE                          *RawFile;
+  EFI_STATUS                    Status;
+
+  //
+  // Every 16th record is a poll stamped at the start of the trace, including
+  // the first record of every block, so neither records nor blocks are sorted
+  // by timestamp.
+  //
+  Records = AllocateZeroPool (TRACE_TEST_UNSORTED_RECORD_COUNT * sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  UT_ASSERT_NOT_NULL (Records);
+  for (Index = 0; Index < TRACE_TEST_UNSORTED_RECORD_COUNT; Index++) {
+    Records[Index].Timestamp = ((Index % 16) == 0) ? 0 : 1000 + Index * 10;
+    Records[Index].Type = RegisterAccessTraceMmioRead;
+    Records[Index].Width = 4;
+    Records[Index].Address = (Index * 4) % 0x1000;
+  }
+  TraceTestMakeRegions (&Region, 1);
+
+  Status = TraceTestWriteRecords (TRACE_TEST_UNSORTED_FILE, Records, TRACE_TEST_UNSORTED_RECORD_COUNT, &Region, 1);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  ZeroMem (&Header, sizeof (Header));
+  Header.Signature = REGISTER_ACCESS_TRACE_SIGNATURE;
+  Header.Version = REGISTER_ACCESS_TRACE_VERSION;
+  Header.RegionCount = 1;
+  Header.RecordCount = TRACE_TEST_UNSORTED_RECORD_COUNT;
+  RawFile = fopen (TRACE_TEST_UNSORTED_RAW_FILE, "wb");
+  UT_ASSERT_NOT_NULL (RawFile);
+  fwrite (&Header, sizeof (Header), 1, RawFile);
+  fwrite (&Region, sizeof (Region), 1, RawFile);
+  fwrite (Records, sizeof (REGISTER_ACCESS_TRACE_RECORD), TRACE_TEST_UNSORTED_RECORD_COUNT, RawFile);
+  fclose (RawFile);
+  FreePool (Records);
+
+  for (File = 0; File < ARRAY_SIZE (FileNames); File++) {
+    Status = RegisterAccessTraceReaderOpen (FileNames[File], &Reader);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+
+    Status = RegisterAccessTraceReaderSeekTimestamp (Reader, 1000 + 5000 * 10, &Index);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (Index, 5000);
+
+    Status = RegisterAccessTraceReaderSeekTimestamp (Reader, 1000 + 5000 * 10 + 1, &Index);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (Index, 5001);
+
+    Status = RegisterAccessTraceReaderSeekTimestamp (Reader, 1000 + 4096 * 10, &Index);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (Index, 4097);
+
+    Status = RegisterAccessTraceReaderSeekTimestamp (Reader, 0, &Index);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (Index, 0);
+
+    Status = RegisterAccessTraceReaderSeekTimestamp (Reader, MAX_UINT64, &Index);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (Index, TRACE_TEST_UNSORTED_RECORD_COUNT);
+
+    RegisterAccessTraceReaderClose (Reader);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+//
+// Writes the reference trace and the second trace made of reference records
+// [0, Split) followed by Inserted new records and reference records
+// [Split + Deleted, End).
+//
+STATIC
+EFI_STATUS
+TraceTestWriteDiffTraces (
+  IN UINTN  Split,
+  IN UINTN  Deleted,
+  IN UINTN  Inserted,
+  IN UINTN  End
+  )
+{
+  REGISTER_ACCESS_TRACE_RECORD  *Records;
+  REGISTER_ACCESS_TRACE_REGION  Regions[TRACE_TEST_REGION_COUNT];
+  UINTN                         Index;
+  UINTN                         Count;
+  EFI_STATUS                    Status;
+
+  Records = AllocatePool ((TRACE_TEST_DIFF_RECORD_COUNT + Inserted) * sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  if (Records == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  TraceTestMakeRegions (Regions, ARRAY_SIZE (Regions));
+  for (Index = 0; Index < TRACE_TEST_DIFF_RECORD_COUNT; Index++) {
+    TraceTestMakeRecord (Index, TRUE, &Records[Index]);
+  }
+  Status = TraceTestWriteRecords (TRACE_TEST_DIFF_FIRST_FILE, Records, TRACE_TEST_DIFF_RECORD_COUNT, Regions, ARRAY_SIZE (Regions));
+  if (EFI_ERROR (Status)) {
+    FreePool (Records);
+    return Status;
+  }
+
+  Count = 0;
+  for (Index = 0; Index < End; Index++) {
+    if (Index == Split) {
+      while (Inserted > 0) {
+        TraceTestMakeRecord (Index, TRUE, &Records[Count]);
+        Records[Count].Address = 0xDEAD0000 + Inserted--;
+        Count++;
+      }
+    }
+    if (Index < Split || Index >= Split + Deleted) {
+      TraceTestMakeRecord (Index, TRUE, &Records[Count++]);
+    }
+  }
+  Status = TraceTestWriteRecords (TRACE_TEST_DIFF_SECOND_FILE, Records, Count, Regions, ARRAY_SIZE (Regions));
+
+  FreePool (Records);
+  return Status;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAccessTraceDiffTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  REGISTER_ACCESS_TRACE_DIFF_RESULT   Result;
+  REGISTER_ACCESS_TRACE_DIFF_OPTIONS  Options;
+  REGISTER_ACCESS_TRACE_RECORD        *Records;
+  REGISTER_ACCESS_TRACE_REGION        Regions[TRACE_TEST_REGION_COUNT];
+  UINTN                               Index;
+  EFI_STATUS                          Status;
+
+  Status = TraceTestWriteDiffTraces (0, 0, 0, TRACE_TEST_DIFF_RECORD_COUNT);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = RegisterAccessTraceDiff (TRACE_TEST_DIFF_FIRST_FILE, TRACE_TEST_DIFF_SECOND_FILE, NULL, &Result);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Result.FirstKind, RegisterAccessTraceDiffNone);
+  UT_ASSERT_EQUAL (Result.MatchedCount, TRACE_TEST_DIFF_RECORD_COUNT);
+  RegisterAccessTraceDiffPrint (&Result);
+
+  //
+  // Deleted and inserted records are followed by the rest of the trace.
+  //
+  Status = TraceTestWriteDiffTraces (7000, 10, 0, TRACE_TEST_DIFF_RECORD_COUNT);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = RegisterAccessTraceDiff (TRACE_TEST_DIFF_FIRST_FILE, TRACE_TEST_DIFF_SECOND_FILE, NULL, &Result);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Result.FirstKind, RegisterAccessTraceDiffDeleted);
+  UT_ASSERT_EQUAL (Result.FirstIndex[0], 7000);
+  UT_ASSERT_EQUAL (Result.FirstIndex[1], 7000);
+  UT_ASSERT_EQUAL (Result.FirstDeletedLength, 10);
+  UT_ASSERT_EQUAL (Result.DeletedCount, 10);
+  UT_ASSERT_EQUAL (Result.InsertedCount, 0);
+  UT_ASSERT_EQUAL (Result.MatchedCount, TRACE_TEST_DIFF_RECORD_COUNT - 10);
+  UT_ASSERT_EQUAL (Result.ResyncCount, 1);
+  RegisterAccessTraceDiffPrint (&Result);
+
+  Status = TraceTestWriteDiffTraces (100, 0, 3, TRACE_TEST_DIFF_RECORD_COUNT);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = RegisterAccessTraceDiff (TRACE_TEST_DIFF_FIRST_FILE, TRACE_TEST_DIFF_SECOND_FILE, NULL, &Result);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Result.FirstKind, RegisterAccessTraceDiffInserted);
+  UT_ASSERT_EQUAL (Result.FirstIndex[1], 100);
+  UT_ASSERT_EQUAL (Result.FirstRecord[1].Address, 0xDEAD0003);
+  UT_ASSERT_EQUAL (Result.InsertedCount, 3);
+  UT_ASSERT_EQUAL (Result.MatchedCount, TRACE_TEST_DIFF_RECORD_COUNT);
+
+  Status = TraceTestWriteDiffTraces (12000, 5, 2, TRACE_TEST_DIFF_RECORD_COUNT);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = RegisterAccessTraceDiff (TRACE_TEST_DIFF_FIRST_FILE, TRACE_TEST_DIFF_SECOND_FILE, NULL, &Result);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Result.FirstKind, RegisterAccessTraceDiffReplaced);
+  UT_ASSERT_EQUAL (Result.FirstDeletedLength, 5);
+  UT_ASSERT_EQUAL (Result.FirstInsertedLength, 2);
+  UT_ASSERT_EQUAL (Result.MatchedCount, TRACE_TEST_DIFF_RECORD_COUNT - 5);
+
+  //
+  // Truncated second trace.
+  //
+  Status = TraceTestWriteDiffTraces (0, 0, 0, TRACE_TEST_DIFF_RECORD_COUNT - 1000);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = RegisterAccessTraceDiff (TRACE_TEST_DIFF_FIRST_FILE, TRACE_TEST_DIFF_SECOND_FILE, NULL, &Result);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Result.FirstKind, RegisterAccessTraceDiffDeleted);
+  UT_ASSERT_EQUAL (Result.FirstIndex[0], TRACE_TEST_DIFF_RECORD_COUNT - 1000);
+  UT_ASSERT_EQUAL (Result.FirstIndex[1], Result.RecordCount[1]);
+  UT_ASSERT_EQUAL (Result.FirstDeletedLength, 1000);
+  RegisterAccessTraceDiffPrint (&Result);
+
+  //
+  // Second trace has its regions registered in reverse order and value of
+  // a write and a read changed.
+  //
+  Records = AllocatePool (TRACE_TEST_DIFF_RECORD_COUNT * sizeof (REGISTER_ACCESS_TRACE_RECORD));
+  UT_ASSERT_NOT_NULL (Records);
+  TraceTestMakeRegions (Regions, ARRAY_SIZE (Regions));
+  for (Index = 0; Index < ARRAY_SIZE (Regions); Index++) {
+    Regions[Index].Base = (TRACE_TEST_REGION_COUNT - 1 - Index) * 0x1000;
+    AsciiSPrint (Regions[Index].Name, sizeof (Regions[Index].Name), "Region%d", TRACE_TEST_REGION_COUNT - 1 - Index);
+  }
+  for (Index = 0; Index < TRACE_TEST_DIFF_RECORD_COUNT; Index++) {
+    TraceTestMakeRecord (Index, TRUE, &Records[Index]);
+    Records[Index].Region = (UINT16)(TRACE_TEST_REGION_COUNT - 1 - Records[Index].Region);
+    Records[Index].Timestamp += 12345;
+  }
+  //
+  // Record 5005 is a read and 5006 a write.
+  //
+  Records[5005].Value ^= 1;
+  Records[5006].Value ^= 1;
+  Status = TraceTestWriteRecords (TRACE_TEST_DIFF_SECOND_FILE, Records, TRACE_TEST_DIFF_RECORD_COUNT, Regions, ARRAY_SIZE (Regions));
+  FreePool (Records);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Status = RegisterAccessTraceDiff (TRACE_TEST_DIFF_FIRST_FILE, TRACE_TEST_DIFF_SECOND_FILE, NULL, &Result);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Result.FirstKind, RegisterAccessTraceDiffValue);
+  UT_ASSERT_EQUAL (Result.FirstIndex[0], 5005);
+  UT_ASSERT_EQUAL (Result.FirstIndex[1], 5005);
+  UT_ASSERT_EQUAL (Result.ValueMismatchCount, 2);
+  UT_ASSERT_EQUAL (Result.MatchedCount, TRACE_TEST_DIFF_RECORD_COUNT - 2);
+  UT_ASSERT_EQUAL (Result.DeletedCount + Result.InsertedCount, 0);
+
+  ZeroMem (&Options, sizeof (Options));
+  Options.Flags = REGISTER_ACCESS_TRACE_DIFF_IGNORE_READ_VALUES;
+  Status = RegisterAccessTraceDiff (TRACE_TEST_DIFF_FIRST_FILE, TRACE_TEST_DIFF_SECOND_FILE, &Options, &Result);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Result.ValueMismatchCount, 1);
+  UT_ASSERT_EQUAL (Result.FirstIndex[0], 5006);
+
+  Options.Flags = REGISTER_ACCESS_TRACE_DIFF_STOP_AT_FIRST;
+  Status = RegisterAccessTraceDiff (TRACE_TEST_DIFF_FIRST_FILE, TRACE_TEST_DIFF_SECOND_FILE, &Options, &Result);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Result.ValueMismatchCount, 1);
+  UT_ASSERT_EQUAL (Result.MatchedCount, 5005);
+
+  Status = RegisterAccessTraceDiff (TRACE_TEST_DIFF_FIRST_FILE, "RegisterAccessTraceFileLibUnitTestMissing.ctrace", NULL, &Result);
+  UT_ASSERT_EQUAL (Status, EFI_NOT_FOUND);
+
+  return UNIT_TEST_PASSED;
+}
+
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      RegisterAccessTraceFileLibTest;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    return Status;
+  }
+
+  Status = CreateUnitTestSuite (&RegisterAccessTraceFileLibTest, Framework, "RegisterAccessTraceFileLibUnitTests", "RegisterAccessTraceFileLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  AddTestCase (RegisterAccessTraceFileLibTest, "RegisterAccessTraceCompactRoundTripTest", "RegisterAccessTraceCompactRoundTripTest", RegisterAccessTraceCompactRoundTripTest, NULL, NULL, NULL);
+  AddTestCase (RegisterAccessTraceFileLibTest, "RegisterAccessTraceCompactSeekTest", "RegisterAccessTraceCompactSeekTest", RegisterAccessTraceCompactSeekTest, NULL, NULL, NULL);
+  AddTestCase (RegisterAccessTraceFileLibTest, "RegisterAccessTraceRawReadTest", "RegisterAccessTraceRawReadTest", RegisterAccessTraceRawReadTest, NULL, NULL, NULL);
+  AddTestCase (RegisterAccessTraceFileLibTest, "RegisterAccessTraceCorruptedTest", "RegisterAccessTraceCorruptedTest", RegisterAccessTraceCorruptedTest, NULL, NULL, NULL);
+  AddTestCase (RegisterAccessTraceFileLibTest, "RegisterAccessTraceUnsortedSeekTest", "RegisterAccessTraceUnsortedSeekTest", RegisterAccessTraceUnsortedSeekTest, NULL, NULL, NULL);
+  AddTestCase (RegisterAccessTraceFileLibTest, "RegisterAccessTraceDiffTest", "RegisterAccessTraceDiffTest", RegisterAccessTraceDiffTest, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UefiTestMain ();
+}
\ No newline at end of file
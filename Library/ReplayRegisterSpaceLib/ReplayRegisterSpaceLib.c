@@ -0,0 +1,554 @@
+/** @file
+  Register space answering accesses from a trace recorded by RegisterAccessIoLib.
+
+  Trace is read with RegisterAccessTraceFileLib so both raw and compact traces
+  can be replayed. Only the records belonging to the replayed region are kept,
+  with their addresses translated to offsets within the region.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/ReplayRegisterSpaceLib.h>
+#include <Library/RegisterAccessTraceFileLib.h>
+
+#define REPLAY_VALUE_MASK(Size)  (((Size) >= 8) ? MAX_UINT64 : (LShiftU64 (1, (Size) * 8) - 1))
+
+typedef struct {
+  UINT64  Offset;
+  //
+  // Position of the record in the trace. Keeps values recorded for the same
+  // offset in the recorded order after sorting.
+  //
+  UINT64  Sequence;
+  UINT64  Value;
+} REPLAY_READ_ENTRY;
+
+typedef struct {
+  UINT64  Offset;
+  UINTN   First;
+  UINTN   Count;
+  UINTN   Next;
+} REPLAY_ADDRESS_SLOT;
+
+typedef struct {
+  REGISTER_ACCESS_INTERFACE           RegisterSpace;
+  REPLAY_REGISTER_SPACE_MODE          Mode;
+  UINT64                              Mismatches;
+  //
+  // Replayed records in trace order. Address holds the offset within the region.
+  //
+  REGISTER_ACCESS_TRACE_RECORD        *Records;
+  UINTN                               RecordCount;
+  //
+  // Strict mode. Index of the next expected record.
+  //
+  UINTN                               Cursor;
+  //
+  // Relaxed mode. Read values sorted by offset and slots sorted by offset.
+  //
+  REPLAY_READ_ENTRY                   *ReadEntries;
+  REPLAY_ADDRESS_SLOT                 *Slots;
+  UINTN                               SlotCount;
+} REPLAY_REGISTER_SPACE;
+
+STATIC
+BOOLEAN
+ReplayIsRead (
+  IN UINT8  Type
+  )
+{
+  return (Type == RegisterAccessTraceMmioRead || Type == RegisterAccessTraceIoRead);
+}
+
+STATIC
+BOOLEAN
+ReplayIsWrite (
+  IN UINT8  Type
+  )
+{
+  return (Type == RegisterAccessTraceMmioWrite || Type == RegisterAccessTraceIoWrite);
+}
+
+STATIC
+INTN
+EFIAPI
+ReplayCompareReadEntry (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST REPLAY_READ_ENTRY  *Entry1;
+  CONST REPLAY_READ_ENTRY  *Entry2;
+
+  Entry1 = (CONST REPLAY_READ_ENTRY*) Buffer1;
+  Entry2 = (CONST REPLAY_READ_ENTRY*) Buffer2;
+  if (Entry1->Offset != Entry2->Offset) {
+    return (Entry1->Offset < Entry2->Offset) ? -1 : 1;
+  }
+  if (Entry1->Sequence != Entry2->Sequence) {
+    return (Entry1->Sequence < Entry2->Sequence) ? -1 : 1;
+  }
+  return 0;
+}
+
+STATIC
+REPLAY_ADDRESS_SLOT*
+ReplayFindSlot (
+  IN REPLAY_REGISTER_SPACE  *Replay,
+  IN UINT64                 Offset
+  )
+{
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Middle;
+
+  Low = 0;
+  High = Replay->SlotCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Replay->Slots[Middle].Offset == Offset) {
+      return &Replay->Slots[Middle];
+    } else if (Replay->Slots[Middle].Offset < Offset) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  return NULL;
+}
+
+STATIC
+EFI_STATUS
+ReplayBuildReadIndex (
+  IN REPLAY_REGISTER_SPACE  *Replay
+  )
+{
+  UINTN              Index;
+  UINTN              NoOfReads;
+  REPLAY_READ_ENTRY  Swap;
+
+  NoOfReads = 0;
+  for (Index = 0; Index < Replay->RecordCount; Index++) {
+    if (ReplayIsRead (Replay->Records[Index].Type)) {
+      NoOfReads++;
+    }
+  }
+  if (NoOfReads == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Replay->ReadEntries = AllocatePool (NoOfReads * sizeof (REPLAY_READ_ENTRY));
+  Replay->Slots = AllocateZeroPool (NoOfReads * sizeof (REPLAY_ADDRESS_SLOT));
+  if (Replay->ReadEntries == NULL || Replay->Slots == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NoOfReads = 0;
+  for (Index = 0; Index < Replay->RecordCount; Index++) {
+    if (ReplayIsRead (Replay->Records[Index].Type)) {
+      Replay->ReadEntries[NoOfReads].Offset = Replay->Records[Index].Address;
+      Replay->ReadEntries[NoOfReads].Sequence = Index;
+      Replay->ReadEntries[NoOfReads].Value = Replay->Records[Index].Value;
+      NoOfReads++;
+    }
+  }
+
+  QuickSort (Replay->ReadEntries, NoOfReads, sizeof (REPLAY_READ_ENTRY), ReplayCompareReadEntry, &Swap);
+
+  for (Index = 0; Index < NoOfReads; Index++) {
+    if (Replay->SlotCount == 0 || Replay->Slots[Replay->SlotCount - 1].Offset != Replay->ReadEntries[Index].Offset) {
+      Replay->Slots[Replay->SlotCount].Offset = Replay->ReadEntries[Index].Offset;
+      Replay->Slots[Replay->SlotCount].First = Index;
+      Replay->SlotCount++;
+    }
+    Replay->Slots[Replay->SlotCount - 1].Count++;
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+CONST REGISTER_ACCESS_TRACE_RECORD*
+ReplayNextRecord (
+  IN REPLAY_REGISTER_SPACE  *Replay
+  )
+{
+  if (Replay->Cursor >= Replay->RecordCount) {
+    return NULL;
+  }
+
+  return &Replay->Records[Replay->Cursor];
+}
+
+STATIC
+VOID
+ReplayReportMismatch (
+  IN REPLAY_REGISTER_SPACE               *Replay,
+  IN CONST CHAR8                         *Operation,
+  IN UINT64                              Address,
+  IN UINT32                              Size,
+  IN UINT64                              Value,
+  IN CONST REGISTER_ACCESS_TRACE_RECORD  *Expected
+  )
+{
+  Replay->Mismatches++;
+  if (Expected == NULL) {
+    DEBUG ((DEBUG_ERROR, "%s: %a Address %LX Size %d Value %LX past the end of the trace\n", Replay->RegisterSpace.Name, Operation, Address, Size, Value));
+    return;
+  }
+
+  DEBUG ((
+    DEBUG_ERROR,
+    "%s: record %Ld %a Address %LX Size %d Value %LX doesn't match recorded %a Address %LX Size %d Value %LX\n",
+    Replay->RegisterSpace.Name,
+    (UINT64) Replay->Cursor,
+    Operation,
+    Address,
+    Size,
+    Value,
+    ReplayIsRead (Expected->Type) ? "read" : "write",
+    Expected->Address,
+    Expected->Width,
+    Expected->Value
+    ));
+}
+
+STATIC
+EFI_STATUS
+ReplayRegisterRead (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64                     Address,
+  IN UINT32                     Size,
+  OUT UINT64                    *Value
+  )
+{
+  REPLAY_REGISTER_SPACE               *Replay;
+  CONST REGISTER_ACCESS_TRACE_RECORD  *Record;
+  REPLAY_ADDRESS_SLOT                 *Slot;
+
+  Replay = (REPLAY_REGISTER_SPACE*) RegisterSpace;
+
+  if (Replay->Mode == ReplayRegisterSpaceModeRelaxed) {
+    Slot = ReplayFindSlot (Replay, Address);
+    if (Slot == NULL) {
+      Replay->Mismatches++;
+      DEBUG ((DEBUG_ERROR, "%s: Address %LX was never read in the trace\n", RegisterSpace->Name, Address));
+      *Value = REPLAY_VALUE_MASK (Size);
+      return EFI_NOT_FOUND;
+    }
+
+    *Value = Replay->ReadEntries[Slot->First + Slot->Next].Value & REPLAY_VALUE_MASK (Size);
+    if (Slot->Next + 1 < Slot->Count) {
+      Slot->Next++;
+    }
+    return EFI_SUCCESS;
+  }
+
+  //
+  // In strict mode a mismatching access doesn't consume the record so that
+  // the first divergence stays at the cursor.
+  //
+  Record = ReplayNextRecord (Replay);
+  if (Record == NULL || !ReplayIsRead (Record->Type) ||
+      Record->Address != Address || Record->Width != Size) {
+    ReplayReportMismatch (Replay, "read", Address, Size, 0, Record);
+    *Value = REPLAY_VALUE_MASK (Size);
+    return EFI_DEVICE_ERROR;
+  }
+
+  Replay->Cursor++;
+  *Value = Record->Value & REPLAY_VALUE_MASK (Size);
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+ReplayRegisterWrite (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64                     Address,
+  IN UINT32                     Size,
+  IN UINT64                     Value
+  )
+{
+  REPLAY_REGISTER_SPACE               *Replay;
+  CONST REGISTER_ACCESS_TRACE_RECORD  *Record;
+
+  Replay = (REPLAY_REGISTER_SPACE*) RegisterSpace;
+
+  if (Replay->Mode == ReplayRegisterSpaceModeRelaxed) {
+    return EFI_SUCCESS;
+  }
+
+  Record = ReplayNextRecord (Replay);
+  if (Record == NULL || !ReplayIsWrite (Record->Type) ||
+      Record->Address != Address || Record->Width != Size ||
+      (Record->Value & REPLAY_VALUE_MASK (Size)) != (Value & REPLAY_VALUE_MASK (Size))) {
+    ReplayReportMismatch (Replay, "write", Address, Size, Value, Record);
+    return EFI_DEVICE_ERROR;
+  }
+
+  Replay->Cursor++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Write combined block is matched against the recorded writes it was built from.
+  RegisterAccessIoLib records writes before they are combined so the block has to
+  be covered by consecutive write records.
+**/
+STATIC
+EFI_STATUS
+ReplayRegisterWriteBlock (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  IN UINT64                     Address,
+  IN UINT32                     Length,
+  IN CONST UINT8                *Buffer
+  )
+{
+  REPLAY_REGISTER_SPACE               *Replay;
+  CONST REGISTER_ACCESS_TRACE_RECORD  *Record;
+  UINT64                              Offset;
+  UINT64                              Value;
+  UINT32                              Index;
+
+  Replay = (REPLAY_REGISTER_SPACE*) RegisterSpace;
+
+  if (Replay->Mode == ReplayRegisterSpaceModeRelaxed) {
+    return EFI_SUCCESS;
+  }
+
+  Offset = Address;
+  while (Offset < Address + Length) {
+    Record = ReplayNextRecord (Replay);
+    if (Record == NULL || !ReplayIsWrite (Record->Type) ||
+        Record->Address != Offset ||
+        Offset + Record->Width > Address + Length) {
+      ReplayReportMismatch (Replay, "block write", Offset, (UINT32)(Address + Length - Offset), 0, Record);
+      return EFI_DEVICE_ERROR;
+    }
+
+    Value = 0;
+    for (Index = 0; Index < Record->Width; Index++) {
+      Value |= LShiftU64 (Buffer[Offset - Address + Index], Index * 8);
+    }
+    if ((Record->Value & REPLAY_VALUE_MASK (Record->Width)) != Value) {
+      ReplayReportMismatch (Replay, "block write", Offset, Record->Width, Value, Record);
+      return EFI_DEVICE_ERROR;
+    }
+
+    Replay->Cursor++;
+    Offset += Record->Width;
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+BOOLEAN
+ReplayIsSelected (
+  IN CONST BOOLEAN                       *Selected,
+  IN UINT32                              RegionCount,
+  IN CONST REGISTER_ACCESS_TRACE_RECORD  *Record
+  )
+{
+  return (Record->Region < RegionCount && Selected[Record->Region] &&
+          (ReplayIsRead (Record->Type) || ReplayIsWrite (Record->Type)));
+}
+
+STATIC
+EFI_STATUS
+ReplayLoadTrace (
+  IN REPLAY_REGISTER_SPACE  *Replay,
+  IN CONST CHAR8            *TraceFileName,
+  IN CONST CHAR8            *RegionName
+  )
+{
+  REGISTER_ACCESS_TRACE_READER        *Reader;
+  REGISTER_ACCESS_TRACE_RECORD        Record;
+  CONST REGISTER_ACCESS_TRACE_REGION  *Regions;
+  UINT32                              RegionCount;
+  BOOLEAN                             *Selected;
+  BOOLEAN                             Found;
+  UINT32                              Index;
+  UINT8                               Type;
+  EFI_STATUS                          Status;
+
+  Status = RegisterAccessTraceReaderOpen (TraceFileName, &Reader);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  RegisterAccessTraceReaderGetInfo (Reader, NULL, NULL, &Regions, &RegionCount);
+
+  //
+  // Same register space may be registered several times during the session
+  // and every registration gets its own region so select them all by name.
+  //
+  Selected = AllocateZeroPool (RegionCount * sizeof (BOOLEAN) + 1);
+  if (Selected == NULL) {
+    RegisterAccessTraceReaderClose (Reader);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Found = FALSE;
+  for (Index = 0; Index < RegionCount; Index++) {
+    Type = Regions[Index].Type;
+    if ((Type == RegisterAccessTraceRegionMmio || Type == RegisterAccessTraceRegionIo) &&
+        AsciiStrnCmp (Regions[Index].Name, RegionName, REGISTER_ACCESS_TRACE_REGION_NAME_LENGTH) == 0) {
+      Selected[Index] = TRUE;
+      Found = TRUE;
+    }
+  }
+  if (!Found) {
+    Status = EFI_NOT_FOUND;
+    goto Exit;
+  }
+
+  //
+  // Records are streamed twice, first to size the array and then to fill it,
+  // so compact traces don't have to be decoded in memory as a whole.
+  //
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  while (Status == EFI_SUCCESS) {
+    if (ReplayIsSelected (Selected, RegionCount, &Record)) {
+      Replay->RecordCount++;
+    }
+    Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  }
+  if (Status != EFI_END_OF_FILE) {
+    goto Exit;
+  }
+
+  if (Replay->RecordCount != 0) {
+    Replay->Records = AllocatePool (Replay->RecordCount * sizeof (REGISTER_ACCESS_TRACE_RECORD));
+    if (Replay->Records == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Exit;
+    }
+  }
+
+  Status = RegisterAccessTraceReaderSeek (Reader, 0);
+  if (EFI_ERROR (Status)) {
+    goto Exit;
+  }
+
+  Replay->RecordCount = 0;
+  Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  while (Status == EFI_SUCCESS) {
+    if (ReplayIsSelected (Selected, RegionCount, &Record)) {
+      Record.Address -= Regions[Record.Region].Base;
+      CopyMem (&Replay->Records[Replay->RecordCount++], &Record, sizeof (REGISTER_ACCESS_TRACE_RECORD));
+    }
+    Status = RegisterAccessTraceReaderNext (Reader, &Record);
+  }
+  if (Status != EFI_END_OF_FILE) {
+    goto Exit;
+  }
+
+  Status = EFI_SUCCESS;
+  if (Replay->Mode == ReplayRegisterSpaceModeRelaxed) {
+    Status = ReplayBuildReadIndex (Replay);
+  }
+
+Exit:
+  FreePool (Selected);
+  RegisterAccessTraceReaderClose (Reader);
+  return Status;
+}
+
+EFI_STATUS
+ReplayRegisterSpaceCreate (
+  IN CHAR16                      *RegisterSpaceDescription,
+  IN CONST CHAR8                 *TraceFileName,
+  IN CONST CHAR8                 *RegionName,
+  IN REPLAY_REGISTER_SPACE_MODE  Mode,
+  OUT REGISTER_ACCESS_INTERFACE  **RegisterSpace
+  )
+{
+  REPLAY_REGISTER_SPACE  *Replay;
+  EFI_STATUS             Status;
+
+  if (TraceFileName == NULL || RegionName == NULL || RegisterSpace == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Replay = AllocateZeroPool (sizeof (REPLAY_REGISTER_SPACE));
+  if (Replay == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Replay->RegisterSpace.Name = RegisterSpaceDescription;
+  Replay->RegisterSpace.Read = ReplayRegisterRead;
+  Replay->RegisterSpace.Write = ReplayRegisterWrite;
+  Replay->RegisterSpace.WriteBlock = ReplayRegisterWriteBlock;
+  Replay->Mode = Mode;
+
+  Status = ReplayLoadTrace (Replay, TraceFileName, RegionName);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed to load region %a from trace %a %r\n", RegionName, TraceFileName, Status));
+    ReplayRegisterSpaceDestroy (&Replay->RegisterSpace);
+    return Status;
+  }
+
+  *RegisterSpace = &Replay->RegisterSpace;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+ReplayRegisterSpaceGetStatus (
+  IN  REGISTER_ACCESS_INTERFACE  *RegisterSpace,
+  OUT UINT64                     *Remaining OPTIONAL,
+  OUT UINT64                     *Mismatches OPTIONAL
+  )
+{
+  REPLAY_REGISTER_SPACE  *Replay;
+
+  if (RegisterSpace == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Replay = (REPLAY_REGISTER_SPACE*) RegisterSpace;
+  if (Remaining != NULL) {
+    *Remaining = Replay->RecordCount - Replay->Cursor;
+  }
+  if (Mismatches != NULL) {
+    *Mismatches = Replay->Mismatches;
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+ReplayRegisterSpaceDestroy (
+  IN REGISTER_ACCESS_INTERFACE  *RegisterSpace
+  )
+{
+  REPLAY_REGISTER_SPACE  *Replay;
+
+  if (RegisterSpace == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Replay = (REPLAY_REGISTER_SPACE*) RegisterSpace;
+  if (Replay->Records != NULL) {
+    FreePool (Replay->Records);
+  }
+  if (Replay->ReadEntries != NULL) {
+    FreePool (Replay->ReadEntries);
+  }
+  if (Replay->Slots != NULL) {
+    FreePool (Replay->Slots);
+  }
+
+  FreePool (Replay);
+  return EFI_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,346 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/FakeRegisterSpaceLib.h>
+#include <Library/ReplayRegisterSpaceLib.h>
+#include <Library/RegisterAccessIoLib.h>
+
+#define UNIT_TEST_NAME     "ReplayRegisterSpaceLib unit tests"
+#define UNIT_TEST_VERSION  "0.1"
+
+#define REPLAY_TEST_DEVICE_NAME       L"ReplayTestDevice"
+#define REPLAY_TEST_DEVICE_NAME_ASCII "ReplayTestDevice"
+#define REPLAY_TEST_REPLAY_NAME       L"ReplayTestDeviceReplay"
+#define REPLAY_TEST_TRACE_FILE        "ReplayRegisterSpaceLibUnitTest.trace"
+#define REPLAY_TEST_COMPACT_FILE      "ReplayRegisterSpaceLibUnitTest.ctrace"
+#define REPLAY_TEST_DEVICE_ADDRESS    0x20000000
+#define REPLAY_TEST_DEVICE_SIZE       0x100
+
+#define REPLAY_TEST_STATUS_REG   0x0 // Counts up on every read
+#define REPLAY_TEST_CONTROL_REG  0x4 // RW
+#define REPLAY_TEST_ID_REG       0x8 // RO
+#define REPLAY_TEST_ID_VALUE     0x5A5AA5A5
+
+typedef struct {
+  UINT32  Status;
+  UINT32  Control;
+} REPLAY_TEST_DEVICE;
+
+VOID
+ReplayTestDeviceRead (
+  IN  VOID    *Context,
+  IN  UINT64  Address,
+  IN  UINT32  ByteEnable,
+  OUT UINT32  *Value
+  )
+{
+  REPLAY_TEST_DEVICE  *Device;
+
+  Device = (REPLAY_TEST_DEVICE*) Context;
+
+  switch (Address) {
+    case REPLAY_TEST_STATUS_REG:
+      Device->Status++;
+      *Value = Device->Status;
+      break;
+    case REPLAY_TEST_CONTROL_REG:
+      *Value = Device->Control;
+      break;
+    case REPLAY_TEST_ID_REG:
+      *Value = REPLAY_TEST_ID_VALUE;
+      break;
+    default:
+      *Value = 0xFFFFFFFF;
+      break;
+  }
+  *Value &= ByteEnableToBitMask (ByteEnable);
+}
+
+VOID
+ReplayTestDeviceWrite (
+  IN VOID    *Context,
+  IN UINT64  Address,
+  IN UINT32  ByteEnable,
+  IN UINT32  Value
+  )
+{
+  REPLAY_TEST_DEVICE  *Device;
+  UINT32              ByteMask;
+
+  Device = (REPLAY_TEST_DEVICE*) Context;
+  ByteMask = ByteEnableToBitMask (ByteEnable);
+
+  if (Address == REPLAY_TEST_CONTROL_REG) {
+    Device->Control &= ~ByteMask;
+    Device->Control |= (Value & ByteMask);
+  }
+}
+
+/**
+  Driver flow used by all tests. Returns sum of the values it read.
+**/
+UINT64
+ReplayTestDriverFlow (
+  VOID
+  )
+{
+  UINT64  Sum;
+
+  Sum = MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_ID_REG);
+  MmioWrite32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_CONTROL_REG, 0x1);
+  Sum += MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_STATUS_REG);
+  Sum += MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_STATUS_REG);
+  Sum += MmioRead8 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_CONTROL_REG);
+  MmioWrite32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_CONTROL_REG, 0x0);
+
+  return Sum;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ReplayTestRecordTrace (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                 Status;
+  REPLAY_TEST_DEVICE         Device;
+  REGISTER_ACCESS_INTERFACE  *RegisterSpace;
+  UINT64                     *ExpectedSum;
+
+  ExpectedSum = (UINT64*) Context;
+
+  ZeroMem (&Device, sizeof (Device));
+  Status = FakeRegisterSpaceCreate (REPLAY_TEST_DEVICE_NAME, FakeRegisterSpaceAlignmentDword, ReplayTestDeviceWrite, ReplayTestDeviceRead, &Device, &RegisterSpace);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = RegisterAccessIoRegisterMmioAtAddress (RegisterSpace, RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS, REPLAY_TEST_DEVICE_SIZE);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  RegisterAccessIoTraceReset ();
+  RegisterAccessIoTraceEnable (TRUE);
+  *ExpectedSum = ReplayTestDriverFlow ();
+  RegisterAccessIoTraceEnable (FALSE);
+
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS);
+  FakeRegisterSpaceDestroy (RegisterSpace);
+
+  Status = RegisterAccessIoTraceSave (REPLAY_TEST_TRACE_FILE);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = RegisterAccessIoTraceSaveCompact (REPLAY_TEST_COMPACT_FILE);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ReplayRegisterSpaceCreateTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                 Status;
+  REGISTER_ACCESS_INTERFACE  *RegisterSpace;
+
+  Status = ReplayRegisterSpaceCreate (REPLAY_TEST_REPLAY_NAME, REPLAY_TEST_TRACE_FILE, "NoSuchRegion", ReplayRegisterSpaceModeStrict, &RegisterSpace);
+  UT_ASSERT_EQUAL (Status, EFI_NOT_FOUND);
+
+  Status = ReplayRegisterSpaceCreate (REPLAY_TEST_REPLAY_NAME, "NoSuchFile.trace", REPLAY_TEST_DEVICE_NAME_ASCII, ReplayRegisterSpaceModeStrict, &RegisterSpace);
+  UT_ASSERT_EQUAL (Status, EFI_NOT_FOUND);
+
+  Status = ReplayRegisterSpaceCreate (REPLAY_TEST_REPLAY_NAME, REPLAY_TEST_TRACE_FILE, REPLAY_TEST_DEVICE_NAME_ASCII, ReplayRegisterSpaceModeStrict, &RegisterSpace);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Status = ReplayRegisterSpaceDestroy (RegisterSpace);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ReplayRegisterSpaceStrictTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                 Status;
+  REGISTER_ACCESS_INTERFACE  *RegisterSpace;
+  UINT64                     Sum;
+  UINT64                     Remaining;
+  UINT64                     Mismatches;
+
+  Status = ReplayRegisterSpaceCreate (REPLAY_TEST_REPLAY_NAME, REPLAY_TEST_TRACE_FILE, REPLAY_TEST_DEVICE_NAME_ASCII, ReplayRegisterSpaceModeStrict, &RegisterSpace);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoRegisterMmioAtAddress (RegisterSpace, RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS, REPLAY_TEST_DEVICE_SIZE);
+
+  Sum = ReplayTestDriverFlow ();
+  UT_ASSERT_EQUAL (Sum, *(UINT64*) Context);
+
+  ReplayRegisterSpaceGetStatus (RegisterSpace, &Remaining, &Mismatches);
+  UT_ASSERT_EQUAL (Remaining, 0);
+  UT_ASSERT_EQUAL (Mismatches, 0);
+
+  //
+  // Any access past the end of the trace diverges.
+  //
+  MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_ID_REG);
+  ReplayRegisterSpaceGetStatus (RegisterSpace, NULL, &Mismatches);
+  UT_ASSERT_EQUAL (Mismatches, 1);
+
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS);
+  ReplayRegisterSpaceDestroy (RegisterSpace);
+
+  //
+  // Write with a different value than recorded is reported and doesn't
+  // consume the record.
+  //
+  Status = ReplayRegisterSpaceCreate (REPLAY_TEST_REPLAY_NAME, REPLAY_TEST_TRACE_FILE, REPLAY_TEST_DEVICE_NAME_ASCII, ReplayRegisterSpaceModeStrict, &RegisterSpace);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoRegisterMmioAtAddress (RegisterSpace, RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS, REPLAY_TEST_DEVICE_SIZE);
+
+  UT_ASSERT_EQUAL (MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_ID_REG), REPLAY_TEST_ID_VALUE);
+  MmioWrite32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_CONTROL_REG, 0x2);
+  ReplayRegisterSpaceGetStatus (RegisterSpace, &Remaining, &Mismatches);
+  UT_ASSERT_EQUAL (Mismatches, 1);
+  UT_ASSERT_EQUAL (Remaining, 5);
+
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS);
+  ReplayRegisterSpaceDestroy (RegisterSpace);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ReplayRegisterSpaceCompactTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                 Status;
+  REGISTER_ACCESS_INTERFACE  *RegisterSpace;
+  UINT64                     Sum;
+  UINT64                     Remaining;
+  UINT64                     Mismatches;
+
+  Status = ReplayRegisterSpaceCreate (REPLAY_TEST_REPLAY_NAME, REPLAY_TEST_COMPACT_FILE, REPLAY_TEST_DEVICE_NAME_ASCII, ReplayRegisterSpaceModeStrict, &RegisterSpace);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoRegisterMmioAtAddress (RegisterSpace, RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS, REPLAY_TEST_DEVICE_SIZE);
+
+  Sum = ReplayTestDriverFlow ();
+  UT_ASSERT_EQUAL (Sum, *(UINT64*) Context);
+
+  ReplayRegisterSpaceGetStatus (RegisterSpace, &Remaining, &Mismatches);
+  UT_ASSERT_EQUAL (Remaining, 0);
+  UT_ASSERT_EQUAL (Mismatches, 0);
+
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS);
+  ReplayRegisterSpaceDestroy (RegisterSpace);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ReplayRegisterSpaceRelaxedTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                 Status;
+  REGISTER_ACCESS_INTERFACE  *RegisterSpace;
+  UINT64                     Mismatches;
+
+  Status = ReplayRegisterSpaceCreate (REPLAY_TEST_REPLAY_NAME, REPLAY_TEST_TRACE_FILE, REPLAY_TEST_DEVICE_NAME_ASCII, ReplayRegisterSpaceModeRelaxed, &RegisterSpace);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  RegisterAccessIoRegisterMmioAtAddress (RegisterSpace, RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS, REPLAY_TEST_DEVICE_SIZE);
+
+  //
+  // Reads of every address follow the recorded order independently of the
+  // order of accesses to other addresses. Last value sticks.
+  //
+  UT_ASSERT_EQUAL (MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_STATUS_REG), 1);
+  MmioWrite32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_CONTROL_REG, 0x2);
+  UT_ASSERT_EQUAL (MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_ID_REG), REPLAY_TEST_ID_VALUE);
+  UT_ASSERT_EQUAL (MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_STATUS_REG), 2);
+  UT_ASSERT_EQUAL (MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_STATUS_REG), 2);
+  UT_ASSERT_EQUAL (MmioRead8 (REPLAY_TEST_DEVICE_ADDRESS + REPLAY_TEST_CONTROL_REG), 1);
+
+  ReplayRegisterSpaceGetStatus (RegisterSpace, NULL, &Mismatches);
+  UT_ASSERT_EQUAL (Mismatches, 0);
+
+  MmioRead32 (REPLAY_TEST_DEVICE_ADDRESS + 0x10);
+  ReplayRegisterSpaceGetStatus (RegisterSpace, NULL, &Mismatches);
+  UT_ASSERT_EQUAL (Mismatches, 1);
+
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, REPLAY_TEST_DEVICE_ADDRESS);
+  ReplayRegisterSpaceDestroy (RegisterSpace);
+
+  return UNIT_TEST_PASSED;
+}
+
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      ReplayRegisterSpaceLibTest;
+  UINT64                      ExpectedSum;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    return Status;
+  }
+
+  Status = CreateUnitTestSuite (&ReplayRegisterSpaceLibTest, Framework, "ReplayRegisterSpaceLibUnitTests", "ReplayRegisterSpaceLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  AddTestCase (ReplayRegisterSpaceLibTest, "ReplayTestRecordTrace", "ReplayTestRecordTrace", ReplayTestRecordTrace, NULL, NULL, &ExpectedSum);
+  AddTestCase (ReplayRegisterSpaceLibTest, "ReplayRegisterSpaceCreateTest", "ReplayRegisterSpaceCreateTest", ReplayRegisterSpaceCreateTest, NULL, NULL, NULL);
+  AddTestCase (ReplayRegisterSpaceLibTest, "ReplayRegisterSpaceStrictTest", "ReplayRegisterSpaceStrictTest", ReplayRegisterSpaceStrictTest, NULL, NULL, &ExpectedSum);
+  AddTestCase (ReplayRegisterSpaceLibTest, "ReplayRegisterSpaceCompactTest", "ReplayRegisterSpaceCompactTest", ReplayRegisterSpaceCompactTest, NULL, NULL, &ExpectedSum);
+  AddTestCase (ReplayRegisterSpaceLibTest, "ReplayRegisterSpaceRelaxedTest", "ReplayRegisterSpaceRelaxedTest", ReplayRegisterSpaceRelaxedTest, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UefiTestMain ();
+}
\ No newline at end of file
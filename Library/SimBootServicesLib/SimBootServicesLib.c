@@ -0,0 +1,676 @@
+/** @file
+  Boot services events and timers running on the virtual time of
+  RegisterAccessIoLib.
+
+  Timers are scheduled on the virtual clock of the simulation context, so
+  timer notify functions interleave deterministically with device model
+  events and a driver waiting for a 1 second timeout returns as soon as the
+  host finishes running the events due within that second.
+
+  Expired timers only queue their notify functions, which run once the
+  virtual time callback returns. Stall advances the clock from one timer
+  expiration to the next and dispatches notifies in between, so a notify
+  function runs at the time its timer expired and can itself stall.
+
+  Events and TPL are kept per simulation context, every driver thread with a
+  context of its own has its own event queue.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/RegisterAccessIoLib.h>
+#include <Library/SimBootServicesLib.h>
+
+#define SIM_EVENT_SIGNATURE  SIGNATURE_32 ('s', 'e', 'v', 't')
+
+#define SIM_EVENT_SUPPORTED_TYPES  (EVT_TIMER | EVT_NOTIFY_WAIT | EVT_NOTIFY_SIGNAL)
+
+typedef struct {
+  LIST_ENTRY                      Link;
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *SimContext;
+  LIST_ENTRY                      Events;
+  LIST_ENTRY                      NotifyQueue;
+  EFI_TPL                         CurrentTpl;
+} SIM_BOOT_SERVICES_CONTEXT;
+
+typedef struct {
+  UINT32                     Signature;
+  SIM_BOOT_SERVICES_CONTEXT  *Context;
+  UINT32                     Type;
+  EFI_TPL                    NotifyTpl;
+  EFI_EVENT_NOTIFY           NotifyFunction;
+  VOID                       *NotifyContext;
+  BOOLEAN                    Signaled;
+  BOOLEAN                    NotifyPending;
+  EFI_TIMER_DELAY            TimerType;
+  UINT64                     TimerPeriod;
+  //
+  // Id of the virtual time event of the armed timer, 0 if timer isn't armed.
+  //
+  UINT64                     TimerEventId;
+  //
+  // Virtual time the armed timer expires at.
+  //
+  UINT64                     TimerExpiry;
+  LIST_ENTRY                 Link;
+  LIST_ENTRY                 NotifyLink;
+} SIM_EVENT;
+
+STATIC EFI_BOOT_SERVICES  *mBootServices = NULL;
+STATIC EFI_BOOT_SERVICES  mOriginalBootServices;
+STATIC LIST_ENTRY         mContexts;
+STATIC SPIN_LOCK          mContextsLock;
+
+/**
+  Recomputes checksum of the table after its services were replaced.
+**/
+STATIC
+VOID
+SimBootServicesUpdateCrc (
+  IN OUT EFI_BOOT_SERVICES  *BootServices
+  )
+{
+  BootServices->Hdr.CRC32 = 0;
+  BootServices->Hdr.CRC32 = CalculateCrc32 (BootServices, BootServices->Hdr.HeaderSize);
+}
+
+/**
+  Returns event state of the calling thread's simulation context, creating
+  it on first use.
+
+  @return Context state, NULL if it couldn't be allocated.
+**/
+STATIC
+SIM_BOOT_SERVICES_CONTEXT *
+SimBootServicesGetContext (
+  VOID
+  )
+{
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *SimContext;
+  SIM_BOOT_SERVICES_CONTEXT       *Context;
+  LIST_ENTRY                      *Entry;
+
+  SimContext = RegisterAccessIoSimContextGetCurrent ();
+  AcquireSpinLock (&mContextsLock);
+  for (Entry = GetFirstNode (&mContexts); !IsNull (&mContexts, Entry); Entry = GetNextNode (&mContexts, Entry)) {
+    Context = BASE_CR (Entry, SIM_BOOT_SERVICES_CONTEXT, Link);
+    if (Context->SimContext == SimContext) {
+      ReleaseSpinLock (&mContextsLock);
+      return Context;
+    }
+  }
+
+  Context = AllocateZeroPool (sizeof (SIM_BOOT_SERVICES_CONTEXT));
+  if (Context != NULL) {
+    Context->SimContext = SimContext;
+    InitializeListHead (&Context->Events);
+    InitializeListHead (&Context->NotifyQueue);
+    Context->CurrentTpl = TPL_APPLICATION;
+    InsertTailList (&mContexts, &Context->Link);
+  } else {
+    DEBUG ((DEBUG_ERROR, "Failed to allocate event state of the simulation context\n"));
+  }
+  ReleaseSpinLock (&mContextsLock);
+
+  return Context;
+}
+
+STATIC
+SIM_EVENT *
+SimEventFromHandle (
+  IN EFI_EVENT  Handle
+  )
+{
+  SIM_EVENT  *Event;
+
+  Event = (SIM_EVENT*) Handle;
+  if (Event == NULL || Event->Signature != SIM_EVENT_SIGNATURE) {
+    return NULL;
+  }
+  return Event;
+}
+
+/**
+  Runs queued notify functions whose notify TPL is above the current TPL,
+  highest TPL first. Each function runs at its own notify TPL.
+**/
+STATIC
+VOID
+SimEventDispatchNotifies (
+  IN SIM_BOOT_SERVICES_CONTEXT  *Context
+  )
+{
+  LIST_ENTRY  *Entry;
+  SIM_EVENT   *Event;
+  SIM_EVENT   *Next;
+  EFI_TPL     OldTpl;
+
+  while (TRUE) {
+    Next = NULL;
+    for (Entry = GetFirstNode (&Context->NotifyQueue); !IsNull (&Context->NotifyQueue, Entry); Entry = GetNextNode (&Context->NotifyQueue, Entry)) {
+      Event = BASE_CR (Entry, SIM_EVENT, NotifyLink);
+      if (Event->NotifyTpl > Context->CurrentTpl && (Next == NULL || Event->NotifyTpl > Next->NotifyTpl)) {
+        Next = Event;
+      }
+    }
+    if (Next == NULL) {
+      return;
+    }
+
+    RemoveEntryList (&Next->NotifyLink);
+    Next->NotifyPending = FALSE;
+    OldTpl = Context->CurrentTpl;
+    Context->CurrentTpl = Next->NotifyTpl;
+    Next->NotifyFunction ((EFI_EVENT) Next, Next->NotifyContext);
+    Context->CurrentTpl = OldTpl;
+  }
+}
+
+STATIC
+VOID
+SimEventQueueNotify (
+  IN SIM_EVENT  *Event
+  )
+{
+  if (!Event->NotifyPending) {
+    Event->NotifyPending = TRUE;
+    InsertTailList (&Event->Context->NotifyQueue, &Event->NotifyLink);
+  }
+}
+
+/**
+  Signals the event. Notify function of a signal event is only queued, the
+  caller dispatches it.
+**/
+STATIC
+VOID
+SimEventSignal (
+  IN SIM_EVENT  *Event
+  )
+{
+  if ((Event->Type & EVT_NOTIFY_SIGNAL) != 0) {
+    SimEventQueueNotify (Event);
+  } else {
+    Event->Signaled = TRUE;
+  }
+}
+
+/**
+  Virtual time callback of an armed timer. Notify function isn't run from
+  here, as the clock doesn't advance inside virtual time callbacks.
+**/
+STATIC
+VOID
+SimEventTimerExpired (
+  IN VOID  *Context
+  )
+{
+  SIM_EVENT  *Event;
+
+  Event = (SIM_EVENT*) Context;
+  Event->TimerEventId = 0;
+
+  //
+  // Periodic timer is rearmed before the notify function runs, since the
+  // function may cancel the timer or close the event.
+  //
+  if (Event->TimerType == TimerPeriodic) {
+    Event->TimerExpiry = RegisterAccessIoSimTimeGetNow () + Event->TimerPeriod;
+    RegisterAccessIoSimTimeSchedule (Event->TimerPeriod, SimEventTimerExpired, Event, &Event->TimerEventId);
+  }
+  SimEventSignal (Event);
+}
+
+STATIC
+VOID
+SimEventCancelTimer (
+  IN SIM_EVENT  *Event
+  )
+{
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *OldSimContext;
+
+  if (Event->TimerEventId != 0) {
+    //
+    // Timer is queued on the clock of the context the event belongs to.
+    //
+    OldSimContext = RegisterAccessIoSimContextGetCurrent ();
+    if (OldSimContext != Event->Context->SimContext) {
+      RegisterAccessIoSimContextSelect (Event->Context->SimContext);
+    }
+    RegisterAccessIoSimTimeCancel (Event->TimerEventId);
+    if (OldSimContext != Event->Context->SimContext) {
+      RegisterAccessIoSimContextSelect (OldSimContext);
+    }
+    Event->TimerEventId = 0;
+  }
+  Event->TimerType = TimerCancel;
+}
+
+STATIC
+EFI_TPL
+EFIAPI
+SimRaiseTpl (
+  IN EFI_TPL  NewTpl
+  )
+{
+  SIM_BOOT_SERVICES_CONTEXT  *Context;
+  EFI_TPL                    OldTpl;
+
+  Context = SimBootServicesGetContext ();
+  if (Context == NULL) {
+    return TPL_APPLICATION;
+  }
+
+  OldTpl = Context->CurrentTpl;
+  ASSERT (NewTpl >= OldTpl);
+  Context->CurrentTpl = NewTpl;
+  return OldTpl;
+}
+
+STATIC
+VOID
+EFIAPI
+SimRestoreTpl (
+  IN EFI_TPL  OldTpl
+  )
+{
+  SIM_BOOT_SERVICES_CONTEXT  *Context;
+
+  Context = SimBootServicesGetContext ();
+  if (Context == NULL) {
+    return;
+  }
+
+  ASSERT (OldTpl <= Context->CurrentTpl);
+  Context->CurrentTpl = OldTpl;
+  SimEventDispatchNotifies (Context);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SimCreateEvent (
+  IN  UINT32            Type,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction OPTIONAL,
+  IN  VOID              *NotifyContext OPTIONAL,
+  OUT EFI_EVENT         *Event
+  )
+{
+  SIM_BOOT_SERVICES_CONTEXT  *Context;
+  SIM_EVENT                  *SimEvent;
+
+  if (Event == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Type & ~SIM_EVENT_SUPPORTED_TYPES) != 0) {
+    DEBUG ((DEBUG_ERROR, "Event type %X not supported\n", Type));
+    return EFI_UNSUPPORTED;
+  }
+
+  if ((Type & (EVT_NOTIFY_WAIT | EVT_NOTIFY_SIGNAL)) != 0) {
+    if ((Type & (EVT_NOTIFY_WAIT | EVT_NOTIFY_SIGNAL)) == (EVT_NOTIFY_WAIT | EVT_NOTIFY_SIGNAL)) {
+      return EFI_INVALID_PARAMETER;
+    }
+    //
+    // Notify functions can't run at TPL_HIGH_LEVEL, same as in firmware.
+    //
+    if (NotifyFunction == NULL || NotifyTpl <= TPL_APPLICATION || NotifyTpl >= TPL_HIGH_LEVEL) {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  Context = SimBootServicesGetContext ();
+  if (Context == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  SimEvent = AllocateZeroPool (sizeof (SIM_EVENT));
+  if (SimEvent == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  SimEvent->Signature = SIM_EVENT_SIGNATURE;
+  SimEvent->Context = Context;
+  SimEvent->Type = Type;
+  SimEvent->NotifyTpl = NotifyTpl;
+  SimEvent->NotifyFunction = NotifyFunction;
+  SimEvent->NotifyContext = NotifyContext;
+  SimEvent->TimerType = TimerCancel;
+  InsertTailList (&Context->Events, &SimEvent->Link);
+
+  *Event = (EFI_EVENT) SimEvent;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SimCreateEventEx (
+  IN  UINT32            Type,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction OPTIONAL,
+  IN  CONST VOID        *NotifyContext OPTIONAL,
+  IN  CONST EFI_GUID    *EventGroup OPTIONAL,
+  OUT EFI_EVENT         *Event
+  )
+{
+  if (EventGroup != NULL) {
+    DEBUG ((DEBUG_ERROR, "Event groups not supported\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  return SimCreateEvent (Type, NotifyTpl, NotifyFunction, (VOID*) NotifyContext, Event);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SimSetTimer (
+  IN EFI_EVENT        Event,
+  IN EFI_TIMER_DELAY  Type,
+  IN UINT64           TriggerTime
+  )
+{
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *OldSimContext;
+  SIM_EVENT                       *SimEvent;
+  UINT64                          Delay;
+  EFI_STATUS                      Status;
+
+  SimEvent = SimEventFromHandle (Event);
+  if (SimEvent == NULL || (SimEvent->Type & EVT_TIMER) == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Type != TimerCancel && Type != TimerPeriodic && Type != TimerRelative) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SimEventCancelTimer (SimEvent);
+  if (Type == TimerCancel) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // TriggerTime is in 100 ns units.
+  //
+  if (TriggerTime > DivU64x32 (MAX_UINT64, 100)) {
+    Delay = MAX_UINT64;
+  } else {
+    Delay = MultU64x32 (TriggerTime, 100);
+  }
+  if (Delay == 0) {
+    Delay = SIM_BOOT_SERVICES_TIMER_TICK;
+  }
+
+  OldSimContext = RegisterAccessIoSimContextGetCurrent ();
+  if (OldSimContext != SimEvent->Context->SimContext) {
+    RegisterAccessIoSimContextSelect (SimEvent->Context->SimContext);
+  }
+  SimEvent->TimerExpiry = RegisterAccessIoSimTimeGetNow () + Delay;
+  if (SimEvent->TimerExpiry < Delay) {
+    SimEvent->TimerExpiry = MAX_UINT64;
+  }
+  Status = RegisterAccessIoSimTimeSchedule (Delay, SimEventTimerExpired, SimEvent, &SimEvent->TimerEventId);
+  if (OldSimContext != SimEvent->Context->SimContext) {
+    RegisterAccessIoSimContextSelect (OldSimContext);
+  }
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  SimEvent->TimerType = Type;
+  SimEvent->TimerPeriod = Delay;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SimSignalEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  SIM_EVENT  *SimEvent;
+
+  SimEvent = SimEventFromHandle (Event);
+  if (SimEvent == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SimEventSignal (SimEvent);
+  SimEventDispatchNotifies (SimEvent->Context);
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SimCheckEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  SIM_EVENT  *SimEvent;
+
+  SimEvent = SimEventFromHandle (Event);
+  if (SimEvent == NULL || (SimEvent->Type & EVT_NOTIFY_SIGNAL) != 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!SimEvent->Signaled && (SimEvent->Type & EVT_NOTIFY_WAIT) != 0) {
+    SimEventQueueNotify (SimEvent);
+    SimEventDispatchNotifies (SimEvent->Context);
+  }
+
+  if (SimEvent->Signaled) {
+    SimEvent->Signaled = FALSE;
+    return EFI_SUCCESS;
+  }
+
+  return EFI_NOT_READY;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SimWaitForEvent (
+  IN  UINTN      NumberOfEvents,
+  IN  EFI_EVENT  *Event,
+  OUT UINTN      *Index
+  )
+{
+  SIM_BOOT_SERVICES_CONTEXT  *Context;
+  EFI_STATUS                 Status;
+  UINTN                      EventIndex;
+
+  if (NumberOfEvents == 0 || Event == NULL || Index == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Context = SimBootServicesGetContext ();
+  if (Context == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Context->CurrentTpl != TPL_APPLICATION) {
+    return EFI_UNSUPPORTED;
+  }
+
+  while (TRUE) {
+    for (EventIndex = 0; EventIndex < NumberOfEvents; EventIndex++) {
+      Status = SimCheckEvent (Event[EventIndex]);
+      if (Status != EFI_NOT_READY) {
+        *Index = EventIndex;
+        return Status;
+      }
+    }
+
+    //
+    // Firmware would hang here forever, fail instead so the test can report it.
+    //
+    if (RegisterAccessIoSimTimeIsIdle ()) {
+      DEBUG ((DEBUG_ERROR, "WaitForEvent: No event can be signaled\n"));
+      return EFI_NOT_READY;
+    }
+
+    RegisterAccessIoSimTimeWait (MAX_UINT64);
+    SimEventDispatchNotifies (Context);
+  }
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SimCloseEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  SIM_EVENT  *SimEvent;
+
+  SimEvent = SimEventFromHandle (Event);
+  if (SimEvent == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SimEventCancelTimer (SimEvent);
+  if (SimEvent->NotifyPending) {
+    RemoveEntryList (&SimEvent->NotifyLink);
+  }
+  RemoveEntryList (&SimEvent->Link);
+  SimEvent->Signature = 0;
+  FreePool (SimEvent);
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SimStall (
+  IN UINTN  Microseconds
+  )
+{
+  SIM_BOOT_SERVICES_CONTEXT  *Context;
+  LIST_ENTRY                 *Entry;
+  SIM_EVENT                  *Event;
+  UINT64                     Now;
+  UINT64                     Start;
+  UINT64                     End;
+  UINT64                     Next;
+
+  Context = SimBootServicesGetContext ();
+  if (Context == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Advance to each timer expiration within the stall in turn, so notify
+  // functions run at the time their timer expired, outside of the virtual
+  // time callback.
+  //
+  Now = RegisterAccessIoSimTimeGetNow ();
+  End = Now + MultU64x32 (Microseconds, 1000);
+  while (TRUE) {
+    Next = End;
+    for (Entry = GetFirstNode (&Context->Events); !IsNull (&Context->Events, Entry); Entry = GetNextNode (&Context->Events, Entry)) {
+      Event = BASE_CR (Entry, SIM_EVENT, Link);
+      if (Event->TimerEventId != 0 && Event->TimerExpiry < Next) {
+        Next = Event->TimerExpiry;
+      }
+    }
+
+    Start = Now;
+    if (Next > Now) {
+      RegisterAccessIoSimTimeAdvance (Next - Now);
+    }
+    SimEventDispatchNotifies (Context);
+
+    //
+    // Clock doesn't advance when stalled from a virtual time callback.
+    //
+    Now = RegisterAccessIoSimTimeGetNow ();
+    if (Now >= End || Now == Start) {
+      return EFI_SUCCESS;
+    }
+  }
+}
+
+EFI_STATUS
+SimBootServicesInstall (
+  IN OUT EFI_BOOT_SERVICES  *BootServices
+  )
+{
+  if (BootServices == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mBootServices != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  InitializeListHead (&mContexts);
+  InitializeSpinLock (&mContextsLock);
+
+  CopyMem (&mOriginalBootServices, BootServices, sizeof (EFI_BOOT_SERVICES));
+  BootServices->RaiseTPL = SimRaiseTpl;
+  BootServices->RestoreTPL = SimRestoreTpl;
+  BootServices->CreateEvent = SimCreateEvent;
+  BootServices->CreateEventEx = SimCreateEventEx;
+  BootServices->SetTimer = SimSetTimer;
+  BootServices->WaitForEvent = SimWaitForEvent;
+  BootServices->SignalEvent = SimSignalEvent;
+  BootServices->CloseEvent = SimCloseEvent;
+  BootServices->CheckEvent = SimCheckEvent;
+  BootServices->Stall = SimStall;
+  SimBootServicesUpdateCrc (BootServices);
+  mBootServices = BootServices;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+SimBootServicesUninstall (
+  VOID
+  )
+{
+  SIM_BOOT_SERVICES_CONTEXT  *Context;
+  LIST_ENTRY                 *Entry;
+
+  if (mBootServices == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  while (!IsListEmpty (&mContexts)) {
+    Context = BASE_CR (GetFirstNode (&mContexts), SIM_BOOT_SERVICES_CONTEXT, Link);
+    while (!IsListEmpty (&Context->Events)) {
+      Entry = GetFirstNode (&Context->Events);
+      SimCloseEvent ((EFI_EVENT) BASE_CR (Entry, SIM_EVENT, Link));
+    }
+    RemoveEntryList (&Context->Link);
+    FreePool (Context);
+  }
+
+  mBootServices->RaiseTPL = mOriginalBootServices.RaiseTPL;
+  mBootServices->RestoreTPL = mOriginalBootServices.RestoreTPL;
+  mBootServices->CreateEvent = mOriginalBootServices.CreateEvent;
+  mBootServices->CreateEventEx = mOriginalBootServices.CreateEventEx;
+  mBootServices->SetTimer = mOriginalBootServices.SetTimer;
+  mBootServices->WaitForEvent = mOriginalBootServices.WaitForEvent;
+  mBootServices->SignalEvent = mOriginalBootServices.SignalEvent;
+  mBootServices->CloseEvent = mOriginalBootServices.CloseEvent;
+  mBootServices->CheckEvent = mOriginalBootServices.CheckEvent;
+  mBootServices->Stall = mOriginalBootServices.Stall;
+  SimBootServicesUpdateCrc (mBootServices);
+  mBootServices = NULL;
+
+  return EFI_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,411 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/SimBootServicesLib.h>
+#include <Library/FakeRegisterSpaceLib.h>
+#include <Library/RegisterAccessIoLib.h>
+
+#define UNIT_TEST_NAME     "SimBootServicesLib unit tests"
+#define UNIT_TEST_VERSION  "0.1"
+
+#define SIM_BS_TEST_DEVICE_NAME     L"SimBootServicesTestDevice"
+#define SIM_BS_TEST_DEVICE_ADDRESS  0x50000000
+#define SIM_BS_TEST_DEVICE_SIZE     0x100
+#define SIM_BS_TEST_READY_TIME      2000000
+
+#define SIM_BS_TEST_CONTROL_REG  0x0 // BIT0 starts the device
+#define SIM_BS_TEST_STATUS_REG   0x4 // BIT0 is set once device is ready
+
+typedef struct {
+  BOOLEAN                    Ready;
+  REGISTER_ACCESS_INTERFACE  *RegisterSpace;
+  UINT32                     NotifyCount;
+  EFI_TPL                    NotifyTpl;
+  UINT64                     NotifyTime;
+  UINT64                     StallTime;
+} SIM_BS_TEST_CONTEXT;
+
+STATIC EFI_BOOT_SERVICES  mTestBootServices;
+STATIC EFI_BOOT_SERVICES  *mBs = &mTestBootServices;
+
+VOID
+SimBsTestDeviceReady (
+  IN VOID  *Context
+  )
+{
+  ((SIM_BS_TEST_CONTEXT*) Context)->Ready = TRUE;
+}
+
+VOID
+SimBsTestDeviceRead (
+  IN  VOID    *Context,
+  IN  UINT64  Address,
+  IN  UINT32  ByteEnable,
+  OUT UINT32  *Value
+  )
+{
+  SIM_BS_TEST_CONTEXT  *Device;
+
+  Device = (SIM_BS_TEST_CONTEXT*) Context;
+  switch (Address) {
+    case SIM_BS_TEST_STATUS_REG:
+      *Value = Device->Ready ? BIT0 : 0;
+      break;
+    default:
+      *Value = 0;
+      break;
+  }
+  *Value &= ByteEnableToBitMask (ByteEnable);
+}
+
+VOID
+SimBsTestDeviceWrite (
+  IN VOID    *Context,
+  IN UINT64  Address,
+  IN UINT32  ByteEnable,
+  IN UINT32  Value
+  )
+{
+  if (Address == SIM_BS_TEST_CONTROL_REG && (Value & BIT0) != 0) {
+    RegisterAccessIoSimTimeSchedule (SIM_BS_TEST_READY_TIME, SimBsTestDeviceReady, Context, NULL);
+  }
+}
+
+VOID
+EFIAPI
+SimBsTestCountNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  SIM_BS_TEST_CONTEXT  *TestContext;
+
+  TestContext = (SIM_BS_TEST_CONTEXT*) Context;
+  TestContext->NotifyCount++;
+  TestContext->NotifyTpl = mBs->RaiseTPL (TPL_HIGH_LEVEL);
+  mBs->RestoreTPL (TestContext->NotifyTpl);
+  TestContext->NotifyTime = RegisterAccessIoSimTimeGetNow ();
+}
+
+VOID
+EFIAPI
+SimBsTestStallNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  SIM_BS_TEST_CONTEXT  *TestContext;
+  UINT64               Start;
+
+  TestContext = (SIM_BS_TEST_CONTEXT*) Context;
+  TestContext->NotifyCount++;
+  Start = RegisterAccessIoSimTimeGetNow ();
+  mBs->Stall (10);
+  TestContext->StallTime = RegisterAccessIoSimTimeGetNow () - Start;
+}
+
+VOID
+EFIAPI
+SimBsTestDeviceReadyNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  ((SIM_BS_TEST_CONTEXT*) Context)->NotifyCount++;
+  if ((MmioRead32 (SIM_BS_TEST_DEVICE_ADDRESS + SIM_BS_TEST_STATUS_REG) & BIT0) != 0) {
+    mBs->SignalEvent (Event);
+  }
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SimBsTestPrerequisite (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIM_BS_TEST_CONTEXT  *TestContext;
+  EFI_STATUS           Status;
+
+  TestContext = (SIM_BS_TEST_CONTEXT*) Context;
+  ZeroMem (TestContext, sizeof (SIM_BS_TEST_CONTEXT));
+  ZeroMem (&mTestBootServices, sizeof (mTestBootServices));
+  mTestBootServices.Hdr.HeaderSize = sizeof (mTestBootServices);
+  RegisterAccessIoSimTimeReset ();
+
+  Status = SimBootServicesInstall (mBs);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = FakeRegisterSpaceCreate (SIM_BS_TEST_DEVICE_NAME, FakeRegisterSpaceAlignmentDword, SimBsTestDeviceWrite, SimBsTestDeviceRead, TestContext, &TestContext->RegisterSpace);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = RegisterAccessIoRegisterMmioAtAddress (TestContext->RegisterSpace, RegisterAccessIoTypeMmio, SIM_BS_TEST_DEVICE_ADDRESS, SIM_BS_TEST_DEVICE_SIZE);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+VOID
+EFIAPI
+SimBsTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIM_BS_TEST_CONTEXT  *TestContext;
+
+  TestContext = (SIM_BS_TEST_CONTEXT*) Context;
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, SIM_BS_TEST_DEVICE_ADDRESS);
+  FakeRegisterSpaceDestroy (TestContext->RegisterSpace);
+  SimBootServicesUninstall ();
+  RegisterAccessIoSimTimeReset ();
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SimBootServicesTimerTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_EVENT                       Event;
+  EFI_EVENT                       NotifyEvent;
+  EFI_GUID                        Group;
+  UINT64                          Start;
+  UINTN                           Index;
+  UINT32                          Crc;
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *SimContext;
+  REGISTER_ACCESS_IO_SIM_CONTEXT  *OldSimContext;
+
+  UT_ASSERT_STATUS_EQUAL (SimBootServicesInstall (mBs), EFI_ALREADY_STARTED);
+  Crc = mBs->Hdr.CRC32;
+  mBs->Hdr.CRC32 = 0;
+  UT_ASSERT_EQUAL (CalculateCrc32 (mBs, mBs->Hdr.HeaderSize), Crc);
+  mBs->Hdr.CRC32 = Crc;
+  UT_ASSERT_STATUS_EQUAL (mBs->CreateEvent (EVT_NOTIFY_SIGNAL, TPL_HIGH_LEVEL, SimBsTestCountNotify, Context, &Event), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (mBs->CreateEvent (EVT_NOTIFY_SIGNAL, TPL_CALLBACK, NULL, NULL, &Event), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (mBs->CreateEvent (EVT_NOTIFY_SIGNAL, TPL_APPLICATION, SimBsTestCountNotify, Context, &Event), EFI_INVALID_PARAMETER);
+  ZeroMem (&Group, sizeof (Group));
+  UT_ASSERT_STATUS_EQUAL (mBs->CreateEventEx (0, TPL_CALLBACK, NULL, NULL, &Group, &Event), EFI_UNSUPPORTED);
+
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CreateEvent (EVT_NOTIFY_SIGNAL, TPL_CALLBACK, SimBsTestCountNotify, Context, &NotifyEvent));
+  UT_ASSERT_STATUS_EQUAL (mBs->CheckEvent (NotifyEvent), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (mBs->SetTimer (NotifyEvent, TimerRelative, 10), EFI_INVALID_PARAMETER);
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CloseEvent (NotifyEvent));
+
+  //
+  // Wait returns the moment the timer expires in virtual time.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CreateEvent (EVT_TIMER, 0, NULL, NULL, &Event));
+  Start = RegisterAccessIoSimTimeGetNow ();
+  UT_ASSERT_NOT_EFI_ERROR (mBs->SetTimer (Event, TimerRelative, 100000));
+  UT_ASSERT_STATUS_EQUAL (mBs->CheckEvent (Event), EFI_NOT_READY);
+  UT_ASSERT_NOT_EFI_ERROR (mBs->WaitForEvent (1, &Event, &Index));
+  UT_ASSERT_EQUAL (Index, 0);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow () - Start, 10000000);
+
+  //
+  // Waiting for a timer that isn't armed would hang forever.
+  //
+  UT_ASSERT_STATUS_EQUAL (mBs->WaitForEvent (1, &Event, &Index), EFI_NOT_READY);
+
+  //
+  // Timer set to 0 fires on the next tick.
+  //
+  Start = RegisterAccessIoSimTimeGetNow ();
+  UT_ASSERT_NOT_EFI_ERROR (mBs->SetTimer (Event, TimerRelative, 0));
+  UT_ASSERT_NOT_EFI_ERROR (mBs->WaitForEvent (1, &Event, &Index));
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow () - Start, SIM_BOOT_SERVICES_TIMER_TICK);
+
+  UT_ASSERT_NOT_EFI_ERROR (mBs->Stall (100));
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow () - Start, SIM_BOOT_SERVICES_TIMER_TICK + 100000);
+
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CloseEvent (Event));
+  UT_ASSERT_STATUS_EQUAL (mBs->CloseEvent (NULL), EFI_INVALID_PARAMETER);
+
+  //
+  // TPL is kept per simulation context.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimContextCreate (&SimContext));
+  OldSimContext = RegisterAccessIoSimContextSelect (SimContext);
+  UT_ASSERT_EQUAL (mBs->RaiseTPL (TPL_NOTIFY), TPL_APPLICATION);
+  RegisterAccessIoSimContextSelect (OldSimContext);
+  UT_ASSERT_EQUAL (mBs->RaiseTPL (TPL_CALLBACK), TPL_APPLICATION);
+  mBs->RestoreTPL (TPL_APPLICATION);
+  RegisterAccessIoSimContextSelect (SimContext);
+  UT_ASSERT_EQUAL (mBs->RaiseTPL (TPL_NOTIFY), TPL_NOTIFY);
+  mBs->RestoreTPL (TPL_APPLICATION);
+  RegisterAccessIoSimContextSelect (OldSimContext);
+  UT_ASSERT_NOT_EFI_ERROR (RegisterAccessIoSimContextDestroy (SimContext));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SimBootServicesPeriodicNotifyTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIM_BS_TEST_CONTEXT  *TestContext;
+  EFI_EVENT            Event;
+  EFI_EVENT            StallEvent;
+  EFI_TPL              OldTpl;
+  UINTN                Index;
+  UINT64               Start;
+
+  TestContext = (SIM_BS_TEST_CONTEXT*) Context;
+
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, SimBsTestCountNotify, Context, &Event));
+  Start = RegisterAccessIoSimTimeGetNow ();
+  UT_ASSERT_NOT_EFI_ERROR (mBs->SetTimer (Event, TimerPeriodic, 10000));
+
+  //
+  // Notify function runs at its TPL, at the time each period expires.
+  //
+  mBs->Stall (3500);
+  UT_ASSERT_EQUAL (TestContext->NotifyCount, 3);
+  UT_ASSERT_EQUAL (TestContext->NotifyTpl, TPL_CALLBACK);
+  UT_ASSERT_EQUAL (TestContext->NotifyTime - Start, 3000000);
+
+  //
+  // Notify is held off while TPL is raised and runs once it is restored.
+  //
+  OldTpl = mBs->RaiseTPL (TPL_NOTIFY);
+  UT_ASSERT_EQUAL (OldTpl, TPL_APPLICATION);
+  mBs->Stall (1000);
+  UT_ASSERT_EQUAL (TestContext->NotifyCount, 3);
+  UT_ASSERT_STATUS_EQUAL (mBs->WaitForEvent (1, &Event, &Index), EFI_UNSUPPORTED);
+  mBs->RestoreTPL (OldTpl);
+  UT_ASSERT_EQUAL (TestContext->NotifyCount, 4);
+
+  UT_ASSERT_NOT_EFI_ERROR (mBs->SetTimer (Event, TimerCancel, 0));
+  mBs->Stall (5000);
+  UT_ASSERT_EQUAL (TestContext->NotifyCount, 4);
+
+  //
+  // Notify function runs outside of the virtual time callback so it can stall.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, SimBsTestStallNotify, Context, &StallEvent));
+  Start = RegisterAccessIoSimTimeGetNow ();
+  UT_ASSERT_NOT_EFI_ERROR (mBs->SetTimer (StallEvent, TimerRelative, 10));
+  mBs->Stall (100);
+  UT_ASSERT_EQUAL (TestContext->NotifyCount, 5);
+  UT_ASSERT_EQUAL (TestContext->StallTime, 10000);
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow () - Start, 100000);
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CloseEvent (StallEvent));
+  TestContext->NotifyCount = 4;
+
+  UT_ASSERT_NOT_EFI_ERROR (mBs->SignalEvent (Event));
+  UT_ASSERT_EQUAL (TestContext->NotifyCount, 5);
+
+  //
+  // Events left open are closed on uninstall.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (mBs->SetTimer (Event, TimerPeriodic, 10000));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SimBootServicesDeviceWaitTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIM_BS_TEST_CONTEXT  *TestContext;
+  EFI_EVENT            Events[2];
+  UINTN                Index;
+  UINT64               Start;
+
+  TestContext = (SIM_BS_TEST_CONTEXT*) Context;
+
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CreateEvent (EVT_NOTIFY_WAIT, TPL_CALLBACK, SimBsTestDeviceReadyNotify, Context, &Events[0]));
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CreateEvent (EVT_TIMER, 0, NULL, NULL, &Events[1]));
+
+  //
+  // Driver waits for the device with a 5 ms timeout. Device gets ready first
+  // and the wait takes no longer than the device needs.
+  //
+  MmioWrite32 (SIM_BS_TEST_DEVICE_ADDRESS + SIM_BS_TEST_CONTROL_REG, BIT0);
+  Start = RegisterAccessIoSimTimeGetNow ();
+  UT_ASSERT_NOT_EFI_ERROR (mBs->SetTimer (Events[1], TimerRelative, 50000));
+  UT_ASSERT_NOT_EFI_ERROR (mBs->WaitForEvent (2, Events, &Index));
+  UT_ASSERT_EQUAL (Index, 0);
+  UT_ASSERT_TRUE (RegisterAccessIoSimTimeGetNow () - Start >= SIM_BS_TEST_READY_TIME);
+  UT_ASSERT_TRUE (RegisterAccessIoSimTimeGetNow () - Start < 5000000);
+  UT_ASSERT_TRUE (TestContext->NotifyCount >= 2);
+
+  //
+  // Device stays ready so notify signals the event again, timeout still expires on time.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CheckEvent (Events[0]));
+  UT_ASSERT_NOT_EFI_ERROR (mBs->WaitForEvent (1, &Events[1], &Index));
+  UT_ASSERT_EQUAL (RegisterAccessIoSimTimeGetNow () - Start, 5000000);
+
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CloseEvent (Events[0]));
+  UT_ASSERT_NOT_EFI_ERROR (mBs->CloseEvent (Events[1]));
+
+  return UNIT_TEST_PASSED;
+}
+
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SimBootServicesLibTest;
+  SIM_BS_TEST_CONTEXT         TestContext;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    return Status;
+  }
+
+  Status = CreateUnitTestSuite (&SimBootServicesLibTest, Framework, "SimBootServicesLibUnitTests", "SimBootServicesLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  AddTestCase (SimBootServicesLibTest, "SimBootServicesTimerTest", "SimBootServicesTimerTest", SimBootServicesTimerTest, SimBsTestPrerequisite, SimBsTestCleanup, &TestContext);
+  AddTestCase (SimBootServicesLibTest, "SimBootServicesPeriodicNotifyTest", "SimBootServicesPeriodicNotifyTest", SimBootServicesPeriodicNotifyTest, SimBsTestPrerequisite, SimBsTestCleanup, &TestContext);
+  AddTestCase (SimBootServicesLibTest, "SimBootServicesDeviceWaitTest", "SimBootServicesDeviceWaitTest", SimBootServicesDeviceWaitTest, SimBsTestPrerequisite, SimBsTestCleanup, &TestContext);
+
+  Status = RunAllTestSuites (Framework);
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UefiTestMain ();
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+/** @file
+  TimerLib running on the virtual time of RegisterAccessIoLib.
+
+  Delays advance the virtual clock of the calling thread's simulation context
+  instantly and run device events which become due, so delay heavy driver
+  code runs at host speed while device models see consistent time.
+  Performance counter counts virtual nanoseconds.
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseLib.h>
+#include <Library/TimerLib.h>
+#include <Library/RegisterAccessIoLib.h>
+
+#define SIM_TIMER_FREQUENCY  1000000000ULL
+
+UINTN
+EFIAPI
+MicroSecondDelay (
+  IN UINTN  MicroSeconds
+  )
+{
+  RegisterAccessIoSimTimeAdvance (MultU64x32 (MicroSeconds, 1000));
+  return MicroSeconds;
+}
+
+UINTN
+EFIAPI
+NanoSecondDelay (
+  IN UINTN  NanoSeconds
+  )
+{
+  RegisterAccessIoSimTimeAdvance (NanoSeconds);
+  return NanoSeconds;
+}
+
+UINT64
+EFIAPI
+GetPerformanceCounter (
+  VOID
+  )
+{
+  return RegisterAccessIoSimTimeGetNow ();
+}
+
+UINT64
+EFIAPI
+GetPerformanceCounterProperties (
+  OUT UINT64  *StartValue OPTIONAL,
+  OUT UINT64  *EndValue OPTIONAL
+  )
+{
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+
+  if (EndValue != NULL) {
+    *EndValue = MAX_UINT64;
+  }
+
+  return SIM_TIMER_FREQUENCY;
+}
+
+UINT64
+EFIAPI
+GetTimeInNanoSecond (
+  IN UINT64  Ticks
+  )
+{
+  return Ticks;
+}
\ No newline at end of file
@@ -0,0 +1,227 @@
+/** @file
+
+Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/TimerLib.h>
+#include <Library/FakeRegisterSpaceLib.h>
+#include <Library/RegisterAccessIoLib.h>
+
+#define UNIT_TEST_NAME     "SimTimerLib unit tests"
+#define UNIT_TEST_VERSION  "0.1"
+
+#define SIM_TIMER_TEST_DEVICE_NAME     L"SimTimerTestDevice"
+#define SIM_TIMER_TEST_DEVICE_ADDRESS  0x50000000
+#define SIM_TIMER_TEST_DEVICE_SIZE     0x100
+#define SIM_TIMER_TEST_RESET_TIME      1000000
+
+#define SIM_TIMER_TEST_CONTROL_REG  0x0 // BIT0 starts reset and stays set until reset completes
+
+typedef struct {
+  BOOLEAN                    InReset;
+  UINT64                     ResetDoneTime;
+  REGISTER_ACCESS_INTERFACE  *RegisterSpace;
+} SIM_TIMER_TEST_DEVICE;
+
+VOID
+SimTimerTestResetDone (
+  IN VOID  *Context
+  )
+{
+  SIM_TIMER_TEST_DEVICE  *Device;
+
+  Device = (SIM_TIMER_TEST_DEVICE*) Context;
+  Device->InReset = FALSE;
+  Device->ResetDoneTime = RegisterAccessIoSimTimeGetNow ();
+}
+
+VOID
+SimTimerTestDeviceRead (
+  IN  VOID    *Context,
+  IN  UINT64  Address,
+  IN  UINT32  ByteEnable,
+  OUT UINT32  *Value
+  )
+{
+  SIM_TIMER_TEST_DEVICE  *Device;
+
+  Device = (SIM_TIMER_TEST_DEVICE*) Context;
+  switch (Address) {
+    case SIM_TIMER_TEST_CONTROL_REG:
+      *Value = Device->InReset ? BIT0 : 0;
+      break;
+    default:
+      *Value = 0xFFFFFFFF;
+      break;
+  }
+  *Value &= ByteEnableToBitMask (ByteEnable);
+}
+
+VOID
+SimTimerTestDeviceWrite (
+  IN VOID    *Context,
+  IN UINT64  Address,
+  IN UINT32  ByteEnable,
+  IN UINT32  Value
+  )
+{
+  SIM_TIMER_TEST_DEVICE  *Device;
+
+  Device = (SIM_TIMER_TEST_DEVICE*) Context;
+  if (Address == SIM_TIMER_TEST_CONTROL_REG && (Value & BIT0) != 0 && !Device->InReset) {
+    Device->InReset = TRUE;
+    RegisterAccessIoSimTimeSchedule (SIM_TIMER_TEST_RESET_TIME, SimTimerTestResetDone, Device, NULL);
+  }
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SimTimerTestPrerequisite (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIM_TIMER_TEST_DEVICE  *Device;
+  EFI_STATUS             Status;
+
+  Device = (SIM_TIMER_TEST_DEVICE*) Context;
+  ZeroMem (Device, sizeof (SIM_TIMER_TEST_DEVICE));
+  RegisterAccessIoSimTimeReset ();
+
+  Status = FakeRegisterSpaceCreate (SIM_TIMER_TEST_DEVICE_NAME, FakeRegisterSpaceAlignmentDword, SimTimerTestDeviceWrite, SimTimerTestDeviceRead, Device, &Device->RegisterSpace);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Status = RegisterAccessIoRegisterMmioAtAddress (Device->RegisterSpace, RegisterAccessIoTypeMmio, SIM_TIMER_TEST_DEVICE_ADDRESS, SIM_TIMER_TEST_DEVICE_SIZE);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+VOID
+EFIAPI
+SimTimerTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIM_TIMER_TEST_DEVICE  *Device;
+
+  Device = (SIM_TIMER_TEST_DEVICE*) Context;
+  RegisterAccessIoUnRegisterMmioAtAddress (RegisterAccessIoTypeMmio, SIM_TIMER_TEST_DEVICE_ADDRESS);
+  FakeRegisterSpaceDestroy (Device->RegisterSpace);
+  RegisterAccessIoSimTimeReset ();
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SimTimerCounterTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64  Start;
+  UINT64  End;
+  UINT64  Counter;
+
+  UT_ASSERT_EQUAL (GetPerformanceCounterProperties (&Start, &End), 1000000000);
+  UT_ASSERT_EQUAL (Start, 0);
+  UT_ASSERT_EQUAL (End, MAX_UINT64);
+  UT_ASSERT_EQUAL (GetTimeInNanoSecond (1234), 1234);
+
+  //
+  // Delays move the counter by exactly the time requested.
+  //
+  Counter = GetPerformanceCounter ();
+  UT_ASSERT_EQUAL (Counter, RegisterAccessIoSimTimeGetNow ());
+  UT_ASSERT_EQUAL (MicroSecondDelay (10), 10);
+  UT_ASSERT_EQUAL (GetPerformanceCounter () - Counter, 10000);
+  UT_ASSERT_EQUAL (NanoSecondDelay (500), 500);
+  UT_ASSERT_EQUAL (GetPerformanceCounter () - Counter, 10500);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SimTimerDeviceEventTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIM_TIMER_TEST_DEVICE  *Device;
+  UINT64                 Start;
+
+  Device = (SIM_TIMER_TEST_DEVICE*) Context;
+
+  //
+  // Reset completes only once the driver waited long enough.
+  //
+  MmioWrite32 (SIM_TIMER_TEST_DEVICE_ADDRESS + SIM_TIMER_TEST_CONTROL_REG, BIT0);
+  Start = GetPerformanceCounter ();
+  MicroSecondDelay (SIM_TIMER_TEST_RESET_TIME / 1000 / 2);
+  UT_ASSERT_EQUAL (MmioRead32 (SIM_TIMER_TEST_DEVICE_ADDRESS + SIM_TIMER_TEST_CONTROL_REG) & BIT0, BIT0);
+  MicroSecondDelay (SIM_TIMER_TEST_RESET_TIME / 1000);
+  UT_ASSERT_EQUAL (MmioRead32 (SIM_TIMER_TEST_DEVICE_ADDRESS + SIM_TIMER_TEST_CONTROL_REG) & BIT0, 0);
+
+  //
+  // Event ran at its own time, not at the end of the delay.
+  //
+  UT_ASSERT_TRUE (Device->ResetDoneTime - Start <= SIM_TIMER_TEST_RESET_TIME);
+  UT_ASSERT_TRUE (GetPerformanceCounter () - Start >= SIM_TIMER_TEST_RESET_TIME + SIM_TIMER_TEST_RESET_TIME / 2);
+
+  return UNIT_TEST_PASSED;
+}
+
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SimTimerLibTest;
+  SIM_TIMER_TEST_DEVICE       Device;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    return Status;
+  }
+
+  Status = CreateUnitTestSuite (&SimTimerLibTest, Framework, "SimTimerLibUnitTests", "SimTimerLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  AddTestCase (SimTimerLibTest, "SimTimerCounterTest", "SimTimerCounterTest", SimTimerCounterTest, SimTimerTestPrerequisite, SimTimerTestCleanup, &Device);
+  AddTestCase (SimTimerLibTest, "SimTimerDeviceEventTest", "SimTimerDeviceEventTest", SimTimerDeviceEventTest, SimTimerTestPrerequisite, SimTimerTestCleanup, &Device);
+
+  Status = RunAllTestSuites (Framework);
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UefiTestMain ();
+}
\ No newline at end of file